@@ -0,0 +1,29 @@
+#include <cstdlib>
+#include <atomic>
+#include <new>
+
+#include "AllocCounter.hpp"
+
+
+/// Счётчик выделений памяти всего процесса.
+static std::atomic<size_t> g_allocs(0);
+
+
+void* operator new(std::size_t size_) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    void *p = std::malloc(size_ ? size_ : 1);
+    if (not p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+
+void operator delete(void *p_) noexcept {
+    std::free(p_);
+}
+
+
+size_t bench::allocCount() {
+    return g_allocs.load(std::memory_order_relaxed);
+}
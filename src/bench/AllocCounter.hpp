@@ -0,0 +1,19 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Подсчёт выделений памяти процесса для замеров: замещает глобальные operator new/delete.
+ * \author Величко Ростислав
+ * \date   07.17.2017
+ */
+
+#pragma once
+
+#include <cstddef>
+
+
+namespace bench {
+
+/**
+ * \brief Метод возвращает количество вызовов operator new с начала работы процесса.
+ *        Обращение к методу подключает замещающие операторы из библиотеки bench_alloc.
+ */
+size_t allocCount();
+} /// bench
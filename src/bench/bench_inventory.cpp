@@ -0,0 +1,312 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Замер длительности и пропускной способности циклов инвенторизации RfidController на эмуляторе считывателя.
+ * \author Величко Ростислав
+ * \date   07.17.2017
+ */
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include <boost/program_options.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "Log.hpp"
+#include "AllocCounter.hpp"
+#include "ReaderEmulator.hpp"
+#include "RfidController.hpp"
+
+
+namespace bpo = boost::program_options;
+namespace chr = std::chrono;
+
+typedef robocooler::rfid::ReaderEmulator ReaderEmulator;
+typedef robocooler::driver::RfidController RfidController;
+typedef std::chrono::steady_clock Clock;
+
+
+static const size_t BENCH_MAX_BUFFER_CYCLES = 255;  ///< Ограничение счётчика циклов RfidController::inventory.
+static const size_t BENCH_RUN_TIMEOUT = 600;        ///< Предельная длительность одного замера [с].
+
+
+namespace {
+
+/**
+ * \brief Показания счётчиков на границе замера.
+ */
+struct Snapshot {
+    Clock::time_point _time;
+    double _cpu;        ///< Процессорное время процесса [с].
+    double _emu_cpu;    ///< Процессорное время потока эмулятора [с].
+    size_t _allocs;     ///< Выделений памяти.
+    size_t _bytes;      ///< Байт, переданных по линии в обе стороны.
+    size_t _tags;       ///< Переданных пакетов меток.
+};
+
+
+/**
+ * \brief Результат замера одного режима при одном количестве меток.
+ */
+struct Result {
+    std::string _mode;
+    size_t _tags;
+    size_t _cycles;
+    double _p50_ms;
+    double _p99_ms;
+    double _mean_ms;
+    double _tags_per_s;
+    double _bytes_per_s;
+    double _cpu_pct;
+    double _allocs_per_cycle;
+};
+
+
+double processCpu() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return static_cast<double>(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) +
+           static_cast<double>(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+
+/**
+ * \brief Наблюдатель циклов опроса: фиксирует моменты завершения циклов и счётчики на границах замера.
+ *        Вызывается из потока инвенторизации и не выделяет память.
+ */
+class CycleProbe {
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    ReaderEmulator *_emu;
+    size_t _warmup;                       ///< Циклов прогрева, не входящих в замер.
+    size_t _cycles;                       ///< Циклов замера.
+    std::vector<Clock::time_point> _stamps; ///< Момент запуска и моменты завершения циклов.
+    Snapshot _begin;
+    Snapshot _end;
+
+    Snapshot snapshot(const Clock::time_point &now_) {
+        Snapshot snap;
+        snap._time = now_;
+        snap._cpu = processCpu();
+        snap._emu_cpu = _emu->getCpuTime();
+        snap._allocs = bench::allocCount();
+        snap._bytes = _emu->getBytesIn() + _emu->getBytesOut();
+        snap._tags = _emu->getTagsOut();
+        return snap;
+    }
+
+public:
+    CycleProbe(ReaderEmulator *emu_, size_t warmup_, size_t cycles_)
+        : _emu(emu_)
+        , _warmup(warmup_)
+        , _cycles(cycles_) {
+        _stamps.reserve(warmup_ + cycles_ + 1);
+        _stamps.push_back(Clock::now());
+        if (not _warmup) {
+            _begin = snapshot(_stamps.front());
+        }
+    }
+
+    void onCycle(size_t) {
+        Clock::time_point now = Clock::now();
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_stamps.size() > _warmup + _cycles) {
+            return;
+        }
+        _stamps.push_back(now);
+        size_t done = _stamps.size() - 1;
+        if (done == _warmup) {
+            _begin = snapshot(now);
+        }
+        if (done == _warmup + _cycles) {
+            _end = snapshot(now);
+            _cond.notify_all();
+        }
+    }
+
+    bool wait(size_t timeout_sec_) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        return _cond.wait_for(lock, chr::seconds(timeout_sec_), [this] {
+            return _stamps.size() > _warmup + _cycles;
+        });
+    }
+
+    void fill(Result &res_) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        std::vector<double> durs;
+        for (size_t i = _warmup; i + 1 < _stamps.size(); ++i) {
+            durs.push_back(chr::duration<double, std::milli>(_stamps[i + 1] - _stamps[i]).count());
+        }
+        std::sort(durs.begin(), durs.end());
+        /// Процентили по ближайшему рангу.
+        auto rank = [&durs](double p_) {
+            size_t r = static_cast<size_t>(p_ * static_cast<double>(durs.size()) + 0.999999);
+            return durs[std::min(std::max<size_t>(r, 1), durs.size()) - 1];
+        };
+        double wall = chr::duration<double>(_end._time - _begin._time).count();
+        res_._cycles = durs.size();
+        res_._p50_ms = rank(0.5);
+        res_._p99_ms = rank(0.99);
+        res_._mean_ms = wall * 1000.0 / static_cast<double>(durs.size());
+        res_._tags_per_s = static_cast<double>(_end._tags - _begin._tags) / wall;
+        res_._bytes_per_s = static_cast<double>(_end._bytes - _begin._bytes) / wall;
+        /// Поток эмулятора изображает считыватель и в загрузку драйвера не входит.
+        res_._cpu_pct = ((_end._cpu - _begin._cpu) - (_end._emu_cpu - _begin._emu_cpu)) * 100.0 / wall;
+        res_._allocs_per_cycle = static_cast<double>(_end._allocs - _begin._allocs) / static_cast<double>(durs.size());
+    }
+};
+
+
+std::string toJson(const Result &res_, const ReaderEmulator::Settings &sets_) {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3)
+       << "{\"bench\":\"inventory\""
+       << ",\"mode\":\"" << res_._mode << "\""
+       << ",\"tags\":" << res_._tags
+       << ",\"cycles\":" << res_._cycles
+       << ",\"bytes_per_sec_limit\":" << sets_._bytes_per_sec
+       << ",\"round_ms\":" << sets_._round_ms
+       << ",\"p50_ms\":" << res_._p50_ms
+       << ",\"p99_ms\":" << res_._p99_ms
+       << ",\"mean_ms\":" << res_._mean_ms
+       << ",\"tags_per_s\":" << res_._tags_per_s
+       << ",\"bytes_per_s\":" << res_._bytes_per_s
+       << ",\"cpu_pct\":" << res_._cpu_pct
+       << ",\"allocs_per_cycle\":" << res_._allocs_per_cycle
+       << "}";
+    return ss.str();
+}
+
+
+/**
+ * \brief Метод выполняет замер режима опроса mode_ на эмуляторе с настройками sets_.
+ * \return false, если считыватель не инициализирован или циклы не завершились за отведённое время.
+ */
+bool runBench(const std::string &mode_, const ReaderEmulator::Settings &sets_,
+              size_t warmup_, size_t cycles_, Result &res_) {
+    if (mode_ not_eq "buffer" and mode_ not_eq "stream" and mode_ not_eq "session") {
+        LOG(ERROR) << "Unknown mode: " << mode_;
+        return false;
+    }
+    ReaderEmulator emu(sets_);
+    if (not emu.isInit()) {
+        LOG(ERROR) << emu.what();
+        return false;
+    }
+    RfidController rfidc(nullptr, emu.getSlaveName(), 0, 1, 1);
+    if (not rfidc.isInited()) {
+        LOG(ERROR) << "Can`t init controller on " << emu.getSlaveName();
+        return false;
+    }
+    if (mode_ == "stream") {
+        rfidc.setSessionSettings(0, 1);
+    }
+    if (mode_ == "buffer") {
+        cycles_ = std::min(cycles_, BENCH_MAX_BUFFER_CYCLES - warmup_);
+    }
+    CycleProbe probe(&emu, warmup_, cycles_);
+    rfidc.setCycleObserver([&probe](size_t tags_num_) {
+        probe.onCycle(tags_num_);
+    });
+    if (mode_ == "buffer") {
+        rfidc.inventory(warmup_ + cycles_);
+    } else {
+        rfidc.startInventory();
+    }
+    bool is_done = probe.wait(BENCH_RUN_TIMEOUT);
+    rfidc.stopInventory();
+    rfidc.setCycleObserver(nullptr);
+    if (not is_done) {
+        LOG(ERROR) << "Timeout: " << mode_ << " " << sets_._tags_num;
+        return false;
+    }
+    res_._mode = mode_;
+    res_._tags = sets_._tags_num;
+    probe.fill(res_);
+    return true;
+}
+} /// namespace
+
+
+/// bench-inventory -t 10,100 -m stream,session -c 20 -o bench.jsonl
+
+
+int main(int argc, char **argv) {
+    LOG_TOGGLE(DEBUG, false);
+    LOG_TOGGLE(TRACE, false);
+    LOG_TOGGLE(INFO, false);
+    try {
+        ReaderEmulator::Settings sets = ReaderEmulator::defaultSettings();
+        std::string tags;
+        std::string modes;
+        std::string out_file;
+        size_t cycles;
+        size_t warmup;
+        size_t baud;
+        bpo::options_description desc("Замер циклов инвенторизации RfidController на эмуляторе считывателя.\n" \
+                                      "Результат каждого замера выводится строкой JSON.\n" \
+                                      "Пример запуска: \"./bench-inventory -t 10,100,500,2000 -c 20 -o bench.jsonl\"");
+        desc.add_options()
+          ("help,h", "Показать список параметров")
+          ("tags,t", bpo::value<std::string>(&tags)->default_value("10,100,500,2000"), "Количества меток в шкафу")
+          ("modes,m", bpo::value<std::string>(&modes)->default_value("buffer,stream,session"),
+                      "Режимы опроса: buffer - inventory(), stream - потоковый, session - по сессии S2")
+          ("cycles,c", bpo::value<size_t>(&cycles)->default_value(10), "Циклов замера")
+          ("warmup,w", bpo::value<size_t>(&warmup)->default_value(1), "Циклов прогрева")
+          ("baud,b", bpo::value<size_t>(&baud)->default_value(115200), "Скорость UART [бод], 0 - без ограничения")
+          ("round,r", bpo::value<size_t>(&sets._round_ms)->default_value(sets._round_ms),
+                      "Длительность цикла инвенторизации на антенне [мс]")
+          ("out,o", bpo::value<std::string>(&out_file), "Дописать результаты в файл")
+          ; //NOLINT
+        bpo::variables_map vm;
+        bpo::store(bpo::parse_command_line(argc, argv, desc), vm);
+        bpo::notify(vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << "\n";
+            return 0;
+        }
+        sets._bytes_per_sec = baud / 10; ///< 8N1: 10 бит на байт.
+        cycles = std::max<size_t>(cycles, 1);
+        warmup = std::min<size_t>(warmup, BENCH_MAX_BUFFER_CYCLES - 1);
+        std::vector<std::string> tag_strs;
+        std::vector<std::string> mode_strs;
+        boost::split(tag_strs, tags, boost::is_any_of(","));
+        boost::split(mode_strs, modes, boost::is_any_of(","));
+        std::ofstream out;
+        if (not out_file.empty()) {
+            out.open(out_file, std::ios::app);
+        }
+        int ret = 0;
+        for (const std::string &mode : mode_strs) {
+            for (const std::string &tag_str : tag_strs) {
+                sets._tags_num = std::stoul(tag_str);
+                Result res;
+                if (runBench(mode, sets, warmup, cycles, res)) {
+                    std::string json = toJson(res, sets);
+                    std::cout << json << "\n" << std::flush;
+                    if (out.is_open()) {
+                        out << json << "\n" << std::flush;
+                    }
+                } else {
+                    ret = 1;
+                }
+            }
+        }
+        return ret;
+    } catch (std::exception &e) {
+        LOG(FATAL) << "EXCEPTION: " << e.what();
+    }
+    return 1;
+}
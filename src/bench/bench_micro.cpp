@@ -0,0 +1,370 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Микрозамеры протокола RFID и обработки JSON: время операции и количество выделений памяти.
+ * \author Величко Ростислав
+ * \date   07.17.2017
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Log.hpp"
+#include "AllocCounter.hpp"
+#include "Message.hpp"
+#include "Commands.hpp"
+#include "CommandsHandler.hpp"
+#include "JsonExtractor.hpp"
+#include "CommandHandler.hpp"
+#include "JsonWriter.hpp"
+
+
+typedef robocooler::rfid::Message Message;
+typedef robocooler::rfid::Command RfidCmd;
+typedef robocooler::rfid::Command::ECommandId RfidCid;
+typedef robocooler::rfid::CommandsHandler RfidCmdHdl;
+typedef robocooler::rfid::Epc Epc;
+typedef robocooler::driver::JsonExtractor JsonExtractor;
+typedef robocooler::driver::CommandHandler CommandHandler;
+typedef robocooler::driver::JsonWriter JsonWriter;
+typedef robocooler::driver::EPayloadFormat EPayloadFormat;
+typedef Message::Buffer Buffer;
+
+
+static const size_t BENCH_EPC_LEN = 12;        ///< Длина EPC меток шкафа [байт].
+static const size_t BENCH_STREAM_TAGS = 100;   ///< Пакетов меток в записанном потоке.
+static const size_t BENCH_JSON_CHUNK = 16;     ///< Размер фрагмента при разбиении JSON на части.
+
+
+namespace {
+
+static const uint8_t BENCH_EPC[BENCH_EPC_LEN] = {0xe2, 0x00, 0x30, 0x16, 0x66, 0x13, 0x01, 0x55, 0x18, 0x70, 0x3a, 0x5c};
+
+static const char BENCH_JSON_CONTENT[] = "{\"H\":\"PlantHub\",\"M\":\"getContent\",\"A\":{\"bufReadNumAttempt\":3}}";
+
+static const char BENCH_JSON_DOOR[] = "{\"M\":\"closeRightDoor\",\"H\":\"PlantHub\",\"A\":\"\"}";
+
+static const char BENCH_JSON_PRODUCTS[] =
+    "{\"H\":\"PlantHub\",\"M\":\"sendPutOrTakenGoodsByUser\",\"A\":{\"PlantId\":\"0\","
+    "\"O\":[\"e2 00 30 16 66 13 01 55 18 70 3a 5c\",\"e2 00 30 16 66 13 01 55 18 70 3a 5d\"],"
+    "\"I\":[\"e2 00 30 16 66 13 01 55 18 70 3a 5e\"]}}";
+
+
+/**
+ * \brief Метод сохраняет среднее количество выделений памяти на операцию.
+ */
+void setAllocs(benchmark::State &state_, size_t start_) {
+    state_.counters["allocs"] = benchmark::Counter(static_cast<double>(bench::allocCount() - start_),
+                                                   benchmark::Counter::kAvgIterations);
+}
+
+
+/**
+ * \brief Метод записывает поток ответов потоковой инвенторизации: пакеты меток и пакет завершения.
+ */
+Buffer recordStream(size_t tags_) {
+    Buffer stream;
+    uint8_t frame[RFID_MAX_PACK_LEN];
+    uint8_t data[BENCH_EPC_LEN + 4];
+    for (size_t t = 0; t < tags_; ++t) {
+        data[0] = static_cast<uint8_t>(t & 0x03); ///< FreqAnt.
+        data[1] = 0x30;                           ///< PC.
+        data[2] = 0x00;
+        std::copy(BENCH_EPC, BENCH_EPC + BENCH_EPC_LEN, data + 3);
+        data[3 + BENCH_EPC_LEN - 1] = static_cast<uint8_t>(t);
+        data[3 + BENCH_EPC_LEN] = 0x45;           ///< RSSI.
+        size_t len = Message::encode(frame, RFID_ADDR, static_cast<uint8_t>(RfidCid::cmd_real_time_inventory),
+                                     data, BENCH_EPC_LEN + 4);
+        stream.insert(stream.end(), frame, frame + len);
+    }
+    uint8_t done[] = {0x00, 0x00, 0x64, 0x00, 0x00, 0x00, static_cast<uint8_t>(tags_)};
+    size_t len = Message::encode(frame, RFID_ADDR, static_cast<uint8_t>(RfidCid::cmd_real_time_inventory),
+                                 done, sizeof(done));
+    stream.insert(stream.end(), frame, frame + len);
+    return stream;
+}
+
+
+/**
+ * \brief Метод формирует данные пакета выгрузки буфера меток.
+ */
+Buffer bufferTagData() {
+    Buffer data = {0x00, 0x01, static_cast<uint8_t>(BENCH_EPC_LEN + 4), 0x30, 0x00};
+    data.insert(data.end(), BENCH_EPC, BENCH_EPC + BENCH_EPC_LEN);
+    Buffer tail = {0x12, 0x34, 0x45, 0x01, 0x03};
+    data.insert(data.end(), tail.begin(), tail.end());
+    return data;
+}
+} /// namespace
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+static void BM_MessageEncode(benchmark::State &state_) {
+    uint8_t frame[RFID_MAX_PACK_LEN];
+    uint8_t data[] = {0x00, 0x01, 0x02, 0x03, 0x01, 0x00, 0x0a};
+    size_t allocs = bench::allocCount();
+    while (state_.KeepRunning()) {
+        benchmark::DoNotOptimize(Message::encode(frame, RFID_ADDR, 0x8a, data, sizeof(data)));
+        benchmark::ClobberMemory();
+    }
+    setAllocs(state_, allocs);
+}
+BENCHMARK(BM_MessageEncode);
+
+
+static void BM_MessageConstruct(benchmark::State &state_) {
+    Buffer data = {0x00, 0x01, 0x02, 0x03, 0x01, 0x00, 0x0a};
+    size_t allocs = bench::allocCount();
+    while (state_.KeepRunning()) {
+        Message msg(RFID_ADDR, 0x8a, data);
+        benchmark::DoNotOptimize(msg.getSize());
+    }
+    setAllocs(state_, allocs);
+}
+BENCHMARK(BM_MessageConstruct);
+
+
+static void BM_MessageParse(benchmark::State &state_) {
+    Buffer frame = recordStream(1);
+    frame.resize(frame.size() - (RFID_PACK_MINLEN + 7)); ///< Только пакет метки.
+    size_t allocs = bench::allocCount();
+    while (state_.KeepRunning()) {
+        Message msg(frame);
+        Buffer data = msg.getAryData();
+        benchmark::DoNotOptimize(data.data());
+    }
+    setAllocs(state_, allocs);
+}
+BENCHMARK(BM_MessageParse);
+
+
+static void BM_ReceivePacket(benchmark::State &state_) {
+    Buffer stream = recordStream(BENCH_STREAM_TAGS);
+    RfidCmdHdl hdl(nullptr);
+    size_t tags = 0;
+    hdl.initOnReadDataFunc([&tags](const RfidCmd::ReadCmdData&) {
+        ++tags;
+    });
+    size_t allocs = bench::allocCount();
+    while (state_.KeepRunning()) {
+        for (uint8_t b : stream) {
+            benchmark::DoNotOptimize(hdl.receivePacket(b));
+        }
+    }
+    setAllocs(state_, allocs);
+    state_.SetItemsProcessed(static_cast<int64_t>(state_.iterations() * BENCH_STREAM_TAGS));
+    state_.SetBytesProcessed(static_cast<int64_t>(state_.iterations() * stream.size()));
+}
+BENCHMARK(BM_ReceivePacket);
+
+
+static void BM_ReceiveChunk(benchmark::State &state_) {
+    Buffer stream = recordStream(BENCH_STREAM_TAGS);
+    RfidCmdHdl hdl(nullptr);
+    size_t tags = 0;
+    hdl.initOnReadDataFunc([&tags](const RfidCmd::ReadCmdData&) {
+        ++tags;
+    });
+    size_t allocs = bench::allocCount();
+    while (state_.KeepRunning()) {
+        hdl.receiveChunk(stream.data(), stream.size(), nullptr);
+    }
+    setAllocs(state_, allocs);
+    state_.SetItemsProcessed(static_cast<int64_t>(state_.iterations() * BENCH_STREAM_TAGS));
+    state_.SetBytesProcessed(static_cast<int64_t>(state_.iterations() * stream.size()));
+}
+BENCHMARK(BM_ReceiveChunk);
+
+
+static void BM_ParseInventoryBufferData(benchmark::State &state_) {
+    Buffer data = bufferTagData();
+    size_t allocs = bench::allocCount();
+    while (state_.KeepRunning()) {
+        RfidCmd::ReadCmdData rcd;
+        RfidCmd::parseInventoryBufferData(data.data(), data.size(), rcd);
+        benchmark::DoNotOptimize(rcd._EPC);
+    }
+    setAllocs(state_, allocs);
+}
+BENCHMARK(BM_ParseInventoryBufferData);
+
+
+static void BM_ToString(benchmark::State &state_) {
+    size_t allocs = bench::allocCount();
+    while (state_.KeepRunning()) {
+        std::string str = RfidCmdHdl::toString(BENCH_EPC, BENCH_EPC_LEN);
+        benchmark::DoNotOptimize(str.data());
+    }
+    setAllocs(state_, allocs);
+}
+BENCHMARK(BM_ToString);
+
+
+static void BM_EpcToString(benchmark::State &state_) {
+    Epc epc;
+    epc.assign(BENCH_EPC, BENCH_EPC_LEN);
+    size_t allocs = bench::allocCount();
+    while (state_.KeepRunning()) {
+        std::string str = epc.toString();
+        benchmark::DoNotOptimize(str.data());
+    }
+    setAllocs(state_, allocs);
+}
+BENCHMARK(BM_EpcToString);
+
+
+static void BM_JsonExtractorWhole(benchmark::State &state_) {
+    std::string msg(BENCH_JSON_PRODUCTS);
+    size_t jsons = 0;
+    JsonExtractor extractor([&jsons](const robocooler::driver::JsonView&) {
+        ++jsons;
+    });
+    size_t allocs = bench::allocCount();
+    while (state_.KeepRunning()) {
+        extractor.onMessage(msg);
+    }
+    setAllocs(state_, allocs);
+    state_.SetBytesProcessed(static_cast<int64_t>(state_.iterations() * msg.size()));
+}
+BENCHMARK(BM_JsonExtractorWhole);
+
+
+static void BM_JsonExtractorChunked(benchmark::State &state_) {
+    std::string msg(BENCH_JSON_PRODUCTS);
+    std::vector<std::string> chunks;
+    for (size_t pos = 0; pos < msg.size(); pos += BENCH_JSON_CHUNK) {
+        chunks.push_back(msg.substr(pos, BENCH_JSON_CHUNK));
+    }
+    size_t jsons = 0;
+    JsonExtractor extractor([&jsons](const robocooler::driver::JsonView&) {
+        ++jsons;
+    });
+    size_t allocs = bench::allocCount();
+    while (state_.KeepRunning()) {
+        for (const std::string &chunk : chunks) {
+            extractor.onMessage(chunk);
+        }
+    }
+    setAllocs(state_, allocs);
+    state_.SetBytesProcessed(static_cast<int64_t>(state_.iterations() * msg.size()));
+}
+BENCHMARK(BM_JsonExtractorChunked);
+
+
+static void BM_HandleContent(benchmark::State &state_) {
+    std::string json(BENCH_JSON_CONTENT);
+    CommandHandler handler(nullptr);
+    size_t allocs = bench::allocCount();
+    while (state_.KeepRunning()) {
+        handler.handle(json);
+    }
+    setAllocs(state_, allocs);
+}
+BENCHMARK(BM_HandleContent);
+
+
+static void BM_HandleDoor(benchmark::State &state_) {
+    std::string json(BENCH_JSON_DOOR);
+    CommandHandler handler(nullptr);
+    size_t allocs = bench::allocCount();
+    while (state_.KeepRunning()) {
+        handler.handle(json);
+    }
+    setAllocs(state_, allocs);
+}
+BENCHMARK(BM_HandleDoor);
+
+
+static void BM_HandleProducts(benchmark::State &state_) {
+    std::string json(BENCH_JSON_PRODUCTS);
+    CommandHandler handler(nullptr);
+    size_t allocs = bench::allocCount();
+    while (state_.KeepRunning()) {
+        handler.handle(json);
+    }
+    setAllocs(state_, allocs);
+}
+BENCHMARK(BM_HandleProducts);
+
+
+static void BM_SendCurProducts(benchmark::State &state_) {
+    std::vector<std::string> labels;
+    Epc epc;
+    epc.assign(BENCH_EPC, BENCH_EPC_LEN);
+    for (int i = 0; i < state_.range(0); ++i) {
+        epc._bytes[0] = static_cast<uint8_t>(i);
+        epc._bytes[1] = static_cast<uint8_t>(i >> 8);
+        labels.push_back(epc.toString());
+    }
+    CommandHandler handler(nullptr);
+    size_t allocs = bench::allocCount();
+    while (state_.KeepRunning()) {
+        handler.sendCurProducts(labels);
+    }
+    setAllocs(state_, allocs);
+}
+BENCHMARK(BM_SendCurProducts)->Arg(500);
+
+
+/// Аргумент - кодирование: 0 - JSON, 1 - CBOR.
+static void BM_WriteLabels(benchmark::State &state_) {
+    EPayloadFormat format = static_cast<EPayloadFormat>(state_.range(0));
+    Epc epc;
+    epc.assign(BENCH_EPC, BENCH_EPC_LEN);
+    JsonWriter writer(format);
+    size_t allocs = bench::allocCount();
+    while (state_.KeepRunning()) {
+        writer.clear();
+        writer.beginObject().key("labels").beginArray();
+        for (size_t i = 0; i < 500; ++i) {
+            epc._bytes[0] = static_cast<uint8_t>(i);
+            writer.value(epc);
+        }
+        writer.endArray().endObject();
+        benchmark::DoNotOptimize(writer.str().data());
+    }
+    state_.counters["bytes"] = static_cast<double>(writer.str().size());
+    setAllocs(state_, allocs);
+}
+BENCHMARK(BM_WriteLabels)->Arg(0)->Arg(1);
+
+
+static void BM_LogDisabled(benchmark::State &state_) {
+    size_t allocs = bench::allocCount();
+    size_t i = 0;
+    while (state_.KeepRunning()) {
+        LOG(TRACE) << "Tag: " << ++i << " ant: " << 1;
+    }
+    setAllocs(state_, allocs);
+}
+BENCHMARK(BM_LogDisabled);
+
+
+static void BM_LogEnabled(benchmark::State &state_) {
+    size_t allocs = bench::allocCount();
+    size_t i = 0;
+    while (state_.KeepRunning()) {
+        LOG(WARNING) << "Tag: " << ++i << " ant: " << 1;
+    }
+    setAllocs(state_, allocs);
+}
+BENCHMARK(BM_LogEnabled);
+
+
+/// bench-micro --benchmark_format=json --benchmark_out=micro.json
+
+
+int main(int argc, char **argv) {
+    /// Сообщения формируются и ставятся в очередь как в работе драйвера, но никуда не выводятся.
+    utils::Singleton<utils::Log>::getShared()->init(false, false);
+    LOG_TOGGLE(DEBUG, false);
+    LOG_TOGGLE(TRACE, false);
+    LOG_TOGGLE(INFO, false);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
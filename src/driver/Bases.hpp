@@ -6,7 +6,9 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 
 #define UNLOCK_TIMEOUT 10000          ///< Предельное время ожидания завершения ответа на команду.
@@ -16,11 +18,37 @@
 #define UPDATE_RECV_DATA_TIMEOUT 1   ///< Таймаут после выполнения очередного опроса буфера.
 #define BUFFER_READING_NUM_ATTEMPT 3
 #define PERIODIC_INVENTORY_TIMEOUT 10000
+#define REAL_TIME_INVENTORY_REPEAT 5 ///< Количество циклов на антенну одной команды потоковой инвенторизации.
+#define FAST_SWITCH_ANT_STAY 1       ///< Количество циклов на антенне при быстром переключении антенн.
+#define SERIAL_READ_CHUNK 1024       ///< Размер блока приёма из последовательного порта за один вызов.
+#define INVENTORY_SESSION 2          ///< Сессия опроса с флагами A/B (S2); 0 - опрос всех меток каждый цикл.
+#define SESSION_SWEEP_PERIOD 5       ///< Каждый N-й цикл при открытых дверях - полная сверка меток.
 
 
 namespace robocooler {
 namespace driver {
 
+/**
+ * \brief Полосы исходящей очереди в порядке убывания приоритета.
+ */
+enum class ESendLane : uint8_t {
+    PRODUCT = 0,    ///< События изъятия и добавления продуктов, служебные команды.
+    STATE = 1,      ///< Снимки содержимого и настроек, вытесняются более новыми.
+    DIAGNOSTIC = 2, ///< Диагностика и выгрузка журналов.
+    QUANTITY = 3
+};
+
+/**
+ * \brief Кодирование посылок websocket канала.
+ */
+enum class EPayloadFormat : uint8_t {
+    JSON = 0, ///< Текстовые кадры JSON.
+    CBOR = 1  ///< Двоичные кадры CBOR, EPC - байтовые строки.
+};
+
+
+class JsonWriter;
+
 
 class CommandHandlerBase {
 public:
@@ -153,11 +181,42 @@ public:
      */
     virtual void setReadAntennsTimeout(size_t timeout_) = 0;
 
+    /**
+     * \brief Абстрактный метод устанавливает последовательность антенн для опроса с быстрым переключением.
+     * \param ants_ Номера антенн в порядке опроса (0..3); пустой список отключает быстрое переключение.
+     * \param stay_ Количество циклов инвенторизации на каждой антенне.
+     */
+    virtual void setAntennasSequence(const std::vector<uint8_t> &ants_, size_t stay_) = 0;
+
+    /**
+     * \brief Метод устанавливает сессию опроса меток и период полной сверки.
+     * \param session_ Номер сессии (1 - S1, 2 - S2); 0 отключает опрос по сессии.
+     * \param sweep_period_ Количество циклов между полными сверками.
+     */
+    virtual void setSessionSettings(uint8_t session_, size_t sweep_period_) = 0;
+
     /**
      * \brief Метод запускает процесс выявления плохо читаемых меток.
      * \param iterations_num_ Количество иттераций при тестировании.
      */
     virtual void findBrokenLabels(size_t iterations_num_) = 0;
+
+    /**
+     * \brief Абстрактный метод включает версионную синхронизацию содержимого изменениями.
+     * \param is_delta_ false - полный список меток в каждой посылке.
+     */
+    virtual void setLabelsSyncMode(bool is_delta_) = 0;
+
+    /**
+     * \brief Абстрактный метод принимает подтверждение сервером версии содержимого.
+     * \param version_ Подтверждённая версия.
+     */
+    virtual void ackLabelsSync(uint32_t version_) = 0;
+
+    /**
+     * \brief Абстрактный метод отправляет содержимое полностью при расхождении с сервером.
+     */
+    virtual void resyncLabels() = 0;
 };
 
     
@@ -170,15 +229,42 @@ public:
     {}
 
     /**
-     * \brief Метод отправляет строку JSIN по websocket.
+     * \brief Метод ставит закрытую посылку writer_ в очередь отправки по websocket.
+     *        Тип кадра определяется кодированием writer_.
+     * \param writer_       Отправляемая посылка.
+     * \param lane_         Полоса приоритета.
+     * \param coalesce_key_ Ключ вытеснения: неотправленная посылка с тем же ключом заменяется новой.
+     */
+    virtual void send(const JsonWriter &writer_,
+                      ESendLane lane_ = ESendLane::PRODUCT,
+                      const char *coalesce_key_ = nullptr) = 0;
+
+    /**
+     * \brief Метод дописывает номер события "seq" в открытый объект "A" посылки writer_, закрывает посылку,
+     *        сохраняет её в журнал и ставит в очередь отправки. Сервер подтверждает номера командой "ackEvents".
+     * \param snapshot_key_ Ключ снимка содержимого или nullptr для события с продуктами.
+     *        Снимок отправляется полосой STATE и вытесняется более новым с тем же ключом.
+     */
+    virtual void sendEvent(JsonWriter &writer_, const char *snapshot_key_ = nullptr) = 0;
+
+    /**
+     * \brief Метод принимает подтверждение сервером событий с номерами до seq_ включительно.
      */
-    virtual void send(const std::string &json_str_) = 0;
+    virtual void ackEvents(uint64_t) {
+    }
 
     /**
      * \brief Абстрактный метод, возвращающий идентификатор холодильника.
      */
     virtual std::string getCoolerId() = 0;
 
+    /**
+     * \brief Метод возвращает кодирование посылок, согласованное с сервером.
+     */
+    virtual EPayloadFormat getPayloadFormat() {
+        return EPayloadFormat::JSON;
+    }
+
     /**
      * \brief Абстрактный метод, возвращающий обработчик команд сервера.
      */
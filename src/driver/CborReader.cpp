@@ -0,0 +1,231 @@
+#include <cmath>
+#include <cstring>
+
+#include "CborReader.hpp"
+
+
+using namespace robocooler;
+using namespace driver;
+
+
+namespace {
+static const char HEX_DIGITS[] = "0123456789abcdef";
+static const uint8_t CBOR_INDEFINITE = 31; ///< Дополнительная информация: неопределённая длина.
+static const uint8_t CBOR_BREAK = 0xff;    ///< Завершение элемента неопределённой длины.
+
+
+double halfToDouble(uint16_t half_) {
+    int exp = (half_ >> 10) & 0x1f;
+    int mant = half_ & 0x3ff;
+    double val;
+    if (exp == 0) {
+        val = std::ldexp(mant, -24);
+    } else if (exp not_eq 31) {
+        val = std::ldexp(mant + 1024, exp - 25);
+    } else {
+        val = mant ? NAN : INFINITY;
+    }
+    return (half_ & 0x8000) ? -val : val;
+}
+} /// namespace
+
+
+bool CborReader::fail(const char *error_) {
+    _error = std::string(error_) + " at " + std::to_string(_pos);
+    return false;
+}
+
+
+bool CborReader::readHeader(uint8_t &major_, uint8_t &info_, uint64_t &val_) {
+    if (_pos >= _size) {
+        return fail("Unexpected end of CBOR");
+    }
+    uint8_t b = _data[_pos++];
+    major_ = static_cast<uint8_t>(b >> 5);
+    info_ = static_cast<uint8_t>(b & 0x1f);
+    val_ = info_;
+    if (info_ < 24 or info_ == CBOR_INDEFINITE) {
+        return true;
+    }
+    if (info_ > 27) {
+        return fail("Bad CBOR additional info");
+    }
+    size_t len = static_cast<size_t>(1) << (info_ - 24);
+    if (_size - _pos < len) {
+        return fail("Unexpected end of CBOR");
+    }
+    val_ = 0;
+    for (size_t i = 0; i < len; ++i) {
+        val_ = (val_ << 8) | _data[_pos++];
+    }
+    return true;
+}
+
+
+bool CborReader::readString(uint8_t major_, uint8_t info_, uint64_t len_, std::string &res_) {
+    if (info_ == CBOR_INDEFINITE) {
+        /// Строка неопределённой длины - последовательность определённых частей того же типа.
+        while (_pos < _size and _data[_pos] not_eq CBOR_BREAK) {
+            uint8_t major;
+            uint8_t info;
+            uint64_t len;
+            if (not readHeader(major, info, len)) {
+                return false;
+            }
+            if (major not_eq major_ or info == CBOR_INDEFINITE) {
+                return fail("Bad CBOR string chunk");
+            }
+            if (not readString(major, info, len, res_)) {
+                return false;
+            }
+        }
+        if (_pos >= _size) {
+            return fail("Unexpected end of CBOR");
+        }
+        ++_pos;
+        return true;
+    }
+    if (_size - _pos < len_) {
+        return fail("Unexpected end of CBOR");
+    }
+    const uint8_t *data = _data + _pos;
+    size_t len = static_cast<size_t>(len_);
+    _pos += len;
+    if (major_ == 3) {
+        res_.append(reinterpret_cast<const char*>(data), len);
+        return true;
+    }
+    /// Байтовая строка - EPC.
+    for (size_t i = 0; i < len; ++i) {
+        if (not res_.empty()) {
+            res_.push_back(' ');
+        }
+        res_.push_back(HEX_DIGITS[data[i] >> 4]);
+        res_.push_back(HEX_DIGITS[data[i] & 0x0f]);
+    }
+    return true;
+}
+
+
+bool CborReader::readItem(Json &res_, size_t depth_) {
+    if (depth_ > CBOR_READER_MAX_DEPTH) {
+        return fail("CBOR is too deep");
+    }
+    uint8_t major;
+    uint8_t info;
+    uint64_t val;
+    if (not readHeader(major, info, val)) {
+        return false;
+    }
+    bool is_indefinite = (info == CBOR_INDEFINITE);
+    if (is_indefinite and (major == 0 or major == 1 or major == 6)) {
+        return fail("Bad CBOR indefinite item");
+    }
+    switch (major) {
+        case 0:
+            res_ = val;
+            return true;
+        case 1:
+            res_ = -1 - static_cast<int64_t>(val);
+            return true;
+        case 2:
+        case 3: {
+            std::string str;
+            if (not readString(major, info, val, str)) {
+                return false;
+            }
+            res_ = std::move(str);
+            return true;
+        }
+        case 4:
+            res_ = Json::array();
+            for (uint64_t i = 0; is_indefinite or i < val; ++i) {
+                if (is_indefinite and _pos < _size and _data[_pos] == CBOR_BREAK) {
+                    ++_pos;
+                    break;
+                }
+                Json item;
+                if (not readItem(item, depth_ + 1)) {
+                    return false;
+                }
+                res_.push_back(std::move(item));
+            }
+            return true;
+        case 5:
+            res_ = Json::object();
+            for (uint64_t i = 0; is_indefinite or i < val; ++i) {
+                if (is_indefinite and _pos < _size and _data[_pos] == CBOR_BREAK) {
+                    ++_pos;
+                    break;
+                }
+                Json key;
+                if (not readItem(key, depth_ + 1)) {
+                    return false;
+                }
+                const std::string *key_str = key.get_ptr<const std::string*>();
+                if (not key_str) {
+                    return fail("CBOR map key is not a string");
+                }
+                if (not readItem(res_[*key_str], depth_ + 1)) {
+                    return false;
+                }
+            }
+            return true;
+        case 6:
+            /// Тэг не меняет значения.
+            return readItem(res_, depth_ + 1);
+        default:
+            break;
+    }
+    switch (info) {
+        case 20:
+            res_ = false;
+            return true;
+        case 21:
+            res_ = true;
+            return true;
+        case 22:
+        case 23:
+            res_ = nullptr;
+            return true;
+        case 25:
+            res_ = halfToDouble(static_cast<uint16_t>(val));
+            return true;
+        case 26: {
+            uint32_t bits = static_cast<uint32_t>(val);
+            float num;
+            memcpy(&num, &bits, sizeof(num));
+            res_ = static_cast<double>(num);
+            return true;
+        }
+        case 27: {
+            double num;
+            memcpy(&num, &val, sizeof(num));
+            res_ = num;
+            return true;
+        }
+        default:
+            return fail("Unsupported CBOR simple value");
+    }
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+CborReader::CborReader(const uint8_t *data_, size_t size_)
+    : _data(data_)
+    , _size(size_)
+    , _pos(0) {
+}
+
+
+bool CborReader::read(Json &res_) {
+    _pos = 0;
+    _error.clear();
+    if (not readItem(res_, 0)) {
+        return false;
+    }
+    if (_pos not_eq _size) {
+        return fail("Extra data after CBOR");
+    }
+    return true;
+}
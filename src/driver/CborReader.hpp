@@ -0,0 +1,54 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Разбор входящих посылок CBOR в json.
+ * \author Величко Ростислав
+ * \date   07.22.2017
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "json.hpp"
+
+
+static const size_t CBOR_READER_MAX_DEPTH = 32; ///< Предельная вложенность массивов и объектов.
+
+
+namespace robocooler {
+namespace driver {
+
+/**
+ * \brief Разборщик переводит CBOR в json для CommandHandler.
+ *        В отличие от nlohmann::json::from_cbor, принимает байтовые строки: они переводятся
+ *        в строку EPC формата сервера (байты в нижнем регистре через пробел). Тэги пропускаются.
+ */
+class CborReader {
+    typedef nlohmann::json Json;
+
+    const uint8_t *_data;
+    size_t _size;
+    size_t _pos;
+    std::string _error;
+
+    bool fail(const char *error_);
+    bool readHeader(uint8_t &major_, uint8_t &info_, uint64_t &val_);
+    bool readString(uint8_t major_, uint8_t info_, uint64_t len_, std::string &res_);
+    bool readItem(Json &res_, size_t depth_);
+
+public:
+    CborReader(const uint8_t *data_, size_t size_);
+
+    /**
+     * \brief Метод разбирает посылку целиком.
+     * \return false, если посылка повреждена или содержит лишние данные; причина - в what().
+     */
+    bool read(Json &res_);
+
+    const std::string& what() const {
+        return _error;
+    }
+};
+} /// driver
+} /// robocooler
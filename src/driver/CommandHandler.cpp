@@ -1,342 +1,556 @@
-#include <ostream>
-
-#include <boost/property_tree/json_parser.hpp>
-#include <boost/optional/optional.hpp>
+#include <unordered_map>
 
 #include "Log.hpp"
 #include "Commands.hpp"
+#include "CborReader.hpp"
+#include "JsonWriter.hpp"
 #include "CommandHandler.hpp"
 #include "GpioController.hpp"
 #include "RfidController.hpp"
 
 
-namespace bpt = boost::property_tree;
-
 using namespace robocooler;
 using namespace driver;
 
+typedef CommandHandler::Method Method;
+typedef std::unordered_map<std::string, Method> MethodTable;
+
+
+namespace {
+
+/**
+ * \brief Метод возвращает поле объекта или nullptr, если значение не объект или поля нет.
+ */
+const Json* field(const Json &obj_, const char *key_) {
+    if (obj_.is_object()) {
+        Json::const_iterator it = obj_.find(key_);
+        if (it not_eq obj_.end()) {
+            return &(*it);
+        }
+    }
+    return nullptr;
+}
+
+
+/**
+ * \brief Метод читает неотрицательное число; сервер может передавать числа строками.
+ */
+bool toSize(const Json *val_, size_t &res_) {
+    if (not val_) {
+        return false;
+    }
+    if (val_->is_number_unsigned()) {
+        res_ = val_->get<size_t>();
+        return true;
+    }
+    if (val_->is_number()) {
+        double val = val_->get<double>();
+        if (val >= 0) {
+            res_ = static_cast<size_t>(val);
+            return true;
+        }
+        return false;
+    }
+    const std::string *str = val_->get_ptr<const std::string*>();
+    if (str and not str->empty() and str->find_first_not_of("0123456789") == std::string::npos) {
+        res_ = std::stoul(*str);
+        return true;
+    }
+    return false;
+}
+
+
+bool toByte(const Json *val_, uint8_t &res_) {
+    size_t val = 0;
+    if (toSize(val_, val) and val <= 0xff) {
+        res_ = static_cast<uint8_t>(val);
+        return true;
+    }
+    return false;
+}
+
+
+/**
+ * \brief Метод читает строку; числа передаются в текстовом виде, как их отдавал property_tree.
+ */
+bool toString(const Json *val_, std::string &res_) {
+    if (not val_) {
+        return false;
+    }
+    const std::string *str = val_->get_ptr<const std::string*>();
+    if (str) {
+        res_ = *str;
+        return true;
+    }
+    if (val_->is_number()) {
+        res_ = val_->dump();
+        return true;
+    }
+    return false;
+}
+
+
+bool toStrings(const Json *val_, std::vector<std::string> &res_) {
+    if (not val_ or not val_->is_array()) {
+        return false;
+    }
+    res_.reserve(val_->size());
+    for (const Json &item : *val_) {
+        std::string str;
+        if (toString(&item, str)) {
+            res_.push_back(str);
+        }
+    }
+    return true;
+}
+
 
-std::string CommandHandler::getLabelsString(const std::vector<std::string> &labels_) {
-    std::ostringstream oss;
-    std::vector<std::string> labels;
-    for (auto &l : labels_) {
-        labels.push_back("\"" + l + "\"");
+/**
+ * \brief Метод возвращает посылку для журнала: двоичная посылка заменяется её размером.
+ */
+std::string toLog(const JsonWriter &writer_) {
+    if (writer_.getFormat() == EPayloadFormat::CBOR) {
+        return "CBOR: " + std::to_string(writer_.str().size()) + " bytes";
     }
-    std::copy(labels.begin(), labels.end() - 1, std::ostream_iterator<std::string>(oss, ","));
-    oss << labels.back();
-    return oss.str();
+    return writer_.str();
 }
 
 
-void CommandHandler::handlePlantHub(const bpt::ptree &pt_) {
-    /// Выделить сообщени из "M" поля.
-    std::string M_str = pt_.get<std::string>("M");
-    if (M_str == "sendPutOrTakenGoodsByUser") { ///< Админ команда изъятия и внесения продуктов.  
-        boost::optional<const bpt::ptree&> opt_A = pt_.get_child_optional("A");
-        if (opt_A) { ///< Проверить наличие поля "A".
-            handleA(pt_.get_child("A"));
+bool toBytes(const Json *val_, std::vector<uint8_t> &res_) {
+    if (not val_ or not val_->is_array()) {
+        return false;
+    }
+    res_.reserve(val_->size());
+    for (const Json &item : *val_) {
+        uint8_t b = 0;
+        if (toByte(&item, b)) {
+            res_.push_back(b);
         }
-    } else if (M_str == "openRightDoor" or M_str == "openLeftDoor") {
-        LOG(INFO) << "Open door.";
-        if (_worker) {
-            GpioControllerBase *door = _worker->getGpioController();
-            if (door) {
-                if (M_str == "openRightDoor") {
-                    door->openRightDoor();
-                } else if (M_str == "openLeftDoor") {
-                    door->openLeftDoor();
-                }
+    }
+    return true;
+}
+} /// namespace
+
+
+bool CommandHandler::parseArgs(const Json&, NoArgs&) {
+    return true;
+}
+
+
+bool CommandHandler::parseArgs(const Json &A_, ProductsArgs &args_) {
+    if (not toString(field(A_, "PlantId"), args_._plant_id)) {
+        LOG(ERROR) << "Can`t find PlantId";
+        return false;
+    }
+    /// Массивы "O" изъятых и "I" добавленных продуктов необязательны.
+    toStrings(field(A_, "O"), args_._out);
+    toStrings(field(A_, "I"), args_._in);
+    return true;
+}
+
+
+bool CommandHandler::parseArgs(const Json &A_, ContentArgs &args_) {
+    args_._buf_read_num_attempt = 0;
+    args_._has_buf_read_num_attempt = toSize(field(A_, "bufReadNumAttempt"), args_._buf_read_num_attempt);
+    return true;
+}
+
+
+bool CommandHandler::parseArgs(const Json &A_, RfidConfigArgs &args_) {
+    args_._has_region = false;
+    args_._region = static_cast<uint8_t>(RfidCmd::ESpektrumRegion::ETSI);
+    args_._start_freq = 0;
+    args_._end_freq = 0;
+    const Json *region = field(A_, "frequencyRegion");
+    if (region) {
+        /// Регион передаётся только целиком.
+        bool has_region = toByte(field(*region, "region"), args_._region);
+        bool has_start = toByte(field(*region, "startFrequency"), args_._start_freq);
+        bool has_end = toByte(field(*region, "endFrequency"), args_._end_freq);
+        args_._has_region = has_region and has_start and has_end;
+    }
+    bool has_powers = toBytes(field(A_, "powers"), args_._powers);
+    if (not region and not has_powers) {
+        LOG(ERROR) << "Can`t find RFID settings in JSON.";
+        return false;
+    }
+    return true;
+}
+
+
+bool CommandHandler::parseArgs(const Json &A_, RequestsSettingsArgs &args_) {
+    args_._read_antenns_count = 0;
+    args_._has_read_antenns_count = toSize(field(A_, "readAntennsCount"), args_._read_antenns_count);
+    if (not args_._has_read_antenns_count) {
+        LOG(ERROR) << "Can`t find readAntennsCount";
+    }
+    args_._buf_read_num_attempt = 0;
+    args_._has_buf_read_num_attempt = toSize(field(A_, "bufReadNumAttempt"), args_._buf_read_num_attempt);
+    if (not args_._has_buf_read_num_attempt) {
+        LOG(ERROR) << "Can`t find bufReadNumAttempt";
+    }
+    args_._update_recv_data_timeout = 0;
+    args_._has_update_recv_data_timeout = toSize(field(A_, "updateRecvDataTimeout"), args_._update_recv_data_timeout);
+    if (not args_._has_update_recv_data_timeout) {
+        LOG(ERROR) << "Can`t find updateRecvDataTimeout";
+    }
+    /// Необязательная последовательность антенн для быстрого переключения: "antennas":[0,1,2,3],"antennaStay":1
+    args_._has_antennas = toBytes(field(A_, "antennas"), args_._antennas);
+    args_._antenna_stay = FAST_SWITCH_ANT_STAY;
+    toSize(field(A_, "antennaStay"), args_._antenna_stay);
+    /// Необязательная сессия опроса: "session":2,"sweepPeriod":5
+    args_._session = 0;
+    args_._has_session = toByte(field(A_, "session"), args_._session);
+    args_._sweep_period = SESSION_SWEEP_PERIOD;
+    toSize(field(A_, "sweepPeriod"), args_._sweep_period);
+    return true;
+}
+
+
+bool CommandHandler::parseArgs(const Json &A_, BrokenLabelsArgs &args_) {
+    if (not toSize(field(A_, "iterationsNumber"), args_._iterations_num)) {
+        LOG(ERROR) << "Can`t find iterationsNumber";
+        return false;
+    }
+    return true;
+}
+
+
+bool CommandHandler::parseArgs(const Json &A_, LabelsSyncModeArgs &args_) {
+    const Json *delta = field(A_, "delta");
+    if (not delta or not delta->is_boolean()) {
+        LOG(ERROR) << "Can`t find delta";
+        return false;
+    }
+    args_._is_delta = delta->get<bool>();
+    return true;
+}
+
+
+bool CommandHandler::parseArgs(const Json &A_, LabelsAckArgs &args_) {
+    if (not toSize(field(A_, "version"), args_._version)) {
+        LOG(ERROR) << "Can`t find version";
+        return false;
+    }
+    return true;
+}
+
+
+bool CommandHandler::parseArgs(const Json &A_, EventsAckArgs &args_) {
+    if (not toSize(field(A_, "seq"), args_._seq)) {
+        LOG(ERROR) << "Can`t find seq";
+        return false;
+    }
+    return true;
+}
+
+
+Method CommandHandler::findMethod(const std::string &name_) {
+    /// Таблица строится один раз; поиск по строке из разобранного json не выделяет память.
+    static const MethodTable methods = {
+        {"sendPutOrTakenGoodsByUser", &CommandHandler::dispatch<ProductsArgs, &CommandHandler::putOrTakenGoods>},
+        {"openLeftDoor", &CommandHandler::dispatch<NoArgs, &CommandHandler::openLeftDoor>},
+        {"openRightDoor", &CommandHandler::dispatch<NoArgs, &CommandHandler::openRightDoor>},
+        {"closeLeftDoor", &CommandHandler::dispatch<NoArgs, &CommandHandler::closeLeftDoor>},
+        {"closeRightDoor", &CommandHandler::dispatch<NoArgs, &CommandHandler::closeRightDoor>},
+        {"getContent", &CommandHandler::dispatch<ContentArgs, &CommandHandler::getContent>},
+        {"configureRFIDDevice", &CommandHandler::dispatch<RfidConfigArgs, &CommandHandler::setRfidConfig>},
+        {"getAntennasConfiguration", &CommandHandler::dispatch<NoArgs, &CommandHandler::getAntennasConfiguration>},
+        {"updateAntennasRequestsSettings",
+            &CommandHandler::dispatch<RequestsSettingsArgs, &CommandHandler::setRequestsSettings>},
+        {"findBrokenLabels", &CommandHandler::dispatch<BrokenLabelsArgs, &CommandHandler::findBrokenLabels>},
+        {"setLabelsSyncMode", &CommandHandler::dispatch<LabelsSyncModeArgs, &CommandHandler::setLabelsSyncMode>},
+        {"ackLabelsSynchronization", &CommandHandler::dispatch<LabelsAckArgs, &CommandHandler::ackLabelsSync>},
+        {"requestLabelsSynchronization", &CommandHandler::dispatch<NoArgs, &CommandHandler::resyncLabels>},
+        {"ackEvents", &CommandHandler::dispatch<EventsAckArgs, &CommandHandler::ackEvents>}
+    };
+    MethodTable::const_iterator it = methods.find(name_);
+    return it not_eq methods.end() ? it->second : nullptr;
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+void CommandHandler::putOrTakenGoods(const ProductsArgs &args_) {
+    std::string cooler_id = "0";
+    if (_worker) {
+        cooler_id = _worker->getCoolerId();
+    }
+    if (args_._plant_id == cooler_id) {
+        sendProducts(args_._out, args_._in);
+    } else {
+        LOG(WARNING) << "PlantId is foreign " << args_._plant_id;
+    }
+}
+
+
+void CommandHandler::openLeftDoor(const NoArgs&) {
+    openDoor(true);
+}
+
+
+void CommandHandler::openRightDoor(const NoArgs&) {
+    openDoor(false);
+}
+
+
+void CommandHandler::closeLeftDoor(const NoArgs&) {
+    closeDoor(true);
+}
+
+
+void CommandHandler::closeRightDoor(const NoArgs&) {
+    closeDoor(false);
+}
+
+
+void CommandHandler::openDoor(bool is_left_) {
+    LOG(INFO) << "Open door.";
+    if (_worker) {
+        GpioControllerBase *door = _worker->getGpioController();
+        if (door) {
+            if (is_left_) {
+                door->openLeftDoor();
+            } else {
+                door->openRightDoor();
             }
+        }
+        postInventory([this](RfidControllerBase *rfidc_) {
             /// Остановить таймер завершения инвенторизации по закрытию двери.
             _stop_inventory_timer.reset();
             /// Запустить инвенторизацию.
-            RfidControllerBase *rfidc = _worker->getRfidController();
-            if (rfidc) {
-                rfidc->startInventory(true);
+            rfidc_->startInventory(true);
+        });
+    }
+}
+
+
+void CommandHandler::closeDoor(bool is_left_) {
+    LOG(INFO) << "Close door.";
+    if (_worker) {
+        GpioControllerBase *door = _worker->getGpioController();
+        if (door) {
+            if (is_left_) {
+                door->closeLeftDoor();
+            } else {
+                door->closeRightDoor();
             }
         }
-    } else if (M_str == "closeLeftDoor" or M_str == "closeRightDoor") {
-        LOG(INFO) << "Close door.";
-        if (_worker) {
-            GpioControllerBase *door = _worker->getGpioController();
-            if (door) {
-                if (M_str == "closeLeftDoor") {
-                    door->closeLeftDoor();
-                } else if (M_str == "closeRightDoor") {
-                    door->closeRightDoor();
-                }
-            }
-            /// Остановить перезапустить процесс инвенторизации .
-            LOG(DEBUG) << "Stop by close door.";
-            RfidControllerBase *rfidc = _worker->getRfidController();
-            if (rfidc) {
-                rfidc->stopInventory();
-            }
-            /// Запустить таймер закрытия двери.
-            _close_inventory_timer = std::make_shared<Timer>(CLOSED_TIMEOUT, [this] {
+        /// Остановить перезапустить процесс инвенторизации .
+        LOG(DEBUG) << "Stop by close door.";
+        postInventory([](RfidControllerBase *rfidc_) {
+            rfidc_->stopInventory();
+        });
+        /// Запустить таймер закрытия двери.
+        _close_inventory_timer = std::make_shared<Timer>(CLOSED_TIMEOUT, [this] {
+            postInventory([this](RfidControllerBase *rfidc_) {
                 /// Запустить итоговую инвенторизацию.
                 LOG(DEBUG) << "Start result inventory.";
-                RfidControllerBase *rfidc = _worker->getRfidController();
-                if (rfidc) {
-                    rfidc->startInventory(false);
-                }
+                rfidc_->startInventory(false);
                 /// Запустить таймер завершения итоговой инвенторизации.
                 _stop_inventory_timer = std::make_shared<Timer>(INVENTORY_TIMEOUT, [this] {
                     LOG(DEBUG) << "Stop result inventory by timer.";
-                    RfidControllerBase *rfidc = _worker->getRfidController();
-                    if (rfidc) {
-                        rfidc->stopInventory();
-                        rfidc->accumulateBuffer();
-                    }
+                    postInventory([](RfidControllerBase *rfidc_) {
+                        rfidc_->stopInventory();
+                        rfidc_->accumulateBuffer();
+                    });
                 });
             });
+        });
+    }
+}
+
+
+void CommandHandler::getContent(const ContentArgs &args_) {
+    LOG(INFO) << "Get content.";
+    ContentArgs args = args_;
+    postInventory([args](RfidControllerBase *rfidc_) {
+        size_t count = args._has_buf_read_num_attempt ? args._buf_read_num_attempt : rfidc_->getBufReadNumAttempt();
+        rfidc_->inventory(count, false);
+    });
+}
+
+
+void CommandHandler::setRfidConfig(const RfidConfigArgs &args_) {
+    LOG(INFO) << "Set RFID configuration.";
+    RfidConfigArgs args = args_;
+    postRfid([args](RfidControllerBase *rfidc_) {
+        /// Передать настройки частотных диапазонов.
+        if (args._has_region) {
+            LOG(DEBUG) << "Set Frequency region";
+            RfidBuffer buf({args._region, args._start_freq, args._end_freq});
+            rfidc_->execute(static_cast<uint8_t>(RfidCid::cmd_set_frequency_region), buf);
         }
-    } else if (M_str == "getContent") { ///< { "H": "PlantHub", "M":"getContent”, "A":null }
-        LOG(INFO) << "Get content.";
-        if (_worker) {
-            RfidControllerBase *rfidc = _worker->getRfidController();
-            if (rfidc) {
-                size_t count = rfidc->getBufReadNumAttempt();
-                boost::optional<const bpt::ptree&> opt_A = pt_.get_child_optional("A");
-                if (opt_A) { ///< Проверить наличие поля "A".
-                    bpt::ptree A = pt_.get_child("A");
-                    boost::optional<size_t> opt_brna = A.get_optional<size_t>("bufReadNumAttempt");
-                    if (opt_brna) { ///< Проверить наличие поля "bufReadNumAttempt".
-                        count = opt_brna.get();
-                    }
-                }
-                rfidc->inventory(count, false);
-            }
-        }
-    } else if (M_str == "configureRFIDDevice") { ///< {"H":"PlantHub", "M":"configureRFIDDevice", "A":{...}}
-        LOG(INFO) << "Set RFID configuration.";
-        boost::optional<const bpt::ptree&> opt_A = pt_.get_child_optional("A");
-        if (opt_A) { ///< Проверить наличие поля "A".
-            setRfidConfig(pt_.get_child("A"));
-        }
-    } else if (M_str == "getAntennasConfiguration") { ///< {"H":"PlantHub", "M":"getAntennasConfiguration"}
-        LOG(INFO) << "Get RFID configuration.";
-        if (_worker) {
-            RfidControllerBase *rfidc = _worker->getRfidController();
-            if (rfidc) {
-                std::stringstream ss;
-                ss << "{\"H\":\"antennasConfiguration\",\"M\":\"setCurrentConfiguration\","
-                   << "\"A\":{" << rfidc->getAntSettings() << ",\"plantId\":" << _worker->getCoolerId() << "},}";
-                _worker->send(ss.str());
-            }
-        }
-    } else if (M_str == "updateAntennasRequestsSettings") { ///< {"M":"updateAntennasRequestsSettings","H":"PlantHub","A":{"readAntennsCount":3,"bufReadNumAttempt":2,"updateRecvDataTimeout":10}}
-        LOG(INFO) << "Update RFID request settings.";
-        if (_worker) {
-            boost::optional<const bpt::ptree&> opt_A = pt_.get_child_optional("A");
-            if (opt_A) { ///< Проверить наличие поля "A".
-                setRequestsSettings(pt_.get_child("A"));
-            }
+        /// Передать настройки мощности антенн.
+        if (not args._powers.empty()) {
+            LOG(DEBUG) << "Set Power";
+            rfidc_->execute(static_cast<uint8_t>(RfidCid::cmd_set_output_power), args._powers);
         }
-    } else if (M_str == "findBrokenLabels") { ///< {"M":"findBrokenLabels","H":"PlantHub","A":{"iterationsNumber":0}}
-        LOG(INFO) << "Update RFID request settings.";
-        if (_worker) {
-            boost::optional<const bpt::ptree&> opt_A = pt_.get_child_optional("A");
-            if (opt_A) { ///< Проверить наличие поля "A".
-                findBrokenLabels(pt_.get_child("A"));
+    });
+}
+
+
+void CommandHandler::getAntennasConfiguration(const NoArgs&) {
+    LOG(INFO) << "Get RFID configuration.";
+    /// Запрос ждёт ответов модуля до UNLOCK_TIMEOUT, ответ серверу отправляется по его завершении.
+    postRfid([this](RfidControllerBase *rfidc_) {
+        sendAntSettings(rfidc_->getAntSettings());
+    });
+}
+
+
+void CommandHandler::sendAntSettings(const std::string &ant_sets_) {
+    if (_worker) {
+        JsonWriter writer(_worker->getPayloadFormat());
+        writer.reserve(JSON_WRITER_HEAD_SIZE * 2);
+        writer.beginObject()
+            .key("H").value("antennasConfiguration")
+            .key("M").value("setCurrentConfiguration")
+            .key("A").beginObject();
+        if (not ant_sets_.empty()) {
+            /// Настройки приходят фрагментом JSON объекта, перекодируются для CBOR поле за полем.
+            Json sets = Json::parse("{" + ant_sets_ + "}");
+            for (Json::const_iterator it = sets.begin(); it not_eq sets.end(); ++it) {
+                writer.key(it.key().c_str()).value(it.value());
             }
         }
-    } else {
-        LOG(WARNING) << "\"M\": " << M_str;
+        writer.key("plantId").number(_worker->getCoolerId())
+            .endObject()
+            .endObject();
+        _worker->send(writer, ESendLane::STATE, "setCurrentConfiguration");
     }
 }
 
 
-void CommandHandler::setRfidConfig(const bpt::ptree &pt_) {
-    /// "A":{"frequencyRegion":{"startFrequency":0,"endFrequency":59,"region":1},"powers":[0,1,2,33]}}
-    bpt::ptree A_pt = pt_;
-    /// Передать настройки частотных диапазонов.
-    boost::optional<bpt::ptree&> opt_frequencyRegion = A_pt.get_child_optional("frequencyRegion");
-    if (opt_frequencyRegion) {
-        bpt::ptree frequencyRegion_pt = opt_frequencyRegion.get();
-        /// Получить настройки региона.
-        RfidCmd::ESpektrumRegion region = RfidCmd::ESpektrumRegion::ETSI;
-        boost::optional<uint8_t> opt_region = frequencyRegion_pt.get_optional<uint8_t>("region");
-        if (opt_region) {
-            region = static_cast<RfidCmd::ESpektrumRegion>(opt_region.get());
+void CommandHandler::setRequestsSettings(const RequestsSettingsArgs &args_) {
+    LOG(INFO) << "Update RFID request settings.";
+    RequestsSettingsArgs args = args_;
+    postRfid([args](RfidControllerBase *rfidc_) {
+        if (args._has_read_antenns_count) {
+            rfidc_->setReadAntennsCount(args._read_antenns_count);
         }
-        /// Получить настройки начала чистотного региона.
-        uint8_t startFrequency = 0;
-        boost::optional<uint8_t> opt_startFrequency = frequencyRegion_pt.get_optional<uint8_t>("startFrequency");
-        if (opt_startFrequency) {
-            startFrequency = opt_startFrequency.get();
+        if (args._has_buf_read_num_attempt) {
+            rfidc_->setBufReadNumAttempt(args._buf_read_num_attempt);
         }
-        /// Получить настройки конца чистотного региона.
-        uint8_t endFrequency = 0;
-        boost::optional<uint8_t> opt_endFrequency = frequencyRegion_pt.get_optional<uint8_t>("endFrequency");
-        if (opt_endFrequency) {
-            endFrequency = opt_endFrequency.get();
+        if (args._has_update_recv_data_timeout) {
+            rfidc_->setReadAntennsTimeout(args._update_recv_data_timeout);
         }
-        /// Передать настройки.
-        if (opt_region and opt_startFrequency and opt_endFrequency) {
-            RfidControllerBase *rfidc = _worker->getRfidController();
-            if (rfidc) {
-                LOG(DEBUG) << "Set Frequency region";
-                RfidBuffer buf({static_cast<uint8_t>(region), startFrequency, endFrequency});
-                rfidc->execute(static_cast<uint8_t>(RfidCid::cmd_set_frequency_region), buf);
-            }
+        if (args._has_antennas) {
+            rfidc_->setAntennasSequence(args._antennas, args._antenna_stay);
         }
-    }
-    /// Передать настройки мощности антенн.
-    boost::optional<bpt::ptree&> opt_powers = A_pt.get_child_optional("powers");
-    if (opt_powers) {
-        RfidControllerBase *rfidc = _worker->getRfidController();
-        if (rfidc and not opt_powers.get().empty()) {
-            RfidBuffer buf;
-            for (auto &v : opt_powers.get()) {
-                buf.push_back(v.second.get_value<uint8_t>());
-            }
-            LOG(DEBUG) << "Set Power";
-            rfidc->execute(static_cast<uint8_t>(RfidCid::cmd_set_output_power), buf);
+        if (args._has_session) {
+            rfidc_->setSessionSettings(args._session, args._sweep_period);
         }
+    });
+}
+
+
+void CommandHandler::findBrokenLabels(const BrokenLabelsArgs &args_) {
+    LOG(INFO) << "Find broken labels.";
+    size_t iterations_num = args_._iterations_num;
+    postInventory([iterations_num](RfidControllerBase *rfidc_) {
+        rfidc_->findBrokenLabels(iterations_num);
+    });
+}
+
+
+void CommandHandler::setLabelsSyncMode(const LabelsSyncModeArgs &args_) {
+    LOG(INFO) << "Labels sync mode: " << (args_._is_delta ? "delta" : "full");
+    bool is_delta = args_._is_delta;
+    postRfid([is_delta](RfidControllerBase *rfidc_) {
+        rfidc_->setLabelsSyncMode(is_delta);
+    });
+}
+
+
+void CommandHandler::ackLabelsSync(const LabelsAckArgs &args_) {
+    uint32_t version = static_cast<uint32_t>(args_._version);
+    postRfid([version](RfidControllerBase *rfidc_) {
+        rfidc_->ackLabelsSync(version);
+    });
+}
+
+
+void CommandHandler::resyncLabels(const NoArgs&) {
+    LOG(INFO) << "Labels resync requested.";
+    postRfid([](RfidControllerBase *rfidc_) {
+        rfidc_->resyncLabels();
+    });
+}
+
+
+void CommandHandler::postRfid(const RfidTask &task_) {
+    post(_rfid_executor, task_);
+}
+
+
+void CommandHandler::postInventory(const RfidTask &task_) {
+    post(_inventory_executor, task_);
+}
+
+
+void CommandHandler::post(Executor &executor_, const RfidTask &task_) {
+    RfidControllerBase *rfidc = _worker ? _worker->getRfidController() : nullptr;
+    if (rfidc) {
+        executor_.post([rfidc, task_] {
+            task_(rfidc);
+        });
     }
-    if (not opt_frequencyRegion and not opt_powers) {
-        LOG(ERROR) << "Can`t find RFID settings in JSON.";
+}
+
+
+void CommandHandler::ackEvents(const EventsAckArgs &args_) {
+    LOG(DEBUG) << "Events ack: " << args_._seq;
+    if (_worker) {
+        _worker->ackEvents(static_cast<uint64_t>(args_._seq));
     }
 }
 
 
 void CommandHandler::sendProducts(const std::vector<std::string> &out_, const std::vector<std::string> &in_) {
-    std::ostringstream oss;
-    oss << "{\"H\":\"labeledGoods\",\"M\":\"setPutOrTakenGoods\",\"A\":{";
-    oss << "\"userActionOUT\":[";
-    if (not out_.empty()) {
-        oss << getLabelsString(out_);
-    }
-    oss << "],";
-    oss << "\"userActionIN\":[";
-    if (not in_.empty()) {
-        oss << getLabelsString(in_);
-    }
-    oss << "],";
-    oss << "\"param\":{\"id\":";
     std::string cooler_id = "0";
     if (_worker) {
         cooler_id = _worker->getCoolerId();
     }
-    oss << cooler_id << "}}}";
-    LOG(INFO) << oss.str();
-    /// Отрпавить JSON на сервер с данными о продуктах.
+    JsonWriter writer(_worker ? _worker->getPayloadFormat() : EPayloadFormat::JSON);
+    writer.reserve(JSON_WRITER_HEAD_SIZE + (out_.size() + in_.size()) * JSON_WRITER_EPC_SIZE);
+    writer.beginObject()
+        .key("H").value("labeledGoods")
+        .key("M").value("setPutOrTakenGoods")
+        .key("A").beginObject()
+            .key("userActionOUT").values(out_)
+            .key("userActionIN").values(in_)
+            .key("param").beginObject()
+                .key("id").number(cooler_id)
+            .endObject();
+    /// Отрпавить JSON на сервер с данными о продуктах; событие сохраняется в журнал до подтверждения сервером.
     if (_worker) {
-        _worker->send(oss.str());
+        _worker->sendEvent(writer);
+    } else {
+        writer.endObject().endObject();
     }
+    LOG(INFO) << toLog(writer);
 }
 
 
 void CommandHandler::sendCurProducts(const std::vector<std::string> &cur_) {
-    std::ostringstream oss;
-    oss << "{\"H\":\"labeledGoods\",\"M\":\"verifyLabelsSynchronization\",\"A\":{";
     std::string cooler_id = "0";
     if (_worker) {
         cooler_id = _worker->getCoolerId();
     }
-    oss << "\"plantId\":\"" << cooler_id << "\",";
-    oss << "\"labels\":[";
-    if (not cur_.empty()) {
-        oss << getLabelsString(cur_);
-    }
-    oss << "]}}";
-    LOG(INFO) << oss.str();
+    JsonWriter writer(_worker ? _worker->getPayloadFormat() : EPayloadFormat::JSON);
+    writer.reserve(JSON_WRITER_HEAD_SIZE + cur_.size() * JSON_WRITER_EPC_SIZE);
+    writer.beginObject()
+        .key("H").value("labeledGoods")
+        .key("M").value("verifyLabelsSynchronization")
+        .key("A").beginObject()
+            .key("plantId").value(cooler_id)
+            .key("labels").values(cur_)
+        .endObject()
+        .endObject();
+    LOG(INFO) << toLog(writer);
     /// Отрпавить JSON на сервер с данными о продуктах.
     if (_worker) {
-        _worker->send(oss.str());
-    }
-}
-
-
-void CommandHandler::handleA(const bpt::ptree &pt_) {
-    /// "A":{"O":[], "I":[], "PlantId": 0}
-    bpt::ptree A_pt = pt_;
-    boost::optional<std::string> opt_PlantId = A_pt.get_optional<std::string>("PlantId");
-    if (opt_PlantId) {
-        std::string cooler_id = "0";
-        if (_worker) {
-            cooler_id = _worker->getCoolerId();
-        }
-        if (opt_PlantId.get() == cooler_id) {
-            /// Проверить наличие поля "O" c массивом изъятых продуктов.
-            boost::optional<bpt::ptree&> opt_O = A_pt.get_child_optional("O");
-            std::vector<std::string> out;
-            if (opt_O) {
-                for (bpt::ptree::value_type &v : A_pt.get_child("O")) {
-                    out.push_back(v.second.data());
-                }
-            }
-            /// Проверить наличие поля "I" c массивом добавленных продуктов.
-            boost::optional<bpt::ptree&> opt_I = A_pt.get_child_optional("I");
-            std::vector<std::string> in;
-            if (opt_I) {
-                for (bpt::ptree::value_type &v : A_pt.get_child("I")) {
-                    in.push_back(v.second.data());
-                }
-            }
-            sendProducts(out, in);
-        } else {
-            LOG(WARNING) << "PlantId is foreign " << opt_PlantId.get();
-        }
-    } else {
-        LOG(ERROR) << "Can`t find PlantId";
-    }
-}
-
-
-void CommandHandler::setRequestsSettings(const bpt::ptree &pt_) {
-    /// "A":{"readAntennsCount":3,"bufReadNumAttempt":2,"updateRecvDataTimeout":10}
-    bpt::ptree A_pt = pt_;
-    boost::optional<size_t> opt_readAntennsCount = A_pt.get_optional<size_t>("readAntennsCount");
-    if (opt_readAntennsCount) {
-        if (_worker) {
-            RfidControllerBase *rfidc = _worker->getRfidController();
-            if (rfidc) {
-                rfidc->setReadAntennsCount(opt_readAntennsCount.get());
-            }
-        }
-    } else {
-        LOG(ERROR) << "Can`t find readAntennsCount";
-    }
-    boost::optional<size_t> opt_bufReadNumAttempt = A_pt.get_optional<size_t>("bufReadNumAttempt");
-    if (opt_bufReadNumAttempt) {
-        if (_worker) {
-            RfidControllerBase *rfidc = _worker->getRfidController();
-            if (rfidc) {
-                rfidc->setBufReadNumAttempt(opt_bufReadNumAttempt.get());
-            }
-        }
-    } else {
-        LOG(ERROR) << "Can`t find bufReadNumAttempt";
-    }
-    boost::optional<size_t> opt_updateRecvDataTimeout = A_pt.get_optional<size_t>("updateRecvDataTimeout");
-    if (opt_updateRecvDataTimeout) {
-        if (_worker) {
-            RfidControllerBase *rfidc = _worker->getRfidController();
-            if (rfidc) {
-                rfidc->setReadAntennsTimeout(opt_updateRecvDataTimeout.get());
-            }
-        }
-    } else {
-        LOG(ERROR) << "Can`t find updateRecvDataTimeout";
-    }
-}
-
-
-void CommandHandler::findBrokenLabels(const bpt::ptree &pt_) {
-    /// "A":{"iterationsNumber":0}
-    bpt::ptree A_pt = pt_;
-    boost::optional<size_t> opt_iterationsNumber = A_pt.get_optional<size_t>("iterationsNumber");
-    if (opt_iterationsNumber) {
-        if (_worker) {
-            RfidControllerBase *rfidc = _worker->getRfidController();
-            if (rfidc) {
-                rfidc->findBrokenLabels(opt_iterationsNumber.get());
-            }
-        }
-    } else {
-        LOG(ERROR) << "Can`t find requestsNumber";
+        _worker->send(writer, ESendLane::STATE, "verifyLabelsSynchronization");
     }
 }
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -350,42 +564,81 @@ CommandHandler::CommandHandler(WorkerBase *worker_)
 
 CommandHandler::~CommandHandler() {
     LOG(DEBUG);
-    /// Остановить таймер завершения инвенторизации по закрытию двери.
-    _stop_inventory_timer.reset();
+    /// Остановить таймеры до исполнителей: их задачи ставят работу в очередь инвенторизации.
+    _close_inventory_timer.reset();
+    /// Таймер завершения инвенторизации изменяется только в потоке своей очереди.
+    _inventory_executor.post([this] {
+        _stop_inventory_timer.reset();
+    });
+    _inventory_executor.wait();
 }
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     
     
 void CommandHandler::handle(const std::string &json_) {    
-    LOG(DEBUG) << json_;
-    /// Отправка старта подключения.
+    handle(json_.data(), json_.size());
+}
+
+
+void CommandHandler::handle(const char *json_, size_t len_) {
+    LOG(DEBUG) << std::string(json_, len_);
     try {
-        bpt::ptree pt;
-        std::stringstream ss(json_);
-        bpt::read_json(ss, pt);
-        if (not pt.empty()) {
-            /// Проверить посылки с "H" и "M"
-            boost::optional<std::string> opt_H = pt.get_optional<std::string>("H");
-            boost::optional<std::string> opt_M = pt.get_optional<std::string>("M");
-            if (opt_H and opt_M) {
-                if (opt_H.get() == "PlantHub") {
-                    handlePlantHub(pt);
-                } else {
-                    LOG(WARNING) << "\"H\" is not PlantHub: " << opt_H.get();
-                }
-            } else {
-                LOG(ERROR) << "Can`t find \"H\" or \"M\" tags: " << json_;
-            }
-        } 
+        /// Разбор без промежуточного потока; поле "A" передаётся обработчику без копирования.
+        handleJson(Json::parse(json_, json_ + len_));
+    } catch (const std::exception &e) {
+        LOG(ERROR) << e.what();
+    }
+}
+
+
+void CommandHandler::handleCbor(const uint8_t *data_, size_t len_) {
+    LOG(DEBUG) << "CBOR: " << len_;
+    Json js;
+    CborReader reader(data_, len_);
+    if (not reader.read(js)) {
+        LOG(ERROR) << reader.what();
+        return;
+    }
+    try {
+        handleJson(js);
     } catch (const std::exception &e) {
         LOG(ERROR) << e.what();
     }
 }
 
 
+void CommandHandler::handleJson(const Json &js_) {
+    const Json *H = field(js_, "H");
+    const Json *M = field(js_, "M");
+    const std::string *H_str = H ? H->get_ptr<const std::string*>() : nullptr;
+    const std::string *M_str = M ? M->get_ptr<const std::string*>() : nullptr;
+    if (H_str and M_str) {
+        if (*H_str == "PlantHub") {
+            Method method = findMethod(*M_str);
+            if (method) {
+                static const Json null_args;
+                const Json *A = field(js_, "A");
+                (this->*method)(A ? *A : null_args);
+            } else {
+                LOG(WARNING) << "\"M\": " << *M_str;
+            }
+        } else {
+            LOG(WARNING) << "\"H\" is not PlantHub: " << *H_str;
+        }
+    } else if (not js_.empty()) {
+        LOG(ERROR) << "Can`t find \"H\" or \"M\" tags: " << js_.dump();
+    }
+}
+
+
 void CommandHandler::restartStopInventoryTimeout() {
     if (_close_inventory_timer) {
         _close_inventory_timer->restart();
     }
 }
 
+
+void CommandHandler::wait() {
+    _inventory_executor.wait();
+    _rfid_executor.wait();
+}
@@ -6,69 +6,228 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
 #include <memory>
+#include <functional>
 
-#include <boost/property_tree/ptree.hpp>
-
+#include "json.hpp"
 #include "Bases.hpp"
 #include "Timer.hpp"
+#include "Executor.hpp"
 
 
 #define INVENTORY_TIMEOUT 5000
 #define CLOSED_TIMEOUT 3000
 
 
-namespace bpt = boost::property_tree;
-
 namespace robocooler {
 namespace driver {
 
 typedef utils::Timer Timer;
 typedef std::shared_ptr<Timer> PTimer;
+typedef utils::Executor Executor;
+typedef nlohmann::json Json;
 
 
 class CommandHandler :
     public CommandHandlerBase {
+public:
+    /// Команда без параметров.
+    struct NoArgs {
+    };
+
+    /// "A":{"O":[], "I":[], "PlantId": 0}
+    struct ProductsArgs {
+        std::string _plant_id;          ///< Идентификатор холодильника.
+        std::vector<std::string> _out;  ///< Изъятые продукты.
+        std::vector<std::string> _in;   ///< Добавленные продукты.
+    };
+
+    /// "A":{"bufReadNumAttempt":3}
+    struct ContentArgs {
+        bool _has_buf_read_num_attempt;
+        size_t _buf_read_num_attempt;   ///< Количество опросов антенн.
+    };
+
+    /// "A":{"frequencyRegion":{"startFrequency":0,"endFrequency":59,"region":1},"powers":[0,1,2,33]}
+    struct RfidConfigArgs {
+        bool _has_region;
+        uint8_t _region;                ///< Частотный регион RfidCmd::ESpektrumRegion.
+        uint8_t _start_freq;            ///< Код начальной частоты.
+        uint8_t _end_freq;              ///< Код конечной частоты.
+        std::vector<uint8_t> _powers;   ///< Мощности антенн, пустой - не менять.
+    };
+
+    /// "A":{"readAntennsCount":3,"bufReadNumAttempt":2,"updateRecvDataTimeout":10,
+    ///      "antennas":[0,1,2,3],"antennaStay":1,"session":2,"sweepPeriod":5}
+    struct RequestsSettingsArgs {
+        bool _has_read_antenns_count;
+        size_t _read_antenns_count;
+        bool _has_buf_read_num_attempt;
+        size_t _buf_read_num_attempt;
+        bool _has_update_recv_data_timeout;
+        size_t _update_recv_data_timeout;
+        bool _has_antennas;
+        std::vector<uint8_t> _antennas;  ///< Последовательность антенн для быстрого переключения.
+        size_t _antenna_stay;
+        bool _has_session;
+        uint8_t _session;
+        size_t _sweep_period;
+    };
+
+    /// "A":{"iterationsNumber":0}
+    struct BrokenLabelsArgs {
+        size_t _iterations_num;
+    };
+
+    /// "A":{"delta":true}
+    struct LabelsSyncModeArgs {
+        bool _is_delta;
+    };
+
+    /// "A":{"version":12}
+    struct LabelsAckArgs {
+        size_t _version;
+    };
+
+    /// "A":{"seq":42}
+    struct EventsAckArgs {
+        size_t _seq;
+    };
+
+    /**
+     * \brief Обработчик команды: разбирает поле "A" и вызывает типизированный метод.
+     */
+    typedef void (CommandHandler::*Method)(const Json &A_);
+
+private:
+    typedef std::function<void(RfidControllerBase*)> RfidTask;
+
     WorkerBase *_worker;
-    PTimer _stop_inventory_timer;
+    Executor _rfid_executor;        ///< Работа с RFID модулем вне сетевого потока, в порядке поступления команд.
+    Executor _inventory_executor;   ///< Запуск и остановка инвенторизации, не ждут запросов к модулю.
+    PTimer _stop_inventory_timer;   ///< Изменяется только в потоке _inventory_executor.
     PTimer _close_inventory_timer;
 
     /**
-     * \brief Метод обработки "H" == "PlantHub" команд.
-     * \param pt_ Содержит готовый к обработке JSON.
+     * \brief Метод разбирает аргументы команды из поля "A" в структуру и вызывает обработчик.
+     */
+    template<class Args, void (CommandHandler::*Handler)(const Args&)>
+    void dispatch(const Json &A_) {
+        Args args;
+        if (parseArgs(A_, args)) {
+            (this->*Handler)(args);
+        }
+    }
+
+    /**
+     * \brief Методы разбора поля "A".
+     * \return false, если обязательные параметры отсутствуют.
+     */
+    static bool parseArgs(const Json &A_, NoArgs &args_);
+    static bool parseArgs(const Json &A_, ProductsArgs &args_);
+    static bool parseArgs(const Json &A_, ContentArgs &args_);
+    static bool parseArgs(const Json &A_, RfidConfigArgs &args_);
+    static bool parseArgs(const Json &A_, RequestsSettingsArgs &args_);
+    static bool parseArgs(const Json &A_, BrokenLabelsArgs &args_);
+    static bool parseArgs(const Json &A_, LabelsSyncModeArgs &args_);
+    static bool parseArgs(const Json &A_, LabelsAckArgs &args_);
+    static bool parseArgs(const Json &A_, EventsAckArgs &args_);
+
+    /**
+     * \brief Метод возвращает обработчик по имени команды "M" или nullptr.
+     */
+    static Method findMethod(const std::string &name_);
+
+    /**
+     * \brief Метод обработки "A" команд администратора: "sendPutOrTakenGoodsByUser".
+     */
+    void putOrTakenGoods(const ProductsArgs &args_);
+
+    void openLeftDoor(const NoArgs &args_);
+    void openRightDoor(const NoArgs &args_);
+    void closeLeftDoor(const NoArgs &args_);
+    void closeRightDoor(const NoArgs &args_);
+
+    /**
+     * \brief Метод открывает дверь и запускает инвенторизацию.
+     */
+    void openDoor(bool is_left_);
+
+    /**
+     * \brief Метод закрывает дверь и запускает итоговую инвенторизацию по таймеру.
+     */
+    void closeDoor(bool is_left_);
+
+    /**
+     * \brief Метод запускает получение текущего содержимого: "getContent".
+     */
+    void getContent(const ContentArgs &args_);
+
+    /**
+     * \brief Метод передаёт настройки в RFID модуль: "configureRFIDDevice".
+     */
+    void setRfidConfig(const RfidConfigArgs &args_);
+
+    /**
+     * \brief Метод отправляет настройки антенн на сервер: "getAntennasConfiguration".
+     */
+    void getAntennasConfiguration(const NoArgs &args_);
+
+    /**
+     * \brief Метод завершения "getAntennasConfiguration": отправляет полученные настройки на сервер.
+     */
+    void sendAntSettings(const std::string &ant_sets_);
+
+    /**
+     * \brief Метод передаёт настройки процесса опроса антенн в RFID модуль: "updateAntennasRequestsSettings".
+     */
+    void setRequestsSettings(const RequestsSettingsArgs &args_);
+
+    /**
+     * \brief Метод запускает процесс выявления плохо определяемых меток: "findBrokenLabels".
+     */
+    void findBrokenLabels(const BrokenLabelsArgs &args_);
+
+    /**
+     * \brief Метод переключает режим синхронизации содержимого: "setLabelsSyncMode".
+     */
+    void setLabelsSyncMode(const LabelsSyncModeArgs &args_);
+
+    /**
+     * \brief Метод передаёт подтверждение версии содержимого: "ackLabelsSynchronization".
      */
-    void handlePlantHub(const bpt::ptree &pt_);
+    void ackLabelsSync(const LabelsAckArgs &args_);
 
     /**
-     * \brief Метод обработки "A" команд администратора.
-     * \param pt_ Готовый к обработке json.
+     * \brief Метод запрашивает полную отправку содержимого при расхождении хеша: "requestLabelsSynchronization".
      */
-    void handleA(const bpt::ptree &pt_);
+    void resyncLabels(const NoArgs &args_);
 
     /**
-     * \brief Метод передаёт настройки в RFID модуль.
-     * \param pt_ Готовый к обработке json.
+     * \brief Метод передаёт подтверждение доставки событий журнала: "ackEvents".
      */
-    void setRfidConfig(const bpt::ptree &pt_);
+    void ackEvents(const EventsAckArgs &args_);
 
     /**
-     * \brief Метод Преобразует массив меток в строку метод для вставки в JSON.
-     * \param labels_ Массив меток.
+     * \brief Метод ставит работу с RFID модулем в очередь исполнителя. Ожидание последовательного порта
+     *        не задерживает сетевой поток: двери и ping обрабатываются, пока выполняется запрос к модулю.
+     *        Ответ серверу отправляет сама задача по завершении.
      */
-    std::string getLabelsString(const std::vector<std::string> &labels_);
-            
+    void postRfid(const RfidTask &task_);
+
     /**
-     * \brief Метод передаёт настройки процесса опроса антенн в RFID модуль.
-     * \param pt_ json формата "A":{"requestsNumber":4,"delay":1234}.
+     * \brief Метод ставит запуск или остановку инвенторизации в отдельную очередь: открытие и закрытие дверей
+     *        не ждут длительных запросов к модулю. Задачи этой очереди выполняются по порядку между собой.
      */
-    void setRequestsSettings(const bpt::ptree &pt_);
+    void postInventory(const RfidTask &task_);
 
     /**
-     * \brief Метод запускает процесс выявления плохо определяемых меток.
-     * \param pt_ json формата "A":{"iterationsNumber":0}.
+     * \brief Метод ставит задачу task_ в очередь executor_, если RFID контроллер доступен.
      */
-    void findBrokenLabels(const bpt::ptree &pt_);
+    void post(Executor &executor_, const RfidTask &task_);
 
 public:
     /**
@@ -77,13 +236,33 @@ public:
      */
     explicit CommandHandler(WorkerBase *worker_);
     virtual ~CommandHandler();
-    
+
     /**
-     * \brief Метод отправляет кипелайв в ответ на сообщения и кипелайвы от сервера.
+     * \brief Метод разбирает json один раз и передаёт команду "M" обработчику из таблицы методов.
      * \param json_ Принятый json на обработку.
      */
     void handle(const std::string &json_);
-    
+
+    /**
+     * \brief Метод разбирает json непосредственно из буфера приёма, без копирования в строку.
+     * \param json_ Начало json.
+     * \param len_  Размер json.
+     */
+    void handle(const char *json_, size_t len_);
+
+    /**
+     * \brief Метод разбирает посылку CBOR двоичного режима канала.
+     * \param data_ Начало посылки.
+     * \param len_  Размер посылки.
+     */
+    void handleCbor(const uint8_t *data_, size_t len_);
+
+    /**
+     * \brief Метод передаёт разобранную команду "M" обработчику из таблицы методов.
+     * \param js_ Разобранная посылка.
+     */
+    void handleJson(const Json &js_);
+
     /**
      * \brief Метод отправляет добавленные и изъятые продукты.
      * \param out_ Массив идентификаторов изъятых продуктов.
@@ -101,7 +280,11 @@ public:
      * \brief Метод перезапускает таймер завершения инвентаризации.
      */
     void restartStopInventoryTimeout();
+
+    /**
+     * \brief Метод дожидается выполнения поставленной работы с RFID модулем.
+     */
+    void wait();
 };
 } // driver
 } // robocooler
-
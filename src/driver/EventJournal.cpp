@@ -0,0 +1,487 @@
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "Log.hpp"
+#include "EventJournal.hpp"
+
+
+using namespace robocooler;
+using namespace driver;
+
+
+namespace {
+static const uint32_t JOURNAL_MAGIC = 0x4a435652; ///< "RVCJ".
+static const uint32_t JOURNAL_VERSION = 2;        ///< 2 - кодирование посылки в записи.
+static const size_t JOURNAL_HEAD_SIZE = 64;       ///< Заголовок с запасом, записи начинаются с выровненного смещения.
+static const size_t JOURNAL_ALIGN = 8;
+
+/// Виды записей.
+static const uint8_t RECORD_EVENT = 0;
+static const uint8_t RECORD_SNAPSHOT = 1;
+static const uint8_t RECORD_PAD = 2;               ///< Заполнение хвоста кольца, следующая запись - в начале.
+
+
+size_t align(size_t size_) {
+    return (size_ + JOURNAL_ALIGN - 1) & ~(JOURNAL_ALIGN - 1);
+}
+} /// namespace
+
+
+struct EventJournal::Head {
+    uint32_t _magic;
+    uint32_t _version;
+    uint64_t _capacity;  ///< Размер области записей.
+    uint64_t _begin;     ///< Смещение первой неподтверждённой записи.
+    uint64_t _acked_seq; ///< Номер, подтверждённый сервером.
+    uint64_t _last_seq;  ///< Номер последней записи на момент сохранения заголовка.
+    uint32_t _is_clean;  ///< Журнал закрыт штатно.
+    uint32_t _reserved;
+};
+
+
+struct EventJournal::Record {
+    uint32_t _crc;      ///< crc32 последующих полей, ключа и посылки.
+    uint32_t _size;     ///< Размер посылки; для заполнения - размер хвоста за заголовком записи.
+    uint64_t _seq;      ///< Номер записи; заполнение несёт номер следующей за ним записи.
+    uint8_t _kind;      ///< Вид записи.
+    uint8_t _key_size;  ///< Размер ключа снимка.
+    uint8_t _format;    ///< Кодирование посылки EPayloadFormat.
+    uint8_t _reserved;
+    uint32_t _reserved2;
+
+    const char* key() const {
+        return reinterpret_cast<const char*>(this + 1);
+    }
+
+    const char* message() const {
+        return key() + _key_size;
+    }
+
+    size_t total() const {
+        return _kind == RECORD_PAD ? sizeof(Record) + _size : align(sizeof(Record) + _key_size + _size);
+    }
+
+    uint32_t crc() const {
+        const Bytef *fields = reinterpret_cast<const Bytef*>(&_size);
+        uLong res = crc32(0L, Z_NULL, 0);
+        res = crc32(res, fields, static_cast<uInt>(sizeof(Record) - sizeof(_crc)));
+        if (_kind not_eq RECORD_PAD) {
+            res = crc32(res, reinterpret_cast<const Bytef*>(key()), static_cast<uInt>(_key_size + _size));
+        }
+        return static_cast<uint32_t>(res);
+    }
+};
+
+
+bool EventJournal::open(const std::string &path_, size_t capacity_) {
+    _fd = ::open(path_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (_fd < 0) {
+        LOG(ERROR) << "Can`t open journal " << path_ << ": " << strerror(errno);
+        return false;
+    }
+    _capacity = align(capacity_);
+    _map_size = JOURNAL_HEAD_SIZE + _capacity;
+    struct stat st;
+    bool is_new = (fstat(_fd, &st) not_eq 0 or static_cast<size_t>(st.st_size) not_eq _map_size);
+    if (is_new) {
+        /// Место на диске резервируется сразу: запись в отображение несуществующего блока завершится SIGBUS.
+        int res = ftruncate(_fd, 0);
+        if (res == 0) {
+            res = posix_fallocate(_fd, 0, static_cast<off_t>(_map_size));
+        }
+        if (res not_eq 0) {
+            LOG(ERROR) << "Can`t allocate journal " << path_ << ": " << strerror(res > 0 ? res : errno);
+            return false;
+        }
+    }
+    void *map = mmap(nullptr, _map_size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (map == MAP_FAILED) {
+        LOG(ERROR) << "Can`t map journal " << path_ << ": " << strerror(errno);
+        return false;
+    }
+    _map = static_cast<uint8_t*>(map);
+    _head = reinterpret_cast<Head*>(_map);
+    _data = _map + JOURNAL_HEAD_SIZE;
+    if (is_new or _head->_magic not_eq JOURNAL_MAGIC or _head->_version not_eq JOURNAL_VERSION or
+        _head->_capacity not_eq _capacity) {
+        LOG(WARNING) << "Journal " << path_ << " is created.";
+        memset(_head, 0, JOURNAL_HEAD_SIZE);
+        _head->_magic = JOURNAL_MAGIC;
+        _head->_version = JOURNAL_VERSION;
+        _head->_capacity = _capacity;
+        _head->_is_clean = 1;
+    }
+    return true;
+}
+
+
+const EventJournal::Record* EventJournal::record(size_t pos_, uint64_t prev_seq_) const {
+    if (_capacity - pos_ < sizeof(Record)) {
+        return nullptr;
+    }
+    const Record *rec = reinterpret_cast<const Record*>(_data + pos_);
+    if (rec->_kind > RECORD_PAD or rec->_seq <= prev_seq_ or rec->_size > _capacity or
+        rec->total() > _capacity - pos_ or rec->_crc not_eq rec->crc()) {
+        return nullptr;
+    }
+    return rec;
+}
+
+
+size_t EventJournal::next(size_t pos_) const {
+    size_t pos = pos_ + reinterpret_cast<const Record*>(_data + pos_)->total();
+    if (_capacity - pos < sizeof(Record) or
+        (pos not_eq _end and reinterpret_cast<const Record*>(_data + pos)->_kind == RECORD_PAD)) {
+        return 0;
+    }
+    return pos;
+}
+
+
+void EventJournal::recover() {
+    _begin = static_cast<size_t>(_head->_begin);
+    if (_begin >= _capacity or _begin % JOURNAL_ALIGN) {
+        _begin = 0;
+    }
+    _end = _begin;
+    uint64_t prev = _head->_acked_seq;
+    size_t pos = _begin;
+    size_t scanned = 0;
+    while (scanned < _capacity) {
+        if (_capacity - pos < sizeof(Record)) {
+            scanned += _capacity - pos;
+            pos = 0;
+        }
+        const Record *rec = record(pos, prev);
+        if (not rec) {
+            break;
+        }
+        scanned += rec->total();
+        if (rec->_kind == RECORD_PAD) {
+            prev = rec->_seq - 1;
+            pos = 0;
+            continue;
+        }
+        ++_records;
+        prev = rec->_seq;
+        pos += rec->total();
+        _end = pos;
+    }
+    if (_records == 0) {
+        _begin = _end = 0;
+    }
+    _last_seq = std::max(std::max(prev, _head->_last_seq), _head->_acked_seq);
+    if (not _head->_is_clean) {
+        /// События, отправленные до сбоя, но не сохранённые, не должны совпасть номерами с новыми.
+        _last_seq += EVENT_JOURNAL_SEQ_GAP;
+        LOG(WARNING) << "Journal was not closed properly, sequence is advanced to " << _last_seq;
+    }
+    _head->_begin = _begin;
+    _head->_last_seq = _last_seq;
+    _head->_is_clean = 0;
+    _is_dirty = true;
+    LOG(INFO) << "Journal: " << _records << " unacked records, acked " << _head->_acked_seq << ", last " << _last_seq;
+}
+
+
+void EventJournal::syncProcess() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (_is_run) {
+        _sync_cond.wait_for(lock, std::chrono::milliseconds(EVENT_JOURNAL_SYNC_PERIOD), [this] {
+            return not _is_run or _unsynced >= EVENT_JOURNAL_SYNC_BATCH;
+        });
+        if (_is_dirty) {
+            sync(lock);
+        }
+    }
+}
+
+
+bool EventJournal::sync(std::unique_lock<std::mutex> &lock_) {
+    _is_dirty = false;
+    _unsynced = 0;
+    /// Отображение не перемещается, запись на диск идёт без блокировки добавления событий.
+    lock_.unlock();
+    int res = msync(_map, _map_size, MS_SYNC);
+    int err = errno;
+    lock_.lock();
+    ++_syncs;
+    if (res not_eq 0) {
+        LOG(ERROR) << "Journal sync error: " << strerror(err);
+        _is_dirty = true;
+        return false;
+    }
+    return true;
+}
+
+
+void EventJournal::dropFirst() {
+    ++_dropped;
+    --_records;
+    _begin = _records ? next(_begin) : 0;
+    if (not _records) {
+        _end = 0;
+    }
+    _head->_begin = _begin;
+}
+
+
+bool EventJournal::compact() {
+    /// Последний снимок каждого ключа.
+    std::unordered_map<std::string, uint64_t> snapshots;
+    size_t pos = _begin;
+    for (size_t i = 0; i < _records; ++i) {
+        const Record *rec = reinterpret_cast<const Record*>(_data + pos);
+        if (rec->_kind == RECORD_SNAPSHOT) {
+            snapshots[std::string(rec->key(), rec->_key_size)] = rec->_seq;
+        }
+        pos = next(pos);
+    }
+    std::vector<uint8_t> live;
+    size_t records = 0;
+    pos = _begin;
+    for (size_t i = 0; i < _records; ++i) {
+        const Record *rec = reinterpret_cast<const Record*>(_data + pos);
+        if (rec->_kind not_eq RECORD_SNAPSHOT or snapshots[std::string(rec->key(), rec->_key_size)] == rec->_seq) {
+            const uint8_t *begin = _data + pos;
+            live.insert(live.end(), begin, begin + rec->total());
+            ++records;
+        }
+        pos = next(pos);
+    }
+    if (records == _records) {
+        return false;
+    }
+    /// Последняя запись всегда остаётся, поэтому устаревшие данные за новым концом кольца
+    /// имеют меньшие номера и отбрасываются при открытии.
+    memcpy(_data, live.data(), live.size());
+    _compacted += _records - records;
+    LOG(INFO) << "Journal is compacted: " << _records - records << " superseded snapshots are removed.";
+    _records = records;
+    _begin = 0;
+    _end = live.size();
+    _head->_begin = 0;
+    _is_dirty = true;
+    return true;
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+EventJournal::EventJournal(const std::string &path_, size_t capacity_)
+    : _fd(-1)
+    , _map(nullptr)
+    , _map_size(0)
+    , _head(nullptr)
+    , _data(nullptr)
+    , _capacity(0)
+    , _begin(0)
+    , _end(0)
+    , _records(0)
+    , _last_seq(0)
+    , _dropped(0)
+    , _compacted(0)
+    , _syncs(0)
+    , _unsynced(0)
+    , _is_dirty(false)
+    , _is_run(false) {
+    if (not open(path_, capacity_)) {
+        if (_fd >= 0) {
+            close(_fd);
+            _fd = -1;
+        }
+        return;
+    }
+    recover();
+    _is_run = true;
+    _sync_thread = std::thread(&EventJournal::syncProcess, this);
+}
+
+
+EventJournal::~EventJournal() {
+    if (not _map) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _is_run = false;
+        _sync_cond.notify_one();
+    }
+    _sync_thread.join();
+    _head->_last_seq = _last_seq;
+    _head->_is_clean = 1;
+    msync(_map, _map_size, MS_SYNC);
+    munmap(_map, _map_size);
+    close(_fd);
+}
+
+
+bool EventJournal::isOpened() const {
+    return _map not_eq nullptr;
+}
+
+
+uint64_t EventJournal::getLastSeq() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _last_seq;
+}
+
+
+bool EventJournal::append(uint64_t seq_, const std::string &message_, EPayloadFormat format_, const char *snapshot_key_) {
+    size_t key_size = snapshot_key_ ? strnlen(snapshot_key_, UINT8_MAX) : 0;
+    size_t total = align(sizeof(Record) + key_size + message_.size());
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (not _map or seq_ <= _last_seq or total > _capacity) {
+        LOG(ERROR) << "Can`t journal record " << seq_ << ": " << message_.size();
+        return false;
+    }
+    /// Место под запись: за последней записью, либо с начала кольца, если хвост мал.
+    size_t pos = _capacity;
+    bool need_pad = false;
+    bool is_compacted = false;
+    while (pos == _capacity) {
+        if (not _records) {
+            _begin = _end = 0;
+            _head->_begin = 0;
+            pos = 0;
+        } else if (_end > _begin) {
+            if (total <= _capacity - _end) {
+                pos = _end;
+            } else if (total <= _begin) {
+                pos = 0;
+                need_pad = true;
+            }
+        } else if (_end + total <= _begin) {
+            pos = _end;
+        }
+        if (pos == _capacity and not is_compacted) {
+            /// Заменённые снимки освобождают место раньше, чем вытесняются события.
+            is_compacted = true;
+            if (compact()) {
+                continue;
+            }
+        }
+        if (pos == _capacity) {
+            LOG(WARNING) << "Journal is full, record " << reinterpret_cast<const Record*>(_data + _begin)->_seq
+                         << " is dropped.";
+            dropFirst();
+        }
+    }
+    if (need_pad and _capacity - _end >= sizeof(Record)) {
+        Record *pad = reinterpret_cast<Record*>(_data + _end);
+        memset(pad, 0, sizeof(Record));
+        pad->_size = static_cast<uint32_t>(_capacity - _end - sizeof(Record));
+        pad->_seq = seq_;
+        pad->_kind = RECORD_PAD;
+        pad->_crc = pad->crc();
+    }
+    Record *rec = reinterpret_cast<Record*>(_data + pos);
+    memset(rec, 0, sizeof(Record));
+    rec->_size = static_cast<uint32_t>(message_.size());
+    rec->_seq = seq_;
+    rec->_kind = snapshot_key_ ? RECORD_SNAPSHOT : RECORD_EVENT;
+    rec->_key_size = static_cast<uint8_t>(key_size);
+    rec->_format = static_cast<uint8_t>(format_);
+    memcpy(_data + pos + sizeof(Record), snapshot_key_, key_size);
+    memcpy(_data + pos + sizeof(Record) + key_size, message_.data(), message_.size());
+    rec->_crc = rec->crc();
+    _end = pos + total;
+    ++_records;
+    _last_seq = seq_;
+    _head->_last_seq = seq_;
+    _is_dirty = true;
+    if (++_unsynced >= EVENT_JOURNAL_SYNC_BATCH) {
+        _sync_cond.notify_one();
+    }
+    return true;
+}
+
+
+void EventJournal::ack(uint64_t seq_) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (not _map or seq_ <= _head->_acked_seq) {
+        return;
+    }
+    if (seq_ > _last_seq) {
+        LOG(WARNING) << "Ack " << seq_ << " is beyond last record " << _last_seq;
+        seq_ = _last_seq;
+    }
+    while (_records and reinterpret_cast<const Record*>(_data + _begin)->_seq <= seq_) {
+        --_records;
+        _begin = _records ? next(_begin) : 0;
+    }
+    if (not _records) {
+        _end = 0;
+    }
+    _head->_begin = _begin;
+    _head->_acked_seq = seq_;
+    _is_dirty = true;
+}
+
+
+size_t EventJournal::replay(const Handler &handler_) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<const Record*> recs;
+    recs.reserve(_records);
+    /// Из снимков с одним ключом отправляется только последний.
+    std::unordered_map<std::string, uint64_t> snapshots;
+    size_t pos = _begin;
+    for (size_t i = 0; i < _records; ++i) {
+        const Record *rec = reinterpret_cast<const Record*>(_data + pos);
+        recs.push_back(rec);
+        if (rec->_kind == RECORD_SNAPSHOT) {
+            snapshots[std::string(rec->key(), rec->_key_size)] = rec->_seq;
+        }
+        pos = next(pos);
+    }
+    size_t count = 0;
+    std::string key;
+    std::string message;
+    for (const Record *rec : recs) {
+        if (rec->_kind == RECORD_SNAPSHOT) {
+            key.assign(rec->key(), rec->_key_size);
+            if (snapshots[key] not_eq rec->_seq) {
+                continue;
+            }
+        }
+        message.assign(rec->message(), rec->_size);
+        handler_(rec->_seq, message, static_cast<EPayloadFormat>(rec->_format),
+                 rec->_kind == RECORD_SNAPSHOT ? key.c_str() : nullptr);
+        ++count;
+    }
+    return count;
+}
+
+
+void EventJournal::sync() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_map and _is_dirty) {
+        sync(lock);
+    }
+}
+
+
+EventJournalStats EventJournal::getStats() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    EventJournalStats stats;
+    stats._records = _records;
+    stats._used = 0;
+    if (_records) {
+        stats._used = _end > _begin ? _end - _begin : _capacity - _begin + _end;
+    }
+    stats._last_seq = _last_seq;
+    stats._acked_seq = _head ? _head->_acked_seq : 0;
+    stats._dropped = _dropped;
+    stats._compacted = _compacted;
+    stats._syncs = _syncs;
+    return stats;
+}
@@ -0,0 +1,155 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Журнал исходящих событий на диске для отправки после восстановления связи.
+ * \author Величко Ростислав
+ * \date   07.25.2017
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+
+#include "Bases.hpp"
+
+
+static const size_t EVENT_JOURNAL_SIZE = 1024 * 1024;  ///< Объём области записей журнала [байт].
+static const size_t EVENT_JOURNAL_SYNC_PERIOD = 500;   ///< Предельная задержка сохранения записей на диск [милисекунды].
+static const size_t EVENT_JOURNAL_SYNC_BATCH = 16;     ///< Количество записей, после которого сохранение не ждёт периода.
+static const uint64_t EVENT_JOURNAL_SEQ_GAP = 1024;    ///< Пропуск номеров после аварийного завершения.
+
+
+namespace robocooler {
+namespace driver {
+
+/**
+ * \brief Счётчики журнала.
+ */
+struct EventJournalStats {
+    size_t _records;     ///< Неподтверждённых записей.
+    size_t _used;        ///< Занято области записей [байт].
+    uint64_t _last_seq;  ///< Номер последней записи.
+    uint64_t _acked_seq; ///< Номер, подтверждённый сервером.
+    uint64_t _dropped;   ///< Неподтверждённых записей вытеснено при переполнении.
+    uint64_t _compacted; ///< Снимков, заменённых более новыми, удалено сжатием.
+    uint64_t _syncs;     ///< Сохранений на диск.
+};
+
+
+/**
+ * \brief Журнал - файл фиксированного размера, отображённый в память: заголовок и кольцо записей.
+ *        Запись - копирование в отображение под мьютексом, без системных вызовов; на диск записи сохраняет
+ *        отдельный поток пачками через msync. Каждая запись несёт номер события и crc32, при открытии
+ *        журнал просматривается от начала до первой повреждённой записи или записи с номером не больше
+ *        предыдущего - так отбрасываются недописанные и устаревшие данные кольца.
+ *        Подтверждение сервера освобождает место в кольце без перезаписи данных.
+ *        Снимки содержимого хранятся наравне с событиями, но при повторной отправке из снимков с одним
+ *        ключом передаётся только последний. При переполнении кольцо сначала сжимается: снимки, заменённые
+ *        более новыми, удаляются, остальные записи переписываются с начала кольца. Самые старые
+ *        неподтверждённые события вытесняются, только если места не хватает и после сжатия.
+ */
+class EventJournal {
+    struct Head;
+    struct Record;
+
+    std::mutex _mutex;
+    int _fd;
+    uint8_t *_map;      ///< Отображение файла.
+    size_t _map_size;   ///< Размер отображения [байт].
+    Head *_head;        ///< Заголовок в отображении.
+    uint8_t *_data;     ///< Область записей в отображении.
+    size_t _capacity;   ///< Размер области записей [байт].
+    size_t _begin;      ///< Смещение первой неподтверждённой записи.
+    size_t _end;        ///< Смещение для очередной записи.
+    size_t _records;    ///< Количество записей в кольце.
+    uint64_t _last_seq; ///< Номер последней записи.
+    uint64_t _dropped;
+    uint64_t _compacted;
+    uint64_t _syncs;
+
+    std::condition_variable _sync_cond;
+    size_t _unsynced;   ///< Записей с момента последнего сохранения.
+    bool _is_dirty;     ///< Отображение изменено после последнего сохранения.
+    bool _is_run;
+    std::thread _sync_thread;
+
+    bool open(const std::string &path_, size_t capacity_);
+    void recover();
+    void syncProcess();
+    bool sync(std::unique_lock<std::mutex> &lock_);
+
+    /**
+     * \brief Метод возвращает запись по смещению, если она цела и следует за записью с номером prev_seq_.
+     */
+    const Record* record(size_t pos_, uint64_t prev_seq_) const;
+    size_t next(size_t pos_) const;
+    void dropFirst();
+
+    /**
+     * \brief Метод удаляет снимки, заменённые более новыми с тем же ключом, и переписывает остальные записи
+     *        с начала кольца в прежнем порядке.
+     * \return false, если удалять нечего.
+     */
+    bool compact();
+
+public:
+    /**
+     * \brief Обработчик повторной отправки.
+     * \param seq_          Номер записи.
+     * \param message_      Посылка в том виде, в каком была сохранена.
+     * \param format_       Кодирование, с которым посылка сохранена.
+     * \param snapshot_key_ Ключ снимка или nullptr для события.
+     */
+    typedef std::function<void(uint64_t seq_, const std::string &message_, EPayloadFormat format_,
+                               const char *snapshot_key_)> Handler;
+
+    /**
+     * \param path_     Путь к файлу журнала; файл создаётся или пересоздаётся при несовпадении размера.
+     * \param capacity_ Объём области записей [байт].
+     */
+    explicit EventJournal(const std::string &path_, size_t capacity_ = EVENT_JOURNAL_SIZE);
+    ~EventJournal();
+
+    bool isOpened() const;
+
+    /**
+     * \brief Метод возвращает номер последней записи; номер очередной записи должен быть больше.
+     */
+    uint64_t getLastSeq();
+
+    /**
+     * \brief Метод сохраняет посылку. Не ждёт записи на диск.
+     * \param seq_          Номер записи, больше номера предыдущей.
+     * \param format_       Кодирование посылки.
+     * \param snapshot_key_ Ключ снимка или nullptr для события.
+     * \return false, если журнал не открыт, номер не возрастает или посылка больше журнала.
+     */
+    bool append(uint64_t seq_, const std::string &message_, EPayloadFormat format_, const char *snapshot_key_ = nullptr);
+
+    /**
+     * \brief Метод принимает подтверждение сервера: записи с номерами до seq_ включительно больше не нужны.
+     */
+    void ack(uint64_t seq_);
+
+    /**
+     * \brief Метод передаёт обработчику неподтверждённые записи по возрастанию номеров.
+     * \return Количество переданных записей.
+     */
+    size_t replay(const Handler &handler_);
+
+    /**
+     * \brief Метод сохраняет изменения на диск немедленно.
+     */
+    void sync();
+
+    EventJournalStats getStats();
+};
+
+typedef std::shared_ptr<EventJournal> PEventJournal;
+} /// driver
+} /// robocooler
@@ -1,9 +1,3 @@
-#include <utility>
-
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/json_parser.hpp>
-#include <boost/optional/optional.hpp>
-
 #include "Log.hpp"
 #include "JsonExtractor.hpp"
 
@@ -12,63 +6,88 @@ using namespace robocooler;
 using namespace driver;
 
 
-JsonExtractor::JsonExtractor(const OnJsonFunc &on_json_fn_) 
-    : _on_json_fn(on_json_fn_) {
+void JsonExtractor::compact() {
+    if (not _depth) {
+        /// Незавершённого объекта нет: очистка сохраняет выделенную память.
+        _buf.clear();
+        _scan = 0;
+        _begin = 0;
+    } else if (_begin and _begin * 2 >= _buf.size()) {
+        /// Сдвиг не чаще, чем буфер удваивается относительно незавершённого объекта.
+        _buf.erase(0, _begin);
+        _scan -= _begin;
+        _begin = 0;
+    }
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+JsonExtractor::JsonExtractor(const OnJsonFunc &on_json_fn_)
+    : _on_json_fn(on_json_fn_)
+    , _scan(0)
+    , _begin(0)
+    , _depth(0)
+    , _in_string(false)
+    , _is_escape(false) {
 }
 
 
 void JsonExtractor::onMessage(const std::string &msg_) {
-    //LOG(DEBUG) << "I:" << msg;
-    typedef std::pair<size_t, size_t> Pair;
-    typedef std::string::size_type SizeType;
+    onMessage(msg_.data(), msg_.size());
+}
+
 
-    try {
-        _buf += msg_;
-        LOG(DEBUG) << _buf;
-        std::vector<uint8_t> tmp(_buf.begin(), _buf.end());
-        if (not tmp.empty()) {
-            /// Найти крайние парные cкобки.
-            std::vector<Pair> json_poses;
-            for (size_t pos = 0; pos < tmp.size(); ++pos) {
-                if (tmp[pos] == static_cast<uint8_t>('{')) { ///< Найти открывающую скобку.
-                    _stack.push(pos);
-                } else if (tmp[pos] == static_cast<uint8_t>('}')) { ///< Найти закрывающую скобку.
-                    if (not _stack.empty()) {
-                        size_t begin = _stack.top();
-                        _stack.pop();
-                        if (_stack.empty()) { ///< Если стек пустой в данном месте - закрывающая скобка найдена.
-                            json_poses.push_back(std::make_pair(begin, pos + 1));
-                        }
-                    } else {
-                        LOG(ERROR) << "Bad JSON data.";
-                        clear();
-                        break;
-                    }
-                }
+void JsonExtractor::onMessage(const char *data_, size_t len_) {
+    _buf.append(data_, len_);
+    const char *buf = _buf.data();
+    size_t size = _buf.size();
+    for (size_t pos = _scan; pos < size; ++pos) {
+        char c = buf[pos];
+        if (not _depth) {
+            /// Вне объекта ищется только начало следующего объекта.
+            if (c == '{') {
+                _begin = pos;
+                _depth = 1;
+            } else if (c == '}') {
+                LOG(ERROR) << "Bad JSON data.";
             }
-            /// Если найдены полные json - обработать их.
-            if (not json_poses.empty()) {
-                /// Обработать json - ы.
-                for (Pair pair: json_poses) {
-                    std::string json(reinterpret_cast<char*>(&tmp[pair.first]), reinterpret_cast<char*>(&tmp[pair.second]));
-                    LOG(DEBUG) << "C=" << json;
-                    _on_json_fn(json);
-                }
-                /// Очистить обработанную часть буфера.
-                if (json_poses.rbegin()->second <= _buf.size()) {
-                    _stack = Stack();
-                    _buf = _buf.substr(static_cast<SizeType>(json_poses.rbegin()->second)); 
-                    //LOG(DEBUG) << "B=" << _buf;
-                }
+        } else if (_in_string) {
+            if (_is_escape) {
+                _is_escape = false;
+            } else if (c == '\\') {
+                _is_escape = true;
+            } else if (c == '"') {
+                _in_string = false;
+            }
+        } else if (c == '"') {
+            _in_string = true;
+        } else if (c == '{') {
+            ++_depth;
+        } else if (c == '}' and not --_depth) {
+            JsonView json = {buf + _begin, pos + 1 - _begin};
+            LOG(DEBUG) << "C=" << json.toString();
+            try {
+                _on_json_fn(json);
+            } catch (std::exception &e) {
+                LOG(ERROR) << e.what();
             }
         }
-    } catch (std::exception &e) {
-        LOG(ERROR) << e.what();
     }
+    _scan = size;
+    if (_depth and size - _begin > JSON_EXTRACTOR_MAX_SIZE) {
+        LOG(ERROR) << "JSON is too large: " << size - _begin;
+        clear();
+        return;
+    }
+    compact();
 }
 
 
 void JsonExtractor::clear() {
-    _buf = "";
-    _stack = Stack();
+    _buf.clear();
+    _scan = 0;
+    _begin = 0;
+    _depth = 0;
+    _in_string = false;
+    _is_escape = false;
 }
@@ -6,36 +6,69 @@
 
 #pragma once
 
+#include <cstddef>
 #include <functional>
 #include <string>
-#include <stack>
+
+
+static const size_t JSON_EXTRACTOR_MAX_SIZE = 1 << 20;  ///< Предельный размер незавершённой посылки [байт].
+
 
 namespace robocooler {
 namespace driver {
-    
-typedef std::function<void(const std::string&)> OnJsonFunc;
-typedef std::stack<size_t> Stack;
 
-    
+/**
+ * \brief Невладеющее представление выделенного json в буфере извлекателя.
+ *        Действительно только во время вызова функтора OnJsonFunc.
+ */
+struct JsonView {
+    const char *_data;
+    size_t _size;
+
+    std::string toString() const {
+        return std::string(_data, _size);
+    }
+};
+
+typedef std::function<void(const JsonView&)> OnJsonFunc;
+
+
+/**
+ * \brief Извлекатель продолжает разбор с места остановки: каждый принятый байт просматривается один раз.
+ *        Скобки внутри строковых литералов (с учётом экранирования) не учитываются.
+ *        Байты вне объектов верхнего уровня (разделители посылок) пропускаются.
+ */
 class JsonExtractor {
     OnJsonFunc _on_json_fn; ///< Функтор принимающий готовый json.
-    std::string _buf; ///< Буфер принятых данных.
-    Stack _stack; ///< Глобальный контроль JSON посылок.
-    
+    std::string _buf;       ///< Буфер принятых данных.
+    size_t _scan;           ///< Позиция продолжения разбора в _buf.
+    size_t _begin;          ///< Начало незавершённого объекта в _buf.
+    size_t _depth;          ///< Глубина вложенности скобок, 0 - вне объекта.
+    bool _in_string;        ///< Разбор внутри строкового литерала.
+    bool _is_escape;        ///< Предыдущий символ литерала - обратная косая черта.
+
+    /**
+     * \brief Метод удаляет из буфера обработанные данные: целиком вне объекта или
+     *        сдвигом, когда обработанная часть превышает половину буфера.
+     */
+    void compact();
+
 public:
     /**
-     * \brief Конструктор инициализирует функтор, в который передаётся готовый json. 
+     * \brief Конструктор инициализирует функтор, в который передаётся готовый json.
      */
     JsonExtractor(const OnJsonFunc &on_json_fn_);
 
     /**
-     * \brief Метод вызыватеся при получении очередного блока данных с кусками JSON. 
+     * \brief Метод вызыватеся при получении очередного блока данных с кусками JSON.
+     *        Функтор не должен вызывать onMessage того же извлекателя.
      * \param msg_ Входная строка необработанных данных.
      */
     void onMessage(const std::string &msg_);
-    
+    void onMessage(const char *data_, size_t len_);
+
     /**
-     * \brief Метод выполняет очистку состояний и буферов при ошибках снаружи. 
+     * \brief Метод выполняет очистку состояний и буферов при ошибках снаружи.
      */
     void clear();
 };
@@ -0,0 +1,298 @@
+#include <cstring>
+#include <limits>
+
+#include "JsonWriter.hpp"
+
+
+using namespace robocooler;
+using namespace driver;
+
+
+namespace {
+static const char HEX_DIGITS[] = "0123456789abcdef";
+} /// namespace
+
+
+void JsonWriter::separate() {
+    if (_need_comma and _format == EPayloadFormat::JSON) {
+        _buf.push_back(',');
+    }
+    _need_comma = true;
+}
+
+
+void JsonWriter::escape(const char *str_, size_t len_) {
+    _buf.push_back('"');
+    for (size_t i = 0; i < len_; ++i) {
+        unsigned char c = static_cast<unsigned char>(str_[i]);
+        if (c == '"' or c == '\\') {
+            _buf.push_back('\\');
+            _buf.push_back(static_cast<char>(c));
+        } else if (c == '\n') {
+            _buf.append("\\n", 2);
+        } else if (c == '\r') {
+            _buf.append("\\r", 2);
+        } else if (c == '\t') {
+            _buf.append("\\t", 2);
+        } else if (c < 0x20) {
+            _buf.append("\\u00", 4);
+            _buf.push_back(HEX_DIGITS[c >> 4]);
+            _buf.push_back(HEX_DIGITS[c & 0x0f]);
+        } else {
+            _buf.push_back(static_cast<char>(c));
+        }
+    }
+    _buf.push_back('"');
+}
+
+
+void JsonWriter::header(uint8_t major_, uint64_t val_) {
+    uint8_t major = static_cast<uint8_t>(major_ << 5);
+    if (val_ < 24) {
+        _buf.push_back(static_cast<char>(major | val_));
+        return;
+    }
+    size_t len = 8;
+    if (val_ <= 0xff) {
+        _buf.push_back(static_cast<char>(major | 24));
+        len = 1;
+    } else if (val_ <= 0xffff) {
+        _buf.push_back(static_cast<char>(major | 25));
+        len = 2;
+    } else if (val_ <= 0xffffffff) {
+        _buf.push_back(static_cast<char>(major | 26));
+        len = 4;
+    } else {
+        _buf.push_back(static_cast<char>(major | 27));
+    }
+    while (len) {
+        _buf.push_back(static_cast<char>(val_ >> (--len * 8)));
+    }
+}
+
+
+void JsonWriter::string(const char *str_, size_t len_) {
+    if (_format == EPayloadFormat::CBOR) {
+        header(3, len_);
+        _buf.append(str_, len_);
+    } else {
+        escape(str_, len_);
+    }
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+JsonWriter::JsonWriter(EPayloadFormat format_)
+    : _need_comma(false)
+    , _format(format_) {
+}
+
+
+void JsonWriter::reserve(size_t size_) {
+    _buf.reserve(size_);
+}
+
+
+void JsonWriter::clear() {
+    _buf.clear();
+    _need_comma = false;
+}
+
+
+JsonWriter& JsonWriter::beginObject() {
+    separate();
+    _buf.push_back(_format == EPayloadFormat::CBOR ? '\xbf' : '{');
+    _need_comma = false;
+    return *this;
+}
+
+
+JsonWriter& JsonWriter::endObject() {
+    _buf.push_back(_format == EPayloadFormat::CBOR ? '\xff' : '}');
+    _need_comma = true;
+    return *this;
+}
+
+
+JsonWriter& JsonWriter::beginArray() {
+    separate();
+    _buf.push_back(_format == EPayloadFormat::CBOR ? '\x9f' : '[');
+    _need_comma = false;
+    return *this;
+}
+
+
+JsonWriter& JsonWriter::endArray() {
+    _buf.push_back(_format == EPayloadFormat::CBOR ? '\xff' : ']');
+    _need_comma = true;
+    return *this;
+}
+
+
+JsonWriter& JsonWriter::key(const char *key_) {
+    separate();
+    string(key_, strlen(key_));
+    if (_format == EPayloadFormat::JSON) {
+        _buf.push_back(':');
+    }
+    _need_comma = false;
+    return *this;
+}
+
+
+JsonWriter& JsonWriter::value(const char *str_) {
+    separate();
+    string(str_, strlen(str_));
+    return *this;
+}
+
+
+JsonWriter& JsonWriter::value(const std::string &str_) {
+    separate();
+    string(str_.data(), str_.size());
+    return *this;
+}
+
+
+JsonWriter& JsonWriter::value(uint64_t num_) {
+    separate();
+    if (_format == EPayloadFormat::CBOR) {
+        header(0, num_);
+        return *this;
+    }
+    char digits[20];
+    size_t len = 0;
+    do {
+        digits[len++] = static_cast<char>('0' + num_ % 10);
+        num_ /= 10;
+    } while (num_);
+    while (len) {
+        _buf.push_back(digits[--len]);
+    }
+    return *this;
+}
+
+
+JsonWriter& JsonWriter::value(const Epc &epc_) {
+    separate();
+    if (_format == EPayloadFormat::CBOR) {
+        header(2, epc_._len);
+        _buf.append(reinterpret_cast<const char*>(epc_._bytes), epc_._len);
+        return *this;
+    }
+    _buf.push_back('"');
+    for (size_t i = 0; i < epc_._len; ++i) {
+        if (i) {
+            _buf.push_back(' ');
+        }
+        _buf.push_back(HEX_DIGITS[epc_._bytes[i] >> 4]);
+        _buf.push_back(HEX_DIGITS[epc_._bytes[i] & 0x0f]);
+    }
+    _buf.push_back('"');
+    return *this;
+}
+
+
+JsonWriter& JsonWriter::value(const Epc &epc_, uint32_t num_) {
+    if (_format == EPayloadFormat::CBOR) {
+        separate();
+        header(4, 2);
+        _need_comma = false;
+        value(epc_);
+        return value(static_cast<uint64_t>(num_));
+    }
+    value(epc_);
+    /// Счётчик дописывается внутрь строки EPC.
+    _buf.pop_back();
+    _buf.push_back(':');
+    _need_comma = false;
+    value(static_cast<uint64_t>(num_));
+    _buf.push_back('"');
+    return *this;
+}
+
+
+JsonWriter& JsonWriter::value(const Json &json_) {
+    if (_format == EPayloadFormat::JSON) {
+        separate();
+        _buf.append(json_.dump());
+        return *this;
+    }
+    switch (json_.type()) {
+        case Json::value_t::object:
+            beginObject();
+            for (Json::const_iterator it = json_.begin(); it not_eq json_.end(); ++it) {
+                key(it.key().c_str()).value(it.value());
+            }
+            return endObject();
+        case Json::value_t::array:
+            beginArray();
+            for (const Json &item : json_) {
+                value(item);
+            }
+            return endArray();
+        case Json::value_t::string:
+            return value(json_.get_ref<const std::string&>());
+        case Json::value_t::number_unsigned:
+            return value(json_.get<uint64_t>());
+        case Json::value_t::number_integer: {
+            int64_t num = json_.get<int64_t>();
+            if (num >= 0) {
+                return value(static_cast<uint64_t>(num));
+            }
+            separate();
+            header(1, static_cast<uint64_t>(-(num + 1)));
+            return *this;
+        }
+        case Json::value_t::number_float: {
+            separate();
+            double num = json_.get<double>();
+            uint64_t bits = 0;
+            memcpy(&bits, &num, sizeof(bits));
+            _buf.push_back('\xfb');
+            for (size_t i = 8; i; --i) {
+                _buf.push_back(static_cast<char>(bits >> ((i - 1) * 8)));
+            }
+            return *this;
+        }
+        case Json::value_t::boolean:
+            separate();
+            _buf.push_back(json_.get<bool>() ? '\xf5' : '\xf4');
+            return *this;
+        default:
+            separate();
+            _buf.push_back('\xf6');
+            return *this;
+    }
+}
+
+
+JsonWriter& JsonWriter::values(const std::vector<std::string> &strs_) {
+    beginArray();
+    for (const std::string &str : strs_) {
+        value(str);
+    }
+    return endArray();
+}
+
+
+JsonWriter& JsonWriter::number(const std::string &num_) {
+    if (_format == EPayloadFormat::CBOR) {
+        /// Идентификатор холодильника - число в текстовом виде.
+        uint64_t num = 0;
+        bool is_num = not num_.empty() and num_.size() < std::numeric_limits<uint64_t>::digits10;
+        for (size_t i = 0; is_num and i < num_.size(); ++i) {
+            is_num = (num_[i] >= '0' and num_[i] <= '9');
+            num = num * 10 + static_cast<uint64_t>(num_[i] - '0');
+        }
+        return is_num ? value(num) : value(num_);
+    }
+    separate();
+    _buf.append(num_);
+    return *this;
+}
+
+
+const std::string& JsonWriter::str() const {
+    return _buf;
+}
@@ -0,0 +1,106 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Класс формирует исходящие посылки JSON или CBOR дописыванием в один буфер.
+ * \author Величко Ростислав
+ * \date   07.19.2017
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+#include "Epc.hpp"
+#include "Bases.hpp"
+
+
+static const size_t JSON_WRITER_EPC_SIZE = RFID_EPC_MAXLEN * 3 + 8; ///< Оценка размера EPC с кавычками и счётчиком [байт].
+static const size_t JSON_WRITER_HEAD_SIZE = 128;                    ///< Оценка размера заголовка посылки [байт].
+
+
+namespace robocooler {
+namespace driver {
+
+/**
+ * \brief Писатель расставляет запятые между элементами сам и экранирует строки.
+ *        Буфер резервируется один раз по оценке размера посылки, и может использоваться повторно после clear().
+ *        В режиме CBOR объекты и массивы пишутся с неопределённой длиной (0xbf/0x9f ... 0xff),
+ *        EPC - байтовыми строками, EPC со счётчиком - массивом [EPC, счётчик].
+ */
+class JsonWriter {
+    std::string _buf;        ///< Формируемая посылка.
+    bool _need_comma;        ///< Перед очередным элементом требуется запятая.
+    EPayloadFormat _format;  ///< Кодирование посылки.
+
+    void separate();
+    void escape(const char *str_, size_t len_);
+    void header(uint8_t major_, uint64_t val_);
+    void string(const char *str_, size_t len_);
+
+public:
+    typedef robocooler::rfid::Epc Epc;
+    typedef nlohmann::json Json;
+
+    explicit JsonWriter(EPayloadFormat format_ = EPayloadFormat::JSON);
+
+    EPayloadFormat getFormat() const {
+        return _format;
+    }
+
+    /**
+     * \brief Метод резервирует буфер под посылку, чтобы она формировалась без перевыделений.
+     * \param size_ Ожидаемый размер посылки [байт].
+     */
+    void reserve(size_t size_);
+
+    /**
+     * \brief Метод очищает посылку, сохраняя выделенную память.
+     */
+    void clear();
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+
+    /**
+     * \brief Метод записывает имя поля объекта, следующий элемент становится его значением.
+     */
+    JsonWriter& key(const char *key_);
+
+    JsonWriter& value(const char *str_);
+    JsonWriter& value(const std::string &str_);
+    JsonWriter& value(uint64_t num_);
+
+    /**
+     * \brief Метод записывает EPC строкой в формате сервера непосредственно из двоичного представления.
+     */
+    JsonWriter& value(const Epc &epc_);
+
+    /**
+     * \brief Метод записывает EPC со счётчиком чтений строкой "<epc>:<num>".
+     */
+    JsonWriter& value(const Epc &epc_, uint32_t num_);
+
+    /**
+     * \brief Метод записывает разобранное значение любого типа.
+     */
+    JsonWriter& value(const Json &json_);
+
+    /**
+     * \brief Метод записывает массив строк.
+     */
+    JsonWriter& values(const std::vector<std::string> &strs_);
+
+    /**
+     * \brief Метод записывает число, переданное текстом, без кавычек.
+     *        В CBOR текст, не являющийся беззнаковым числом, записывается строкой.
+     */
+    JsonWriter& number(const std::string &num_);
+
+    const std::string& str() const;
+};
+} /// driver
+} /// robocooler
@@ -0,0 +1,88 @@
+#include "Log.hpp"
+#include "LabelSync.hpp"
+
+
+using namespace robocooler;
+using namespace driver;
+
+
+LabelSync::LabelSync()
+    : _version(0)
+    , _acked_version(0) {
+}
+
+
+void LabelSync::write(const TagSet &cur_, const TagIndex &ids_, JsonWriter &writer_) {
+    ++_version;
+    TagSet::difference(cur_, _acked, _added);
+    TagSet::difference(_acked, cur_, _removed);
+    writer_.key("version").value(static_cast<uint64_t>(_version))
+        .key("base").value(static_cast<uint64_t>(_acked_version))
+        .key("added").beginArray();
+    _added.forEach([&ids_, &writer_](uint32_t id_) {
+        writer_.value(ids_.epc(id_));
+    });
+    writer_.endArray()
+        .key("removed").beginArray();
+    _removed.forEach([&ids_, &writer_](uint32_t id_) {
+        writer_.value(ids_.epc(id_));
+    });
+    writer_.endArray()
+        .key("count").value(static_cast<uint64_t>(cur_.size()))
+        .key("hash").value(static_cast<uint64_t>(hash(cur_, ids_)));
+    /// Сервер, не отвечающий подтверждениями, получает изменения от последней известной базы.
+    if (_pending.size() >= LABEL_SYNC_MAX_PENDING) {
+        _pending.pop_front();
+    }
+    _pending.push_back(Snapshot(_version, cur_));
+}
+
+
+bool LabelSync::ack(uint32_t version_) {
+    Snapshots::iterator it = _pending.begin();
+    while (it not_eq _pending.end() and it->first not_eq version_) {
+        ++it;
+    }
+    if (it == _pending.end()) {
+        LOG(WARNING) << "Unknown labels version: " << version_;
+        return false;
+    }
+    _acked.swap(it->second);
+    _acked_version = version_;
+    _pending.erase(_pending.begin(), it + 1);
+    return true;
+}
+
+
+void LabelSync::reset() {
+    _acked.clear();
+    _acked_version = 0;
+    _pending.clear();
+}
+
+
+void LabelSync::collect(TagSet &live_) const {
+    live_.merge(_acked);
+    for (const Snapshot &snapshot : _pending) {
+        live_.merge(snapshot.second);
+    }
+}
+
+
+void LabelSync::remap(const TagRemap &remap_) {
+    _acked.remap(remap_);
+    for (Snapshot &snapshot : _pending) {
+        snapshot.second.remap(remap_);
+    }
+    _added.remap(remap_);
+    _removed.remap(remap_);
+}
+
+
+uint32_t LabelSync::hash(const TagSet &set_, const TagIndex &ids_) {
+    uint32_t res = 0;
+    set_.forEach([&ids_, &res](uint32_t id_) {
+        res += ids_.epc(id_).hash();
+    });
+    return res;
+}
@@ -0,0 +1,81 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Версионная синхронизация содержимого шкафа изменениями относительно подтверждённого сервером снимка.
+ * \author Величко Ростислав
+ * \date   07.21.2017
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+#include "TagIndex.hpp"
+#include "JsonWriter.hpp"
+
+
+static const size_t LABEL_SYNC_MAX_PENDING = 8; ///< Предельное количество неподтверждённых снимков.
+
+
+namespace robocooler {
+namespace driver {
+
+/**
+ * \brief Каждый снимок получает очередную версию и передаётся изменениями относительно последней версии,
+ *        подтверждённой сервером ("base"); base = 0 - полный снимок. Поскольку база не зависит от
+ *        предыдущих неподтверждённых посылок, любая из них может быть потеряна или вытеснена более новой.
+ *        Посылка содержит количество меток и хеш содержимого: сумму Epc::hash() всех меток по модулю 2^32.
+ *        При расхождении хеша сервер запрашивает полный снимок.
+ */
+class LabelSync {
+    typedef robocooler::rfid::TagSet TagSet;
+    typedef robocooler::rfid::TagIndex TagIndex;
+    typedef robocooler::rfid::TagRemap TagRemap;
+    typedef std::pair<uint32_t, TagSet> Snapshot;
+    typedef std::deque<Snapshot> Snapshots;
+
+    uint32_t _version;       ///< Версия последнего сформированного снимка.
+    uint32_t _acked_version; ///< Подтверждённая сервером версия, 0 - база пуста.
+    TagSet _acked;           ///< Подтверждённый снимок.
+    Snapshots _pending;      ///< Отправленные и ещё не подтверждённые снимки.
+    TagSet _added;           ///< Рабочий набор добавленных меток.
+    TagSet _removed;         ///< Рабочий набор изъятых меток.
+
+public:
+    LabelSync();
+
+    /**
+     * \brief Метод формирует очередную версию снимка cur_ и записывает поля
+     *        "version", "base", "added", "removed", "count", "hash" в открытый объект writer_.
+     */
+    void write(const TagSet &cur_, const TagIndex &ids_, JsonWriter &writer_);
+
+    /**
+     * \brief Метод принимает подтверждение версии version_, более старые снимки отбрасываются.
+     * \return false, если версия неизвестна или уже подтверждена более новая.
+     */
+    bool ack(uint32_t version_);
+
+    /**
+     * \brief Метод сбрасывает подтверждённую базу: следующий снимок передаётся полностью.
+     */
+    void reset();
+
+    /**
+     * \brief Метод добавляет в live_ метки подтверждённого и неподтверждённых снимков.
+     */
+    void collect(TagSet &live_) const;
+
+    /**
+     * \brief Метод переводит снимки на идентификаторы сжатого индекса.
+     */
+    void remap(const TagRemap &remap_);
+
+    /**
+     * \brief Метод вычисляет хеш содержимого, не зависящий от порядка меток.
+     */
+    static uint32_t hash(const TagSet &set_, const TagIndex &ids_);
+};
+} /// driver
+} /// robocooler
@@ -3,6 +3,7 @@
 #include <atomic>
 
 #include "Log.hpp"
+#include "JsonWriter.hpp"
 #include "Timer.hpp"
 #include "WsClientWorker.hpp"
 #include "CommandHandler.hpp"
@@ -22,100 +23,79 @@ typedef RfidCommandsHandler RfidCmdHdl;
 typedef RfidController Ctrl;
 
 
-void RfidController::notifyOneCmdResult(RfidCid cmd_id_) {
-    //G(DEBUG) << RfidCmd::cmdToString(cmd_id_);
-    std::unique_lock<std::mutex> lock(_mutex);
-    WaitCmdResultIter iter = _cmd_conditions.find(cmd_id_);
-    if (iter not_eq _cmd_conditions.end()) {
-        PCondition condition_complete = iter->second;
-        /// Уведомить условный объект синхронизации.
-        condition_complete->notify_all();
+RfidFuture RfidController::post(RfidCid cmd_id_, const RfidSendFunc &send_, size_t timeout_) {
+    if (not _pipeline) {
+        std::promise<bool> promise;
+        promise.set_value(false);
+        return promise.get_future();
     }
+    return _pipeline->post(cmd_id_, send_, timeout_);
 }
 
 
-void RfidController::waitCmdResult(RfidCid cmd_id_) {
-    std::unique_lock<std::mutex> lock(_mutex);
-    WaitCmdResultIter iter = _cmd_conditions.find(cmd_id_);
-    if (iter == _cmd_conditions.end()) {
-        PCondition condition_complete = std::make_shared<std::condition_variable>();
-        auto insert_iter = _cmd_conditions.insert(std::make_pair(cmd_id_, condition_complete));
-        iter = insert_iter.first;
-    }
-    iter->second->wait(lock);
+bool RfidController::wait(RfidFuture &future_) {
+    return _pipeline ? _pipeline->wait(future_) : future_.get();
 }
 
 
-bool RfidController::extLockWaitCmdResult(RfidCid cmd_id_, std::unique_lock<std::mutex>& lock_, size_t unlock_timout_) {
-    WaitCmdResultIter iter = _cmd_conditions.find(cmd_id_);
-    if (iter == _cmd_conditions.end()) {
-        PCondition condition_complete = std::make_shared<std::condition_variable>();
-        auto insert_iter = _cmd_conditions.insert(std::make_pair(cmd_id_, condition_complete));
-        iter = insert_iter.first;
-    } else {
-        iter->second->notify_all();
-    }
-    PCondition condition = iter->second;
-    bool is_no_timeout = true;
-    _notify_timer = std::shared_ptr<Timer>(new Timer(unlock_timout_, [&] {
-        LOG(WARNING) << "\"" << RfidCmd::cmdToString(cmd_id_) << "\" is lock.";
-        is_no_timeout = false;
-        condition->notify_all();
-    }));
-    condition->wait(lock_);
-    _notify_timer.reset();
-    return is_no_timeout;
+bool RfidController::call(RfidCid cmd_id_, const RfidSendFunc &send_, size_t timeout_) {
+    RfidFuture future = post(cmd_id_, send_, timeout_);
+    return wait(future);
 }
 
 
 void RfidController::runSerial() {
+    uint8_t buf[SERIAL_READ_CHUNK];
+    auto on_result = [this](RfidCid cid_) {
+        _pipeline->complete(cid_);
+    };
     while (_is_runing) {
-        uint8_t byte = 0;
-        int rlen = _tty_io->read(&byte, 1);
-        if (rlen and rlen not_eq ERROR_LEN and _rfid_handler) {
-            RfidCid cid = _rfid_handler->receivePacket(static_cast<uint8_t>(byte));
-            if (RfidCid::cmd_none not_eq cid) {
-                notifyOneCmdResult(cid);
-            }
+        /// Ждать данных не дольше ближайшего срока ответа, забирать всё доступное одним вызовом.
+        int rlen = _tty_io->readAvailable(buf, sizeof(buf), _pipeline->nextTimeout());
+        if (rlen == ERROR_LEN) {
+            LOG(ERROR) << _tty_io->what();
+            std::this_thread::sleep_for(chr::milliseconds(UNLOCK_TIMEOUT / 10));
+        } else if (rlen and _rfid_handler) {
+            _rfid_handler->receiveChunk(buf, static_cast<size_t>(rlen), on_result);
         }
-        /// Отпустить процессор.
-        std::this_thread::sleep_for(chr::milliseconds(1));
+        /// Завершить запросы, срок ответа на которые истёк.
+        _pipeline->expire();
     };
 }
 
 
 void RfidController::readFromBufferAndReset() {
-    uint16_t tag_count = 0;
-    /// Прочитать количество меток, находящихся в буфере.
+    /// Очистить приёмный буфер.
     {
         std::unique_lock<std::mutex> lock(_mutex);
-        if (_rfid_handler) {
-            RfidCmd *rfid_cmd = _rfid_handler->getCommand();
-            if (rfid_cmd) {
-                rfid_cmd->getInventoryBufferTagCount();
-                extLockWaitCmdResult(RfidCid::cmd_get_inventory_buffer_tag_count, lock, UNLOCK_TIMEOUT);
-                tag_count = _rfid_handler->getCurTagCount();
-                LOG(DEBUG) << "In buffer " << tag_count << " tag counts";
-                /// Очистить приёмный буфер.
-                _buffered_data.clear();
-                /// Читать буфер со сбросом.
-                rfid_cmd->getAndResetInventoryBuffer();
-            }
-        }
+        _buffered_data.clear();
+    }
+    /// Количество меток и чтение буфера со сбросом уходят подряд, не дожидаясь первого ответа.
+    RfidFuture count = post(RfidCid::cmd_get_inventory_buffer_tag_count, [](RfidCmd *cmd_) {
+        cmd_->getInventoryBufferTagCount();
+    });
+    RfidFuture tags = post(RfidCid::cmd_get_and_reset_inventory_buffer, [](RfidCmd *cmd_) {
+        cmd_->getAndResetInventoryBuffer();
+    }, ALL_TAGS_RECV_TIMEOUT);
+    uint16_t tag_count = 0;
+    if (wait(count)) {
+        tag_count = _rfid_handler->getCurTagCount();
+        LOG(DEBUG) << "In buffer " << tag_count << " tag counts";
     }
-    /// Принять метки из буфера по количеству с перезапуском таймера.
+    /// Принять метки из буфера: запрос завершается последней меткой или ошибкой пустого буфера.
+    bool is_received = wait(tags);
     if (not tag_count) {
         LOG(ERROR) << "Tags count is 0.";
     } else {
         uint16_t cur_read_data_size = 0;
         {
             std::unique_lock<std::mutex> lock(_mutex);
-            extLockWaitCmdResult(RfidCid::all_tags_receaved, lock, ALL_TAGS_RECV_TIMEOUT);
             LOG(WARNING) << "Tags count: " << tag_count;
-            _cur_read_data = _buffered_data;
+            /// Приёмный буфер очищается перед следующим чтением: обменять без копирования.
+            _cur_read_data.swap(_buffered_data);
             cur_read_data_size = _cur_read_data.size();
         };
-        if (cur_read_data_size not_eq tag_count) {
+        if (not is_received or cur_read_data_size not_eq tag_count) {
             LOG(ERROR) << "Receaved tags count is " << cur_read_data_size << " [" << tag_count << "].";
         } else {
             LOG(DEBUG) << "Receaved tags count is " << cur_read_data_size << " [" << tag_count << "].";
@@ -126,95 +106,215 @@ void RfidController::readFromBufferAndReset() {
 
 void RfidController::bufferReadProcess() {
     LOG(DEBUG);
-    PTimer timer;
-    /// Выполнить опрос по каждой антенне.
-    //for (uint8_t aq = 0; aq < static_cast<uint8_t>(RfidCmd::EWorkAntenna::QUANTITY); ++aq) {
-        {
-            std::unique_lock<std::mutex> lock(_mutex);
-            if (_rfid_handler) {
-                RfidCmd *rfid_cmd = _rfid_handler->getCommand();
-                if (rfid_cmd) {
-                    /// Установить активную антенну.
-                    //rfid_cmd->setWorkAntenna(static_cast<RfidWorkAntenna>(aq));
-                    //extLockWaitCmdResult(RfidCid::cmd_set_work_antenna, lock, UNLOCK_TIMEOUT);
-                    /// Инвенторизировать.
-                    rfid_cmd->inventory(0xff);
-                    extLockWaitCmdResult(RfidCid::cmd_inventory, lock, UNLOCK_TIMEOUT);
-                }
-            }
-        }
-        /// Подождать перед считыванием из следующей антенны.
-        std::this_thread::sleep_for(chr::milliseconds(UPDATE_RECV_DATA_TIMEOUT));
-    //}
+    /// Инвенторизировать.
+    call(RfidCid::cmd_inventory, [](RfidCmd *cmd_) {
+        cmd_->inventory(0xff);
+    });
+    /// Подождать перед чтением буфера.
+    std::this_thread::sleep_for(chr::milliseconds(UPDATE_RECV_DATA_TIMEOUT));
     /// Прочитать буфер.
     readFromBufferAndReset();
 }
 
 
+void RfidController::streamReadProcess() {
+    LOG(DEBUG);
+    RfidCid cid = RfidCid::cmd_real_time_inventory;
+    RfidSendFunc send = [](RfidCmd *cmd_) {
+        cmd_->realTimeInventory(REAL_TIME_INVENTORY_REPEAT);
+    };
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _buffered_data.clear();
+        if (_use_fast_switch) {
+            /// Все антенны одной командой, номер антенны приходит в каждой метке.
+            cid = RfidCid::cmd_fast_switch_ant_inventory;
+            RfidFss sets = _fast_switch_sets;
+            send = [sets](RfidCmd *cmd_) {
+                cmd_->fastSwitchAntInventory(sets);
+            };
+        }
+    }
+    _is_streaming = true;
+    /// Метки обрабатываются в onReadData по мере приёма, ждать только пакет завершения.
+    if (not call(cid, send)) {
+        LOG(ERROR) << "Real time inventory is not completed.";
+    }
+    _is_streaming = false;
+    std::unique_lock<std::mutex> lock(_mutex);
+    LOG(DEBUG) << "Stream tags count: " << _buffered_data.size();
+}
+
+
+void RfidController::sessionPass(RfidTarget target_) {
+    std::vector<uint8_t> ants;
+    RfidSession session;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        session = _session;
+        for (size_t a = 0; _use_fast_switch and a < static_cast<size_t>(RfidWorkAntenna::QUANTITY); ++a) {
+            if (_fast_switch_sets._ants[a] < static_cast<uint8_t>(RfidWorkAntenna::QUANTITY)) {
+                ants.push_back(_fast_switch_sets._ants[a]);
+            }
+        }
+    }
+    /// Флаг сессии принадлежит метке, а не антенне: метка, ответившая на одной антенне, молчит на остальных.
+    /// Ридер не переключает антенну во время опроса, поэтому следующая антенна выбирается после завершения 0x8B.
+    _is_streaming = true;
+    for (uint8_t ant : ants) {
+        RfidFuture switched = post(RfidCid::cmd_set_work_antenna, [ant](RfidCmd *cmd_) {
+            cmd_->setWorkAntenna(static_cast<RfidWorkAntenna>(ant));
+        });
+        RfidFuture inventoried = post(RfidCid::cmd_customized_session_target_inventory, [session, target_](RfidCmd *cmd_) {
+            cmd_->customizedSessionTargetInventory(session, target_, REAL_TIME_INVENTORY_REPEAT);
+        });
+        if (not wait(switched)) {
+            LOG(ERROR) << "Work antenna " << static_cast<int>(ant) << " is not set.";
+        }
+        if (not wait(inventoried)) {
+            LOG(ERROR) << "Session inventory is not completed.";
+        }
+    }
+    if (ants.empty()) {
+        /// Без последовательности антенн опрашивается только текущая рабочая антенна.
+        RfidFuture inventoried = post(RfidCid::cmd_customized_session_target_inventory, [session, target_](RfidCmd *cmd_) {
+            cmd_->customizedSessionTargetInventory(session, target_, REAL_TIME_INVENTORY_REPEAT);
+        });
+        if (not wait(inventoried)) {
+            LOG(ERROR) << "Session inventory is not completed.";
+        }
+    }
+    _is_streaming = false;
+    LOG(DEBUG) << "Target " << (target_ == RfidTarget::A ? "A" : "B") << " on " << ants.size() << " antennas";
+}
+
+
+void RfidController::sessionReadProcess(bool is_sweep_) {
+    LOG(DEBUG) << (is_sweep_ ? "sweep" : "cycle");
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _buffered_data.clear();
+    }
+    if (is_sweep_) {
+        sessionPass(RfidTarget::B);
+    }
+    sessionPass(RfidTarget::A);
+    std::unique_lock<std::mutex> lock(_mutex);
+    LOG(DEBUG) << "Session tags count: " << _buffered_data.size();
+}
+
+
+void RfidController::readProcess(bool is_sweep_) {
+    bool use_session = false;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        use_session = (_session not_eq RfidSession::S0);
+    }
+    if (_use_stream and use_session) {
+        sessionReadProcess(is_sweep_);
+    } else if (_use_stream) {
+        streamReadProcess();
+    } else {
+        bufferReadProcess();
+    }
+}
+
+
 void RfidController::currentBuffer() {
     LOG(DEBUG);
-    /// Вывести все полученные метки.
-    std::stringstream cur_ss;
-    std::stringstream snd_cur_ss;
+    /// Посылка и журнал формируются за один проход по меткам, EPC пишутся из двоичного вида.
+    bool is_log = LOG_IS_ON(INFO);
+    JsonWriter writer(_worker ? _worker->getPayloadFormat() : EPayloadFormat::JSON);
+    JsonWriter log_writer;
     size_t cur_size = 0;
+    const char *method = "verifyLabelsSynchronization";
+    bool is_delta = false;
     {
         std::unique_lock<std::mutex> lock(_mutex);
+        is_delta = _use_delta_sync;
+        if (is_delta) {
+            method = "syncLabels";
+            _sync_data.clear();
+        }
         cur_size = _accumulate_data.size();
-        for (auto data : _accumulate_data) {
-            snd_cur_ss << "\"" << data.first << "\",";
-            cur_ss << "\"" << data.first <<  ":" << data.second._readed_num << "\",";
+        writer.reserve(JSON_WRITER_HEAD_SIZE + cur_size * JSON_WRITER_EPC_SIZE);
+        writer.beginObject()
+            .key("H").value("labeledGoods")
+            .key("M").value(method)
+            .key("A").beginObject();
+        if (not is_delta) {
+            writer.key("labels").beginArray();
+        }
+        if (is_log) {
+            log_writer.reserve(cur_size * JSON_WRITER_EPC_SIZE);
+        }
+        _accumulate_data.forEach([this, &writer, &log_writer, is_log, is_delta](const RfidTagRecord &rec_) {
+            if (is_delta) {
+                _sync_data.insert(_tag_ids.intern(rec_._epc));
+            } else {
+                writer.value(rec_._epc);
+            }
+            if (is_log) {
+                log_writer.value(rec_._epc, rec_._readed_num);
+            }
+        });
+        if (is_delta) {
+            /// Передаются только изменения относительно подтверждённой сервером версии.
+            _label_sync.write(_sync_data, _tag_ids, writer);
+        } else {
+            writer.endArray();
         }
-    }
-    std::string prods_str;
-    std::string snd_prods_str;
-    if (not cur_ss.str().empty()) {
-        snd_prods_str = std::string(snd_cur_ss.str().c_str(), (snd_cur_ss.str().size() - 1));
-        prods_str = std::string(cur_ss.str().c_str(), (cur_ss.str().size() - 1));
     }
     LOG(INFO) << "ACM:\n-------------------------------------------------------\n"
-              << prods_str
+              << log_writer.str()
               << "\nsize = " << cur_size << "\n"
               <<     "\n_______________________________________________________\n";
     /// Зафиксировать изменения на сервере.
     if (_worker) {
-        std::stringstream ss;
-        ss << "{\"H\": \"labeledGoods\",\"M\":\"verifyLabelsSynchronization\",\"A\":{\"labels\":[";
-        ss << snd_prods_str;
-        ss << "],\"plantId\":" << _worker->getCoolerId() << "}}";
-        _worker->send(ss.str());
+        writer.key("plantId").number(_worker->getCoolerId());
+        if (is_delta) {
+            /// Версии разностей не переживают перезапуск, поэтому в журнал сохраняются только полные снимки.
+            writer.endObject()
+                .endObject();
+            _worker->send(writer, ESendLane::STATE, method);
+        } else {
+            _worker->sendEvent(writer, method);
+        }
     }
 }
 
 
 void RfidController::verifyBuffer() {
     LOG(DEBUG);
-    /// Вывести все полученные метки.
-    std::stringstream snd_cur_ss;
-    std::stringstream cur_ss;
+    /// Посылка JSON содержит те же строки "<epc>:<num>", что и журнал: журнал выводит её массив меток.
+    JsonWriter writer(_worker ? _worker->getPayloadFormat() : EPayloadFormat::JSON);
     size_t cur_size = 0;
+    size_t labels_begin = 0;
     {
         std::unique_lock<std::mutex> lock(_mutex);
         cur_size = _prob_read_data.size();
-        for (auto data : _prob_read_data) {
-            snd_cur_ss << "\"" << data.first <<  ":" << data.second._readed_num << "\",";
-            cur_ss << data.first <<  " : " << data.second._readed_num << "\n";
-        }
-    }
-    std::string snd_prods_str;
-    if (not snd_cur_ss.str().empty()) {
-        snd_prods_str = std::string(snd_cur_ss.str().c_str(), (snd_cur_ss.str().size() - 1));
+        writer.reserve(JSON_WRITER_HEAD_SIZE + cur_size * JSON_WRITER_EPC_SIZE);
+        writer.beginObject()
+            .key("H").value("labeledGoods")
+            .key("M").value("periodicVerifyLabels")
+            .key("A").beginObject()
+                .key("labels").beginArray();
+        labels_begin = writer.str().size();
+        _prob_read_data.forEach([&writer](const RfidTagRecord &rec_) {
+            writer.value(rec_._epc, rec_._readed_num);
+        });
     }
     LOG(INFO) << "PROB:\n------------------------------------------------------\n"
-              << cur_ss.str()
+              << (writer.getFormat() == EPayloadFormat::JSON ? writer.str().substr(labels_begin) : std::string("CBOR"))
               << "\nsize = " << cur_size << "\n"
               <<     "\n_______________________________________________________\n";
     /// Зафиксировать изменения на сервере.
     if (_worker) {
-        std::stringstream ss;
-        ss << "{\"H\": \"labeledGoods\",\"M\":\"periodicVerifyLabels\",\"A\":{\"labels\":[";
-        ss << snd_prods_str;
-        ss << "],\"plantId\":" << _worker->getCoolerId() << "}}";
-        _worker->send(ss.str());
+        writer.endArray()
+                .key("plantId").number(_worker->getCoolerId())
+            .endObject()
+            .endObject();
+        _worker->send(writer, ESendLane::DIAGNOSTIC, "periodicVerifyLabels");
     }
 }
 
@@ -226,34 +326,45 @@ void RfidController::compareBuffers(bool need_result_) {
     size_t old_count = 0;
     size_t cur_count = 0;
     std::stringstream cur_ss;
-    {
-        std::unique_lock<std::mutex> lock(_mutex);
-        for (auto data : _cur_read_data) {
-            cur_ss << data.first <<  ":" << data.second._readed_num << "\n";
-        }
-        old_count = _read_data.size();
-        cur_count = _cur_read_data.size();
-    }
-    LOG(TRACE) << "CUR:\n-------------------------------------------------------\n"
-               << cur_ss.str()
-               << "old=" << old_count << "; cur=" << cur_count
-               <<    "\n_______________________________________________________\n";
-    /// Проверить добавленные метки.
     std::vector<std::string> in_prods;
     std::stringstream add_ss;
     size_t add_count = 0;
+    std::vector<std::string> out_prods;
+    std::stringstream rem_ss;
+    size_t rem_count = 0;
     {
         std::unique_lock<std::mutex> lock(_mutex);
-        for (auto data : _cur_read_data) {
-            ReadDataIter iter = _read_data.find(data.first);
-            if (iter == _read_data.end()) {
-                ++add_count;
-                add_ss << data.first << ":" << data.second._readed_num << "\n";
-                in_prods.push_back(data.first);
-            }
+        old_count = _read_data.size();
+        cur_count = _cur_read_data.size();
+        /// Добавленные и изъятые метки - разности битовых наборов, строки EPC только для изменений.
+        RfidTagSet::difference(_cur_read_data, _read_data, _added_tags);
+        RfidTagSet::difference(_read_data, _cur_read_data, _removed_tags);
+        add_count = _added_tags.size();
+        rem_count = _removed_tags.size();
+        if (LOG_IS_ON(TRACE)) {
+            _cur_read_data.forEach([this, &cur_ss](uint32_t id_) {
+                cur_ss << _tag_ids.epc(id_).toString() <<  ":" << readedNum(id_) << "\n";
+            });
         }
+        _added_tags.forEach([this, &add_ss, &in_prods](uint32_t id_) {
+            std::string epc = _tag_ids.epc(id_).toString();
+            add_ss << epc << ":" << readedNum(id_) << "\n";
+            in_prods.push_back(epc);
+        });
+        _removed_tags.forEach([this, &rem_ss, &out_prods](uint32_t id_) {
+            std::string epc = _tag_ids.epc(id_).toString();
+            rem_ss << epc << ":" << readedNum(id_) << "\n";
+            out_prods.push_back(epc);
+        });
+    }
+    if (LOG_IS_ON(TRACE)) {
+        LOG(TRACE) << "CUR:\n-------------------------------------------------------\n"
+                   << cur_ss.str()
+                   << "old=" << old_count << "; cur=" << cur_count
+                   <<    "\n_______________________________________________________\n";
     }
-    if (not add_ss.str().empty()) {
+    /// Проверить добавленные метки.
+    if (add_count) {
         is_compare = true;
         LOG(INFO) << "ADD:\n-------------------------------------------------------\n"
                    << add_ss.str()
@@ -261,21 +372,7 @@ void RfidController::compareBuffers(bool need_result_) {
                    <<    "\n_______________________________________________________\n";
     }
     /// Проверить изъятые метки.
-    std::vector<std::string> out_prods;
-    std::stringstream rem_ss;
-    size_t rem_count = 0;
-    {
-        std::unique_lock<std::mutex> lock(_mutex);
-        for (auto data : _read_data) {
-            ReadDataIter iter = _cur_read_data.find(data.first);
-            if (iter == _cur_read_data.end()) {
-                ++rem_count;
-                rem_ss << data.first << ":" << data.second._readed_num << "\n";
-                out_prods.push_back(data.first);
-            }
-        }
-    }
-    if (not rem_ss.str().empty()) {
+    if (rem_count) {
         is_compare = true;
         LOG(INFO) << "REM:\n-------------------------------------------------------\n"
                    << rem_ss.str()
@@ -292,32 +389,97 @@ void RfidController::compareBuffers(bool need_result_) {
 }
 
 
+uint32_t RfidController::readedNum(uint32_t id_) const {
+    const RfidTagRecord *rec = _prob_read_data.find(_tag_ids.epc(id_));
+    return rec ? rec->_readed_num : 0;
+}
+
+
+void RfidController::saveCycle() {
+    RfidCycleFunc on_cycle;
+    size_t tags_num = 0;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _read_data.swap(_cur_read_data);
+        tags_num = _read_data.size();
+        compactTagIds();
+        on_cycle = _on_cycle;
+        LOG(TRACE) << "Save cur buf: " << tags_num;
+    }
+    /// Наблюдатель вызывается без блокировки: он может обращаться к контроллеру.
+    if (on_cycle) {
+        on_cycle(tags_num);
+    }
+}
+
+
+void RfidController::compactTagIds() {
+    if (_tag_ids.size() < RFID_TAG_TABLE_CAPACITY) {
+        return;
+    }
+    _live_tags.clear();
+    _live_tags.merge(_read_data);
+    _live_tags.merge(_cur_read_data);
+    _live_tags.merge(_buffered_data);
+    _live_tags.merge(_sync_data);
+    _label_sync.collect(_live_tags);
+    if (_live_tags.size() * RFID_TAG_INDEX_COMPACT_RATIO >= _tag_ids.size()) {
+        return;
+    }
+    size_t old_size = _tag_ids.size();
+    RfidTagRemap remap;
+    _tag_ids.compact(_live_tags, remap);
+    _read_data.remap(remap);
+    _cur_read_data.remap(remap);
+    _buffered_data.remap(remap);
+    _sync_data.remap(remap);
+    _added_tags.remap(remap);
+    _removed_tags.remap(remap);
+    _label_sync.remap(remap);
+    _live_tags.remap(remap);
+    LOG(DEBUG) << "Tag ids compacted: " << old_size << " -> " << _tag_ids.size();
+}
+
+
 void RfidController::onReadData(const RfidCmd::ReadCmdData &read_data_) {
-    std::string EPC_str = RfidCmdHdl::toString(read_data_._EPC);
     /// Сохранить очередную метку в буфер, если метка была получена.
     uint16_t cur_read_data_size = 0;
-    RfidCmd::ReadCmdData data;
+    bool is_new_in_stream = false;
+    RfidTagRecord data;
     {
         std::unique_lock<std::mutex> lock(_mutex);
         /// Накопить метки.
-        auto iter = _prob_read_data.find(EPC_str);
-        if (iter not_eq _prob_read_data.end()) {
-            ++iter->second._readed_num;
-            data = iter->second;
+        RfidTagRecord *rec = _prob_read_data.find(read_data_._EPC);
+        if (rec) {
+            ++rec->_readed_num;
+            rec->_ant_id = read_data_._AntId;
+            rec->_rssi = read_data_._RSSI;
+            data = *rec;
         } else {
-            data = read_data_;
+            data._epc = read_data_._EPC;
+            data._pc = read_data_._PC;
+            data._ant_id = read_data_._AntId;
+            data._rssi = read_data_._RSSI;
             data._readed_num = 1;
-            _prob_read_data.insert(std::make_pair(EPC_str, data));
+            _prob_read_data.insert(data);
         }
         /// Сохранить метки, аккумулируемые на иттерацию.
-        _accumulate_data.insert(std::make_pair(EPC_str, data));
+        _accumulate_data.insert(data);
         /// Сохранить текущие данные, для фиксации изменений.
-        _buffered_data.insert(std::make_pair(EPC_str, data));
+        uint32_t id = _tag_ids.intern(data._epc);
+        _buffered_data.insert(id);
         cur_read_data_size = _buffered_data.size();
+        /// При потоковой инвенторизации метка видна сразу, до завершения цикла.
+        if (_is_streaming) {
+            is_new_in_stream = _cur_read_data.insert(id) and not _read_data.contains(id);
+        }
+    }
+    if (is_new_in_stream) {
+        LOG(DEBUG) << "New tag in stream: " << data._epc.toString();
     }
-    LOG(TRACE) << "[" << cur_read_data_size << "]: read: " << EPC_str << ": " << data._readed_num;
-    if (read_data_._TagCount not_eq 0 and read_data_._TagCount == cur_read_data_size) {
-        notifyOneCmdResult(RfidCid::all_tags_receaved);
+    if (LOG_IS_ON(TRACE)) {
+        LOG(TRACE) << "[" << cur_read_data_size << "]: read: " << data._epc.toString() << ": " << data._readed_num
+                   << " ant: " << static_cast<uint16_t>(read_data_._AntId + 1);
     }
 }
 
@@ -342,40 +504,49 @@ RfidController::RfidController(WorkerBase *worker_,
     , _is_runing(false)
     , _is_inventory(false)
     , _is_inventory_run(false)
+    , _is_streaming(false)
+    , _use_stream(true)
+    , _use_fast_switch(true)
+    , _session(static_cast<RfidSession>(INVENTORY_SESSION))
+    , _sweep_period(SESSION_SWEEP_PERIOD)
+    , _session_cycle(0)
     , _read_count(READ_ANTENNS_COUNT)
     , _reread_timeout(reread_timeout_)
     , _close_read_num(close_read_num_)
-    , _attempt_read_num(attempt_read_num_) {
+    , _attempt_read_num(attempt_read_num_)
+    , _use_delta_sync(false) {
+    for (uint8_t a = 0; a < static_cast<uint8_t>(RfidWorkAntenna::QUANTITY); ++a) {
+        _fast_switch_sets._ants[a] = a;
+        _fast_switch_sets._stays[a] = FAST_SWITCH_ANT_STAY;
+    }
+    _fast_switch_sets._interval = 0;
+    _fast_switch_sets._repeat = 1;
     _tty_io = std::make_shared<utils::TtyIo>(device_, B115200);
     if (_tty_io and _tty_io->isInit()) {
         /// Инициализация обработчика.
         _rfid_handler = std::make_shared<RfidCmdHdl>(_tty_io.get());
+        /// Очередь запросов будит поток порта, когда появляется более ранний срок ответа.
+        _pipeline = std::make_shared<RfidPipeline>(_rfid_handler->getCommand(), [this] {
+            _tty_io->interrupt();
+        });
         /// Запуск потока.
         _is_runing = true;
         _thread = std::shared_ptr<Thread>(
             new Thread(std::bind(&Ctrl::runSerial, this)),
             [this](Thread *p_) {
                 _is_runing = false;
+                _tty_io->interrupt();
                 p_->join();
                 delete p_;
         });
         /// Получить информацию об устройстве RFID.
-        if (_rfid_handler) {
-            std::unique_lock<std::mutex> lock(_mutex);
-            RfidCmd *rfid_cmd = _rfid_handler->getCommand();
-            if (rfid_cmd) {
-                rfid_cmd->setRfidAddres(RFID_ADDR);
-                rfid_cmd->getFirmwareVersion();
-                /// Подождать ответа.
-                if (not extLockWaitCmdResult(RfidCid::cmd_get_firmware_version, lock, UNLOCK_TIMEOUT)) {
-                    _is_inited = false;
-                    _is_runing = false;
-                } else {
-                    _is_inited = true;
-                }
-            }
+        _rfid_handler->getCommand()->setRfidAddres(RFID_ADDR);
+        if (not call(RfidCid::cmd_get_firmware_version, [](RfidCmd *cmd_) { cmd_->getFirmwareVersion(); })) {
+            _is_inited = false;
+            _is_runing = false;
+        } else {
+            _is_inited = true;
         }
-        _notify_timer.reset();
         if (_is_inited) {
             /// Проинициализировать функтор приёма меток.
             _rfid_handler->initOnReadDataFunc(std::bind(&RfidController::onReadData, this, ph::_1));
@@ -399,6 +570,12 @@ RfidController::RfidController(WorkerBase *worker_,
 RfidController::~RfidController() {
     /// Остановить инвенторизацию.
     stopInventory();
+    /// Остановить поток порта до разрушения порта.
+    _thread.reset();
+    /// Завершить оставшиеся запросы.
+    if (_pipeline) {
+        _pipeline->cancel();
+    }
 }
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -411,90 +588,130 @@ bool RfidController::isInited() {
 bool RfidController::execute(uint8_t cmd_id_, const std::vector<uint8_t> &data_buf_) {
     bool res = true;
     LOG(DEBUG) << RfidCmdHdl::toString(static_cast<uint8_t>(cmd_id_)) << " " << RfidCmdHdl::toString(data_buf_);
-    std::unique_lock<std::mutex> lock(_mutex); ///< Точка доступа.
-    if (_rfid_handler) {
-        RfidCmd *rfid_cmd = _rfid_handler->getCommand();
-        if (rfid_cmd) {
-            switch (static_cast<RfidCid>(cmd_id_)) {
-                case RfidCid::cmd_reset:
-                    rfid_cmd->reset();
-                    break;
-                case RfidCid::cmd_set_uart_baudrate:
-                    if (data_buf_.size() == 1) {
-                        rfid_cmd->setUartBaudrate(static_cast<RfidBaudrate>(data_buf_[0]));
-                    } else {
-                        res = false;
-                    }
-                    break;
-                case RfidCid::cmd_get_firmware_version:
-                    rfid_cmd->getFirmwareVersion();
-                    break;
-                case RfidCid::cmd_set_work_antenna:
-                    if (data_buf_.size() == 1) {
-                        rfid_cmd->setWorkAntenna(static_cast<RfidWorkAntenna>(data_buf_[0]));
-                    } else {
-                        res = false;
-                    }
-                    break;
-                case RfidCid::cmd_get_work_antenna:
-                    rfid_cmd->getWorkAntenna();
-                    break;
-                case RfidCid::cmd_set_output_power:
-                    if (data_buf_.size() == 1) {
-                        rfid_cmd->setOutputPower(data_buf_[0], data_buf_[0], data_buf_[0], data_buf_[0]);
-                    } else if (data_buf_.size() == 4) {
-                        rfid_cmd->setOutputPower(data_buf_[0], data_buf_[1], data_buf_[2], data_buf_[3]);
-                    } else {
-                        res = false;
-                    }
-                    break;
-                case RfidCid::cmd_get_output_power:
-                    rfid_cmd->getOutputPower();
-                    break;
-                case RfidCid::cmd_set_frequency_region:
-                    if (data_buf_.size() == 3) {
-                        rfid_cmd->setFrequencyRegion(static_cast<RfidESpektrumRegion>(data_buf_[0]), data_buf_[1], data_buf_[2]);
-                    } else if (data_buf_.size() == 2) {
-                        rfid_cmd->setFrequencyRegion(static_cast<RfidESpektrumRegion>(data_buf_[0]), data_buf_[1], data_buf_[1]);
-                    } else {
-                        res = false;
-                    }
-                    break;
-                case RfidCid::cmd_get_frequency_region:
-                    rfid_cmd->getFrequencyRegion();
-                    break;
-                case RfidCid::cmd_inventory:
-                    if (not data_buf_.empty()) {
-                        rfid_cmd->inventory(data_buf_[0]);
-                    } else {
-                        rfid_cmd->inventory(0x0);
-                    }
-                    break;
-                case RfidCid::cmd_read: {
-                        RfidCmd::EReadMemBank mem_bank = data_buf_.size() ?
-                                                     static_cast<RfidCmd::EReadMemBank>(data_buf_[0]) :
-                                                     RfidCmd::EReadMemBank::EPC;
-                        rfid_cmd->read(mem_bank, 0x0, 0x01);
-                    }
-                    break;
-                case RfidCid::cmd_get_inventory_buffer:
-                    rfid_cmd->getInventoryBuffer();
-                    break;
-                case RfidCid::cmd_get_and_reset_inventory_buffer:
-                    rfid_cmd->getAndResetInventoryBuffer();
-                    break;
-                case RfidCid::cmd_get_inventory_buffer_tag_count:
-                    rfid_cmd->getInventoryBufferTagCount();
-                    break;
-                case RfidCid::cmd_reset_inventory_buffer:
-                    rfid_cmd->resetInventoryBuffer();
-                    break;
-                default:
-                    LOG(WARNING) << "Undeclared command: " << RfidCmdHdl::toString(static_cast<uint8_t>(cmd_id_));
-                    res = false;
-                    break;
+    RfidCid cid = static_cast<RfidCid>(cmd_id_);
+    RfidSendFunc send;
+    switch (cid) {
+        case RfidCid::cmd_reset:
+            send = [](RfidCmd *cmd_) { cmd_->reset(); };
+            break;
+        case RfidCid::cmd_set_uart_baudrate:
+            if (data_buf_.size() == 1) {
+                RfidBaudrate bdr = static_cast<RfidBaudrate>(data_buf_[0]);
+                send = [bdr](RfidCmd *cmd_) { cmd_->setUartBaudrate(bdr); };
+            } else {
+                res = false;
             }
-        }
+            break;
+        case RfidCid::cmd_get_firmware_version:
+            send = [](RfidCmd *cmd_) { cmd_->getFirmwareVersion(); };
+            break;
+        case RfidCid::cmd_set_work_antenna:
+            if (data_buf_.size() == 1) {
+                RfidWorkAntenna ant = static_cast<RfidWorkAntenna>(data_buf_[0]);
+                send = [ant](RfidCmd *cmd_) { cmd_->setWorkAntenna(ant); };
+            } else {
+                res = false;
+            }
+            break;
+        case RfidCid::cmd_get_work_antenna:
+            send = [](RfidCmd *cmd_) { cmd_->getWorkAntenna(); };
+            break;
+        case RfidCid::cmd_set_output_power:
+            if (data_buf_.size() == 1) {
+                uint8_t pow = data_buf_[0];
+                send = [pow](RfidCmd *cmd_) { cmd_->setOutputPower(pow, pow, pow, pow); };
+            } else if (data_buf_.size() == 4) {
+                RfidBuffer pows = data_buf_;
+                send = [pows](RfidCmd *cmd_) { cmd_->setOutputPower(pows[0], pows[1], pows[2], pows[3]); };
+            } else {
+                res = false;
+            }
+            break;
+        case RfidCid::cmd_get_output_power:
+            send = [](RfidCmd *cmd_) { cmd_->getOutputPower(); };
+            break;
+        case RfidCid::cmd_set_frequency_region:
+            if (data_buf_.size() == 3 or data_buf_.size() == 2) {
+                RfidESpektrumRegion region = static_cast<RfidESpektrumRegion>(data_buf_[0]);
+                uint8_t start_freq = data_buf_[1];
+                uint8_t end_freq = data_buf_.back();
+                send = [region, start_freq, end_freq](RfidCmd *cmd_) {
+                    cmd_->setFrequencyRegion(region, start_freq, end_freq);
+                };
+            } else {
+                res = false;
+            }
+            break;
+        case RfidCid::cmd_get_frequency_region:
+            send = [](RfidCmd *cmd_) { cmd_->getFrequencyRegion(); };
+            break;
+        case RfidCid::cmd_inventory: {
+                uint8_t repeat = data_buf_.empty() ? 0x0 : data_buf_[0];
+                send = [repeat](RfidCmd *cmd_) { cmd_->inventory(repeat); };
+            }
+            break;
+        case RfidCid::cmd_real_time_inventory: {
+                uint8_t repeat = data_buf_.empty() ? REAL_TIME_INVENTORY_REPEAT : data_buf_[0];
+                send = [repeat](RfidCmd *cmd_) { cmd_->realTimeInventory(repeat); };
+            }
+            break;
+        case RfidCid::cmd_fast_switch_ant_inventory:
+            if (data_buf_.size() == 10) { ///< A, Stay, B, Stay, C, Stay, D, Stay, Interval, Repeat.
+                RfidFss sets;
+                for (size_t a = 0; a < static_cast<size_t>(RfidWorkAntenna::QUANTITY); ++a) {
+                    sets._ants[a] = data_buf_[a * 2];
+                    sets._stays[a] = data_buf_[a * 2 + 1];
+                }
+                sets._interval = data_buf_[8];
+                sets._repeat = data_buf_[9];
+                send = [sets](RfidCmd *cmd_) { cmd_->fastSwitchAntInventory(sets); };
+            } else if (data_buf_.empty()) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                RfidFss sets = _fast_switch_sets;
+                send = [sets](RfidCmd *cmd_) { cmd_->fastSwitchAntInventory(sets); };
+            } else {
+                res = false;
+            }
+            break;
+        case RfidCid::cmd_customized_session_target_inventory:
+            if (data_buf_.size() == 3 or data_buf_.size() == 2) { ///< Session, Target, [Repeat].
+                RfidSession session = static_cast<RfidSession>(data_buf_[0]);
+                RfidTarget target = static_cast<RfidTarget>(data_buf_[1]);
+                uint8_t repeat = data_buf_.size() == 3 ? data_buf_[2] : REAL_TIME_INVENTORY_REPEAT;
+                send = [session, target, repeat](RfidCmd *cmd_) {
+                    cmd_->customizedSessionTargetInventory(session, target, repeat);
+                };
+            } else {
+                res = false;
+            }
+            break;
+        case RfidCid::cmd_read: {
+                RfidCmd::EReadMemBank mem_bank = data_buf_.size() ?
+                                                 static_cast<RfidCmd::EReadMemBank>(data_buf_[0]) :
+                                                 RfidCmd::EReadMemBank::EPC;
+                send = [mem_bank](RfidCmd *cmd_) { cmd_->read(mem_bank, 0x0, 0x01); };
+            }
+            break;
+        case RfidCid::cmd_get_inventory_buffer:
+            send = [](RfidCmd *cmd_) { cmd_->getInventoryBuffer(); };
+            break;
+        case RfidCid::cmd_get_and_reset_inventory_buffer:
+            send = [](RfidCmd *cmd_) { cmd_->getAndResetInventoryBuffer(); };
+            break;
+        case RfidCid::cmd_get_inventory_buffer_tag_count:
+            send = [](RfidCmd *cmd_) { cmd_->getInventoryBufferTagCount(); };
+            break;
+        case RfidCid::cmd_reset_inventory_buffer:
+            send = [](RfidCmd *cmd_) { cmd_->resetInventoryBuffer(); };
+            break;
+        default:
+            LOG(WARNING) << "Undeclared command: " << RfidCmdHdl::toString(static_cast<uint8_t>(cmd_id_));
+            res = false;
+            break;
+    }
+    if (res and _pipeline) {
+        /// Ответ обрабатывается потоком порта, ожидать его не требуется.
+        post(cid, send);
     }
     return res;
 }
@@ -535,11 +752,7 @@ void RfidController::inventory(size_t count_, bool with_count_) {
                 /// Проверять метки на изменение их количества каждую попытку.
                 compareBuffers(false);
                 /// Зафиксировать изменения.
-                {
-                    std::unique_lock<std::mutex> lock(_mutex);
-                    _read_data = _cur_read_data;
-                    LOG(TRACE) << "Save cur buf: " << _read_data.size();
-                }
+                saveCycle();
                 /// Подождать после выполнения текущей операции.
                 if (_is_inventory) {
                     std::this_thread::sleep_for(chr::milliseconds(_reread_timeout));
@@ -578,11 +791,21 @@ void RfidController::startInventory(bool need_result_) {
             _accumulate_data.clear();
             LOG(TRACE) << "Clear accumulated buf: " << _accumulate_data.size();
         }
+        /// Первый цикл после запуска - полная сверка, выставляющая флаги сессии всем меткам.
+        _session_cycle = 0;
         while (_is_inventory) {
+            /// Итоговый результат и каждый N-й цикл требуют полной сверки.
+            bool is_sweep = need_result_ or (_session_cycle++ % std::max<size_t>(_sweep_period, 1)) == 0;
             /// Сбросить буфер меток.
             {
                 std::unique_lock<std::mutex> lock(_mutex);
-                _cur_read_data.clear();
+                if (is_sweep or _session == RfidSession::S0) {
+                    _cur_read_data.clear();
+                } else {
+                    /// Опрошенные метки молчат до полной сверки: считать их присутствующими.
+                    /// Присваивание маски того же размера не выделяет память.
+                    _cur_read_data = _read_data;
+                }
                 LOG(TRACE) << "Clear cur buf: " << _cur_read_data.size();
             }
             /// Проинициализировать и прочитать буфер меток, по завершению - сбросить.
@@ -590,21 +813,16 @@ void RfidController::startInventory(bool need_result_) {
             if (need_result_) {
                 for (size_t i = 0; i < _attempt_read_num; ++i) {
                     LOG(DEBUG) << "STEP: " << i;
-                    bufferReadProcess();
+                    readProcess(is_sweep);
                 }
             } else {
-                bufferReadProcess();
+                readProcess(is_sweep);
             }
             LOG(DEBUG) << "Buf read 1 }";
             /// Проверять метки на изменение их количества каждую попытку.
             compareBuffers(false); ///need_result_);
             ///< Зафиксировать изменения.
-            {
-                std::unique_lock<std::mutex> lock(_mutex);
-                _read_data = _cur_read_data;
-                //_read_data = _accumulate_data;
-                LOG(TRACE) << "Save cur buf: " << _read_data.size();
-            }
+            saveCycle();
             /// Подождать после выполнения текущей операции.
             if (_is_inventory) {
                 std::this_thread::sleep_for(chr::milliseconds(_reread_timeout));
@@ -634,7 +852,7 @@ void RfidController::accumulateBuffer() {
 }
 
 
-MapReadDatas RfidController::getProbBuffer() {
+RfidTagTable RfidController::getProbBuffer() {
     std::unique_lock<std::mutex> lock(_mutex);
     return _prob_read_data;
 }
@@ -643,20 +861,15 @@ MapReadDatas RfidController::getProbBuffer() {
 std::string RfidController::getAntSettings() {
     std::stringstream ss_ant_sets;
     if (not _is_inventory) {
-        {
-            std::unique_lock<std::mutex> lock(_mutex);
-            if (_rfid_handler) {
-                RfidCmd *rfid_cmd = _rfid_handler->getCommand();
-                if (rfid_cmd) {
-                    /// Получить частотные настройки.
-                    rfid_cmd->getFrequencyRegion();
-                    extLockWaitCmdResult(RfidCid::cmd_get_frequency_region, lock, UNLOCK_TIMEOUT);
-                    /// Получить мощность антенн.
-                    rfid_cmd->getOutputPower();
-                    extLockWaitCmdResult(RfidCid::cmd_get_output_power, lock, UNLOCK_TIMEOUT);
-                }
-            }
-        }
+        /// Получить частотные настройки и мощность антенн одной пачкой запросов.
+        RfidFuture region = post(RfidCid::cmd_get_frequency_region, [](RfidCmd *cmd_) {
+            cmd_->getFrequencyRegion();
+        });
+        RfidFuture power = post(RfidCid::cmd_get_output_power, [](RfidCmd *cmd_) {
+            cmd_->getOutputPower();
+        });
+        wait(region);
+        wait(power);
         /// Зафиксировать полученные данные.
         {
             std::unique_lock<std::mutex> lock(_mutex);
@@ -695,6 +908,8 @@ void RfidController::setBufReadNumAttempt(size_t buf_read_num_attempt_) {
 
 
 size_t RfidController::getBufReadNumAttempt() {
+    /// Читается из очереди инвенторизации, изменяется из очереди запросов к модулю.
+    std::unique_lock<std::mutex> lock(_mutex);
     LOG(DEBUG) << _close_read_num;
     return _close_read_num;
 }
@@ -707,6 +922,64 @@ void RfidController::setReadAntennsTimeout(size_t timeout_) {
 }
 
 
+void RfidController::setAntennasSequence(const std::vector<uint8_t> &ants_, size_t stay_) {
+    LOG(DEBUG) << RfidCmdHdl::toString(ants_) << " stay: " << stay_;
+    std::unique_lock<std::mutex> lock(_mutex);
+    _use_fast_switch = not ants_.empty();
+    uint8_t stay = static_cast<uint8_t>(std::min<size_t>(std::max<size_t>(stay_, 1), 0xff));
+    for (size_t a = 0; a < static_cast<size_t>(RfidWorkAntenna::QUANTITY); ++a) {
+        /// Номер антенны больше 3 считыватель пропускает.
+        _fast_switch_sets._ants[a] = a < ants_.size() ? ants_[a] : 0xff;
+        _fast_switch_sets._stays[a] = stay;
+    }
+}
+
+
+void RfidController::setSessionSettings(uint8_t session_, size_t sweep_period_) {
+    LOG(DEBUG) << "session: S" << static_cast<uint16_t>(session_) << " sweep period: " << sweep_period_;
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (session_ > static_cast<uint8_t>(RfidSession::S3)) {
+        LOG(WARNING) << "Incorrect session: " << static_cast<uint16_t>(session_);
+    } else {
+        _session = static_cast<RfidSession>(session_);
+        _sweep_period = std::max<size_t>(sweep_period_, 1);
+    }
+}
+
+
+void RfidController::setLabelsSyncMode(bool is_delta_) {
+    LOG(DEBUG) << "delta: " << is_delta_;
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (is_delta_ not_eq _use_delta_sync) {
+        _use_delta_sync = is_delta_;
+        _label_sync.reset();
+    }
+}
+
+
+void RfidController::ackLabelsSync(uint32_t version_) {
+    LOG(DEBUG) << version_;
+    std::unique_lock<std::mutex> lock(_mutex);
+    _label_sync.ack(version_);
+}
+
+
+void RfidController::resyncLabels() {
+    LOG(INFO) << "Full labels resync.";
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _label_sync.reset();
+    }
+    accumulateBuffer();
+}
+
+
+void RfidController::setCycleObserver(const RfidCycleFunc &func_) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _on_cycle = func_;
+}
+
+
 void RfidController::findBrokenLabels(size_t iterations_num_) {
     if (not iterations_num_) {
         iterations_num_ = 1;
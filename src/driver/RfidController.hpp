@@ -12,13 +12,16 @@
 #include <string>
 #include <utility>
 #include <thread>
-#include <map>
-#include <condition_variable>
+#include <functional>
 
 #include "Bases.hpp"
 #include "Timer.hpp"
 #include "CommandsHandler.hpp"
+#include "CommandPipeline.hpp"
+#include "TagTable.hpp"
+#include "TagIndex.hpp"
 #include "TtyIo.hpp"
+#include "LabelSync.hpp"
 
 namespace robocooler {
 namespace driver {
@@ -33,14 +36,22 @@ typedef robocooler::rfid::Message::Buffer RfidBuffer;
 typedef robocooler::rfid::CommandsHandler RfidCommandsHandler;
 typedef robocooler::rfid::Command::AntSettings RfidCas;
 typedef std::shared_ptr<RfidCommandsHandler> PRfidCommandsHandler;
-typedef std::shared_ptr<std::condition_variable> PCondition;
-typedef std::map<RfidCid, PCondition> MapWaitCmdResults;
-typedef MapWaitCmdResults::iterator WaitCmdResultIter;
+typedef robocooler::rfid::CommandPipeline RfidPipeline;
+typedef std::shared_ptr<RfidPipeline> PRfidPipeline;
+typedef RfidPipeline::SendFunc RfidSendFunc;
+typedef RfidPipeline::Future RfidFuture;
 typedef RfidCmd::EWorkAntenna RfidWorkAntenna; 
-typedef std::map<std::string, RfidCmd::ReadCmdData> MapReadDatas;
-typedef MapReadDatas::iterator ReadDataIter;
+typedef RfidCmd::FastSwitchSettings RfidFss;
+typedef RfidCmd::ESession RfidSession;
+typedef RfidCmd::ETarget RfidTarget;
+typedef robocooler::rfid::TagTable RfidTagTable;
+typedef robocooler::rfid::TagRecord RfidTagRecord;
+typedef robocooler::rfid::TagIndex RfidTagIndex;
+typedef robocooler::rfid::TagSet RfidTagSet;
+typedef robocooler::rfid::TagRemap RfidTagRemap;
 typedef utils::Timer Timer;
 typedef std::shared_ptr<Timer> PTimer;
+typedef std::function<void(size_t)> RfidCycleFunc;
 
 
 class RfidController 
@@ -49,49 +60,62 @@ class RfidController
     WorkerBase *_worker;                         ///< Объект контроллер клиентского подключения к серверу.
     bool _is_inited;                             ///< Флаг true - если последовательный порт к RFID модулю инициализирован.
     AtomicBool _is_runing;                       ///< Флаг true - если запущен процесс обслуживания порта RFID модуля.
-    MapWaitCmdResults _cmd_conditions;           ///< Дерево объектов синхронизации для ожидания результата запроса.
     PThread _thread;                             ///< Поток обслуживания последовательного порта.
     PThread _inv_thread;                         ///< Поток обслуживания процесса инвенторизации.
     PThread _acm_inv_thread;                     ///< Поток обслуживания процесса получения текущего содержимого.
     AtomicBool _is_inventory;                    ///< Атомарный флаг процесса инвенторизации.
     AtomicBool _is_inventory_run;                ///< Атомарный флаг процесса инвенторизации.
+    AtomicBool _is_streaming;                    ///< Флаг выполнения потоковой инвенторизации (метки фиксируются по мере приёма).
+    bool _use_stream;                            ///< Использовать потоковую инвенторизацию при открытых дверях.
+    bool _use_fast_switch;                       ///< Опрашивать все антенны одной командой с быстрым переключением.
+    RfidFss _fast_switch_sets;                   ///< Последовательность антенн для быстрого переключения.
+    RfidSession _session;                        ///< Сессия опроса с флагами A/B, S0 - опрос без сессии.
+    size_t _sweep_period;                        ///< Количество циклов между полными сверками при опросе по сессии.
+    size_t _session_cycle;                       ///< Номер цикла опроса по сессии с момента запуска инвенторизации.
     PRfidCommandsHandler _rfid_handler;          ///< Обработчик RFID протокола.
+    PRfidPipeline _pipeline;                     ///< Очередь запросов к RFID модулю с сопоставлением ответов.
     size_t _read_count;                          ///< Количество опросов антенн при старт-стопной инвентаризации.
     RfidCas _ant_sets;                           ///< Текущие настройки антенн.
     PTtyIo _tty_io;                              ///< Последовательный порт.
     PTimer _periodic_inventory_timeout;          ///< Таймер процесса закрытой инвенторизации.
-    PTimer _notify_timer;                        ///< Таймер аварийного сброса ожидающих мютексов.
+    RfidCycleFunc _on_cycle;                     ///< Наблюдатель завершения цикла опроса.
 
-    MapReadDatas _read_data;       ///< Буфер полученных меток при инициализации или при предыдущем чтении.
-    MapReadDatas _cur_read_data;   ///< Буфер меток, считываемых при текущем запросе.
-    MapReadDatas _buffered_data;   ///< Буфер меток, ожидаемых из rfid после команды запроса меток.
-    MapReadDatas _accumulate_data; ///< Буфер меток, накапливаемых в процессе инвенторизации.
-    MapReadDatas _prob_read_data;  ///< Буфер когда либо считанных меток для вычисления вероятности появления.
+    RfidTagIndex _tag_ids;         ///< Плотные идентификаторы меток для наборов RfidTagSet.
+    RfidTagSet _read_data;         ///< Буфер полученных меток при инициализации или при предыдущем чтении.
+    RfidTagSet _cur_read_data;     ///< Буфер меток, считываемых при текущем запросе.
+    RfidTagSet _buffered_data;     ///< Буфер меток, ожидаемых из rfid после команды запроса меток.
+    RfidTagSet _added_tags;        ///< Метки, появившиеся в последнем цикле.
+    RfidTagSet _removed_tags;      ///< Метки, пропавшие в последнем цикле.
+    RfidTagTable _accumulate_data; ///< Буфер меток, накапливаемых в процессе инвенторизации.
+    RfidTagTable _prob_read_data;  ///< Буфер когда либо считанных меток для вычисления вероятности появления.
+    RfidTagSet _sync_data;         ///< Содержимое шкафа для версионной синхронизации.
+    RfidTagSet _live_tags;         ///< Метки, на которые ссылаются наборы, при проверке сжатия индекса.
+    LabelSync _label_sync;         ///< Версии содержимого, отправленные и подтверждённые сервером.
 
     size_t _reread_timeout; ///< Таймаут перезапуска опроса антенн [миллисекунты].
     size_t _close_read_num; ///< Количество обходов антенн после закрытия дверей.
     size_t _attempt_read_num; ///< Количество обходов антенна при открытых дверях.
+    bool _use_delta_sync;     ///< Передавать содержимое изменениями относительно подтверждённой версии.
 
     /**
-     * \brief Метод уведомляет о завершении ожидания потока в условной переменной синхронизации.
-     * \param cmd_id_ Идентификатор команды, связанной с условной переменной синхронизации.
-     */ 
-    void notifyOneCmdResult(RfidCid cmd_id_);
+     * \brief Метод ставит запрос в очередь RFID модуля, не дожидаясь ответа.
+     * \param cmd_id_ Команда, ответ на которую завершает запрос.
+     * \param send_  Отправка пакета запроса.
+     * \param timeout_  Срок получения ответа [миллисекунды].
+     */
+    RfidFuture post(RfidCid cmd_id_, const RfidSendFunc &send_, size_t timeout_ = UNLOCK_TIMEOUT);
 
     /**
-     * \brief Метод переводит условную переменной синхронизации в состояние ожидания.
-     * \param cmd_id_ Идентификатор команды, связанной с условной переменной синхронизации.
-     */ 
-    void waitCmdResult(RfidCid cmd_id_);
+     * \brief Метод ожидает результат запроса.
+     * \return false, если срок ответа истёк; true, если ответ получен.
+     */
+    bool wait(RfidFuture &future_);
 
     /**
-     * \brief Метод переводит условную переменной синхронизации в состояние ожидания, для внешнего мютекса.
-     * \param cmd_id_ Идентификатор команды, связанной с условной переменной синхронизации.
-     * \param lock_  Внешний lock.
-     * \param unlock_timout_  Таймаут, после которого произойдёт принудительный сброс таймера. 
-     * \return false, если сработал таймер принудительного завершения ожидания; true, если таймер не сработал.
+     * \brief Метод выполняет запрос и ожидает ответ.
+     * \return false, если срок ответа истёк; true, если ответ получен.
      */
-    bool extLockWaitCmdResult(RfidCid cmd_id_, std::unique_lock<std::mutex>& lock_, size_t unlock_timout_);
+    bool call(RfidCid cmd_id_, const RfidSendFunc &send_, size_t timeout_ = UNLOCK_TIMEOUT);
 
     /**
      * \brief Метод обслуживания подсистемы объмена с RFID монтроллером.
@@ -124,6 +148,49 @@ class RfidController
      */
     void bufferReadProcess();
 
+    /**
+     * \brief Метод выполняет потоковую инвенторизацию (cmd_fast_switch_ant_inventory или cmd_real_time_inventory):
+     *        метки попадают в текущий буфер по мере приёма, без чтения буфера считывателя.
+     */
+    void streamReadProcess();
+
+    /**
+     * \brief Метод выполняет cmd_customized_session_target_inventory на каждой антенне последовательности.
+     * \param target_ Отвечают только метки с этим флагом; ответившие метки меняют флаг на противоположный.
+     */
+    void sessionPass(RfidTarget target_);
+
+    /**
+     * \brief Метод выполняет опрос по сессии.
+     *        Обычный цикл опрашивает флаг A: отвечают только новые метки и метки, не опрошенные недавно.
+     *        Полная сверка сначала опрашивает флаг B (все уже известные метки, флаг меняется на A),
+     *        затем флаг A, так что каждая метка в поле отвечает и снова получает флаг B.
+     * \param is_sweep_ true - полная сверка, по которой выявляются изъятые метки.
+     */
+    void sessionReadProcess(bool is_sweep_);
+
+    /**
+     * \brief Метод выбирает способ опроса по текущим настройкам.
+     * \param is_sweep_ true - цикл должен вернуть все метки в поле.
+     */
+    void readProcess(bool is_sweep_);
+
+    /**
+     * \brief Метод возвращает количество считываний метки из вероятностного буфера. Вызывается под _mutex.
+     */
+    uint32_t readedNum(uint32_t id_) const;
+
+    /**
+     * \brief Метод фиксирует изменения цикла опроса и сообщает о завершении цикла наблюдателю.
+     */
+    void saveCycle();
+
+    /**
+     * \brief Метод освобождает идентификаторы меток, которых нет ни в одном наборе, когда живых меток
+     *        меньше 1/RFID_TAG_INDEX_COMPACT_RATIO индекса. Вызывается под _mutex.
+     */
+    void compactTagIds();
+
     /**
      * \brief Метод выполняет фиксацию принятой метки.
      * \param read_data_ Структура с данными метки.
@@ -189,7 +256,7 @@ public:
     /**
      * \brief Метод текущий вероятностный буфер меток.
      */
-    MapReadDatas getProbBuffer();
+    RfidTagTable getProbBuffer();
 
     /**
      * \brief Метод возвращающий текущие настройки антенн в виде JSON.
@@ -220,6 +287,42 @@ public:
      */
     void setReadAntennsTimeout(size_t timeout_) override;
 
+    /**
+     * \brief Метод устанавливает последовательность антенн для опроса с быстрым переключением.
+     * \param ants_ Номера антенн в порядке опроса (0..3); пустой список отключает быстрое переключение.
+     * \param stay_ Количество циклов инвенторизации на каждой антенне.
+     */
+    void setAntennasSequence(const std::vector<uint8_t> &ants_, size_t stay_) override;
+
+    /**
+     * \brief Метод устанавливает сессию опроса меток и период полной сверки.
+     * \param session_ Номер сессии (1 - S1, 2 - S2); 0 отключает опрос по сессии.
+     * \param sweep_period_ Количество циклов между полными сверками.
+     */
+    void setSessionSettings(uint8_t session_, size_t sweep_period_) override;
+
+    /**
+     * \brief Метод включает версионную синхронизацию содержимого изменениями ("syncLabels").
+     * \param is_delta_ false - полный список меток в каждой посылке ("verifyLabelsSynchronization").
+     */
+    void setLabelsSyncMode(bool is_delta_) override;
+
+    /**
+     * \brief Метод принимает подтверждение сервером версии содержимого.
+     */
+    void ackLabelsSync(uint32_t version_) override;
+
+    /**
+     * \brief Метод сбрасывает подтверждённую версию и отправляет содержимое полностью.
+     */
+    void resyncLabels() override;
+
+    /**
+     * \brief Метод устанавливает наблюдателя, вызываемого из потока опроса после каждого цикла.
+     * \param func_ Функтор, получающий количество меток в шкафу по итогам цикла.
+     */
+    void setCycleObserver(const RfidCycleFunc &func_);
+
     /**
      * \brief Метод запускает процесс выявления плохо читаемых меток.
      * \param iterations_num_ Количество иттераций при тестировании.
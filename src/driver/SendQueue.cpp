@@ -0,0 +1,111 @@
+#include <cstring>
+
+#include "Log.hpp"
+#include "SendQueue.hpp"
+
+
+using namespace robocooler;
+using namespace driver;
+
+
+SendQueue::SendQueue(size_t max_size_)
+    : _size(0)
+    , _max_size(max_size_ ? max_size_ : 1) {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+
+bool SendQueue::push(const std::string &message_, EPayloadFormat format_, ESendLane lane_,
+                     const char *coalesce_key_, uint64_t seq_) {
+    size_t lane_id = static_cast<size_t>(lane_);
+    if (lane_id >= SEND_LANES_NUM) {
+        lane_id = SEND_LANES_NUM - 1;
+    }
+    std::unique_lock<std::mutex> lock(_mutex);
+    /// Досылка журнала после переподключения не дублирует события, оставшиеся в очереди,
+    /// а только обновляет их кодирование, если оно сменилось.
+    if (seq_) {
+        for (Lane &queued : _lanes) {
+            for (Item &item : queued) {
+                if (item._seq == seq_) {
+                    item._message = message_;
+                    item._format = format_;
+                    return true;
+                }
+            }
+        }
+    }
+    ++_stats._pushed;
+    Lane &lane = _lanes[lane_id];
+    /// Неотправленный снимок заменяется новым на своём месте в очереди.
+    if (coalesce_key_ and *coalesce_key_) {
+        for (Item &item : lane) {
+            if (item._key == coalesce_key_) {
+                item._message = message_;
+                item._format = format_;
+                item._seq = seq_;
+                ++_stats._coalesced;
+                return true;
+            }
+        }
+    }
+    if (_size >= _max_size) {
+        size_t drop_id = SEND_LANES_NUM;
+        while (drop_id > lane_id and _lanes[drop_id - 1].empty()) {
+            --drop_id;
+        }
+        ++_stats._dropped;
+        if (drop_id == lane_id) {
+            LOG(WARNING) << "Send queue is full, message is dropped: lane " << lane_id;
+            return false;
+        }
+        LOG(WARNING) << "Send queue is full, oldest message is dropped: lane " << drop_id - 1;
+        _lanes[drop_id - 1].pop_front();
+        --_size;
+    }
+    Item item;
+    if (coalesce_key_) {
+        item._key = coalesce_key_;
+    }
+    item._message = message_;
+    item._format = format_;
+    item._seq = seq_;
+    lane.push_back(std::move(item));
+    ++_size;
+    if (_size > _stats._max_depth) {
+        _stats._max_depth = _size;
+    }
+    return true;
+}
+
+
+bool SendQueue::pop(std::string &message_, EPayloadFormat &format_) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (Lane &lane : _lanes) {
+        if (not lane.empty()) {
+            message_.swap(lane.front()._message);
+            format_ = lane.front()._format;
+            lane.pop_front();
+            --_size;
+            ++_stats._sent;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+size_t SendQueue::size() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _size;
+}
+
+
+SendQueueStats SendQueue::getStats() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    SendQueueStats stats = _stats;
+    for (size_t i = 0; i < SEND_LANES_NUM; ++i) {
+        stats._depth[i] = _lanes[i].size();
+    }
+    return stats;
+}
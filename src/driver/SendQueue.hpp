@@ -0,0 +1,96 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Ограниченная очередь исходящих посылок с полосами приоритета и вытеснением устаревших снимков.
+ * \author Величко Ростислав
+ * \date   07.20.2017
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <deque>
+#include <string>
+#include <memory>
+
+#include "Bases.hpp"
+
+
+static const size_t SEND_QUEUE_MAX_SIZE = 256; ///< Предельное количество неотправленных посылок.
+static const size_t SEND_LANES_NUM = static_cast<size_t>(robocooler::driver::ESendLane::QUANTITY);
+
+
+namespace robocooler {
+namespace driver {
+
+/**
+ * \brief Счётчики очереди отправки.
+ */
+struct SendQueueStats {
+    size_t _depth[SEND_LANES_NUM]; ///< Текущая глубина полос.
+    size_t _max_depth;             ///< Наибольшая глубина очереди с момента запуска.
+    uint64_t _pushed;              ///< Принято посылок.
+    uint64_t _sent;                ///< Выдано на отправку.
+    uint64_t _coalesced;           ///< Заменено более новыми посылками с тем же ключом.
+    uint64_t _dropped;             ///< Отброшено при переполнении.
+};
+
+
+/**
+ * \brief Очередь принимает посылки из любых потоков, выбирает их единственный писатель в потоке websocket.
+ *        Выдаётся первая посылка самой приоритетной непустой полосы, порядок внутри полосы сохраняется.
+ *        При переполнении отбрасывается самая старая посылка наименее приоритетной полосы,
+ *        но не приоритетнее добавляемой.
+ */
+class SendQueue {
+    struct Item {
+        std::string _key;        ///< Ключ вытеснения, пустой - посылка не вытесняется.
+        std::string _message;    ///< Посылка.
+        EPayloadFormat _format;  ///< Кодирование посылки, определяет тип кадра websocket.
+        uint64_t _seq;           ///< Номер события журнала, 0 - посылка без номера.
+    };
+    typedef std::deque<Item> Lane;
+
+    std::mutex _mutex;
+    Lane _lanes[SEND_LANES_NUM];
+    size_t _size;
+    size_t _max_size;
+    SendQueueStats _stats;
+
+public:
+    /**
+     * \param max_size_ Предельное количество неотправленных посылок.
+     */
+    explicit SendQueue(size_t max_size_ = SEND_QUEUE_MAX_SIZE);
+
+    /**
+     * \brief Метод добавляет посылку в полосу lane_.
+     * \param format_       Кодирование посылки.
+     * \param coalesce_key_ Ключ вытеснения или nullptr.
+     * \param seq_          Номер события журнала или 0. Событие, которое ещё ждёт отправки, не добавляется
+     *                      повторно, а заменяется на своём месте.
+     * \return false, если очередь заполнена посылками не ниже приоритетом и посылка отброшена.
+     */
+    bool push(const std::string &message_, EPayloadFormat format_, ESendLane lane_,
+              const char *coalesce_key_ = nullptr, uint64_t seq_ = 0);
+
+    /**
+     * \brief Метод извлекает очередную посылку для отправки вместе с её кодированием.
+     * \return false, если очередь пуста.
+     */
+    bool pop(std::string &message_, EPayloadFormat &format_);
+
+    /**
+     * \brief Метод возвращает количество неотправленных посылок.
+     */
+    size_t size();
+
+    /**
+     * \brief Метод возвращает снимок счётчиков очереди.
+     */
+    SendQueueStats getStats();
+};
+
+typedef std::shared_ptr<SendQueue> PSendQueue;
+} /// driver
+} /// robocooler
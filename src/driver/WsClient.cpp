@@ -10,22 +10,39 @@ using namespace driver;
 namespace ph = std::placeholders;
 
 
-WsClient::WsClient(WsClientWorker *client_worker_) 
-    : _client_worker(client_worker_) {
+WsClient::WsClient(WsClientWorker *client_worker_, const PSendQueue &send_queue_) 
+    : _client_worker(client_worker_)
+    , _send_queue(send_queue_)
+    , _is_flushing(false)
+    , _connects(0)
+    , _resumed(0)
+    , _last_ms(0)
+    , _total_ms(0) {
     LOG(DEBUG);
 
-    _endpoint.set_tls_init_handler([this](websocketpp::connection_hdl) {
-        auto ctx = websocketpp::lib::make_shared<boost::asio::ssl::context>(boost::asio::ssl::context::tlsv1);
-
-        try {
-            ctx->set_options(boost::asio::ssl::context::default_workarounds |
-                             boost::asio::ssl::context::no_sslv2 |
-                             boost::asio::ssl::context::single_dh_use);
-        } catch (std::exception& e) {
-            std::cout << e.what() << std::endl;
+    /// Один контекст на все подключения: сессии TLS 1.2 (ID и билеты) и TLS 1.3 сохраняются между ними.
+    _tls_context = wsl::make_shared<TlsContext>(TlsContext::sslv23_client);
+    boost::system::error_code ec;
+    _tls_context->set_options(TlsContext::default_workarounds |
+                              TlsContext::no_sslv2 |
+                              TlsContext::no_sslv3 |
+                              TlsContext::no_tlsv1 |
+                              TlsContext::no_tlsv1_1 |
+                              TlsContext::no_compression, ec);
+    if (ec) {
+        LOG(WARNING) << "Can`t set TLS options: " << ec.message();
+    }
+    SSL_CTX *ctx = _tls_context->native_handle();
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_set_app_data(ctx, this);
+    SSL_CTX_sess_set_new_cb(ctx, &WsClient::onNewTlsSession);
+    _endpoint.set_tls_init_handler([this](ConnectionHdl) {
+        return _tls_context;
+    });
+    _endpoint.set_socket_init_handler([this](ConnectionHdl, boost::asio::ssl::stream<boost::asio::ip::tcp::socket> &socket_) {
+        if (_tls_session) {
+            SSL_set_session(socket_.native_handle(), _tls_session.get());
         }
-        return ctx;
-        //return websocketpp::lib::make_shared<boost::asio::ssl::context>(boost::asio::ssl::context::tlsv1);
     });
 
     _endpoint.set_open_handshake_timeout(HANDSHAKE_TIMEOUT);
@@ -48,24 +65,112 @@ WsClient::WsClient(WsClientWorker *client_worker_)
 WsClient::~WsClient() {
     LOG(DEBUG);
 }
+
+
+int WsClient::onNewTlsSession(SSL *ssl_, SSL_SESSION *session_) {
+    WsClient *client = static_cast<WsClient*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl_)));
+    if (not client) {
+        return 0;
+    }
+    /// Сессия переходит во владение клиента.
+    client->_tls_session = PTlsSession(session_, &SSL_SESSION_free);
+    return 1;
+}
+
+
+void WsClient::onOpen(ConnectionHdl hdl_) {
+    uint64_t ms = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - _connect_start).count());
+    bool is_resumed = false;
+    wsl::error_code ec;
+    PConnection con = _endpoint.get_con_from_hdl(hdl_, ec);
+    if (con) {
+        is_resumed = SSL_session_reused(con->get_socket().native_handle());
+    }
+    ++_connects;
+    if (is_resumed) {
+        ++_resumed;
+    }
+    _last_ms = ms;
+    _total_ms += ms;
+    LOG(INFO) << "Connected in " << ms << " ms, TLS session " << (is_resumed ? "resumed." : "is new.");
+    _client_worker->onOpen(&_endpoint, hdl_);
+}
+
+
+void WsClient::drain() {
+    _is_flushing = false;
+    if (not _send_queue or not _connection or _connection->get_state() not_eq ws::session::state::open) {
+        return;
+    }
+    std::string message;
+    EPayloadFormat format;
+    while (_connection->get_buffered_amount() < SEND_BUFFERED_MAX) {
+        if (not _send_queue->pop(message, format)) {
+            return;
+        }
+        send(message, format);
+    }
+    /// Медленный канал: оставшиеся посылки ждут в очереди, где их могут обогнать приоритетные.
+    if (not _is_flushing.exchange(true)) {
+        _endpoint.set_timer(SEND_RETRY_TIMEOUT, [this](const wsl::error_code &ec_) {
+            if (not ec_) {
+                drain();
+            } else {
+                _is_flushing = false;
+            }
+        });
+    }
+}
+
+
+void WsClient::onPongTimeout(ConnectionHdl hdl_, const std::string &payload_) {
+    wsl::error_code ec;
+    PConnection con = _endpoint.get_con_from_hdl(hdl_, ec);
+    if (not con) {
+        return;
+    }
+    LOG(WARNING) << "No pong in " << PONG_TIMEOUT << " ms, connection is dropped.";
+    con->set_close_handshake_timeout(DROP_CLOSE_TIMEOUT);
+    con->close(ws::close::status::going_away, "Pong timeout", ec);
+    if (ec) {
+        LOG(DEBUG) << "Error initiating close: " << ec.message();
+    }
+}
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
 bool WsClient::connect(const std::string &uri_) {
-    bool result = true;
     wsl::error_code ec;
     _connection = _endpoint.get_connection(uri_, ec);
     if (ec) {
         LOG(ERROR) << "Connect initialization error: " << ec.message();
-        result = false;
+        return false;
     }
-    _connection->set_open_handler(std::bind(&WsClientWorker::onOpen, _client_worker, &_endpoint, ph::_1));
+    /// Предложить двоичный режим; старый сервер не выбирает подпротокол и остаётся JSON.
+    _connection->add_subprotocol(WS_SUBPROTOCOL_CBOR, ec);
+    if (ec) {
+        LOG(WARNING) << "Can`t add subprotocol: " << ec.message();
+    }
+    _connection->set_open_handler(std::bind(&WsClient::onOpen, this, ph::_1));
     _connection->set_fail_handler(std::bind(&WsClientWorker::onError, _client_worker, &_endpoint, ph::_1));
     _connection->set_close_handler(std::bind(&WsClientWorker::onClose, _client_worker, &_endpoint, ph::_1));
     _connection->set_message_handler(std::bind(&WsClientWorker::onMessage, _client_worker, ph::_1, ph::_2));
+    _connection->set_pong_timeout_handler(std::bind(&WsClient::onPongTimeout, this, ph::_1, ph::_2));
+    _connection->set_pong_timeout(PONG_TIMEOUT);
+    _connect_start = Clock::now();
     _endpoint.connect(_connection);
-    LOG(DEBUG) << uri_ << " is " << (result ? "TRUE" : "FALSE");
-    return result;
+    LOG(DEBUG) << uri_ << " is TRUE";
+    return true;
+}
+
+
+void WsClient::reconnect(const std::string &uri_, size_t delay_) {
+    _endpoint.set_timer(static_cast<long>(delay_), [this, uri_](const wsl::error_code &ec_) {
+        if (not ec_) {
+            connect(uri_);
+        }
+    });
 }
 
 
@@ -84,13 +189,39 @@ void WsClient::close(const ws::close::status::value &code_, const std::string &r
 }
 
 
-bool WsClient::send(const std::string &message_) {
+void WsClient::flush() {
+    if (not _is_flushing.exchange(true)) {
+        _endpoint.get_io_service().post(std::bind(&WsClient::drain, this));
+    }
+}
+
+
+void WsClient::ping() {
+    _endpoint.get_io_service().post([this] {
+        if (not _connection or _connection->get_state() not_eq ws::session::state::open) {
+            return;
+        }
+        wsl::error_code ec;
+        _connection->ping("", ec);
+        if (ec) {
+            LOG(DEBUG) << "Error sending ping: " << ec.message();
+        }
+    });
+}
+
+
+bool WsClient::send(const std::string &message_, EPayloadFormat format_) {
     bool result = true;
     if (_connection) {
-        LOG(DEBUG) << message_;
+        bool is_text = (format_ == EPayloadFormat::JSON);
+        if (is_text) {
+            LOG(DEBUG) << message_;
+        } else {
+            LOG(DEBUG) << "CBOR: " << message_.size();
+        }
         wsl::error_code ec;
         ConnectionHdl handle = _connection->get_handle();
-        _endpoint.send(handle, message_, ws::frame::opcode::text, ec);
+        _endpoint.send(handle, message_, is_text ? ws::frame::opcode::text : ws::frame::opcode::binary, ec);
         if (ec) {
             LOG(ERROR) << "Error sending message: " << ec.message();
             result = false;
@@ -101,3 +232,13 @@ bool WsClient::send(const std::string &message_) {
     }
     return result;
 }
+
+
+TlsStats WsClient::getTlsStats() const {
+    TlsStats stats;
+    stats._connects = _connects;
+    stats._resumed = _resumed;
+    stats._last_ms = _last_ms;
+    stats._total_ms = _total_ms;
+    return stats;
+}
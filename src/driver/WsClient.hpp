@@ -7,15 +7,24 @@
 #pragma once
 
 #include <mutex>
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <stack>
 
-#include "websocketpp/config/asio_client.hpp"
+#include "WsConfig.hpp"
 #include "websocketpp/client.hpp"
 
+#include "SendQueue.hpp"
+
 
 #define HANDSHAKE_TIMEOUT 30000
+#define PONG_TIMEOUT 1000       ///< Ожидание ответа на ping, дольше - соединение считается оборванным [милисекунды].
+#define DROP_CLOSE_TIMEOUT 300  ///< Ожидание ответа на закрытие оборванного соединения [милисекунды].
+#define SEND_BUFFERED_MAX 65536 ///< Предельный объём данных в буфере соединения, выше - отправка откладывается [байт].
+#define SEND_RETRY_TIMEOUT 50   ///< Интервал повторной попытки отправки при заполненном буфере [милисекунды].
+#define WS_SUBPROTOCOL_CBOR "robocooler.cbor" ///< Подпротокол двоичного режима, сервер без поддержки его не выбирает.
 
 namespace robocooler {
 namespace driver {
@@ -23,7 +32,7 @@ namespace driver {
 namespace ws = websocketpp;
 namespace wsl = websocketpp::lib;
 
-typedef ws::client<ws::config::asio_tls_client> Client;
+typedef ws::client<WsClientConfig> Client;
 typedef Client::connection_ptr PConnection;
 typedef Client::message_ptr PMessage;
 typedef ws::connection_hdl ConnectionHdl;
@@ -33,19 +42,91 @@ typedef std::shared_ptr<Thread> PThread;
 class WsClientWorker;
 
 
+/**
+ * \brief Счётчики установки соединений.
+ */
+struct TlsStats {
+    uint64_t _connects; ///< Успешных подключений.
+    uint64_t _resumed;  ///< Из них с возобновлением сессии TLS, без полного рукопожатия.
+    uint64_t _last_ms;  ///< Время последнего подключения: TCP, TLS и запрос websocket [милисекунды].
+    uint64_t _total_ms; ///< Суммарное время подключений [милисекунды].
+};
+
+
 class WsClient {
+    typedef boost::asio::ssl::context TlsContext;
+    typedef wsl::shared_ptr<TlsContext> PTlsContext;
+    typedef std::shared_ptr<SSL_SESSION> PTlsSession;
+    typedef std::chrono::steady_clock Clock;
+
     WsClientWorker *_client_worker;
     Client _endpoint;
     PConnection _connection;
+    PSendQueue _send_queue;        ///< Очередь исходящих посылок.
+    std::atomic_bool _is_flushing; ///< Выгрузка очереди уже запланирована в потоке клиента.
+    PTlsContext _tls_context;      ///< Общий контекст TLS всех подключений.
+    PTlsSession _tls_session;      ///< Последняя сессия TLS для возобновления, используется в потоке клиента.
+    Clock::time_point _connect_start;
+    std::atomic<uint64_t> _connects;
+    std::atomic<uint64_t> _resumed;
+    std::atomic<uint64_t> _last_ms;
+    std::atomic<uint64_t> _total_ms;
     PThread _thread;
+
+    /**
+     * \brief Функция сохраняет выданную сервером сессию (в TLS 1.3 - билет после рукопожатия).
+     */
+    static int onNewTlsSession(SSL *ssl_, SSL_SESSION *session_);
+
+    /**
+     * \brief Метод учитывает время подключения и передаёт его обработчику.
+     */
+    void onOpen(ConnectionHdl hdl_);
+
+    /**
+     * \brief Метод выгружает очередь в соединение, выполняется только в потоке клиента.
+     *        При заполненном буфере соединения выгрузка повторяется по таймеру.
+     */
+    void drain();
+
+    /**
+     * \brief Метод закрывает соединение, не ответившее на ping за PONG_TIMEOUT.
+     *        Ответа на закрытие полуоткрытое соединение не даст, поэтому ожидание сокращено до DROP_CLOSE_TIMEOUT,
+     *        после чего обработчик закрытия запускает переподключение.
+     */
+    void onPongTimeout(ConnectionHdl hdl_, const std::string &payload_);
     
 public:
-    WsClient(WsClientWorker *client_worker_);
+    WsClient(WsClientWorker *client_worker_, const PSendQueue &send_queue_);
     virtual ~WsClient();
     
     bool connect(const std::string &uri_);
+
+    /**
+     * \brief Метод планирует новое подключение через delay_ милисекунд в потоке клиента.
+     *        Поток, очередь отправки и точка подключения сохраняются.
+     */
+    void reconnect(const std::string &uri_, size_t delay_);
+
     void close(const ws::close::status::value &code_, const std::string &reason_);
-    bool send(const std::string &message_);
+
+    /**
+     * \brief Метод отправляет посылку: JSON - текстовым кадром, CBOR - двоичным.
+     * \param format_ Кодирование, с которым посылка сформирована.
+     */
+    bool send(const std::string &message_, EPayloadFormat format_);
+
+    /**
+     * \brief Метод планирует выгрузку очереди отправки в потоке клиента. Может вызываться из любого потока.
+     */
+    void flush();
+
+    /**
+     * \brief Метод планирует отправку ping в потоке клиента. Может вызываться из любого потока.
+     */
+    void ping();
+
+    TlsStats getTlsStats() const;
 };
 } /// driver
 } /// robocooler
@@ -1,5 +1,4 @@
 #include <exception>
-#include <sstream>
 #include <algorithm>
 #include <iterator>
 #include <utility>
@@ -11,13 +10,16 @@
 #include "Log.hpp"
 #include "LogSender.hpp"
 #include "JsonExtractor.hpp"
+#include "JsonWriter.hpp"
+#include "CborReader.hpp"
 #include "CommandHandler.hpp"
 #include "GpioController.hpp"
 #include "RfidController.hpp"
 #include "WsClientWorker.hpp"
 
 
-#define RECONNECT_TIMEOUT 1000 ///< Задержка на переподключение в милисекундах.
+#define RECONNECT_TIMEOUT 200        ///< Задержка первой попытки переподключения [милисекунды].
+#define RECONNECT_TIMEOUT_MAX 30000  ///< Предельная задержка переподключения [милисекунды].
 
 namespace bpt = boost::property_tree;
 namespace ph = std::placeholders;
@@ -26,23 +28,86 @@ using namespace robocooler;
 using namespace driver;
 
 typedef utils::Timer Timer;
+typedef nlohmann::json Json;
 
 
 void WsClientWorker::onOpen(Client *client_, ConnectionHdl hdl_) {
     LOG(DEBUG);
-    /// Активировать обработчик команд.
-    _command_handler = std::make_shared<CommandHandler>(this);
+    _attemp_connetion_count = 0;
+    _is_connect_error = false;
+    /// Активировать обработчик команд; при переподключении сохраняется прежний вместе с таймерами дверей.
+    if (not _command_handler) {
+        _command_handler = std::make_shared<CommandHandler>(this);
+    }
+    /// Сервер без поддержки двоичного режима не выбирает подпротокол.
+    /// Клиент websocketpp 0.7 не сохраняет выбор сервера в get_subprotocol(), он читается из ответа.
+    PConnection con = client_->get_con_from_hdl(hdl_);
+    bool is_cbor = (con and con->get_response_header("Sec-WebSocket-Protocol") == WS_SUBPROTOCOL_CBOR);
+    _payload_format = is_cbor ? EPayloadFormat::CBOR : EPayloadFormat::JSON;
+    LOG(INFO) << "Payload format: " << (is_cbor ? "CBOR" : "JSON");
+    if (con) {
+        /// Пустой заголовок - сервер не поддерживает сжатие, посылки идут как есть.
+        LOG(INFO) << "Extensions: \"" << con->get_response_header("Sec-WebSocket-Extensions") << "\"";
+    }
 
-    /// Запустить keepalive.
-    _keepalive_timer = std::make_shared<Timer>(KEEPALIVE_TIMER, [this] {
-        _keepalive_timer->restart(); ///< перезапустить таймер до очередного опроса доступности сервера.
+    /// Запустить keepalive. Обработчик перезапускает таймер через свою ссылку, а не через _keepalive_timer:
+    /// onError и onClose сбрасывают член в потоке клиента одновременно с работой обработчика.
+    std::shared_ptr<std::weak_ptr<Timer>> self = std::make_shared<std::weak_ptr<Timer>>();
+    PTimer keepalive_timer = std::make_shared<Timer>(KEEPALIVE_TIMER, [this, self] {
+        PTimer timer = self->lock();
+        if (not timer) {
+            return; ///< таймер сброшен при обрыве связи.
+        }
+        /// Полуоткрытое соединение без ответа на ping закрывается через PONG_TIMEOUT.
+        if (_client) {
+            _client->ping();
+        }
+        if (LOG_IS_ON(DEBUG)) {
+            SendQueueStats stats = _send_queue->getStats();
+            LOG(DEBUG) << "Send queue: " << stats._depth[0] << "/" << stats._depth[1] << "/" << stats._depth[2]
+                       << " max=" << stats._max_depth << " sent=" << stats._sent
+                       << " coalesced=" << stats._coalesced << " dropped=" << stats._dropped;
+            DeflateStats deflate = getDeflateStats();
+            if (deflate._messages) {
+                LOG(DEBUG) << "Deflate: " << deflate._raw_bytes << " -> " << deflate._packed_bytes
+                           << " ratio=" << static_cast<double>(deflate._raw_bytes) / deflate._packed_bytes
+                           << " ns/msg=" << deflate._deflate_ns / deflate._messages
+                           << " inflated=" << deflate._inflated_bytes << " inflate_ns=" << deflate._inflate_ns;
+            }
+            if (_client) {
+                TlsStats tls = _client->getTlsStats();
+                LOG(DEBUG) << "Connects: " << tls._connects << " resumed=" << tls._resumed
+                           << " last_ms=" << tls._last_ms << " total_ms=" << tls._total_ms;
+            }
+            if (_journal) {
+                EventJournalStats journal = _journal->getStats();
+                LOG(DEBUG) << "Journal: records=" << journal._records << " used=" << journal._used
+                           << " last=" << journal._last_seq << " acked=" << journal._acked_seq
+                           << " dropped=" << journal._dropped << " compacted=" << journal._compacted
+                           << " syncs=" << journal._syncs;
+            }
+        }
+        timer->restart(); ///< перезапустить таймер до очередного опроса доступности сервера.
     });
+    *self = keepalive_timer;
+    _keepalive_timer = keepalive_timer;
 
     /// Отправить команду добавления в комнату.
-    std::stringstream ss;
-    ss << R"({"H":"PlantHub","A":{"group":"Plant_)" << _cooler_id << R"("},"M":"addToGroup"})";
-    LOG(DEBUG) << ss.str();
-    _client->send(ss.str());
+    JsonWriter writer(_payload_format);
+    writer.reserve(JSON_WRITER_HEAD_SIZE);
+    writer.beginObject()
+        .key("H").value("PlantHub")
+        .key("A").beginObject()
+            .key("group").value("Plant_" + _cooler_id)
+        .endObject()
+        .key("M").value("addToGroup")
+        .endObject();
+    send(writer);
+    /// Досылка событий, не подтверждённых до обрыва связи или перезапуска.
+    replayEvents();
+    if (_client) {
+        _client->flush();
+    }
 }
 
 
@@ -53,6 +118,13 @@ void WsClientWorker::onMessage(ConnectionHdl hdl_, PMessage msg_) {
         if (_json_extractor) {
             _json_extractor->onMessage(msg_->get_payload());
         }
+    } else if (msg_->get_opcode() == websocketpp::frame::opcode::binary) {
+        /// Двоичный кадр - целая посылка CBOR.
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_command_handler) {
+            const std::string &payload = msg_->get_payload();
+            _command_handler->handleCbor(reinterpret_cast<const uint8_t*>(payload.data()), payload.size());
+        }
     } else {
         LOG(WARNING) << "Msg is not string";
         //websocketpp::utility::to_hex(msg->get_payload());
@@ -60,18 +132,18 @@ void WsClientWorker::onMessage(ConnectionHdl hdl_, PMessage msg_) {
 }
 
 
-void WsClientWorker::onJson(const std::string &json_) {
+void WsClientWorker::onJson(const JsonView &json_) {
     if (_command_handler) {
-        _command_handler->handle(json_);
+        _command_handler->handle(json_._data, json_._size);
     }
 }
 
 
 void WsClientWorker::onError(Client *client_, ConnectionHdl hdl_) {
     LOG(DEBUG);
+    setOffline();
     /// Сбросить keepalive таймер.
     _keepalive_timer.reset();
-    /// Остановить работу приложения.
     PConnection con = client_->get_con_from_hdl(hdl_);
     std::string server = con->get_response_header("Server");
     std::string error_reason = con->get_ec().message();
@@ -80,41 +152,81 @@ void WsClientWorker::onError(Client *client_, ConnectionHdl hdl_) {
     if (_json_extractor) {
         _json_extractor->clear();
     }
-    /// Остановить обслуживающие модули.
-    _gpio_controller.reset();
-    _rfid_controller.reset();
-    /// Остановить остановить диспетчер системных сигналов.
-    _signal_dispatcher.reset();
-    _return_value = 3;
-    /// Остановить клмент.
-    stop();
+    /// Контроллеры RFID и дверей продолжают работу, события копятся в журнале до переподключения.
+    reconnect();
 }
 
 
 void WsClientWorker::onClose(Client *client_, ConnectionHdl hdl_) {
     LOG(DEBUG);
+    setOffline();
     /// Сбросить keepalive таймер.
     _keepalive_timer.reset();
-    /// Остановить работу приложения.
     PConnection con = client_->get_con_from_hdl(hdl_);
     std::string server = con->get_response_header("Server");
-    std::string error_reason = con->get_ec().message();
     LOG(INFO) << "SERVER \"" << server << "\": Is closed connection.";
     _is_connect_error = true;
     if (_json_extractor) {
         _json_extractor->clear();
     }
-    /// Остановить обслуживающие модули.
-    _gpio_controller.reset();
-    _rfid_controller.reset();
-    /// Остановить остановить диспетчер системных сигналов.
-    _signal_dispatcher.reset();
-    /// Остановить клмент.
-    stop();
+    reconnect();
+}
+
+
+void WsClientWorker::replayEvents() {
+    std::lock_guard<std::mutex> lock(_event_mutex);
+    if (_journal) {
+        EPayloadFormat format = _payload_format;
+        size_t count = _journal->replay([this, format](uint64_t seq_, const std::string &message_,
+                                                       EPayloadFormat format_, const char *key_) {
+            ESendLane lane = key_ ? ESendLane::STATE : ESendLane::PRODUCT;
+            if (format_ == format) {
+                _send_queue->push(message_, format, lane, key_, seq_);
+                return;
+            }
+            /// Кодирование сменилось между подключениями. EPC из JSON остаются в CBOR текстовыми строками.
+            Json js;
+            if (format_ == EPayloadFormat::CBOR) {
+                CborReader reader(reinterpret_cast<const uint8_t*>(message_.data()), message_.size());
+                if (not reader.read(js)) {
+                    LOG(ERROR) << "Journal record " << seq_ << " is broken: " << reader.what();
+                    return;
+                }
+            } else {
+                try {
+                    js = Json::parse(message_);
+                } catch (const std::exception &e) {
+                    LOG(ERROR) << "Journal record " << seq_ << " is broken: " << e.what();
+                    return;
+                }
+            }
+            JsonWriter writer(format);
+            writer.value(js);
+            _send_queue->push(writer.str(), format, lane, key_, seq_);
+        });
+        LOG(INFO) << "Journal replay: " << count << " records.";
+    }
+    _is_online = true;
+}
+
+
+void WsClientWorker::setOffline() {
+    std::lock_guard<std::mutex> lock(_event_mutex);
+    _is_online = false;
 }
 
 
 void WsClientWorker::reconnect() {
+    if (_is_stopped or not _client) {
+        return;
+    }
+    uint32_t shift = std::min<uint32_t>(_attemp_connetion_count, 16);
+    size_t delay = std::min<size_t>(static_cast<size_t>(RECONNECT_TIMEOUT) << shift, RECONNECT_TIMEOUT_MAX);
+    /// Половина задержки случайна: холодильники после общего сбоя сети подключаются не одновременно.
+    delay = delay / 2 + _rand() % (delay / 2 + 1);
+    ++_attemp_connetion_count;
+    LOG(INFO) << "Reconnect attempt " << _attemp_connetion_count << " in " << delay << " ms.";
+    _client->reconnect(_ws_request, delay);
 }
 
 
@@ -128,12 +240,13 @@ void WsClientWorker::init() {
     LOG(DEBUG) << "\n------------------------------------------------"
                << "\n" << _ws_request
                << "\n------------------------------------------------";
-    _client = std::make_shared<WsClient>(this);
+    _client = std::make_shared<WsClient>(this, _send_queue);
 }
 
 
 void WsClientWorker::stop() {
     LOG(DEBUG);
+    _is_stopped = true;
     if (_client) {
         _client.reset();
     }
@@ -147,13 +260,29 @@ WsClientWorker::WsClientWorker(const std::string &usb_device_,
                                size_t reread_timeout_,
                                size_t close_read_num_,
                                size_t attempt_read_num_,
-                               bool is_gpio_on_)
+                               bool is_gpio_on_,
+                               const std::string &journal_path_)
     : _attemp_connetion_count(0)
     , _cooler_id(cooler_id_)
     , _addr(addr_)
     , _return_value(0)
-    , _is_connect_error(false) {
+    , _send_queue(std::make_shared<SendQueue>())
+    , _payload_format(EPayloadFormat::JSON)
+    , _event_seq(0)
+    , _is_online(false)
+    , _is_connect_error(false)
+    , _is_stopped(false)
+    , _rand(std::random_device()()) {
     LOG(DEBUG);
+    if (not journal_path_.empty()) {
+        _journal = std::make_shared<EventJournal>(journal_path_);
+        if (_journal->isOpened()) {
+            _event_seq = _journal->getLastSeq();
+        } else {
+            LOG(ERROR) << "Events journal is disabled.";
+            _journal.reset();
+        }
+    }
     _gpio_controller = std::make_shared<GpioController>(this, is_gpio_on_);
     _rfid_controller = std::make_shared<RfidController>(this, usb_device_, reread_timeout_, close_read_num_, attempt_read_num_);
 }
@@ -161,12 +290,52 @@ WsClientWorker::WsClientWorker(const std::string &usb_device_,
 
 WsClientWorker::~WsClientWorker() {
     LOG(DEBUG);
+    /// Остановить исполнитель команд до разрушения контроллеров, с которыми он работает.
+    _command_handler.reset();
 }
 
 
-void WsClientWorker::send(const std::string &json_str_) {
+void WsClientWorker::send(const JsonWriter &writer_, ESendLane lane_, const char *coalesce_key_) {
     LOG(DEBUG);
-    _client->send(json_str_);
+    _send_queue->push(writer_.str(), writer_.getFormat(), lane_, coalesce_key_);
+    if (_client) {
+        _client->flush();
+    }
+}
+
+
+void WsClientWorker::sendEvent(JsonWriter &writer_, const char *snapshot_key_) {
+    std::lock_guard<std::mutex> lock(_event_mutex);
+    uint64_t seq = ++_event_seq;
+    writer_.key("seq").value(seq)
+        .endObject()
+        .endObject();
+    bool is_online = true;
+    if (_journal) {
+        /// Без подключения событие только сохраняется, отправка - при досылке журнала.
+        _journal->append(seq, writer_.str(), writer_.getFormat(), snapshot_key_);
+        is_online = _is_online;
+    }
+    if (is_online) {
+        /// Номер события в очереди не даёт досылке журнала поставить его повторно.
+        _send_queue->push(writer_.str(), writer_.getFormat(),
+                          snapshot_key_ ? ESendLane::STATE : ESendLane::PRODUCT, snapshot_key_, seq);
+        if (_client) {
+            _client->flush();
+        }
+    }
+}
+
+
+void WsClientWorker::ackEvents(uint64_t seq_) {
+    if (_journal) {
+        _journal->ack(seq_);
+    }
+}
+
+
+SendQueueStats WsClientWorker::getSendQueueStats() {
+    return _send_queue->getStats();
 }
 
 
@@ -180,6 +349,11 @@ std::string WsClientWorker::getCoolerId() {
 }
 
 
+EPayloadFormat WsClientWorker::getPayloadFormat() {
+    return _payload_format;
+}
+
+
 GpioControllerBase* WsClientWorker::getGpioController() {
     return _gpio_controller.get();
 }
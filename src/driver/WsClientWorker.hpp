@@ -13,23 +13,27 @@
 #pragma once
 
 #include <mutex>
+#include <atomic>
 #include <string>
 #include <stack>
 #include <memory>
+#include <random>
 
 #include "Timer.hpp"
 #include "SignalDispatcher.hpp"
 #include "Bases.hpp"
+#include "JsonExtractor.hpp"
+#include "SendQueue.hpp"
+#include "EventJournal.hpp"
 #include "WsClient.hpp"
 
 
-#define KEEPALIVE_TIMER 3000
+#define KEEPALIVE_TIMER 3000 ///< Период keepalive: ping сервера и статистика [милисекунды].
 
 namespace robocooler {
 namespace driver {
 
 class LogSender;
-class JsonExtractor;
 class CommandHandler;
 class GpioController;
 class RfidController;
@@ -59,9 +63,15 @@ class WsClientWorker
     int _port;                ///< Порт серверного подключения.
     int _return_value;        ///< Переменная равна 0, если приложение завершилось штатно.
 
-    PTimer _keepalive_timer; ///< Таймер периодических опросов сервера.
+    PTimer _keepalive_timer; ///< Таймер периодических опросов сервера, сбрасывается только в потоке клиента.
     
     PJsonExtractor _json_extractor;       ///< Объект извлечения json из входного потока.
+    PSendQueue _send_queue;               ///< Очередь исходящих посылок, переживает переподключения.
+    std::atomic<EPayloadFormat> _payload_format; ///< Кодирование, согласованное при подключении.
+    PEventJournal _journal;               ///< Журнал событий до подтверждения сервером.
+    std::mutex _event_mutex;              ///< Порядок номеров событий совпадает с порядком записи в журнал.
+    uint64_t _event_seq;                  ///< Номер последнего события.
+    bool _is_online;                      ///< События отправляются сразу, иначе только сохраняются в журнал.
     PWsClient _client;                    ///< Объект websocket клиентского подключения.
     PLogSender _log_sender;               ///< Объект контролирующий отправку логов на сервер.
     PCommandHandler _command_handler;     ///< Обработчик серверных команд.
@@ -72,6 +82,8 @@ class WsClientWorker
     std::string _ws_request; ///< Строка с адресом подключения.
 
     bool _is_connect_error; ///< Флаг неудачного подключения.
+    std::atomic_bool _is_stopped; ///< Работа завершается, переподключение не выполняется.
+    std::minstd_rand _rand;       ///< Случайная составляющая задержки переподключения.
 
     /**
      * \brief Метод инициализации подключения.
@@ -79,7 +91,8 @@ class WsClientWorker
     void init();
     
     /**
-     * \brief Метод выполняет переподключение при ошибке соединения.
+     * \brief Метод планирует переподключение при ошибке соединения с экспоненциально растущей задержкой
+     *        от RECONNECT_TIMEOUT до RECONNECT_TIMEOUT_MAX, половина которой случайна.
      */
     void reconnect();
 
@@ -91,7 +104,18 @@ class WsClientWorker
     /**
      * \brief Метод принимает выделенный из потока json.
      */
-    void onJson(const std::string &json_);
+    void onJson(const JsonView &json_);
+
+    /**
+     * \brief Метод ставит в очередь неподтверждённые события журнала и переводит отправку событий в прямой режим.
+     *        Посылки, сохранённые в другом кодировании, перекодируются в согласованное.
+     */
+    void replayEvents();
+
+    /**
+     * \brief Метод переводит отправку событий в режим сохранения в журнал до следующего подключения.
+     */
+    void setOffline();
     
 public:
     /**
@@ -103,6 +127,7 @@ public:
      * \param close_read_num_   Количество обходов антенн после закрытия дверей.
      * \param attempt_read_num_ Количество обходов антенна при открытых дверях.
      * \param is_gpio_on_       Флаг режима обслуживания GPIO.
+     * \param journal_path_     Файл журнала событий, пустая строка - без журнала.
      */
     explicit WsClientWorker(const std::string &usb_device_,
                             const std::string &cooler_id_,
@@ -110,7 +135,8 @@ public:
                             size_t reread_timeout_,
                             size_t close_read_num_,
                             size_t attempt_read_num_,
-                            bool is_gpio_on_);
+                            bool is_gpio_on_,
+                            const std::string &journal_path_ = "");
     virtual ~WsClientWorker();
 
     /**
@@ -119,9 +145,26 @@ public:
     int getReturnValue();
 
     /**
-     * \brief Метод отправляет строку JSIN по websocket.
+     * \brief Метод ставит посылку в очередь отправки и планирует её выгрузку в потоке клиента.
+     */
+    virtual void send(const JsonWriter &writer_,
+                      ESendLane lane_ = ESendLane::PRODUCT,
+                      const char *coalesce_key_ = nullptr);
+
+    /**
+     * \brief Метод нумерует событие, сохраняет его в журнал и, при наличии подключения, ставит в очередь отправки.
      */
-    virtual void send(const std::string &json_str_);
+    virtual void sendEvent(JsonWriter &writer_, const char *snapshot_key_ = nullptr);
+
+    /**
+     * \brief Метод освобождает в журнале подтверждённые сервером события.
+     */
+    virtual void ackEvents(uint64_t seq_);
+
+    /**
+     * \brief Метод возвращает счётчики очереди отправки.
+     */
+    SendQueueStats getSendQueueStats();
 
     /**
      * \brief Метод вызывается при успешном подключении по websocket.
@@ -152,6 +195,11 @@ public:
      */
     virtual std::string getCoolerId();
 
+    /**
+     * \brief Метод возвращает кодирование посылок: CBOR, если сервер выбрал подпротокол WS_SUBPROTOCOL_CBOR.
+     */
+    virtual EPayloadFormat getPayloadFormat();
+
     /**
      * \brief Метод возвращает указатель на контроллер дверей.
      */
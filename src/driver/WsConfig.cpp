@@ -0,0 +1,44 @@
+#include <atomic>
+
+#include "WsConfig.hpp"
+
+
+using namespace robocooler;
+using namespace driver;
+
+
+namespace {
+std::atomic<uint64_t> _messages(0);
+std::atomic<uint64_t> _raw_bytes(0);
+std::atomic<uint64_t> _packed_bytes(0);
+std::atomic<uint64_t> _deflate_ns(0);
+std::atomic<uint64_t> _inflated_bytes(0);
+std::atomic<uint64_t> _inflate_ns(0);
+} /// namespace
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+DeflateStats driver::getDeflateStats() {
+    DeflateStats stats;
+    stats._messages = _messages;
+    stats._raw_bytes = _raw_bytes;
+    stats._packed_bytes = _packed_bytes;
+    stats._deflate_ns = _deflate_ns;
+    stats._inflated_bytes = _inflated_bytes;
+    stats._inflate_ns = _inflate_ns;
+    return stats;
+}
+
+
+void driver::countDeflate(size_t raw_, size_t packed_, uint64_t ns_) {
+    ++_messages;
+    _raw_bytes += raw_;
+    _packed_bytes += packed_;
+    _deflate_ns += ns_;
+}
+
+
+void driver::countInflate(size_t raw_, uint64_t ns_) {
+    _inflated_bytes += raw_;
+    _inflate_ns += ns_;
+}
@@ -0,0 +1,128 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Конфигурация websocketpp клиента драйвера со сжатием permessage-deflate.
+ * \author Величко Ростислав
+ * \date   07.24.2017
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <utility>
+
+#include "websocketpp/config/asio_client.hpp"
+#include "websocketpp/extensions/permessage_deflate/enabled.hpp"
+
+
+/// Размер окна LZ77 в степенях двойки (9..15). Окно 2^11 и memLevel 4 - около 16 Кб на сжатие вместо 136 Кб.
+/// zlib не поддерживает для raw deflate окно 2^8, поэтому нижняя граница 9.
+#define WS_DEFLATE_WINDOW_BITS 11
+
+
+namespace robocooler {
+namespace driver {
+
+/**
+ * \brief Накопленная статистика сжатия всех соединений процесса.
+ */
+struct DeflateStats {
+    uint64_t _messages;       ///< Сжато исходящих посылок.
+    uint64_t _raw_bytes;      ///< Объём исходящих посылок до сжатия [байт].
+    uint64_t _packed_bytes;   ///< Объём исходящих посылок после сжатия [байт].
+    uint64_t _deflate_ns;     ///< Время сжатия [наносекунды].
+    uint64_t _inflated_bytes; ///< Объём входящих данных после распаковки [байт].
+    uint64_t _inflate_ns;     ///< Время распаковки [наносекунды].
+};
+
+
+/**
+ * \brief Функция возвращает снимок счётчиков сжатия. Может вызываться из любого потока.
+ */
+DeflateStats getDeflateStats();
+
+void countDeflate(size_t raw_, size_t packed_, uint64_t ns_);
+void countInflate(size_t raw_, uint64_t ns_);
+
+
+/**
+ * \brief Расширение permessage-deflate с окном WS_DEFLATE_WINDOW_BITS и учётом затрат на сжатие.
+ *        Контекст сжатия сохраняется между посылками: повторяющиеся имена полей и префиксы EPC
+ *        кодируются ссылками на предыдущие посылки. Сервер может отказаться от сохранения контекста
+ *        ответом client_no_context_takeover.
+ *        Методы базового класса не виртуальные - процессор hybi13 вызывает их по типу из конфигурации.
+ */
+template <typename config>
+class DeflateExtension : public websocketpp::extensions::permessage_deflate::enabled<config> {
+    typedef websocketpp::extensions::permessage_deflate::enabled<config> Base;
+    typedef std::chrono::steady_clock Clock;
+
+    static uint64_t since(const Clock::time_point &start_) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_).count());
+    }
+
+public:
+    typedef websocketpp::lib::error_code ErrorCode;
+    typedef std::pair<ErrorCode, std::string> ErrStrPair;
+
+    DeflateExtension() {
+        namespace md = websocketpp::extensions::permessage_deflate::mode;
+        /// Собственное окно не больше предложенного, даже если сервер разрешит большее.
+        Base::set_client_max_window_bits(WS_DEFLATE_WINDOW_BITS, md::largest);
+    }
+
+    /**
+     * \brief Предложение серверу: ограничить окна сжатия в обе стороны, контекст сохранять.
+     */
+    std::string generate_offer() const {
+        return "permessage-deflate; client_max_window_bits=" + std::to_string(WS_DEFLATE_WINDOW_BITS) +
+               "; server_max_window_bits=" + std::to_string(WS_DEFLATE_WINDOW_BITS);
+    }
+
+    /**
+     * \brief Разбор ответа сервера. Сервер, не подтвердивший server_max_window_bits, сжимает окном 2^15,
+     *        и распаковка должна его принять.
+     */
+    ErrStrPair negotiate(const websocketpp::http::attribute_list &offer_) {
+        namespace md = websocketpp::extensions::permessage_deflate::mode;
+        Base::set_server_max_window_bits(websocketpp::extensions::permessage_deflate::default_server_max_window_bits,
+                                         md::accept);
+        return Base::negotiate(offer_);
+    }
+
+    ErrorCode compress(const std::string &in_, std::string &out_) {
+        Clock::time_point start = Clock::now();
+        size_t size = out_.size();
+        ErrorCode ec = Base::compress(in_, out_);
+        if (not ec) {
+            /// Завершающие 00 00 ff ff процессор отрезает перед отправкой.
+            size_t packed = out_.size() - size;
+            countDeflate(in_.size(), packed > 4 ? packed - 4 : packed, since(start));
+        }
+        return ec;
+    }
+
+    ErrorCode decompress(const uint8_t *buf_, size_t len_, std::string &out_) {
+        Clock::time_point start = Clock::now();
+        size_t size = out_.size();
+        ErrorCode ec = Base::decompress(buf_, len_, out_);
+        if (not ec) {
+            countInflate(out_.size() - size, since(start));
+        }
+        return ec;
+    }
+};
+
+
+/**
+ * \brief Конфигурация клиента: TLS поверх asio и согласуемое сжатие.
+ */
+struct WsClientConfig : public websocketpp::config::asio_tls_client {
+    typedef WsClientConfig type;
+    typedef websocketpp::config::asio_tls_client base;
+
+    typedef DeflateExtension<base::permessage_deflate_config> permessage_deflate_type;
+};
+} /// driver
+} /// robocooler
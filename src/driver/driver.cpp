@@ -30,6 +30,7 @@
 #define DEFAULT_PORT "443"
 #define DEFAULT_PATH "plant"
 #define DEFAULT_USB_DEVICE "/dev/ttyUSB0"
+#define DEFAULT_JOURNAL_PATH ""
 
 namespace bfs = boost::filesystem;
 namespace bpo = boost::program_options;
@@ -47,6 +48,7 @@ int main(int argc, char **argv) {
         std::string url;
         std::string port;
         std::string path;
+        std::string journal_path;
         bool is_device_off_mode;
         bool is_gpio_off_mode;
         size_t reread_timeout;
@@ -63,6 +65,9 @@ int main(int argc, char **argv) {
             ("port,p", bpo::value<std::string>(&port)->default_value(DEFAULT_PORT), "Указать порт сервера.")
             ("path,d", bpo::value<std::string>(&path)->default_value(DEFAULT_PATH), "Указать патч API сервера.")
             ("cooler_id,i", bpo::value<std::string>(&cooler_id)->default_value("1"), "Указать идентификатор холодильника.")
+            ("journal,j", bpo::value<std::string>(&journal_path)->default_value(DEFAULT_JOURNAL_PATH),
+             "Файл журнала неподтверждённых событий. Только для сервера, подтверждающего события командой "
+             "ackEvents; без журнала события не досылаются после обрыва связи.")
             ("reread_timeout,s", bpo::value<size_t>(&reread_timeout)->default_value(UPDATE_RECV_DATA_TIMEOUT),
                                  "Таймаут перезапуска опроса антенн [миллисекунты].")
             ("close_read_num,k", bpo::value<size_t>(&close_read_num)->default_value(BUFFER_READING_NUM_ATTEMPT),
@@ -85,7 +90,7 @@ int main(int argc, char **argv) {
         LOG(TRACE) << "PlantHub_" << cooler_id << ": " << url;
         PWsClientWorker ws_worker = std::make_shared<WsClientWorker>(usb_device, cooler_id, url,
                                                                      reread_timeout, close_read_num, attempt_read_num,
-                                                                     (not is_gpio_off_mode));
+                                                                     (not is_gpio_off_mode), journal_path);
         ws_worker->startClient();
         ret = ws_worker->getReturnValue();
     } catch (std::exception &e) {
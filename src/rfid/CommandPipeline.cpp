@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <utility>
+
+#include "Log.hpp"
+#include "TtyIo.hpp"
+#include "CommandPipeline.hpp"
+
+
+using namespace robocooler;
+using namespace rfid;
+
+typedef CommandPipeline::Clock Clock;
+typedef CommandPipeline::Cid Cid;
+
+
+void CommandPipeline::pump() {
+    while (not _queue.empty() and _in_flight.size() < _depth) {
+        Request &req = _queue.front();
+        auto iter = std::find_if(_in_flight.begin(), _in_flight.end(), [&req](const Request &r_) {
+            return r_._cid == req._cid;
+        });
+        if (iter not_eq _in_flight.end()) {
+            /// Ответы на одинаковые команды неразличимы: ждать ответа на предыдущую.
+            break;
+        }
+        if (req._send) {
+            req._send(_cmd);
+        }
+        _in_flight.push_back(std::move(req));
+        _queue.pop_front();
+    }
+}
+
+
+void CommandPipeline::takeExpired(const Clock::time_point &now_, Requests &out_) {
+    for (Requests *reqs : {&_in_flight, &_queue}) {
+        for (auto iter = reqs->begin(); iter not_eq reqs->end();) {
+            if (iter->_deadline <= now_) {
+                out_.push_back(std::move(*iter));
+                iter = reqs->erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
+}
+
+
+void CommandPipeline::finish(Request &req_, bool is_done_) {
+    if (not is_done_) {
+        LOG(WARNING) << "\"" << Command::cmdToString(req_._cid) << "\" is lock.";
+    }
+    req_._promise.set_value(is_done_);
+    if (req_._on_result) {
+        req_._on_result(req_._cid, is_done_);
+    }
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+CommandPipeline::CommandPipeline(Command *cmd_, const WakeFunc &wake_, size_t depth_)
+    : _cmd(cmd_)
+    , _wake(wake_)
+    , _depth(std::max<size_t>(depth_, 1))
+{}
+
+
+CommandPipeline::~CommandPipeline() {
+    cancel();
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+CommandPipeline::Future CommandPipeline::post(Cid cid_, const SendFunc &send_, size_t timeout_ms_, const OnResultFunc &on_result_) {
+    Request req;
+    req._cid = cid_;
+    req._send = send_;
+    req._on_result = on_result_;
+    req._deadline = Clock::now() + std::chrono::milliseconds(timeout_ms_);
+    Future future = req._promise.get_future();
+    bool is_earliest = false;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        is_earliest = (req._deadline < nextDeadlineLocked());
+        _queue.push_back(std::move(req));
+        pump();
+    }
+    /// Поток приёма ждёт данные до ближайшего срока: сообщить о более раннем.
+    if (is_earliest and _wake) {
+        _wake();
+    }
+    return future;
+}
+
+
+bool CommandPipeline::complete(Cid cid_) {
+    Requests done;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        auto iter = std::find_if(_in_flight.begin(), _in_flight.end(), [cid_](const Request &r_) {
+            return r_._cid == cid_;
+        });
+        if (iter == _in_flight.end()) {
+            return false;
+        }
+        done.push_back(std::move(*iter));
+        _in_flight.erase(iter);
+        pump();
+    }
+    finish(done.front(), true);
+    return true;
+}
+
+
+size_t CommandPipeline::expire() {
+    Requests expired;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        takeExpired(Clock::now(), expired);
+        if (not expired.empty()) {
+            pump();
+        }
+    }
+    for (Request &req : expired) {
+        finish(req, false);
+    }
+    return expired.size();
+}
+
+
+void CommandPipeline::cancel() {
+    Requests canceled;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        takeExpired(Clock::time_point::max(), canceled);
+    }
+    for (Request &req : canceled) {
+        req._promise.set_value(false);
+        if (req._on_result) {
+            req._on_result(req._cid, false);
+        }
+    }
+}
+
+
+bool CommandPipeline::wait(Future &future_) {
+    while (true) {
+        Clock::time_point deadline = nextDeadline();
+        if (deadline == Clock::time_point::max()) {
+            /// Запрос уже завершён: результат выставлен до удаления из очередей.
+            future_.wait();
+            break;
+        }
+        if (future_.wait_until(deadline) == std::future_status::ready) {
+            break;
+        }
+        expire();
+    }
+    return future_.get();
+}
+
+
+Clock::time_point CommandPipeline::nextDeadline() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return nextDeadlineLocked();
+}
+
+
+Clock::time_point CommandPipeline::nextDeadlineLocked() const {
+    Clock::time_point res = Clock::time_point::max();
+    for (const Requests *reqs : {&_in_flight, &_queue}) {
+        for (const Request &req : *reqs) {
+            res = std::min(res, req._deadline);
+        }
+    }
+    return res;
+}
+
+
+int CommandPipeline::nextTimeout() {
+    Clock::time_point deadline = nextDeadline();
+    if (deadline == Clock::time_point::max()) {
+        return NO_DATA_TIMEOUT;
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+    /// Округлить вверх, чтобы не проснуться раньше срока.
+    return static_cast<int>(std::max<decltype(ms)>(ms + 1, 0));
+}
+
+
+size_t CommandPipeline::queued() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _queue.size();
+}
+
+
+size_t CommandPipeline::inFlight() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _in_flight.size();
+}
@@ -0,0 +1,134 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Конвейер команд RFID: очередь отправки, сопоставление ответов по идентификатору команды и сроки ожидания.
+ * \author Величко Ростислав
+ * \date   07.17.2017
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <future>
+#include <chrono>
+#include <functional>
+
+#include "Commands.hpp"
+
+
+static const size_t RFID_PIPELINE_DEPTH = 4; ///< Максимальное количество команд, отправленных без ответа.
+
+
+namespace robocooler {
+namespace rfid {
+
+
+/**
+ * \brief Очередь запросов к считывателю.
+ *        Запросы отправляются подряд, не дожидаясь ответов, пока не встретится команда с тем же
+ *        идентификатором, что уже ожидает ответа: протокол не нумерует пакеты, и ответы различимы
+ *        только по команде. Порядок отправки совпадает с порядком постановки в очередь.
+ *        Сроки ожидания проверяются вызовами expire() и wait(), отдельные потоки таймеров не создаются.
+ */
+class CommandPipeline {
+public:
+    typedef std::chrono::steady_clock Clock;
+    typedef Command::ECommandId Cid;
+    typedef std::function<void(Command*)> SendFunc;        ///< Отправка пакета запроса.
+    typedef std::function<void(Cid, bool)> OnResultFunc;   ///< Результат: команда и признак получения ответа.
+    typedef std::function<void()> WakeFunc;                ///< Пробуждение потока приёма для пересчёта срока.
+    typedef std::future<bool> Future;
+
+private:
+    struct Request {
+        Cid _cid;                     ///< Команда, ответ на которую завершает запрос.
+        SendFunc _send;               ///< Отправка пакета запроса.
+        OnResultFunc _on_result;      ///< Необязательный обработчик результата.
+        Clock::time_point _deadline;  ///< Срок получения ответа.
+        std::promise<bool> _promise;  ///< true - ответ получен, false - срок истёк или запрос отменён.
+    };
+    typedef std::deque<Request> Requests;
+
+    std::mutex _mutex;
+    Command *_cmd;         ///< Формирователь пакетов команд.
+    WakeFunc _wake;        ///< Пробуждение потока приёма.
+    size_t _depth;         ///< Максимальное количество запросов в ожидании ответа.
+    Requests _queue;       ///< Запросы, ожидающие отправки.
+    Requests _in_flight;   ///< Отправленные запросы, ожидающие ответа.
+
+    /**
+     * \brief Метод отправляет запросы из начала очереди, пока это допустимо. Вызывается под _mutex.
+     */
+    void pump();
+
+    /**
+     * \brief Метод извлекает запросы со сроком не позже now_ из очереди и из ожидающих ответа.
+     */
+    void takeExpired(const Clock::time_point &now_, Requests &out_);
+
+    /**
+     * \brief Метод возвращает ближайший срок. Вызывается под _mutex.
+     */
+    Clock::time_point nextDeadlineLocked() const;
+
+    /**
+     * \brief Метод завершает запрос вне _mutex: выставляет результат и вызывает обработчик.
+     */
+    static void finish(Request &req_, bool is_done_);
+
+public:
+    /**
+     * \param cmd_    Формирователь пакетов команд.
+     * \param wake_   Функтор пробуждения потока приёма при появлении более раннего срока.
+     * \param depth_  Максимальное количество запросов в ожидании ответа.
+     */
+    explicit CommandPipeline(Command *cmd_, const WakeFunc &wake_ = WakeFunc(), size_t depth_ = RFID_PIPELINE_DEPTH);
+    virtual ~CommandPipeline();
+
+    /**
+     * \brief Метод ставит запрос в очередь и отправляет его сразу, если это допустимо.
+     * \param cid_         Команда, ответ на которую завершает запрос.
+     * \param send_        Отправка пакета; пустой функтор - только ожидание ответа cid_.
+     * \param timeout_ms_  Срок получения ответа от момента постановки в очередь [мс].
+     * \param on_result_   Обработчик результата; вызывается в потоке приёма или в потоке, обнаружившем истечение срока.
+     * \return Результат запроса: true - ответ получен, false - срок истёк или запрос отменён.
+     */
+    Future post(Cid cid_, const SendFunc &send_, size_t timeout_ms_, const OnResultFunc &on_result_ = OnResultFunc());
+
+    /**
+     * \brief Метод завершает самый ранний отправленный запрос с командой cid_ и отправляет следующие.
+     * \return false, если запроса с такой командой нет.
+     */
+    bool complete(Cid cid_);
+
+    /**
+     * \brief Метод завершает все запросы с истёкшим сроком.
+     * \return Количество завершённых запросов.
+     */
+    size_t expire();
+
+    /**
+     * \brief Метод отменяет все запросы.
+     */
+    void cancel();
+
+    /**
+     * \brief Метод ожидает результат запроса, завершая просроченные запросы без отдельного таймера.
+     */
+    bool wait(Future &future_);
+
+    /**
+     * \brief Метод возвращает ближайший срок среди всех запросов или Clock::time_point::max().
+     */
+    Clock::time_point nextDeadline();
+
+    /**
+     * \brief Метод возвращает время до ближайшего срока [мс] для poll или NO_DATA_TIMEOUT, если запросов нет.
+     */
+    int nextTimeout();
+
+    size_t queued();
+    size_t inFlight();
+};
+} /// rfid
+} /// robocooler
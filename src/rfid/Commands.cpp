@@ -15,6 +15,20 @@ typedef Message::Buffer Buffer;
 typedef CommandsHandler CmdHdl;
 
 
+void Command::initShortFrames() {
+    /// Пакеты без параметров отличаются только кодом команды: собрать их один раз для текущего адреса.
+    for (size_t c = 0; c < RFID_SHORT_FRAMES_NUM; ++c) {
+        Message::encode(_short_frames[c], _rfid_addr, static_cast<uint8_t>(c));
+    }
+}
+
+
+void Command::sendShort(Cid cid_) {
+    _hdl->sendFrame(_short_frames[static_cast<uint8_t>(cid_)], RFID_PACK_MINLEN);
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
 std::string Command::cmdToString(Cid cmd_code_) {
     switch (cmd_code_) {
         /// Reader control commands.
@@ -124,8 +138,11 @@ void Command::initErrorCodes() {
 
 
 Command::Command(CommandsHandler *hdl_)
-    : _hdl(hdl_) {
+    : _rfid_addr(RFID_ADDR)
+    , _hdl(hdl_)
+    , _buffer_frames(0) {
     initErrorCodes();
+    initShortFrames();
 }
 
 
@@ -133,27 +150,30 @@ Command::~Command()
 {}
 
 
-Cid Command::receive(const Message &msg_) {
-    //LOG(DEBUG) << "msg: " << CmdHdl::toString(msg_.getAryTranData());
-    Cid cid = static_cast<Cid>(msg_.getCmd());
+Cid Command::receive(const FrameView &frame_) {
+    //LOG(DEBUG) << "msg: " << CmdHdl::toString(frame_.getFrame(), frame_.getSize());
+    Cid cid = static_cast<Cid>(frame_.getCmd());
     switch (cid) {
-        case Cid::cmd_reset: onReset(msg_); break;
-        case Cid::cmd_set_uart_baudrate: onSetUartBaudrate(msg_); break;
-        case Cid::cmd_get_firmware_version: onGetFirmwareVersion(msg_); break;
-        case Cid::cmd_set_work_antenna: onSetWorkAntenna(msg_); break;
-        case Cid::cmd_get_work_antenna: onGetWorkAntenna(msg_); break;
-        case Cid::cmd_set_output_power: onSetOutputPower(msg_); break;
-        case Cid::cmd_get_output_power: onGetOutputPower(msg_); break;
-        case Cid::cmd_set_frequency_region: onSetFrequencyRegion(msg_); break;
-        case Cid::cmd_get_frequency_region: onGetFrequencyRegion(msg_); break;
-        case Cid::cmd_inventory: onInventory(msg_); break;
-        case Cid::cmd_read: onRead(msg_); break;
-        case Cid::cmd_get_inventory_buffer: onGetInventoryBuffer(msg_); break;
-        case Cid::cmd_get_and_reset_inventory_buffer: onGetAndResetInventoryBuffer(msg_); break;
-        case Cid::cmd_get_inventory_buffer_tag_count: onGetInventoryBufferTagCount(msg_); break;
-        case Cid::cmd_reset_inventory_buffer: onResetInventoryBuffer(msg_); break;
+        case Cid::cmd_reset: onReset(frame_); break;
+        case Cid::cmd_set_uart_baudrate: onSetUartBaudrate(frame_); break;
+        case Cid::cmd_get_firmware_version: onGetFirmwareVersion(frame_); break;
+        case Cid::cmd_set_work_antenna: onSetWorkAntenna(frame_); break;
+        case Cid::cmd_get_work_antenna: onGetWorkAntenna(frame_); break;
+        case Cid::cmd_set_output_power: onSetOutputPower(frame_); break;
+        case Cid::cmd_get_output_power: onGetOutputPower(frame_); break;
+        case Cid::cmd_set_frequency_region: onSetFrequencyRegion(frame_); break;
+        case Cid::cmd_get_frequency_region: onGetFrequencyRegion(frame_); break;
+        case Cid::cmd_inventory: onInventory(frame_); break;
+        case Cid::cmd_read: onRead(frame_); break;
+        case Cid::cmd_real_time_inventory: cid = onRealTimeInventory(frame_); break;
+        case Cid::cmd_fast_switch_ant_inventory: cid = onFastSwitchAntInventory(frame_); break;
+        case Cid::cmd_customized_session_target_inventory: cid = onCustomizedSessionTargetInventory(frame_); break;
+        case Cid::cmd_get_inventory_buffer: cid = onGetInventoryBuffer(frame_); break;
+        case Cid::cmd_get_and_reset_inventory_buffer: cid = onGetAndResetInventoryBuffer(frame_); break;
+        case Cid::cmd_get_inventory_buffer_tag_count: onGetInventoryBufferTagCount(frame_); break;
+        case Cid::cmd_reset_inventory_buffer: onResetInventoryBuffer(frame_); break;
         default:
-            LOG(WARNING) << "Undeclared recv command: " << CmdHdl::toString(msg_.getCmd());
+            LOG(WARNING) << "Undeclared recv command: " << CmdHdl::toString(frame_.getCmd());
             cid = Cid::cmd_none;
             break;
     }
@@ -172,6 +192,7 @@ std::string Command::getError(Ec err_code_) {
 
 void Command::setRfidAddres(uint8_t addr_) {
     _rfid_addr = addr_;
+    initShortFrames();
 }
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -179,14 +200,13 @@ void Command::setRfidAddres(uint8_t addr_) {
 void Command::reset() {
     LOG(DEBUG) << "addr: " << CmdHdl::toString(_rfid_addr);
     Cid cid = Cid::cmd_reset;
-    Message msg(_rfid_addr, static_cast<uint8_t>(cid));
-    _hdl->sendMessage(msg);
+    sendShort(cid);
 }
 
 
-void Command::onReset(const Message &msg_) {
-    //LOG(DEBUG) << "msg: " << CmdHdl::toString(msg_.getAryTranData());
-    Ec err_code = static_cast<Ec>(msg_.getErrorCode());
+void Command::onReset(const FrameView &frame_) {
+    //LOG(DEBUG) << "msg: " << CmdHdl::toString(frame_.getFrame(), frame_.getSize());
+    Ec err_code = static_cast<Ec>(frame_.getErrorCode());
     LOG(ERROR) << getError(err_code);
     _hdl->onError(getError(err_code));
 }
@@ -195,14 +215,14 @@ void Command::onReset(const Message &msg_) {
 void Command::setUartBaudrate(EBaudrate bdr_) {
     LOG(DEBUG) << "addr: " << CmdHdl::toString(_rfid_addr) << "uart_baudrate: " << CmdHdl::toString(static_cast<uint8_t>(bdr_));
     Cid cid = Cid::cmd_set_uart_baudrate;
-    Buffer data(1, static_cast<uint8_t>(bdr_));
-    Message msg(_rfid_addr, static_cast<uint8_t>(cid), data);
+    uint8_t data[] = { static_cast<uint8_t>(bdr_) };
+    Message msg(_rfid_addr, static_cast<uint8_t>(cid), data, sizeof(data));
     _hdl->sendMessage(msg);
 }
 
 
-void Command::onSetUartBaudrate(const Message &msg_) {
-    Ec err_code = static_cast<Ec>(msg_.getErrorCode());
+void Command::onSetUartBaudrate(const FrameView &frame_) {
+    Ec err_code = static_cast<Ec>(frame_.getErrorCode());
     if (err_code not_eq Ec::command_success) {
         LOG(ERROR) << getError(err_code);
         _hdl->onError(getError(err_code));
@@ -216,17 +236,16 @@ void Command::onSetUartBaudrate(const Message &msg_) {
 void Command::getFirmwareVersion() {
     LOG(DEBUG) << "addr: " << CmdHdl::toString(_rfid_addr);
     Cid cid = Cid::cmd_get_firmware_version;
-    Message msg(_rfid_addr, static_cast<uint8_t>(cid));
-    _hdl->sendMessage(msg);
+    sendShort(cid);
 }
 
 
-void Command::onGetFirmwareVersion(const Message &msg_) {
-    if (msg_.getDataLen() not_eq 5) { ///< Размер данных, передаваемый в поле пакета.
+void Command::onGetFirmwareVersion(const FrameView &frame_) {
+    if (frame_.getDataLen() not_eq 5) { ///< Размер данных, передаваемый в поле пакета.
         LOG(ERROR) << getError(Ec::command_fail);
         _hdl->onError(getError(Ec::command_fail));
     } else {
-        const Buffer &pack = msg_.getAryTranData();
+        const uint8_t *pack = frame_.getFrame();
         uint8_t major = pack[4];
         uint8_t minor = pack[5];
         //LOG(TRACE) << "Firmware vertion: " << static_cast<uint16_t>(major) << "." << static_cast<uint16_t>(minor);
@@ -240,15 +259,15 @@ void Command::setWorkAntenna(EWorkAntenna work_ant_) {
     LOG(DEBUG) << "addr: " << CmdHdl::toString(_rfid_addr) 
                << " Work ant: [" << CmdHdl::toString(static_cast<uint8_t>(work_ant_)) << "]";
     Cid cid = Cid::cmd_set_work_antenna;
-    Buffer data(1, static_cast<uint8_t>(work_ant_));
-    Message msg(_rfid_addr, static_cast<uint8_t>(cid), data);
+    uint8_t data[] = { static_cast<uint8_t>(work_ant_) };
+    Message msg(_rfid_addr, static_cast<uint8_t>(cid), data, sizeof(data));
     _hdl->sendMessage(msg);
 }
 
 
-void Command::onSetWorkAntenna(const Message &msg_) {
-    LOG(DEBUG) << "msg: " << CmdHdl::toString(msg_.getAryTranData());
-    Ec err_code = static_cast<Ec>(msg_.getErrorCode());
+void Command::onSetWorkAntenna(const FrameView &frame_) {
+    LOG(DEBUG) << "msg: " << CmdHdl::toString(frame_.getFrame(), frame_.getSize());
+    Ec err_code = static_cast<Ec>(frame_.getErrorCode());
     if (err_code not_eq Ec::command_success) {
         LOG(ERROR) << getError(err_code);
         _hdl->onError(getError(err_code));
@@ -262,17 +281,16 @@ void Command::onSetWorkAntenna(const Message &msg_) {
 void Command::getWorkAntenna() {
     LOG(DEBUG) << std::hex << "addr: " << CmdHdl::toString(_rfid_addr);
     Cid cid = Cid::cmd_get_work_antenna;
-    Message msg(_rfid_addr, static_cast<uint8_t>(cid));
-    _hdl->sendMessage(msg);
+    sendShort(cid);
 }
 
 
-void Command::onGetWorkAntenna(const Message &msg_) {
-    if (msg_.getDataLen() not_eq 4) { ///< Размер данных, передаваемый в поле пакета.
+void Command::onGetWorkAntenna(const FrameView &frame_) {
+    if (frame_.getDataLen() not_eq 4) { ///< Размер данных, передаваемый в поле пакета.
         LOG(ERROR) << getError(Ec::command_fail);
         _hdl->onError(getError(Ec::command_fail));
     } else {
-        const Buffer &pack = msg_.getAryTranData();
+        const uint8_t *pack = frame_.getFrame();
         uint8_t ant_id = pack[4];
         //LOG(TRACE) << "Antenna ID: " << CmdHdl::toString(ant_id + 1);
         /// Передать полученные данные подписавшемуся объекту.
@@ -284,20 +302,20 @@ void Command::onGetWorkAntenna(const Message &msg_) {
 void Command::setOutputPower(uint8_t ant_power_1_, uint8_t ant_power_2_, uint8_t ant_power_3_, uint8_t ant_power_4_) {
     LOG(DEBUG) << std::hex << "addr: " << CmdHdl::toString(_rfid_addr);
     Cid cid = Cid::cmd_set_output_power;
-    Buffer data({  
+    uint8_t data[] = {
         ((ant_power_1_ <= static_cast<uint8_t>(0x21)) ? ant_power_1_ : static_cast<uint8_t>(0x00)), 
         ((ant_power_2_ <= static_cast<uint8_t>(0x21)) ? ant_power_2_ : static_cast<uint8_t>(0x00)), 
         ((ant_power_3_ <= static_cast<uint8_t>(0x21)) ? ant_power_3_ : static_cast<uint8_t>(0x00)), 
         ((ant_power_4_ <= static_cast<uint8_t>(0x21)) ? ant_power_4_ : static_cast<uint8_t>(0x00))
-    });
-    Message msg(_rfid_addr, static_cast<uint8_t>(cid), data);
+    };
+    Message msg(_rfid_addr, static_cast<uint8_t>(cid), data, sizeof(data));
     _hdl->sendMessage(msg);
 }
 
 
-void Command::onSetOutputPower(const Message &msg_) {
-    LOG(DEBUG) << "msg: " << CmdHdl::toString(msg_.getAryTranData());
-    Ec err_code = static_cast<Ec>(msg_.getErrorCode());
+void Command::onSetOutputPower(const FrameView &frame_) {
+    LOG(DEBUG) << "msg: " << CmdHdl::toString(frame_.getFrame(), frame_.getSize());
+    Ec err_code = static_cast<Ec>(frame_.getErrorCode());
     if (err_code not_eq Ec::command_success) {
         LOG(ERROR) << getError(err_code);
         _hdl->onError(getError(err_code));
@@ -312,13 +330,12 @@ void Command::onSetOutputPower(const Message &msg_) {
 void Command::getOutputPower() {
     LOG(DEBUG) << std::hex << "addr: " << CmdHdl::toString(_rfid_addr);
     Cid cid = Cid::cmd_get_output_power;
-    Message msg(_rfid_addr, static_cast<uint8_t>(cid));
-    _hdl->sendMessage(msg);
+    sendShort(cid);
 }
 
 
-void Command::onGetOutputPower(const Message &msg_) {
-    if (msg_.getDataLen() not_eq 4) { ///< Размер данных, передаваемый в поле пакета.
+void Command::onGetOutputPower(const FrameView &frame_) {
+    if (frame_.getDataLen() not_eq 4) { ///< Размер данных, передаваемый в поле пакета.
         LOG(ERROR) << getError(Ec::command_fail);
         _hdl->onError(getError(Ec::command_fail));
     } else {
@@ -326,13 +343,13 @@ void Command::onGetOutputPower(const Message &msg_) {
         uint8_t ant_power_2 = 0;
         uint8_t ant_power_3 = 0;
         uint8_t ant_power_4 = 0;
-        const Buffer &data = msg_.getAryData();
-        if (msg_.getDataLen() == 4) {
+        const uint8_t *data = frame_.getData();
+        if (frame_.getDataLen() == 4) {
             ant_power_1 = data[0];
             ant_power_2 = data[0];
             ant_power_3 = data[0];
             ant_power_4 = data[0];
-        } else if (msg_.getDataLen() == 7) {
+        } else if (frame_.getDataLen() == 7) {
             ant_power_1 = data[0];
             ant_power_2 = data[1];
             ant_power_3 = data[2];
@@ -363,19 +380,19 @@ void Command::setFrequencyRegion(ESpektrumRegion region_, uint8_t start_freq_cod
     if (ESpektrumRegion::QUANTITY < region_) {
         region_ = ESpektrumRegion::ETSI;
     }
-    Buffer data({ 
-        static_cast<uint8_t>(region_), 
-        start_freq_code_, 
-        end_freq_code_ 
-    });
-    Message msg(_rfid_addr, static_cast<uint8_t>(cid), data);
+    uint8_t data[] = {
+        static_cast<uint8_t>(region_),
+        start_freq_code_,
+        end_freq_code_
+    };
+    Message msg(_rfid_addr, static_cast<uint8_t>(cid), data, sizeof(data));
     _hdl->sendMessage(msg);
 }
 
 
-void Command::onSetFrequencyRegion(const Message &msg_) {
-    LOG(DEBUG) << "msg: " << CmdHdl::toString(msg_.getAryTranData());
-    Ec err_code = static_cast<Ec>(msg_.getErrorCode());
+void Command::onSetFrequencyRegion(const FrameView &frame_) {
+    LOG(DEBUG) << "msg: " << CmdHdl::toString(frame_.getFrame(), frame_.getSize());
+    Ec err_code = static_cast<Ec>(frame_.getErrorCode());
     if (err_code not_eq Ec::command_success) {
         LOG(ERROR) << getError(err_code);
         _hdl->onError(getError(err_code));
@@ -389,17 +406,16 @@ void Command::onSetFrequencyRegion(const Message &msg_) {
 void Command::getFrequencyRegion() {
     LOG(DEBUG) << std::hex << "addr: " << CmdHdl::toString(_rfid_addr);
     Cid cid = Cid::cmd_get_frequency_region;
-    Message msg(_rfid_addr, static_cast<uint8_t>(cid));
-    _hdl->sendMessage(msg);
+    sendShort(cid);
 }
 
 
-void Command::onGetFrequencyRegion(const Message &msg_) {
-    if (msg_.getDataLen() not_eq 6) { ///< Размер данных, передаваемый в поле пакета.
+void Command::onGetFrequencyRegion(const FrameView &frame_) {
+    if (frame_.getDataLen() not_eq 6) { ///< Размер данных, передаваемый в поле пакета.
         LOG(ERROR) << getError(Ec::command_fail);
         _hdl->onError(getError(Ec::command_fail));
     } else {
-        const Buffer &pack = msg_.getAryTranData();
+        const uint8_t *pack = frame_.getFrame();
         uint8_t Region = pack[4];
         uint8_t StartFreq = pack[5];
         uint8_t EndFreq = pack[6];
@@ -415,19 +431,19 @@ void Command::onGetFrequencyRegion(const Message &msg_) {
 void Command::inventory(uint8_t repeat_) {
     LOG(DEBUG) << std::hex << "addr: " << CmdHdl::toString(_rfid_addr) << " repeat: " << CmdHdl::toString(repeat_);
     Cid cid = Cid::cmd_inventory;
-    Buffer data(1, repeat_);
-    Message msg(_rfid_addr, static_cast<uint8_t>(cid), data);
+    uint8_t data[] = { repeat_ };
+    Message msg(_rfid_addr, static_cast<uint8_t>(cid), data, sizeof(data));
     _hdl->sendMessage(msg);
 }
 
 
-void Command::onInventory(const Message &msg_) {
-    if (msg_.getDataLen() == 4) { ///< Размер данных, передаваемый в поле пакета.
-        Ec err_code = static_cast<Ec>(msg_.getErrorCode());
+void Command::onInventory(const FrameView &frame_) {
+    if (frame_.getDataLen() == 4) { ///< Размер данных, передаваемый в поле пакета.
+        Ec err_code = static_cast<Ec>(frame_.getErrorCode());
         LOG(ERROR) << getError(err_code);
         _hdl->onError(getError(err_code));
     } else {
-        const Buffer &data = msg_.getAryData();
+        const uint8_t *data = frame_.getData();
         uint8_t ant_id = data[0];
         
         /// Байты приходят в перевёрнутом виде.
@@ -458,27 +474,178 @@ void Command::onInventory(const Message &msg_) {
 }
 
 
+void Command::realTimeInventory(uint8_t repeat_) {
+    LOG(DEBUG) << "addr: " << CmdHdl::toString(_rfid_addr) << " repeat: " << CmdHdl::toString(repeat_);
+    Cid cid = Cid::cmd_real_time_inventory;
+    uint8_t data[] = { repeat_ };
+    Message msg(_rfid_addr, static_cast<uint8_t>(cid), data, sizeof(data));
+    _hdl->sendMessage(msg);
+}
+
+
+Command::ReadCmdData Command::parseRealTimeTagData(const uint8_t *data_, size_t len_) {
+    ReadCmdData rcd = {0};
+    size_t epc_len = len_ - 4; ///< FreqAnt, PC (2 байта) и RSSI не входят в EPC.
+
+    rcd._freq_param = data_[0] & 0xfc;
+    rcd._AntId      = data_[0] & 0x03;
+
+    /// Байты приходят в перевёрнутом виде.
+    (reinterpret_cast<uint8_t*>(&(rcd._PC)))[1] = data_[1];
+    (reinterpret_cast<uint8_t*>(&(rcd._PC)))[0] = data_[2];
+
+    rcd._DataLen = epc_len + 2;
+    if (epc_len) {
+        rcd._EPC.assign(&data_[3], epc_len);
+    }
+    /// Старший бит RSSI - признак фазы частотного скачка.
+    rcd._RSSI     = data_[len_ - 1] & 0x7f;
+    rcd._InvCount = 1;
+    return rcd;
+}
+
+
+Cid Command::onRealTimeStream(const FrameView &frame_, Cid cid_) {
+    Cid cid = cid_;
+    if (frame_.getDataLen() == 4) { ///< Пакет с кодом ошибки завершает инвенторизацию.
+        Ec err_code = static_cast<Ec>(frame_.getErrorCode());
+        LOG(ERROR) << getError(err_code);
+        _hdl->onError(getError(err_code));
+    } else if (frame_.getDataLen() == 0x0a) { ///< Пакет завершения: AntID, ReadRate, TotalRead.
+        const uint8_t *data = frame_.getData();
+        uint8_t ant_id = data[0];
+
+        /// Байты приходят в перевёрнутом виде.
+        uint16_t read_rate = 0;
+        (reinterpret_cast<uint8_t*>(&(read_rate)))[1] = data[1];
+        (reinterpret_cast<uint8_t*>(&(read_rate)))[0] = data[2];
+
+        /// Байты приходят в перевёрнутом виде.
+        uint32_t total_read = 0;
+        (reinterpret_cast<uint8_t*>(&(total_read)))[3] = data[3];
+        (reinterpret_cast<uint8_t*>(&(total_read)))[2] = data[4];
+        (reinterpret_cast<uint8_t*>(&(total_read)))[1] = data[5];
+        (reinterpret_cast<uint8_t*>(&(total_read)))[0] = data[6];
+        _hdl->onRealTimeInventory(ant_id, read_rate, total_read);
+    } else if (frame_.getDataSize() > 4) {
+        /// Очередная метка: передать сразу, не дожидаясь завершения цикла.
+        _hdl->onRealTimeInventoryTag(parseRealTimeTagData(frame_.getData(), frame_.getDataSize()));
+        cid = Cid::cmd_none;
+    } else {
+        LOG(WARNING) << "Incorrect real time inventory packet: " << CmdHdl::toString(frame_.getFrame(), frame_.getSize());
+        cid = Cid::cmd_none;
+    }
+    return cid;
+}
+
+
+Cid Command::onRealTimeInventory(const FrameView &frame_) {
+    return onRealTimeStream(frame_, Cid::cmd_real_time_inventory);
+}
+
+
+void Command::customizedSessionTargetInventory(ESession session_, ETarget target_, uint8_t repeat_) {
+    LOG(DEBUG) << "addr: " << CmdHdl::toString(_rfid_addr)
+               << " session: S" << static_cast<uint16_t>(session_)
+               << " target: " << (target_ == ETarget::A ? "A" : "B")
+               << " repeat: " << CmdHdl::toString(repeat_);
+    Cid cid = Cid::cmd_customized_session_target_inventory;
+    uint8_t data[] = {static_cast<uint8_t>(session_), static_cast<uint8_t>(target_), repeat_};
+    Message msg(_rfid_addr, static_cast<uint8_t>(cid), data, sizeof(data));
+    _hdl->sendMessage(msg);
+}
+
+
+Cid Command::onCustomizedSessionTargetInventory(const FrameView &frame_) {
+    /// Формат ответа совпадает с cmd_real_time_inventory.
+    return onRealTimeStream(frame_, Cid::cmd_customized_session_target_inventory);
+}
+
+
+void Command::fastSwitchAntInventory(const FastSwitchSettings &sets_) {
+    LOG(DEBUG) << "addr: " << CmdHdl::toString(_rfid_addr)
+               << " ants: " << CmdHdl::toString(sets_._ants, sizeof(sets_._ants))
+               << " stays: " << CmdHdl::toString(sets_._stays, sizeof(sets_._stays))
+               << " repeat: " << CmdHdl::toString(sets_._repeat);
+    Cid cid = Cid::cmd_fast_switch_ant_inventory;
+    uint8_t data[] = {
+        sets_._ants[0], sets_._stays[0],
+        sets_._ants[1], sets_._stays[1],
+        sets_._ants[2], sets_._stays[2],
+        sets_._ants[3], sets_._stays[3],
+        sets_._interval,
+        sets_._repeat
+    };
+    Message msg(_rfid_addr, static_cast<uint8_t>(cid), data, sizeof(data));
+    _hdl->sendMessage(msg);
+}
+
+
+Cid Command::onFastSwitchAntInventory(const FrameView &frame_) {
+    Cid cid = Cid::cmd_fast_switch_ant_inventory;
+    if (frame_.getDataLen() == 4) { ///< Пакет с кодом ошибки завершает инвенторизацию.
+        Ec err_code = static_cast<Ec>(frame_.getErrorCode());
+        LOG(ERROR) << getError(err_code);
+        _hdl->onError(getError(err_code));
+    } else if (frame_.getDataLen() == 5) { ///< Ошибка антенны: AntId, ErrorCode; опрос продолжается на следующей.
+        const uint8_t *data = frame_.getData();
+        LOG(WARNING) << "Antenna " << static_cast<uint16_t>(data[0] + 1) << ": " << getError(static_cast<Ec>(data[1]));
+        cid = Cid::cmd_none;
+    } else if (frame_.getDataLen() == 0x0a) { ///< Пакет завершения: TotalRead (3 байта), CommandDuration (4 байта).
+        const uint8_t *data = frame_.getData();
+
+        /// Байты приходят в перевёрнутом виде.
+        uint32_t total_read = 0;
+        (reinterpret_cast<uint8_t*>(&(total_read)))[2] = data[0];
+        (reinterpret_cast<uint8_t*>(&(total_read)))[1] = data[1];
+        (reinterpret_cast<uint8_t*>(&(total_read)))[0] = data[2];
+
+        /// Байты приходят в перевёрнутом виде.
+        uint32_t duration = 0;
+        (reinterpret_cast<uint8_t*>(&(duration)))[3] = data[3];
+        (reinterpret_cast<uint8_t*>(&(duration)))[2] = data[4];
+        (reinterpret_cast<uint8_t*>(&(duration)))[1] = data[5];
+        (reinterpret_cast<uint8_t*>(&(duration)))[0] = data[6];
+        _hdl->onFastSwitchAntInventory(total_read, duration);
+    } else if (frame_.getDataSize() > 4) {
+        /// Очередная метка с номером антенны в младших битах FreqAnt.
+        _hdl->onRealTimeInventoryTag(parseRealTimeTagData(frame_.getData(), frame_.getDataSize()));
+        cid = Cid::cmd_none;
+    } else {
+        LOG(WARNING) << "Incorrect fast switch inventory packet: " << CmdHdl::toString(frame_.getFrame(), frame_.getSize());
+        cid = Cid::cmd_none;
+    }
+    return cid;
+}
+
+
 void Command::read(EReadMemBank mem_bank_, uint8_t word_add_, uint8_t word_cnt_) {
     LOG(DEBUG) << "addr: " << CmdHdl::toString(_rfid_addr);
     Cid cid = Cid::cmd_read;
-    Buffer buf(3, 0x0);
-    buf[0] = static_cast<uint8_t>(mem_bank_);
-    buf[1] = word_add_;
-    buf[2] = word_cnt_;
-    Message msg(_rfid_addr, static_cast<uint8_t>(cid), buf);
+    uint8_t data[] = {
+        static_cast<uint8_t>(mem_bank_),
+        word_add_,
+        word_cnt_
+    };
+    Message msg(_rfid_addr, static_cast<uint8_t>(cid), data, sizeof(data));
     _hdl->sendMessage(msg);
 }
 
 
-void Command::onRead(const Message &msg_) {
-    if (msg_.getDataLen() == 4) { ///< Размер данных, передаваемый в поле пакета.
-        Ec err_code = static_cast<Ec>(msg_.getErrorCode());
+void Command::onRead(const FrameView &frame_) {
+    if (frame_.getDataLen() == 4) { ///< Размер данных, передаваемый в поле пакета.
+        Ec err_code = static_cast<Ec>(frame_.getErrorCode());
         LOG(ERROR) << getError(err_code);
         _hdl->onError(getError(err_code));
     } else {
-        const Buffer &data = msg_.getAryData();
+        const uint8_t *data = frame_.getData();
         ReadCmdData rcd = {0};
-        size_t len = msg_.getDataLen() - 3;
+        size_t len = frame_.getDataSize();
+        /// TagCount, DataLen и ReadLen, AntId, ReadCount обрамляют DataLen байт PC, EPC, CRC и данных.
+        if (len < 6 or len < static_cast<size_t>(data[2]) + 6 or data[2] < static_cast<size_t>(data[len - 3]) + 4) {
+            LOG(WARNING) << "Incorrect read packet: " << CmdHdl::toString(frame_.getFrame(), frame_.getSize());
+            return;
+        }
 
         /// Байты приходят в перевёрнутом виде.
         (reinterpret_cast<uint8_t*>(&(rcd._TagCount)))[1] = data[0];
@@ -496,10 +663,7 @@ void Command::onRead(const Message &msg_) {
         (reinterpret_cast<uint8_t*>(&(rcd._PC)))[0] = data[4];
 
         if (epc_len) {
-            rcd._EPC.resize(epc_len, 0x0);
-            for (size_t e = 0; e < epc_len; ++e) {
-                rcd._EPC[e] = data[5 + e];
-            };
+            rcd._EPC.assign(&data[5], epc_len);
         }
 
         /// Байты приходят в перевёрнутом виде.
@@ -515,7 +679,7 @@ void Command::onRead(const Message &msg_) {
         //LOG(TRACE) << " TagCount: " << rcd._TagCount
         //           << " DataLen: " << rcd._DataLen
         //           << " PC: " << rcd._PC
-        //           << " EPC: " << CmdHdl::toString(rcd._EPC)
+        //           << " EPC: " << CmdHdl::toString(rcd._EPC._bytes, rcd._EPC._len)
         //           << " CRC: " << rcd._CRC
         //           << " Data: " << CmdHdl::toString(rcd._Data)
         //           << " ReadLen: " << rcd._ReadLen
@@ -529,98 +693,129 @@ void Command::onRead(const Message &msg_) {
 void Command::getInventoryBuffer() {
     LOG(DEBUG) << "addr: " << CmdHdl::toString(_rfid_addr);
     Cid cid = Cid::cmd_get_inventory_buffer;
-    Message msg(_rfid_addr, static_cast<uint8_t>(cid));
-    _hdl->sendMessage(msg);
+    sendShort(cid);
 }
 
 
-Command::ReadCmdData Command::parseInventoryBufferData(const Buffer &data_) {
-    ReadCmdData rcd = {0};
+bool Command::parseInventoryBufferData(const uint8_t *data_, size_t len_, ReadCmdData &rcd_) {
+    rcd_ = ReadCmdData();
+    if (len_ < 2) {
+        return false;
+    }
 
     /// Байты приходят в перевёрнутом виде.
-    (reinterpret_cast<uint8_t*>(&(rcd._TagCount)))[1] = data_[0];
-    (reinterpret_cast<uint8_t*>(&(rcd._TagCount)))[0] = data_[1];
+    (reinterpret_cast<uint8_t*>(&(rcd_._TagCount)))[1] = data_[0];
+    (reinterpret_cast<uint8_t*>(&(rcd_._TagCount)))[0] = data_[1];
 
-    rcd._DataLen = data_[2];
-    size_t epc_len = static_cast<size_t>(rcd._DataLen) - 4;
+    /// DataLen покрывает PC, EPC и CRC, за ними следуют RSSI, FreqAnt и InvCount.
+    if (len_ < 3 or data_[2] < 4 or len_ < static_cast<size_t>(data_[2]) + 6) {
+        return false;
+    }
+    rcd_._DataLen = data_[2];
+    size_t epc_len = static_cast<size_t>(rcd_._DataLen) - 4;
 
     /// Байты приходят в перевёрнутом виде.
-    (reinterpret_cast<uint8_t*>(&(rcd._PC)))[1] = data_[3];
-    (reinterpret_cast<uint8_t*>(&(rcd._PC)))[0] = data_[4];
+    (reinterpret_cast<uint8_t*>(&(rcd_._PC)))[1] = data_[3];
+    (reinterpret_cast<uint8_t*>(&(rcd_._PC)))[0] = data_[4];
 
     if (epc_len) {
-        rcd._EPC.resize(epc_len, 0x0);
-        for (size_t e = 0; e < epc_len; ++e) {
-            rcd._EPC[e] = data_[5 + e];
-        };
+        rcd_._EPC.assign(&data_[5], epc_len);
     }
 
     /// Байты приходят в перевёрнутом виде.
-    (reinterpret_cast<uint8_t*>(&(rcd._CRC)))[1]  = data_[epc_len + 5];
-    (reinterpret_cast<uint8_t*>(&(rcd._CRC)))[0]  = data_[epc_len + 6];
-
-    rcd._RSSI       = data_[epc_len + 7];
-    rcd._freq_param = data_[epc_len + 8] & 0xfc;
-    rcd._AntId      = data_[epc_len + 8] & 0x03;
-    rcd._InvCount   = data_[epc_len + 9];
-
-    //LOG(TRACE) << " TagCount: " << rcd._TagCount
-    //           << " DataLen: " << rcd._DataLen
-    //           << " PC: " << rcd._PC
-    //           << " EPC: " << CmdHdl::toString(rcd._EPC)
-    //           << " CRC: " << rcd._CRC
-    //           << " RSSI: " << CmdHdl::toString(rcd._RSSI)
-    //           << " FreqAnt: [" << CmdHdl::toString(rcd._freq_param) << "|" << CmdHdl::toString(rcd._AntId) << "]"
-    //           << " InvCount: " << CmdHdl::toString(rcd._InvCount);
-    return rcd;
+    (reinterpret_cast<uint8_t*>(&(rcd_._CRC)))[1]  = data_[epc_len + 5];
+    (reinterpret_cast<uint8_t*>(&(rcd_._CRC)))[0]  = data_[epc_len + 6];
+
+    rcd_._RSSI       = data_[epc_len + 7];
+    rcd_._freq_param = data_[epc_len + 8] & 0xfc;
+    rcd_._AntId      = data_[epc_len + 8] & 0x03;
+    rcd_._InvCount   = data_[epc_len + 9];
+
+    //LOG(TRACE) << " TagCount: " << rcd_._TagCount
+    //           << " DataLen: " << rcd_._DataLen
+    //           << " PC: " << rcd_._PC
+    //           << " EPC: " << CmdHdl::toString(rcd_._EPC._bytes, rcd_._EPC._len)
+    //           << " CRC: " << rcd_._CRC
+    //           << " RSSI: " << CmdHdl::toString(rcd_._RSSI)
+    //           << " FreqAnt: [" << CmdHdl::toString(rcd_._freq_param) << "|" << CmdHdl::toString(rcd_._AntId) << "]"
+    //           << " InvCount: " << CmdHdl::toString(rcd_._InvCount);
+    return true;
+}
+
+
+Cid Command::countBufferFrame(uint16_t tag_count_, Cid cid_) {
+    /// Каждый пакет выгрузки содержит одну метку и общее количество меток в буфере.
+    if (++_buffer_frames < tag_count_) {
+        return Cid::cmd_none;
+    }
+    _buffer_frames = 0;
+    return cid_;
 }
 
 
-void Command::onGetInventoryBuffer(const Message &msg_) {
-    if (msg_.getDataLen() == 4) { ///< Размер данных, передаваемый в поле пакета.
-        Ec err_code = static_cast<Ec>(msg_.getErrorCode());
+Cid Command::onGetInventoryBuffer(const FrameView &frame_) {
+    Cid cid = Cid::cmd_get_inventory_buffer;
+    if (frame_.getDataLen() == 4) { ///< Размер данных, передаваемый в поле пакета.
+        Ec err_code = static_cast<Ec>(frame_.getErrorCode());
         LOG(ERROR) << getError(err_code);
         _hdl->onError(getError(err_code));
+        _buffer_frames = 0;
     } else {
-        _hdl->onGetInventoryBuffer(parseInventoryBufferData(msg_.getAryData()));
+        Command::ReadCmdData rcd;
+        if (parseInventoryBufferData(frame_.getData(), frame_.getDataSize(), rcd)) {
+            _hdl->onGetInventoryBuffer(rcd);
+        } else {
+            /// Пакет отбрасывается, но учитывается, чтобы выгрузка буфера завершилась.
+            LOG(WARNING) << "Incorrect inventory buffer packet: " << CmdHdl::toString(frame_.getFrame(), frame_.getSize());
+        }
+        cid = countBufferFrame(rcd._TagCount, cid);
     }
+    return cid;
 }
 
 
 void Command::getAndResetInventoryBuffer() {
     LOG(DEBUG) << "addr: " << CmdHdl::toString(_rfid_addr);
     Cid cid = Cid::cmd_get_and_reset_inventory_buffer;
-    Message msg(_rfid_addr, static_cast<uint8_t>(cid));
-    _hdl->sendMessage(msg);
+    sendShort(cid);
 }
 
 
-void Command::onGetAndResetInventoryBuffer(const Message &msg_) {
-    if (msg_.getDataLen() == 4) { ///< Размер данных, передаваемый в поле пакета.
-        Ec err_code = static_cast<Ec>(msg_.getErrorCode());
+Cid Command::onGetAndResetInventoryBuffer(const FrameView &frame_) {
+    Cid cid = Cid::cmd_get_and_reset_inventory_buffer;
+    if (frame_.getDataLen() == 4) { ///< Размер данных, передаваемый в поле пакета.
+        Ec err_code = static_cast<Ec>(frame_.getErrorCode());
         LOG(ERROR) << getError(err_code);
         _hdl->onError(getError(err_code));
+        _buffer_frames = 0;
     } else {
-        _hdl->onGetAndResetInventoryBuffer(parseInventoryBufferData(msg_.getAryData()));
+        Command::ReadCmdData rcd;
+        if (parseInventoryBufferData(frame_.getData(), frame_.getDataSize(), rcd)) {
+            _hdl->onGetAndResetInventoryBuffer(rcd);
+        } else {
+            /// Пакет отбрасывается, но учитывается, чтобы выгрузка буфера завершилась.
+            LOG(WARNING) << "Incorrect inventory buffer packet: " << CmdHdl::toString(frame_.getFrame(), frame_.getSize());
+        }
+        cid = countBufferFrame(rcd._TagCount, cid);
     }
+    return cid;
 }
 
 
 void Command::getInventoryBufferTagCount() {
     LOG(DEBUG) << "addr: " << CmdHdl::toString(_rfid_addr);
     Cid cid = Cid::cmd_get_inventory_buffer_tag_count;
-    Message msg(_rfid_addr, static_cast<uint8_t>(cid));
-    _hdl->sendMessage(msg);
+    sendShort(cid);
 }
 
 
-void Command::onGetInventoryBufferTagCount(const Message &msg_) {
-    if (msg_.getDataLen() not_eq 5) { ///< Размер данных, передаваемый в поле пакета.
-        Ec err_code = static_cast<Ec>(msg_.getErrorCode());
+void Command::onGetInventoryBufferTagCount(const FrameView &frame_) {
+    if (frame_.getDataLen() not_eq 5) { ///< Размер данных, передаваемый в поле пакета.
+        Ec err_code = static_cast<Ec>(frame_.getErrorCode());
         LOG(ERROR) << getError(err_code);
         _hdl->onError(getError(err_code));
     } else {
-        const Buffer &data = msg_.getAryData();
+        const uint8_t *data = frame_.getData();
         uint16_t TagCount = 0;
         /// Байты приходят в перевёрнутом виде.
         (reinterpret_cast<uint8_t*>(&(TagCount)))[1] = data[0];
@@ -634,14 +829,13 @@ void Command::onGetInventoryBufferTagCount(const Message &msg_) {
 void Command::resetInventoryBuffer() {
     LOG(DEBUG) << "addr: " << CmdHdl::toString(_rfid_addr);
     Cid cid = Cid::cmd_reset_inventory_buffer;
-    Message msg(_rfid_addr, static_cast<uint8_t>(cid));
-    _hdl->sendMessage(msg);
+    sendShort(cid);
 }
 
 
-void Command::onResetInventoryBuffer(const Message &msg_) {
-    LOG(DEBUG) << "msg: " << CmdHdl::toString(msg_.getAryTranData());
-    Ec err_code = static_cast<Ec>(msg_.getErrorCode());
+void Command::onResetInventoryBuffer(const FrameView &frame_) {
+    LOG(DEBUG) << "msg: " << CmdHdl::toString(frame_.getFrame(), frame_.getSize());
+    Ec err_code = static_cast<Ec>(frame_.getErrorCode());
     if (err_code not_eq Ec::command_success) {
         LOG(ERROR) << getError(err_code);
         _hdl->onError(getError(err_code));
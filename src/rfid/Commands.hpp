@@ -10,11 +10,15 @@
 #include <functional>
 
 #include "Message.hpp"
+#include "Epc.hpp"
+#include "FrameParser.hpp"
 
 #pragma once
 
 #define MAX_FREQUENCY_CODE 0x3b ///< Максимальный код для определения частотного региона.
 
+static const size_t RFID_SHORT_FRAMES_NUM = 0x100; ///< Количество заранее собранных пакетов без параметров (по коду команды).
+
 namespace robocooler {
 namespace rfid {
     
@@ -152,11 +156,23 @@ public:
         QUANTITY = 4
     };
 
+    enum class ESession : uint8_t {
+        S0 = 0x00, ///< Флаг сбрасывается сразу после снятия поля.
+        S1 = 0x01, ///< Флаг сохраняется 0.5-5 с независимо от поля.
+        S2 = 0x02, ///< Флаг сохраняется, пока метка в поле, и не менее 2 с после.
+        S3 = 0x03
+    };
+
+    enum class ETarget : uint8_t {
+        A = 0x00, ///< Отвечают метки с флагом A (ещё не опрошенные в сессии).
+        B = 0x01  ///< Отвечают метки с флагом B (уже опрошенные в сессии).
+    };
+
     struct ReadCmdData {
         uint16_t _TagCount;
         size_t _DataLen;
         uint16_t _PC;
-        Buffer _EPC;
+        Epc _EPC;
         uint16_t _CRC;
         Buffer _Data;
         size_t _ReadLen;
@@ -178,6 +194,13 @@ public:
         uint8_t _ant_pow_4;
     };
 
+    struct FastSwitchSettings {
+        uint8_t _ants[static_cast<size_t>(EWorkAntenna::QUANTITY)];  ///< Последовательность антенн, значение > 3 - пропуск.
+        uint8_t _stays[static_cast<size_t>(EWorkAntenna::QUANTITY)]; ///< Количество циклов инвенторизации на антенне.
+        uint8_t _interval;                                           ///< Пауза между переключениями [мс].
+        uint8_t _repeat;                                             ///< Количество повторов всей последовательности.
+    };
+
     typedef Command::EErrorCode Ec;
     typedef Command::ECommandId Cid;
     typedef std::map<Ec, std::string> MapErrorCodes;
@@ -187,67 +210,148 @@ private:
     uint8_t _rfid_addr;
     MapErrorCodes _err_codes;
     CommandsHandler *_hdl;
+    uint8_t _short_frames[RFID_SHORT_FRAMES_NUM][RFID_PACK_MINLEN]; ///< Готовые пакеты команд без параметров.
+    uint16_t _buffer_frames; ///< Количество принятых пакетов текущей выгрузки буфера меток.
 
     void initErrorCodes();
 
-    Command::ReadCmdData parseInventoryBufferData(const Buffer &data);
+    /**
+     * \brief Метод пересобирает пакеты команд без параметров для текущего адреса считывателя.
+     */
+    void initShortFrames();
+
+    /**
+     * \brief Метод отправляет заранее собранный пакет команды без параметров.
+     */
+    void sendShort(Cid cid_);
+
+    /**
+     * \brief Метод считает пакеты выгрузки буфера меток.
+     * \return cid_ для последнего пакета выгрузки, cmd_none для остальных.
+     */
+    Cid countBufferFrame(uint16_t tag_count_, Cid cid_);
+
+    /**
+     * \brief Метод разбирает пакет метки потоковой инвенторизации: FreqAnt, PC, EPC, RSSI.
+     */
+    Command::ReadCmdData parseRealTimeTagData(const uint8_t *data_, size_t len_);
+
+    /**
+     * \brief Метод обрабатывает пакет потоковой инвенторизации формата cmd_real_time_inventory.
+     * \param cid_  Команда, о выполнении которой сообщает пакет завершения.
+     */
+    Cid onRealTimeStream(const FrameView &frame_, Cid cid_);
     
 public:
     static std::string cmdToString(Cid cmd_code_);
 
+    /**
+     * \brief Метод разбирает пакет выгрузки буфера меток: TagCount, DataLen, PC, EPC, CRC, RSSI, FreqAnt, InvCount.
+     * \param len_  Размер данных пакета.
+     * \return false, если DataLen не помещается в пакет; в rcd_ заполнен только TagCount.
+     */
+    static bool parseInventoryBufferData(const uint8_t *data_, size_t len_, Command::ReadCmdData &rcd_);
+
     explicit Command(CommandsHandler *hdl_);
     virtual ~Command();
     
-    Cid receive(const Message &msg_);
+    Cid receive(const FrameView &frame_);
     std::string getError(Ec err_code_);
     
     void setRfidAddres(uint8_t addr_);
     
     /// Методы команд.
     void reset();
-    void onReset(const Message &msg_);
+    void onReset(const FrameView &frame_);
     
     void setUartBaudrate(EBaudrate bdr_);
-    void onSetUartBaudrate(const Message &msg_);
+    void onSetUartBaudrate(const FrameView &frame_);
     
     void getFirmwareVersion();
-    void onGetFirmwareVersion(const Message &msg_);
+    void onGetFirmwareVersion(const FrameView &frame_);
     
     void setWorkAntenna(EWorkAntenna work_ant_);
-    void onSetWorkAntenna(const Message &msg_);
+    void onSetWorkAntenna(const FrameView &frame_);
     
     void getWorkAntenna();
-    void onGetWorkAntenna(const Message &msg_);
+    void onGetWorkAntenna(const FrameView &frame_);
 
     void setOutputPower(uint8_t ant_power_1_, uint8_t ant_power_2_, uint8_t ant_power_3_, uint8_t ant_power_4_);
-    void onSetOutputPower(const Message &msg_);
+    void onSetOutputPower(const FrameView &frame_);
     
     void getOutputPower();
-    void onGetOutputPower(const Message &msg_);
+    void onGetOutputPower(const FrameView &frame_);
 
     void setFrequencyRegion(ESpektrumRegion region_, uint8_t start_freq_code_, uint8_t end_freq_code_);
-    void onSetFrequencyRegion(const Message &msg_);
+    void onSetFrequencyRegion(const FrameView &frame_);
     
     void getFrequencyRegion();
-    void onGetFrequencyRegion(const Message &msg_);
+    void onGetFrequencyRegion(const FrameView &frame_);
 
     void inventory(uint8_t repeat_);
-    void onInventory(const Message &msg_);
+    void onInventory(const FrameView &frame_);
                    
+    /**
+     * \brief Метод запускает потоковую инвенторизацию: метки передаются по мере чтения, без буфера считывателя.
+     * \param repeat_  Количество циклов инвенторизации на антенну.
+     */
+    void realTimeInventory(uint8_t repeat_);
+
+    /**
+     * \brief Метод обрабатывает пакет потоковой инвенторизации.
+     * \return cmd_real_time_inventory для пакета завершения или ошибки; cmd_none для пакета метки.
+     */
+    Cid onRealTimeInventory(const FrameView &frame_);
+
+    /**
+     * \brief Метод запускает потоковую инвенторизацию с быстрым переключением антенн одной командой.
+     * \param sets_  Последовательность антенн и количество циклов на каждой.
+     */
+    void fastSwitchAntInventory(const FastSwitchSettings &sets_);
+
+    /**
+     * \brief Метод обрабатывает пакет инвенторизации с быстрым переключением антенн.
+     * \return cmd_fast_switch_ant_inventory для пакета завершения или ошибки; cmd_none для метки.
+     */
+    Cid onFastSwitchAntInventory(const FrameView &frame_);
+
+    /**
+     * \brief Метод запускает потоковую инвенторизацию на рабочей антенне с заданной сессией и целевым флагом.
+     *        Отвечают только метки, флаг которых в сессии совпадает с target_; ответившие метки меняют флаг.
+     * \param repeat_  Количество циклов инвенторизации.
+     */
+    void customizedSessionTargetInventory(ESession session_, ETarget target_, uint8_t repeat_);
+
+    /**
+     * \brief Метод обрабатывает пакет инвенторизации с сессией; формат совпадает с cmd_real_time_inventory.
+     * \return cmd_customized_session_target_inventory для пакета завершения или ошибки; cmd_none для метки.
+     */
+    Cid onCustomizedSessionTargetInventory(const FrameView &frame_);
+
     void read(EReadMemBank mem_banck_, uint8_t word_add_, uint8_t word_cnt_ = 1);
-    void onRead(const Message &msg_);
+    void onRead(const FrameView &frame_);
 
     void getInventoryBuffer();
-    void onGetInventoryBuffer(const Message &msg_);
+
+    /**
+     * \brief Метод обрабатывает пакет выгрузки буфера меток.
+     * \return cmd_get_inventory_buffer после последней метки буфера или ошибки; cmd_none для остальных меток.
+     */
+    Cid onGetInventoryBuffer(const FrameView &frame_);
 
     void getAndResetInventoryBuffer();
-    void onGetAndResetInventoryBuffer(const Message &msg_);
+
+    /**
+     * \brief Метод обрабатывает пакет выгрузки буфера меток со сбросом.
+     * \return cmd_get_and_reset_inventory_buffer после последней метки буфера или ошибки; cmd_none для остальных.
+     */
+    Cid onGetAndResetInventoryBuffer(const FrameView &frame_);
 
     void getInventoryBufferTagCount();
-    void onGetInventoryBufferTagCount(const Message &msg_);
+    void onGetInventoryBufferTagCount(const FrameView &frame_);
 
     void resetInventoryBuffer();
-    void onResetInventoryBuffer(const Message &msg_);
+    void onResetInventoryBuffer(const FrameView &frame_);
 };
 } /// robocooler
 } /// rfid
@@ -14,23 +14,36 @@ typedef Message::Buffer Buffer;
 typedef Command::ECommandId Cid;
 
 
-Cid CommandsHandler::onMessage(const Message &msg_) {
+Cid CommandsHandler::onFrame(const FrameView &frame_) {
     Cid res = Cid::cmd_none;
     Command* cmd = getCommand();
     if (cmd) {
-        res = cmd->receive(msg_);
+        res = cmd->receive(frame_);
     } else {
-        LOG(ERROR) << "Can`t find command for responce: " << toString(msg_.getAryTranData());
+        LOG(ERROR) << "Can`t find command for responce: " << toString(frame_.getFrame(), frame_.getSize());
     }
     return res;
 }
+
+
+void CommandsHandler::checkSkipped(size_t skipped_) {
+    size_t skipped = _parser.getSkipped();
+    if (skipped not_eq skipped_) {
+        LOG(ERROR) << "Incorrect data block: " << (skipped - skipped_) << " bytes are skipped.";
+    }
+}
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
 std::string CommandsHandler::toString(const Buffer &recv_buf_) {
+    return toString(recv_buf_.data(), recv_buf_.size());
+}
+
+
+std::string CommandsHandler::toString(const uint8_t *buf_, size_t len_) {
     std::stringstream ss;
-    for (uint8_t b : recv_buf_) {
-        ss << std::hex << std::setfill('0') << std::setw(2) << static_cast<uint16_t>(b) << " ";
+    for (size_t i = 0; i < len_; ++i) {
+        ss << std::hex << std::setfill('0') << std::setw(2) << static_cast<uint16_t>(buf_[i]) << " ";
     }
     return ss.str().substr(0, ss.str().size() - 1);
 }
@@ -116,11 +129,15 @@ Command::AntSettings CommandsHandler::getAntSettings() {
 
 
 bool CommandsHandler::sendMessage(const Message &msg_) {
+    return sendFrame(msg_.getFrame(), msg_.getSize());
+}
+
+
+bool CommandsHandler::sendFrame(const uint8_t *frame_, size_t len_) {
     //LOG(DEBUG);
     bool res = false;
     if (_tty_io->isInit()) {
-        const Buffer &pack = msg_.getAryTranData();
-        _tty_io->write(pack);
+        _tty_io->write(frame_, len_);
         res = true;
     }
     return res;
@@ -129,28 +146,27 @@ bool CommandsHandler::sendMessage(const Message &msg_) {
 
 Cid CommandsHandler::receivePacket(uint8_t b_) {
     Cid res = Cid::cmd_none;
-    _recv_buf.push_back(b_);
-    if (RFID_PACK_MINLEN <= _recv_buf.size()) {
-        if (_recv_buf[0] == RFID_HEAD) {
-            size_t s = _recv_buf[1] + 2; ///< Байт заголовка и байт размера не входят в размер блока данны.
-            if (s <= _recv_buf.size()) {
-                Buffer block(_recv_buf.begin(), _recv_buf.begin() + s);
-                /// Обработать пакет.
-                res = onMessage(Message(block));
-                /// Очистить обработанный блок данных.
-                _recv_buf.erase(_recv_buf.begin(), _recv_buf.begin() + s);
-            }
-        } else {
-            LOG(ERROR) << "Incorrect data block: " << toString(_recv_buf);
-            while (not _recv_buf.empty() and  _recv_buf[0] not_eq RFID_HEAD) {
-                _recv_buf.erase(_recv_buf.begin());
-            }
-        }
-    }
+    size_t skipped = _parser.getSkipped();
+    _parser.feed(&b_, 1, [this, &res](const FrameView &frame_) {
+        res = onFrame(frame_);
+    });
+    checkSkipped(skipped);
     return res;
 }
 
 
+void CommandsHandler::receiveChunk(const uint8_t *buf_, size_t len_, const OnCmdResultFunc &on_result_) {
+    size_t skipped = _parser.getSkipped();
+    _parser.feed(buf_, len_, [this, &on_result_](const FrameView &frame_) {
+        Cid cid = onFrame(frame_);
+        if (Cid::cmd_none not_eq cid and on_result_) {
+            on_result_(cid);
+        }
+    });
+    checkSkipped(skipped);
+}
+
+
 void CommandsHandler::onError(const std::string &err_) {
     _is_error = true;
     _cur_read_data = Command::ReadCmdData();
@@ -226,6 +242,28 @@ void CommandsHandler::onRead(const Command::ReadCmdData &read_data_) {
 }
 
 
+void CommandsHandler::onRealTimeInventory(uint8_t ant_id_, uint16_t read_rate_, uint32_t total_read_) {
+    LOG(DEBUG) << "Real time inventory: ant: " << static_cast<uint16_t>(ant_id_)
+               << ", rate: " << read_rate_ << ", total: " << total_read_;
+    _is_error = false;
+}
+
+
+void CommandsHandler::onRealTimeInventoryTag(const Command::ReadCmdData &read_data_) {
+    if (_on_read_data_func) {
+        _on_read_data_func(read_data_);
+    } else {
+        _cur_read_data = read_data_;
+    }
+}
+
+
+void CommandsHandler::onFastSwitchAntInventory(uint32_t total_read_, uint32_t duration_) {
+    LOG(DEBUG) << "Fast switch inventory: total: " << total_read_ << ", duration: " << duration_ << " ms";
+    _is_error = false;
+}
+
+
 void CommandsHandler::onGetInventoryBuffer(const Command::ReadCmdData &read_data_) {
     _is_error = false;
     if (_on_read_data_func) {
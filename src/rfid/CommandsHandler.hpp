@@ -12,6 +12,7 @@
 #include <functional>
 
 #include "Message.hpp"
+#include "FrameParser.hpp"
 #include "Commands.hpp"
 #include "TtyIo.hpp"
 
@@ -25,10 +26,11 @@ typedef Message::Buffer Buffer;
 class CommandsHandler {
 public:
     typedef std::function<void(const Command::ReadCmdData&)> OnReadDataFunc;
+    typedef std::function<void(Cid)> OnCmdResultFunc;
 
 private:
     utils::TtyIo *_tty_io;
-    std::vector<uint8_t> _recv_buf;
+    FrameParser _parser;
     PCommand _command;
     Command::ReadCmdData _cur_read_data;
     uint16_t _cur_tag_count;
@@ -37,10 +39,16 @@ private:
 
     OnReadDataFunc _on_read_data_func;
     
-    Cid onMessage(const Message &msg_);
+    Cid onFrame(const FrameView &frame_);
+
+    /**
+     * \brief Метод сообщает об отброшенных при синхронизации байтах.
+     */
+    void checkSkipped(size_t skipped_);
 
 public:
     static std::string toString(const Buffer &recv_buf_);
+    static std::string toString(const uint8_t *buf_, size_t len_);
     static std::string toString(uint8_t b_);
     static std::string freqCodeToString(uint8_t code_);
     static std::string specRegionToString(Command::ESpektrumRegion region_);
@@ -57,7 +65,16 @@ public:
 
     Command* getCommand();
     bool sendMessage(const Message &msg_);
+    bool sendFrame(const uint8_t *frame_, size_t len_);
     Cid receivePacket(uint8_t b_);
+
+    /**
+     * \brief Метод принимает блок байт, прочитанный из порта за один вызов, и разбирает все полные пакеты.
+     * \param buf_  Указатель на принятые байты.
+     * \param len_  Количество принятых байт.
+     * \param on_result_  Функтор, вызываемый для каждого обработанного пакета с идентификатором команды.
+     */
+    void receiveChunk(const uint8_t *buf_, size_t len_, const OnCmdResultFunc &on_result_);
     
     void onError(const std::string &err_);
     void onSetUartBaudrate();
@@ -70,6 +87,9 @@ public:
     void onSetFrequencyRegion();
     void onInventory(uint8_t ant_id_, uint16_t tag_count_, uint16_t read_rate_, uint32_t total_read_);
     void onRead(const Command::ReadCmdData &read_data_);
+    void onRealTimeInventory(uint8_t ant_id_, uint16_t read_rate_, uint32_t total_read_);
+    void onRealTimeInventoryTag(const Command::ReadCmdData &read_data_);
+    void onFastSwitchAntInventory(uint32_t total_read_, uint32_t duration_);
     void onGetInventoryBuffer(const Command::ReadCmdData &read_data_);
     void onGetAndResetInventoryBuffer(const Command::ReadCmdData &read_data_);
     void onGetInventoryBufferTagCount(uint16_t TagCount_);
@@ -0,0 +1,74 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Двоичный EPC метки фиксированной ёмкости без размещения в куче.
+ * \author Величко Ростислав
+ * \date   07.17.2017
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+
+static const size_t RFID_EPC_MAXLEN = 16; ///< Максимальная длина EPC [байт] (128 бит).
+
+
+namespace robocooler {
+namespace rfid {
+
+
+struct Epc {
+    uint8_t _len;                     ///< Фактическая длина EPC.
+    uint8_t _bytes[RFID_EPC_MAXLEN]; ///< Байты EPC в порядке передачи.
+
+    /**
+     * \brief Метод копирует EPC из пакета, длинные EPC усекаются до RFID_EPC_MAXLEN.
+     * \return false, если EPC был усечён.
+     */
+    bool assign(const uint8_t *data_, size_t len_) {
+        bool res = (len_ <= RFID_EPC_MAXLEN);
+        _len = static_cast<uint8_t>(res ? len_ : RFID_EPC_MAXLEN);
+        memcpy(_bytes, data_, _len);
+        return res;
+    }
+
+    bool operator == (const Epc &epc_) const {
+        return _len == epc_._len and 0 == memcmp(_bytes, epc_._bytes, _len);
+    }
+
+    bool operator not_eq (const Epc &epc_) const {
+        return not (*this == epc_);
+    }
+
+    /**
+     * \brief Метод вычисляет хеш FNV-1a: EPC уже равномерно распределён, достаточно перемешать байты.
+     */
+    uint32_t hash() const {
+        uint32_t res = 2166136261u;
+        for (size_t i = 0; i < _len; ++i) {
+            res ^= _bytes[i];
+            res *= 16777619u;
+        }
+        return res;
+    }
+
+    /**
+     * \brief Метод формирует строку EPC в формате сервера: байты в нижнем регистре через пробел.
+     */
+    std::string toString() const {
+        static const char digits[] = "0123456789abcdef";
+        std::string res;
+        if (_len) {
+            res.resize(_len * 3 - 1, ' ');
+            for (size_t i = 0; i < _len; ++i) {
+                res[i * 3] = digits[_bytes[i] >> 4];
+                res[i * 3 + 1] = digits[_bytes[i] & 0x0f];
+            }
+        }
+        return res;
+    }
+};
+} /// rfid
+} /// robocooler
@@ -0,0 +1,115 @@
+#include <cstring>
+#include <algorithm>
+
+#include "FrameParser.hpp"
+
+
+using namespace robocooler;
+using namespace rfid;
+
+
+bool FrameParser::seekHead() {
+    while (_tail < _head) {
+        size_t off = _tail & RING_MASK;
+        size_t contiguous = std::min(_head - _tail, RFID_RING_SIZE - off);
+        const uint8_t *p = static_cast<const uint8_t*>(memchr(_ring + off, RFID_HEAD, contiguous));
+        if (p) {
+            size_t skip = static_cast<size_t>(p - (_ring + off));
+            _tail += skip;
+            _skipped += skip;
+            return true;
+        }
+        _tail += contiguous;
+        _skipped += contiguous;
+    }
+    return false;
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+FrameParser::FrameParser()
+    : _head(0)
+    , _tail(0)
+    , _skipped(0)
+    , _bad_frames(0)
+{}
+
+
+size_t FrameParser::write(const uint8_t *buf_, size_t len_) {
+    size_t n = std::min(len_, RFID_RING_SIZE - (_head - _tail));
+    size_t off = _head & RING_MASK;
+    size_t first = std::min(n, RFID_RING_SIZE - off);
+    memcpy(_ring + off, buf_, first);
+    if (first < n) {
+        memcpy(_ring, buf_ + first, n - first);
+    }
+    _head += n;
+    return n;
+}
+
+
+bool FrameParser::next(FrameView &frame_) {
+    while (seekHead()) {
+        size_t avail = _head - _tail;
+        if (avail < 2) {
+            return false;
+        }
+        /// Байт заголовка и байт размера не входят в размер блока данных; минимум адрес, команда и сумма.
+        size_t len = at(_tail + 1);
+        if (len < RFID_PACK_MINLEN - 2) {
+            ++_bad_frames;
+            ++_skipped;
+            ++_tail;
+            continue;
+        }
+        size_t size = len + 2;
+        if (avail < size) {
+            return false;
+        }
+        uint8_t sum = RFID_NULL;
+        for (size_t i = 0; i < size - 1; ++i) {
+            sum += at(_tail + i);
+        }
+        if (static_cast<uint8_t>((~sum) + 1) not_eq at(_tail + size - 1)) {
+            /// Ложный заголовок или повреждённый пакет: искать следующий заголовок.
+            ++_bad_frames;
+            ++_skipped;
+            ++_tail;
+            continue;
+        }
+        size_t off = _tail & RING_MASK;
+        const uint8_t *frame = _ring + off;
+        if (RFID_RING_SIZE < off + size) {
+            /// Пакет разорван границей кольца: собрать его в линейный буфер.
+            size_t first = RFID_RING_SIZE - off;
+            memcpy(_scratch, _ring + off, first);
+            memcpy(_scratch + first, _ring, size - first);
+            frame = _scratch;
+        }
+        _tail += size;
+        frame_ = FrameView(frame, size);
+        return true;
+    }
+    return false;
+}
+
+
+void FrameParser::reset() {
+    _head = 0;
+    _tail = 0;
+}
+
+
+size_t FrameParser::size() const {
+    return _head - _tail;
+}
+
+
+size_t FrameParser::getSkipped() const {
+    return _skipped;
+}
+
+
+size_t FrameParser::getBadFrames() const {
+    return _bad_frames;
+}
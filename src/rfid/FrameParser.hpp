@@ -0,0 +1,143 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Разбор потока байт RFID на пакеты в кольцевом буфере фиксированного размера.
+ * \author Величко Ростислав
+ * \date   07.17.2017
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "Message.hpp"
+
+
+static const size_t RFID_FRAME_MAXLEN = 0xff + 2;  ///< Заголовок, байт длины и до 255 байт пакета.
+static const size_t RFID_RING_SIZE = 1024;         ///< Ёмкость кольцевого буфера, степень двойки.
+
+
+namespace robocooler {
+namespace rfid {
+
+
+/**
+ * \brief Невладеющее представление проверенного пакета.
+ *        Действительно до следующего обращения к FrameParser.
+ */
+class FrameView {
+    const uint8_t *_frame; ///< Начало пакета (байт заголовка).
+    size_t _size;          ///< Полный размер пакета вместе с контрольной суммой.
+
+public:
+    FrameView()
+        : _frame(nullptr)
+        , _size(0)
+    {}
+
+    FrameView(const uint8_t *frame_, size_t size_)
+        : _frame(frame_)
+        , _size(size_)
+    {}
+
+    const uint8_t* getFrame() const {
+        return _frame;
+    }
+
+    size_t getSize() const {
+        return _size;
+    }
+
+    const uint8_t* getData() const {
+        return _frame + RFID_DATA_POS;
+    }
+
+    size_t getDataSize() const {
+        return _size - RFID_PACK_MINLEN;
+    }
+
+    uint8_t getPacketType() const {
+        return _frame[0];
+    }
+
+    uint8_t getDataLen() const {
+        return _frame[1];
+    }
+
+    uint8_t getReadId() const {
+        return _frame[2];
+    }
+
+    uint8_t getCmd() const {
+        return _frame[3];
+    }
+
+    uint8_t getErrorCode() const {
+        return _frame[RFID_ERR_CODE_POS];
+    }
+};
+
+
+class FrameParser {
+    static const size_t RING_MASK = RFID_RING_SIZE - 1;
+
+    uint8_t _ring[RFID_RING_SIZE];        ///< Кольцевой буфер принятых байт.
+    uint8_t _scratch[RFID_FRAME_MAXLEN];  ///< Линейная копия пакета, разорванного границей кольца.
+    size_t _head;                         ///< Счётчик записанных байт.
+    size_t _tail;                         ///< Счётчик разобранных байт.
+    size_t _skipped;                      ///< Количество отброшенных байт при поиске заголовка.
+    size_t _bad_frames;                   ///< Количество пакетов с неверной контрольной суммой или длиной.
+
+    uint8_t at(size_t pos_) const {
+        return _ring[pos_ & RING_MASK];
+    }
+
+    /**
+     * \brief Метод сдвигает начало до ближайшего байта заголовка (memchr по непрерывным участкам кольца).
+     * \return true, если заголовок найден.
+     */
+    bool seekHead();
+
+public:
+    FrameParser();
+
+    /**
+     * \brief Метод копирует в кольцо столько байт, сколько в нём свободно.
+     * \return Количество принятых байт.
+     */
+    size_t write(const uint8_t *buf_, size_t len_);
+
+    /**
+     * \brief Метод выделяет следующий полный пакет, проверяя длину и контрольную сумму на месте.
+     * \param frame_  Представление найденного пакета.
+     * \return true, если пакет найден; false, если данных недостаточно.
+     */
+    bool next(FrameView &frame_);
+
+    /**
+     * \brief Метод разбирает блок принятых байт любого размера, вызывая функтор для каждого пакета.
+     * \param on_frame_  Функтор вида void(const FrameView&).
+     */
+    template <class OnFrame>
+    void feed(const uint8_t *buf_, size_t len_, OnFrame &&on_frame_) {
+        FrameView frame;
+        while (len_) {
+            size_t n = write(buf_, len_);
+            buf_ += n;
+            len_ -= n;
+            while (next(frame)) {
+                on_frame_(frame);
+            }
+        }
+    }
+
+    /**
+     * \brief Метод очищает буфер.
+     */
+    void reset();
+
+    size_t size() const;
+    size_t getSkipped() const;
+    size_t getBadFrames() const;
+};
+} /// rfid
+} /// robocooler
@@ -1,3 +1,5 @@
+#include <cstring>
+
 #include "Log.hpp"
 #include "CommandsHandler.hpp"
 #include "Message.hpp"
@@ -10,10 +12,27 @@ typedef Message::Buffer Buffer;
 typedef CommandsHandler CmdHdl; 
 
 
-uint8_t Message::checkSum(const Buffer &btAryBuffer_, int nStartPos_, int nLen_) {
+size_t Message::encode(uint8_t *out_, uint8_t read_id_, uint8_t cmd_, const uint8_t *data_, size_t len_) {
+    if (RFID_MAX_DATA_LEN < len_) {
+        LOG(ERROR) << "Data length " << len_ << " exceeds " << RFID_MAX_DATA_LEN;
+        return 0;
+    }
+    out_[0] = RFID_HEAD;
+    out_[1] = static_cast<uint8_t>(len_ + 3);
+    out_[2] = read_id_;
+    out_[3] = cmd_;
+    if (len_) {
+        memcpy(out_ + RFID_DATA_POS, data_, len_);
+    }
+    out_[len_ + 4] = checkSum(out_, len_ + 4);
+    return len_ + RFID_PACK_MINLEN;
+}
+
+
+uint8_t Message::checkSum(const uint8_t *buf_, size_t len_) {
     uint8_t btSum = RFID_NULL;
-    for (int nloop = nStartPos_; nloop < nStartPos_ + nLen_; nloop++) {
-        btSum += btAryBuffer_[nloop];
+    for (size_t nloop = 0; nloop < len_; ++nloop) {
+        btSum += buf_[nloop];
     }
     return (((~btSum) + 1) & 0xFF);
 }
@@ -21,138 +40,85 @@ uint8_t Message::checkSum(const Buffer &btAryBuffer_, int nStartPos_, int nLen_)
 
 
 Message::Message() 
-    : _btPacketType(RFID_NULL)
-    , _btDataLen(RFID_NULL)  
-    , _btReadId(RFID_NULL)        
-    , _btCmd(RFID_NULL)           
-    , _btCheck(RFID_NULL) {
+    : _size(RFID_PACK_MINLEN) {
+    memset(_btAryTranData, RFID_NULL, RFID_PACK_MINLEN);
+}
+
+
+Message::Message(uint8_t btReadId_, uint8_t btCmd_, const uint8_t *btAryData_, size_t nLen_)
+    : _size(encode(_btAryTranData, btReadId_, btCmd_, btAryData_, nLen_)) {
 }
 
 
 Message::Message(uint8_t btReadId_, uint8_t btCmd_, const Buffer &btAryData_)            
-    : _btPacketType(RFID_HEAD)
-    , _btDataLen(RFID_NULL)  
-    , _btReadId(btReadId_)        
-    , _btCmd(btCmd_)           
-    , _btCheck(RFID_NULL) {
-    size_t len = btAryData_.size();
-    _btDataLen = len + 3;
-    _btAryData = btAryData_;
-    _btAryTranData.resize(len + 5, RFID_NULL);
-    _btAryTranData[0] = _btPacketType;
-    _btAryTranData[1] = _btDataLen;
-    _btAryTranData[2] = _btReadId;
-    _btAryTranData[3] = _btCmd;
-    _btAryTranData.insert(_btAryTranData.begin() + 4, _btAryData.begin(), _btAryData.end());
-    _btCheck = checkSum(_btAryTranData, 0, len + 4);
-    _btAryTranData[len + 4] = _btCheck;
-//    LOG(DEBUG) << CmdHdl::toString(_btPacketType) << " "
-//               << CmdHdl::toString(_btDataLen) << " "
-//               << CmdHdl::toString(_btReadId) << " "
-//               << CmdHdl::toString(_btCmd) << " "
-//               << CmdHdl::toString(_btAryData) << " "
-//               << CmdHdl::toString(_btCheck);
+    : _size(encode(_btAryTranData, btReadId_, btCmd_, btAryData_.data(), btAryData_.size())) {
 }
 
 
 Message::Message(uint8_t btReadId_, uint8_t btCmd_)        
-    : _btPacketType(RFID_HEAD)
-    , _btDataLen(3)  
-    , _btReadId(btReadId_)        
-    , _btCmd(btCmd_)           
-    , _btCheck(RFID_NULL) {
-    _btAryTranData.resize(5, RFID_NULL);
-    _btAryTranData[0] = _btPacketType;
-    _btAryTranData[1] = _btDataLen;
-    _btAryTranData[2] = _btReadId;
-    _btAryTranData[3] = _btCmd;
-    _btCheck = checkSum(_btAryTranData, 0, 4);
-    _btAryTranData[4] = _btCheck;
-//    LOG(DEBUG) << CmdHdl::toString(_btPacketType) << " "
-//               << CmdHdl::toString(_btDataLen) << " "
-//               << CmdHdl::toString(_btReadId) << " "
-//               << CmdHdl::toString(_btCmd) << " "
-//               << CmdHdl::toString(_btAryData) << " "
-//               << CmdHdl::toString(_btCheck);
+    : _size(encode(_btAryTranData, btReadId_, btCmd_)) {
 }
 
 
 Message::Message(const Buffer &btAryTranData_)
-    : _btPacketType(RFID_NULL)
-    , _btDataLen(RFID_NULL)  
-    , _btReadId(RFID_NULL)        
-    , _btCmd(RFID_NULL)           
-    , _btCheck(RFID_NULL) {
+    : _size(0) {
     size_t nLen = btAryTranData_.size();
-    _btAryTranData = btAryTranData_;
-    uint8_t btCK = checkSum(_btAryTranData, 0, nLen - 1);
-    if (btCK not_eq _btAryTranData[nLen - 1]) {
+    if (nLen < RFID_PACK_MINLEN or RFID_MAX_PACK_LEN < nLen or
+        checkSum(btAryTranData_.data(), nLen - 1) not_eq btAryTranData_[nLen - 1]) {
+        memset(_btAryTranData, RFID_NULL, RFID_PACK_MINLEN);
         return;
     }
-    _btPacketType = _btAryTranData[0];
-    _btDataLen = _btAryTranData[1];
-    _btReadId = _btAryTranData[2];
-    _btCmd = _btAryTranData[3];
-    _btCheck = _btAryTranData[nLen - 1];
-    if (nLen > 5) {
-        _btAryData.resize(nLen - 5, RFID_NULL);
-        for (size_t nloop = 0; nloop < nLen - 5; ++nloop) {
-            _btAryData[nloop] = _btAryTranData[nloop + 4];
-        }
-    }
-    //LOG(DEBUG) << CmdHdl::toString(_btPacketType) << " "
-    //           << CmdHdl::toString(_btDataLen) << " "
-    //           << CmdHdl::toString(_btReadId) << " "
-    //           << CmdHdl::toString(_btCmd) << " "
-    //           << CmdHdl::toString(_btAryData) << " "
-    //           << CmdHdl::toString(_btCheck);
-}
-
-
-void Message::setAryData(const Buffer &ary_data_) {
-    _btDataLen = ary_data_.size();
-    _btAryData = ary_data_;
-    _btAryTranData.resize(_btDataLen + 5, RFID_NULL);
-    _btAryTranData[0] = _btPacketType;
-    _btAryTranData[1] = _btDataLen;
-    _btAryTranData[2] = _btReadId;
-    _btAryTranData[3] = _btCmd;
-    for (size_t nloop = 0; nloop < _btDataLen; ++nloop) {
-        _btAryTranData[nloop + 4] = _btAryData[nloop];
-    }
-    _btCheck = checkSum(_btAryTranData, 0, _btDataLen + 4);
-    _btAryTranData[_btDataLen + 4] = _btCheck;
+    memcpy(_btAryTranData, btAryTranData_.data(), nLen);
+    _size = nLen;
 }
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
-const Buffer& Message::getAryTranData() const {
+const uint8_t* Message::getFrame() const {
     return _btAryTranData;
 }
 
 
-const Buffer& Message::getAryData() const {
-    return _btAryData;
+size_t Message::getSize() const {
+    return _size;
+}
+
+
+const uint8_t* Message::getData() const {
+    return _btAryTranData + RFID_DATA_POS;
+}
+
+
+Buffer Message::getAryTranData() const {
+    return Buffer(_btAryTranData, _btAryTranData + _size);
+}
+
+
+Buffer Message::getAryData() const {
+    if (_size <= RFID_PACK_MINLEN) {
+        return Buffer();
+    }
+    return Buffer(_btAryTranData + RFID_DATA_POS, _btAryTranData + _size - 1);
 }
 
 
 uint8_t Message::getDataLen() const {
-    return _btDataLen;
+    return _btAryTranData[1];
 }
 
 
 uint8_t Message::getReadId() const {
-    return _btReadId;
+    return _btAryTranData[2];
 }
 
 
 uint8_t Message::getCmd() const {
-    return _btCmd;
+    return _btAryTranData[3];
 }
 
 
 uint8_t Message::getPacketType() const {
-    return _btPacketType;
+    return _btAryTranData[0];
 }
 
 
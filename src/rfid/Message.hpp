@@ -16,42 +16,58 @@ static const uint8_t RFID_ADDR = 0xff;
 static const size_t RFID_DATA_POS = 4;
 static const size_t RFID_PACK_MINLEN = 5;
 static const size_t RFID_ERR_CODE_POS = RFID_DATA_POS;
+static const size_t RFID_MAX_DATA_LEN = 0xff - 3;  ///< Длина данных при максимальном значении байта длины.
+static const size_t RFID_MAX_PACK_LEN = RFID_MAX_DATA_LEN + RFID_PACK_MINLEN;
 
 
 namespace robocooler {
 namespace rfid {
 
 
+/**
+ * \brief Пакет RFID во встроенном буфере фиксированного размера, без размещения в куче.
+ */
 class Message {
 public:
     typedef std::vector<uint8_t> Buffer;
 
 private:
-    uint8_t _btPacketType; ///< заголовок пакета, по умолчанию 0xA0.
-    uint8_t _btDataLen;    ///< Количество байтов пакета не содержит сами байты длинны.
-    uint8_t _btReadId;     ///< Адрес чтения.
-    uint8_t _btCmd;        ///< Код команды пакета.
-    Buffer _btAryData;     ///< Параметры команды.
-    uint8_t _btCheck;      ///< Контрольная сумма всех байтов.
-    Buffer _btAryTranData; ///< Весь пакет.
+    uint8_t _btAryTranData[RFID_MAX_PACK_LEN]; ///< Весь пакет.
+    size_t _size;                              ///< Фактический размер пакета.
+
+public:
+    /**
+     * \brief Метод кодирует пакет в буфер вызывающего.
+     * \param out_       Буфер не менее RFID_PACK_MINLEN + len_ байт.
+     * \param read_id_   Адрес считывателя.
+     * \param cmd_       Код команды.
+     * \param data_      Параметры команды.
+     * \param len_       Количество байт параметров, не более RFID_MAX_DATA_LEN.
+     * \return Размер пакета; 0, если параметры не помещаются в пакет.
+     */
+    static size_t encode(uint8_t *out_, uint8_t read_id_, uint8_t cmd_, const uint8_t *data_ = nullptr, size_t len_ = 0);
 
-    uint8_t checkSum(const Buffer &btAryBuffer_, int nStartPos_, int nLen_);
+    /**
+     * \brief Метод вычисляет контрольную сумму (дополнение суммы байт до нуля).
+     */
+    static uint8_t checkSum(const uint8_t *buf_, size_t len_);
 
-public:    
     Message();
+    explicit Message(uint8_t read_id_, uint8_t cmd_, const uint8_t *data_, size_t len_);
     explicit Message(uint8_t read_id_, uint8_t cmd_, const Buffer &ary_data_);
     explicit Message(uint8_t read_id_, uint8_t cmd_);
     explicit Message(const Buffer &ary_tran_data_);
 
-    const Buffer& getAryTranData() const;
-    const Buffer& getAryData() const;
+    const uint8_t* getFrame() const;
+    size_t getSize() const;
+    const uint8_t* getData() const;
+    Buffer getAryTranData() const;
+    Buffer getAryData() const;
     uint8_t getDataLen() const;
     uint8_t getReadId() const;
     uint8_t getCmd() const;
     uint8_t getPacketType() const;
     uint8_t getErrorCode() const;
-
-    void setAryData(const Buffer &ary_data_);
 };
 } /// robocooler
 } /// rfid
@@ -0,0 +1,562 @@
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#include "Log.hpp"
+#include "ReaderEmulator.hpp"
+
+
+using namespace robocooler;
+using namespace rfid;
+
+namespace chr = std::chrono;
+
+typedef ReaderEmulator::Clock Clock;
+typedef ReaderEmulator::Cid Cid;
+typedef ReaderEmulator::Ec Ec;
+typedef ReaderEmulator::Buffer Buffer;
+
+
+static const uint8_t RFID_EMU_FIRMWARE_MAJOR = 0x08;
+static const uint8_t RFID_EMU_FIRMWARE_MINOR = 0x01;
+static const uint8_t RFID_EMU_DEFAULT_POWER = 0x1e;
+
+
+void ReaderEmulator::run() {
+    uint8_t buf[256];
+    while (_is_run) {
+        struct pollfd pfd = {_master, POLLIN, 0};
+        if (poll(&pfd, 1, 100) > 0 and (pfd.revents & POLLIN)) {
+            ssize_t len = ::read(_master, buf, sizeof(buf));
+            if (len > 0) {
+                _bytes_in += static_cast<size_t>(len);
+                _parser.feed(buf, static_cast<size_t>(len), [this](const FrameView &frame_) {
+                    onFrame(frame_);
+                });
+            }
+        }
+        struct timespec ts;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+            _cpu_ns = static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+        }
+    }
+}
+
+
+void ReaderEmulator::onFrame(const FrameView &frame_) {
+    ++_frames_in;
+    uint8_t cmd = frame_.getCmd();
+    size_t len = frame_.getDataSize();
+    /// Представление действительно до следующего обращения к разборщику: скопировать параметры.
+    uint8_t data[RFID_MAX_DATA_LEN];
+    memcpy(data, frame_.getData(), len);
+    _addr = frame_.getReadId();
+    switch (static_cast<Cid>(cmd)) {
+        case Cid::cmd_reset: {
+                /// Считыватель перезагружается без ответа.
+                std::unique_lock<std::mutex> lock(_mutex);
+                _buffer.clear();
+                std::fill(_buffer_pos.begin(), _buffer_pos.end(), -1);
+                _work_ant = 0;
+            }
+            break;
+        case Cid::cmd_set_uart_baudrate:
+            replyCode(cmd, Ec::command_success);
+            break;
+        case Cid::cmd_get_firmware_version: {
+                uint8_t version[] = {RFID_EMU_FIRMWARE_MAJOR, RFID_EMU_FIRMWARE_MINOR};
+                reply(cmd, version, sizeof(version));
+            }
+            break;
+        case Cid::cmd_set_work_antenna:
+            if (len and data[0] < RFID_EMU_ANTS_NUM) {
+                _work_ant = data[0];
+                replyCode(cmd, Ec::command_success);
+            } else {
+                replyCode(cmd, Ec::parameter_invalid_AntennaID_out_of_range);
+            }
+            break;
+        case Cid::cmd_get_work_antenna:
+            reply(cmd, &_work_ant, 1);
+            break;
+        case Cid::cmd_set_output_power:
+            for (size_t a = 0; a < RFID_EMU_ANTS_NUM and len; ++a) {
+                _powers[a] = data[std::min(a, len - 1)];
+            }
+            replyCode(cmd, len ? Ec::command_success : Ec::parameter_invalid);
+            break;
+        case Cid::cmd_get_output_power:
+            /// Одинаковая мощность всех антенн передаётся одним байтом.
+            if (std::count(_powers, _powers + RFID_EMU_ANTS_NUM, _powers[0]) == RFID_EMU_ANTS_NUM) {
+                reply(cmd, _powers, 1);
+            } else {
+                reply(cmd, _powers, RFID_EMU_ANTS_NUM);
+            }
+            break;
+        case Cid::cmd_set_frequency_region:
+            if (len >= sizeof(_region)) {
+                memcpy(_region, data, sizeof(_region));
+                replyCode(cmd, Ec::command_success);
+            } else {
+                replyCode(cmd, Ec::parameter_invalid);
+            }
+            break;
+        case Cid::cmd_get_frequency_region:
+            reply(cmd, _region, sizeof(_region));
+            break;
+        case Cid::cmd_inventory:
+            inventoryToBuffer(len ? data[0] : 1);
+            break;
+        case Cid::cmd_real_time_inventory:
+        case Cid::cmd_customized_session_target_inventory: {
+                bool is_session = (static_cast<Cid>(cmd) == Cid::cmd_customized_session_target_inventory);
+                if (is_session and len < 3) {
+                    replyCode(cmd, Ec::parameter_invalid);
+                    break;
+                }
+                if (_sets._read_prob[_work_ant] <= 0.0) {
+                    replyCode(cmd, Ec::antenna_missing_error);
+                    break;
+                }
+                int session = is_session ? static_cast<int>(data[0] % RFID_EMU_SESSIONS_NUM) : -1;
+                uint8_t target = is_session ? data[1] : 0;
+                size_t repeat = is_session ? data[2] : (len ? data[0] : 1);
+                size_t total = streamRounds(cmd, _work_ant, std::max<size_t>(repeat, 1), session, target);
+                streamDone(cmd, _work_ant, total);
+            }
+            break;
+        case Cid::cmd_fast_switch_ant_inventory:
+            fastSwitch(data, len);
+            break;
+        case Cid::cmd_get_inventory_buffer:
+            sendBuffer(cmd, false);
+            break;
+        case Cid::cmd_get_and_reset_inventory_buffer:
+            sendBuffer(cmd, true);
+            break;
+        case Cid::cmd_get_inventory_buffer_tag_count: {
+                std::unique_lock<std::mutex> lock(_mutex);
+                uint8_t count[] = {static_cast<uint8_t>(_buffer.size() >> 8), static_cast<uint8_t>(_buffer.size() & 0xff)};
+                reply(cmd, count, sizeof(count));
+            }
+            break;
+        case Cid::cmd_reset_inventory_buffer: {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _buffer.clear();
+                std::fill(_buffer_pos.begin(), _buffer_pos.end(), -1);
+                replyCode(cmd, Ec::command_success);
+            }
+            break;
+        default:
+            LOG(WARNING) << "Unsupported command: " << Command::cmdToString(static_cast<Cid>(cmd));
+            replyCode(cmd, Ec::command_fail);
+            break;
+    }
+    flush();
+}
+
+
+void ReaderEmulator::reply(uint8_t cmd_, const uint8_t *data_, size_t len_) {
+    uint8_t frame[RFID_MAX_PACK_LEN];
+    size_t size = Message::encode(frame, _addr, cmd_, data_, len_);
+    _out.insert(_out.end(), frame, frame + size);
+    ++_frames_out;
+}
+
+
+void ReaderEmulator::replyCode(uint8_t cmd_, Ec code_) {
+    uint8_t code = static_cast<uint8_t>(code_);
+    reply(cmd_, &code, 1);
+}
+
+
+void ReaderEmulator::flush() {
+    size_t pos = 0;
+    while (pos < _out.size() and _is_run) {
+        size_t len = _sets._bytes_per_sec ? std::min(RFID_EMU_PACE_CHUNK, _out.size() - pos) : _out.size() - pos;
+        ssize_t wlen = ::write(_master, &_out[pos], len);
+        if (wlen <= 0) {
+            if (errno == EAGAIN or errno == EINTR) {
+                /// Клиент не успевает читать: подождать освобождения буфера псевдотерминала.
+                std::this_thread::sleep_for(chr::milliseconds(1));
+                continue;
+            }
+            LOG(ERROR) << "Write error: " << strerror(errno);
+            break;
+        }
+        pos += static_cast<size_t>(wlen);
+        _bytes_out += static_cast<size_t>(wlen);
+        if (_sets._bytes_per_sec) {
+            /// Блок занимает линию на время передачи со скоростью UART.
+            _line_free = std::max(_line_free, Clock::now()) +
+                         chr::microseconds(static_cast<size_t>(wlen) * 1000000 / _sets._bytes_per_sec);
+            std::this_thread::sleep_until(_line_free);
+        }
+    }
+    _out.clear();
+}
+
+
+void ReaderEmulator::spendRound() {
+    /// Ответы цикла передаются по его завершению.
+    flush();
+    if (_sets._round_ms) {
+        std::this_thread::sleep_for(chr::milliseconds(_sets._round_ms));
+    }
+}
+
+
+bool ReaderEmulator::isRead(size_t tag_, uint8_t ant_) {
+    return _tags[tag_]._is_present and _prob(_rnd) < _sets._read_prob[ant_];
+}
+
+
+uint8_t ReaderEmulator::makeRssi() {
+    std::uniform_int_distribution<int> rssi(_sets._rssi_min, std::max(_sets._rssi_min, _sets._rssi_max));
+    return static_cast<uint8_t>(rssi(_rnd) & 0x7f);
+}
+
+
+bool ReaderEmulator::checkSession(Tag &tag_, uint8_t session_, uint8_t target_, const Clock::time_point &now_) {
+    if (session_ == 0) {
+        /// Флаг S0 сбрасывается сразу после цикла: метка всегда в состоянии A.
+        return target_ == static_cast<uint8_t>(Command::ETarget::A);
+    }
+    bool &flag = tag_._flags[session_];
+    if (flag and now_ - tag_._flag_times[session_] > chr::milliseconds(_sets._session_persist_ms)) {
+        flag = false;
+    }
+    if (flag not_eq (target_ == static_cast<uint8_t>(Command::ETarget::B))) {
+        return false;
+    }
+    /// Опрошенная метка меняет флаг и молчит до следующего опроса с противоположным target.
+    flag = not flag;
+    tag_._flag_times[session_] = now_;
+    return true;
+}
+
+
+void ReaderEmulator::inventoryToBuffer(uint8_t repeat_) {
+    uint8_t cmd = static_cast<uint8_t>(Cid::cmd_inventory);
+    if (_sets._read_prob[_work_ant] <= 0.0) {
+        replyCode(cmd, Ec::antenna_missing_error);
+        return;
+    }
+    /// 0xff - один цикл минимальной длительности.
+    size_t rounds = (repeat_ == 0xff or repeat_ == 0) ? 1 : repeat_;
+    uint32_t total = 0;
+    for (size_t r = 0; r < rounds and _is_run; ++r) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (size_t t = 0; t < _tags.size(); ++t) {
+            if (not isRead(t, _work_ant)) {
+                continue;
+            }
+            ++total;
+            if (_buffer_pos[t] < 0) {
+                _buffer_pos[t] = static_cast<int>(_buffer.size());
+                _buffer.push_back(BufferedTag({t, _work_ant, makeRssi(), 0}));
+            }
+            BufferedTag &bt = _buffer[_buffer_pos[t]];
+            bt._ant = _work_ant;
+            bt._count = static_cast<uint8_t>(std::min(bt._count + 1, 0xff));
+        }
+    }
+    if (_sets._round_ms) {
+        std::this_thread::sleep_for(chr::milliseconds(_sets._round_ms * rounds));
+    }
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_buffer.empty()) {
+        replyCode(cmd, Ec::no_tag_error);
+        return;
+    }
+    uint16_t tag_count = static_cast<uint16_t>(_buffer.size());
+    uint16_t read_rate = static_cast<uint16_t>(_sets._round_ms ? total * 1000 / (_sets._round_ms * rounds) : total);
+    uint8_t data[] = {
+        _work_ant,
+        static_cast<uint8_t>(tag_count >> 8), static_cast<uint8_t>(tag_count & 0xff),
+        static_cast<uint8_t>(read_rate >> 8), static_cast<uint8_t>(read_rate & 0xff),
+        static_cast<uint8_t>(total >> 24), static_cast<uint8_t>((total >> 16) & 0xff),
+        static_cast<uint8_t>((total >> 8) & 0xff), static_cast<uint8_t>(total & 0xff)
+    };
+    reply(cmd, data, sizeof(data));
+}
+
+
+void ReaderEmulator::sendBuffer(uint8_t cmd_, bool is_reset_) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_buffer.empty()) {
+        replyCode(cmd_, Ec::buffer_is_empty_error);
+        return;
+    }
+    uint16_t tag_count = static_cast<uint16_t>(_buffer.size());
+    for (const BufferedTag &bt : _buffer) {
+        const Tag &tag = _tags[bt._tag];
+        uint16_t crc = static_cast<uint16_t>(tag._epc.hash());
+        /// TagCount, DataLen, PC, EPC, CRC, RSSI, FreqAnt, InvCount.
+        uint8_t data[RFID_MAX_DATA_LEN];
+        size_t n = 0;
+        data[n++] = static_cast<uint8_t>(tag_count >> 8);
+        data[n++] = static_cast<uint8_t>(tag_count & 0xff);
+        data[n++] = static_cast<uint8_t>(tag._epc._len + 4);
+        data[n++] = static_cast<uint8_t>(tag._pc >> 8);
+        data[n++] = static_cast<uint8_t>(tag._pc & 0xff);
+        memcpy(&data[n], tag._epc._bytes, tag._epc._len);
+        n += tag._epc._len;
+        data[n++] = static_cast<uint8_t>(crc >> 8);
+        data[n++] = static_cast<uint8_t>(crc & 0xff);
+        data[n++] = bt._rssi;
+        data[n++] = static_cast<uint8_t>((_region[1] << 2) | bt._ant);
+        data[n++] = bt._count;
+        reply(cmd_, data, n);
+        ++_tags_out;
+    }
+    if (is_reset_) {
+        _buffer.clear();
+        std::fill(_buffer_pos.begin(), _buffer_pos.end(), -1);
+    }
+}
+
+
+size_t ReaderEmulator::streamRounds(uint8_t cmd_, uint8_t ant_, size_t rounds_, int session_, uint8_t target_) {
+    size_t total = 0;
+    for (size_t r = 0; r < rounds_ and _is_run; ++r) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            Clock::time_point now = Clock::now();
+            for (size_t t = 0; t < _tags.size(); ++t) {
+                if (not isRead(t, ant_)) {
+                    continue;
+                }
+                if (session_ >= 0 and not checkSession(_tags[t], static_cast<uint8_t>(session_), target_, now)) {
+                    continue;
+                }
+                /// FreqAnt, PC, EPC, RSSI.
+                const Tag &tag = _tags[t];
+                uint8_t data[RFID_MAX_DATA_LEN];
+                size_t n = 0;
+                data[n++] = static_cast<uint8_t>((_region[1] << 2) | ant_);
+                data[n++] = static_cast<uint8_t>(tag._pc >> 8);
+                data[n++] = static_cast<uint8_t>(tag._pc & 0xff);
+                memcpy(&data[n], tag._epc._bytes, tag._epc._len);
+                n += tag._epc._len;
+                data[n++] = makeRssi();
+                reply(cmd_, data, n);
+                ++_tags_out;
+                ++total;
+            }
+        }
+        spendRound();
+    }
+    return total;
+}
+
+
+void ReaderEmulator::streamDone(uint8_t cmd_, uint8_t ant_, size_t total_) {
+    /// AntID, ReadRate, TotalRead.
+    uint16_t read_rate = static_cast<uint16_t>(std::min<size_t>(total_, 0xffff));
+    uint8_t data[] = {
+        ant_,
+        static_cast<uint8_t>(read_rate >> 8), static_cast<uint8_t>(read_rate & 0xff),
+        static_cast<uint8_t>(total_ >> 24), static_cast<uint8_t>((total_ >> 16) & 0xff),
+        static_cast<uint8_t>((total_ >> 8) & 0xff), static_cast<uint8_t>(total_ & 0xff)
+    };
+    reply(cmd_, data, sizeof(data));
+}
+
+
+void ReaderEmulator::fastSwitch(const uint8_t *data_, size_t len_) {
+    uint8_t cmd = static_cast<uint8_t>(Cid::cmd_fast_switch_ant_inventory);
+    if (len_ < RFID_EMU_ANTS_NUM * 2 + 2) {
+        replyCode(cmd, Ec::parameter_invalid);
+        return;
+    }
+    Clock::time_point start = Clock::now();
+    size_t total = 0;
+    size_t repeat = std::max<uint8_t>(data_[RFID_EMU_ANTS_NUM * 2 + 1], 1);
+    for (size_t r = 0; r < repeat and _is_run; ++r) {
+        for (size_t a = 0; a < RFID_EMU_ANTS_NUM; ++a) {
+            uint8_t ant = data_[a * 2];
+            if (ant >= RFID_EMU_ANTS_NUM) {
+                continue;
+            }
+            if (_sets._read_prob[ant] <= 0.0) {
+                /// Неподключенная антенна: AntId, ErrorCode; опрос продолжается.
+                uint8_t missing[] = {ant, static_cast<uint8_t>(Ec::antenna_missing_error)};
+                reply(cmd, missing, sizeof(missing));
+                continue;
+            }
+            total += streamRounds(cmd, ant, std::max<uint8_t>(data_[a * 2 + 1], 1), -1, 0);
+        }
+    }
+    /// TotalRead (3 байта), CommandDuration (4 байта).
+    uint32_t duration = static_cast<uint32_t>(chr::duration_cast<chr::milliseconds>(Clock::now() - start).count());
+    uint8_t done[] = {
+        static_cast<uint8_t>((total >> 16) & 0xff), static_cast<uint8_t>((total >> 8) & 0xff),
+        static_cast<uint8_t>(total & 0xff),
+        static_cast<uint8_t>(duration >> 24), static_cast<uint8_t>((duration >> 16) & 0xff),
+        static_cast<uint8_t>((duration >> 8) & 0xff), static_cast<uint8_t>(duration & 0xff)
+    };
+    reply(cmd, done, sizeof(done));
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+ReaderEmulator::Settings ReaderEmulator::defaultSettings() {
+    Settings sets;
+    sets._tags_num = 100;
+    sets._epc_len = 12;
+    for (size_t a = 0; a < RFID_EMU_ANTS_NUM; ++a) {
+        sets._read_prob[a] = 0.9;
+    }
+    sets._rssi_min = 0x30;
+    sets._rssi_max = 0x50;
+    sets._bytes_per_sec = RFID_EMU_BYTES_PER_SEC;
+    sets._round_ms = RFID_EMU_ROUND_MS;
+    sets._session_persist_ms = RFID_EMU_SESSION_PERSIST;
+    sets._seed = 1;
+    return sets;
+}
+
+
+ReaderEmulator::ReaderEmulator(const Settings &sets_)
+    : _sets(sets_)
+    , _rnd(sets_._seed)
+    , _prob(0.0, 1.0)
+    , _master(-1)
+    , _slave(-1)
+    , _is_run(false)
+    , _addr(RFID_ADDR)
+    , _work_ant(0)
+    , _line_free(Clock::now())
+    , _frames_in(0)
+    , _frames_out(0)
+    , _tags_out(0)
+    , _bytes_in(0)
+    , _bytes_out(0)
+    , _cpu_ns(0) {
+    std::fill(_powers, _powers + RFID_EMU_ANTS_NUM, RFID_EMU_DEFAULT_POWER);
+    _region[0] = static_cast<uint8_t>(Command::ESpektrumRegion::ETSI);
+    _region[1] = 0x00;
+    _region[2] = 0x06;
+    /// Метки с последовательными номерами в младших байтах EPC.
+    _sets._epc_len = std::max<size_t>(std::min(_sets._epc_len, RFID_EPC_MAXLEN), 4);
+    _tags.resize(_sets._tags_num);
+    for (size_t t = 0; t < _tags.size(); ++t) {
+        uint8_t epc[RFID_EPC_MAXLEN] = {0xe2, 0x00};
+        for (size_t i = 0; i < 4; ++i) {
+            epc[_sets._epc_len - 1 - i] = static_cast<uint8_t>((t >> (i * 8)) & 0xff);
+        }
+        Tag &tag = _tags[t];
+        tag._epc.assign(epc, _sets._epc_len);
+        tag._pc = static_cast<uint16_t>((_sets._epc_len / 2) << 11);
+        tag._is_present = true;
+        std::fill(tag._flags, tag._flags + RFID_EMU_SESSIONS_NUM, false);
+    }
+    _buffer_pos.assign(_tags.size(), -1);
+
+    _master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (_master < 0 or grantpt(_master) not_eq 0 or unlockpt(_master) not_eq 0) {
+        _what = std::string("Can`t open pseudo terminal: ") + strerror(errno);
+        return;
+    }
+    _slave_name = ptsname(_master);
+    /// Ведомая сторона удерживается открытой: без клиента ведущая сторона не получает HUP.
+    _slave = open(_slave_name.c_str(), O_RDWR | O_NOCTTY);
+    if (_slave < 0) {
+        _what = std::string("Can`t open ") + _slave_name + ": " + strerror(errno);
+        return;
+    }
+    struct termios tty;
+    if (tcgetattr(_slave, &tty) == 0) {
+        cfmakeraw(&tty);
+        tcsetattr(_slave, TCSANOW, &tty);
+    }
+    _is_run = true;
+    _thread = std::thread(&ReaderEmulator::run, this);
+}
+
+
+ReaderEmulator::~ReaderEmulator() {
+    _is_run = false;
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+    if (_slave >= 0) {
+        close(_slave);
+    }
+    if (_master >= 0) {
+        close(_master);
+    }
+}
+
+
+bool ReaderEmulator::isInit() const {
+    return _is_run;
+}
+
+
+std::string ReaderEmulator::what() const {
+    return _what;
+}
+
+
+std::string ReaderEmulator::getSlaveName() const {
+    return _slave_name;
+}
+
+
+void ReaderEmulator::setPresent(size_t tag_, bool is_present_) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (tag_ < _tags.size()) {
+        _tags[tag_]._is_present = is_present_;
+    }
+}
+
+
+Epc ReaderEmulator::getEpc(size_t tag_) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return tag_ < _tags.size() ? _tags[tag_]._epc : Epc();
+}
+
+
+size_t ReaderEmulator::getTagsNum() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _tags.size();
+}
+
+
+size_t ReaderEmulator::getFramesIn() const {
+    return _frames_in;
+}
+
+
+size_t ReaderEmulator::getFramesOut() const {
+    return _frames_out;
+}
+
+
+size_t ReaderEmulator::getTagsOut() const {
+    return _tags_out;
+}
+
+
+size_t ReaderEmulator::getBytesIn() const {
+    return _bytes_in;
+}
+
+
+size_t ReaderEmulator::getBytesOut() const {
+    return _bytes_out;
+}
+
+
+double ReaderEmulator::getCpuTime() const {
+    return static_cast<double>(_cpu_ns) / 1e9;
+}
@@ -0,0 +1,185 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Эмулятор RFID считывателя на псевдотерминале для замеров и проверки драйвера без оборудования.
+ * \author Величко Ростислав
+ * \date   07.17.2017
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <chrono>
+
+#include "Epc.hpp"
+#include "Message.hpp"
+#include "FrameParser.hpp"
+#include "Commands.hpp"
+
+
+static const size_t RFID_EMU_ANTS_NUM = 4;             ///< Количество антенн считывателя.
+static const size_t RFID_EMU_SESSIONS_NUM = 4;         ///< Количество сессий Gen2: S0..S3.
+static const size_t RFID_EMU_BYTES_PER_SEC = 11520;    ///< 115200 бод, 10 бит на байт.
+static const size_t RFID_EMU_ROUND_MS = 20;            ///< Длительность одного цикла инвенторизации на антенне [мс].
+static const size_t RFID_EMU_SESSION_PERSIST = 2000;   ///< Время сохранения флага сессий S1..S3 [мс].
+static const size_t RFID_EMU_PACE_CHUNK = 64;          ///< Размер блока записи при эмуляции скорости UART.
+
+
+namespace robocooler {
+namespace rfid {
+
+
+/**
+ * \brief Эмулятор считывателя: открывает псевдотерминал и отвечает на пакеты протокола Message/Command.
+ *        Поддерживаются версия прошивки, антенна, мощность, регион, инвенторизация в буфер и выгрузка буфера,
+ *        потоковая инвенторизация (0x89), быстрое переключение антенн (0x8A) и опрос по сессии (0x8B).
+ *        Каждая метка считывается в цикле антенны с заданной вероятностью, ответы передаются со скоростью UART.
+ */
+class ReaderEmulator {
+public:
+    typedef std::chrono::steady_clock Clock;
+    typedef Command::ECommandId Cid;
+    typedef Command::EErrorCode Ec;
+    typedef Message::Buffer Buffer;
+
+    struct Settings {
+        size_t _tags_num;                       ///< Количество меток в шкафу.
+        size_t _epc_len;                        ///< Длина EPC [байт].
+        double _read_prob[RFID_EMU_ANTS_NUM];   ///< Вероятность считывания метки за цикл на антенне, 0 - антенна не подключена.
+        uint8_t _rssi_min;                      ///< Нижняя граница RSSI.
+        uint8_t _rssi_max;                      ///< Верхняя граница RSSI.
+        size_t _bytes_per_sec;                  ///< Скорость передачи ответов, 0 - без ограничения.
+        size_t _round_ms;                       ///< Длительность цикла инвенторизации на антенне [мс].
+        size_t _session_persist_ms;             ///< Время сохранения флага сессий S1..S3 [мс].
+        uint32_t _seed;                         ///< Начальное значение генератора случайных чисел.
+    };
+
+    /**
+     * \brief Метод возвращает настройки по умолчанию: 100 меток, 4 антенны, 115200 бод.
+     */
+    static Settings defaultSettings();
+
+private:
+    struct Tag {
+        Epc _epc;                                              ///< EPC метки.
+        uint16_t _pc;                                          ///< PC слово.
+        bool _is_present;                                      ///< Метка в шкафу.
+        bool _flags[RFID_EMU_SESSIONS_NUM];                    ///< Флаги сессий S0..S3: false - A, true - B.
+        Clock::time_point _flag_times[RFID_EMU_SESSIONS_NUM];  ///< Время последней смены флага сессии.
+    };
+
+    struct BufferedTag {
+        size_t _tag;       ///< Номер метки.
+        uint8_t _ant;      ///< Антенна последнего считывания.
+        uint8_t _rssi;     ///< Уровень сигнала.
+        uint8_t _count;    ///< Количество считываний.
+    };
+
+    std::mutex _mutex;
+    Settings _sets;
+    std::vector<Tag> _tags;                ///< Метки шкафа.
+    std::vector<BufferedTag> _buffer;      ///< Буфер инвенторизации считывателя.
+    std::vector<int> _buffer_pos;          ///< Положение метки в буфере, -1 - нет.
+    std::mt19937 _rnd;
+    std::uniform_real_distribution<double> _prob;
+
+    int _master;                ///< Ведущая сторона псевдотерминала.
+    int _slave;                 ///< Ведомая сторона, удерживается открытой для работы без клиента.
+    std::string _slave_name;    ///< Путь к ведомой стороне для драйвера.
+    std::string _what;          ///< Сообщение об ошибке открытия.
+    std::atomic_bool _is_run;
+    std::thread _thread;
+    FrameParser _parser;
+
+    uint8_t _addr;                           ///< Адрес считывателя из последнего запроса.
+    uint8_t _work_ant;                       ///< Текущая рабочая антенна.
+    uint8_t _powers[RFID_EMU_ANTS_NUM];      ///< Мощность антенн [дБм].
+    uint8_t _region[3];                      ///< Регион, начальная и конечная частота.
+
+    Buffer _out;                             ///< Ответы, ожидающие передачи.
+    Clock::time_point _line_free;            ///< Момент освобождения линии после передачи.
+    std::atomic<size_t> _frames_in;          ///< Принято запросов.
+    std::atomic<size_t> _frames_out;         ///< Передано пакетов.
+    std::atomic<size_t> _tags_out;           ///< Передано пакетов меток.
+    std::atomic<size_t> _bytes_in;           ///< Принято байт.
+    std::atomic<size_t> _bytes_out;          ///< Передано байт.
+    std::atomic<uint64_t> _cpu_ns;           ///< Процессорное время потока эмулятора [нс].
+
+    void run();
+    void onFrame(const FrameView &frame_);
+
+    /**
+     * \brief Метод добавляет пакет ответа в очередь передачи.
+     */
+    void reply(uint8_t cmd_, const uint8_t *data_, size_t len_);
+    void replyCode(uint8_t cmd_, Ec code_);
+
+    /**
+     * \brief Метод передаёт накопленные ответы блоками, выдерживая скорость UART.
+     */
+    void flush();
+
+    /**
+     * \brief Метод выдерживает длительность цикла инвенторизации.
+     */
+    void spendRound();
+
+    bool isRead(size_t tag_, uint8_t ant_);
+    uint8_t makeRssi();
+
+    /**
+     * \brief Метод проверяет и обновляет флаг сессии: метка отвечает, если флаг совпадает с target_.
+     */
+    bool checkSession(Tag &tag_, uint8_t session_, uint8_t target_, const Clock::time_point &now_);
+
+    void inventoryToBuffer(uint8_t repeat_);
+    void sendBuffer(uint8_t cmd_, bool is_reset_);
+
+    /**
+     * \brief Метод выполняет циклы потоковой инвенторизации на антенне.
+     * \param session_  Сессия 0..3 или -1 для опроса без флагов.
+     * \return Количество переданных меток.
+     */
+    size_t streamRounds(uint8_t cmd_, uint8_t ant_, size_t rounds_, int session_, uint8_t target_);
+    void streamDone(uint8_t cmd_, uint8_t ant_, size_t total_);
+
+    void fastSwitch(const uint8_t *data_, size_t len_);
+
+public:
+    explicit ReaderEmulator(const Settings &sets_ = defaultSettings());
+    virtual ~ReaderEmulator();
+
+    bool isInit() const;
+    std::string what() const;
+
+    /**
+     * \brief Метод возвращает путь к ведомой стороне псевдотерминала для открытия драйвером.
+     */
+    std::string getSlaveName() const;
+
+    /**
+     * \brief Метод изымает метку из шкафа или возвращает её.
+     */
+    void setPresent(size_t tag_, bool is_present_);
+
+    Epc getEpc(size_t tag_);
+    size_t getTagsNum();
+
+    size_t getFramesIn() const;
+    size_t getFramesOut() const;
+    size_t getTagsOut() const;
+    size_t getBytesIn() const;
+    size_t getBytesOut() const;
+
+    /**
+     * \brief Метод возвращает процессорное время потока эмулятора [с] для исключения его из замеров драйвера.
+     */
+    double getCpuTime() const;
+};
+} /// rfid
+} /// robocooler
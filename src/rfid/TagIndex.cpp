@@ -0,0 +1,161 @@
+#include <algorithm>
+
+#include "TagIndex.hpp"
+
+
+using namespace robocooler;
+using namespace rfid;
+
+
+size_t TagIndex::lookup(const Epc &epc_) const {
+    size_t pos = epc_.hash() & _mask;
+    while (_slots[pos] and _epcs[_slots[pos] - 1] not_eq epc_) {
+        pos = (pos + 1) & _mask;
+    }
+    return pos;
+}
+
+
+void TagIndex::grow() {
+    Slots old(_slots.size() * 2, 0);
+    old.swap(_slots);
+    _mask = _slots.size() - 1;
+    for (uint32_t slot : old) {
+        if (slot) {
+            _slots[lookup(_epcs[slot - 1])] = slot;
+        }
+    }
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+TagIndex::TagIndex(size_t capacity_) {
+    size_t capacity = 2;
+    while (capacity < capacity_) {
+        capacity <<= 1;
+    }
+    _slots.resize(capacity, 0);
+    _mask = capacity - 1;
+}
+
+
+uint32_t TagIndex::intern(const Epc &epc_) {
+    size_t pos = lookup(epc_);
+    if (_slots[pos]) {
+        return _slots[pos] - 1;
+    }
+    /// Заполнение не более половины: короткие цепочки пробирования.
+    if ((_epcs.size() + 1) * 2 > _slots.size()) {
+        grow();
+        pos = lookup(epc_);
+    }
+    _epcs.push_back(epc_);
+    _slots[pos] = static_cast<uint32_t>(_epcs.size());
+    return static_cast<uint32_t>(_epcs.size() - 1);
+}
+
+
+bool TagIndex::find(const Epc &epc_, uint32_t &id_) const {
+    uint32_t slot = _slots[lookup(epc_)];
+    if (slot) {
+        id_ = slot - 1;
+    }
+    return slot not_eq 0;
+}
+
+
+void TagIndex::compact(const TagSet &live_, TagRemap &remap_) {
+    remap_.assign(_epcs.size(), RFID_TAG_ID_NONE);
+    Epcs epcs;
+    epcs.reserve(live_.size());
+    live_.forEach([this, &epcs, &remap_](uint32_t id_) {
+        if (id_ < _epcs.size()) {
+            remap_[id_] = static_cast<uint32_t>(epcs.size());
+            epcs.push_back(_epcs[id_]);
+        }
+    });
+    _epcs.swap(epcs);
+    /// Ёмкость хеш-таблицы сохраняется: повторный рост не нужен.
+    std::fill(_slots.begin(), _slots.end(), 0);
+    for (size_t id = 0; id < _epcs.size(); ++id) {
+        _slots[lookup(_epcs[id])] = static_cast<uint32_t>(id + 1);
+    }
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+bool TagSet::insert(uint32_t id_) {
+    size_t w = id_ >> 6;
+    if (w >= _words.size()) {
+        _words.resize(w + 1, 0);
+    }
+    uint64_t bit = uint64_t(1) << (id_ & 63);
+    if (_words[w] & bit) {
+        return false;
+    }
+    _words[w] |= bit;
+    ++_count;
+    return true;
+}
+
+
+void TagSet::clear() {
+    std::fill(_words.begin(), _words.end(), 0);
+    _count = 0;
+}
+
+
+void TagSet::merge(const TagSet &set_) {
+    if (_words.size() < set_._words.size()) {
+        _words.resize(set_._words.size(), 0);
+    }
+    size_t count = 0;
+    for (size_t w = 0; w < _words.size(); ++w) {
+        if (w < set_._words.size()) {
+            _words[w] |= set_._words[w];
+        }
+        count += __builtin_popcountll(_words[w]);
+    }
+    _count = count;
+}
+
+
+void TagSet::remap(const TagRemap &remap_) {
+    Words words;
+    size_t count = 0;
+    forEach([&remap_, &words, &count](uint32_t id_) {
+        uint32_t id = id_ < remap_.size() ? remap_[id_] : RFID_TAG_ID_NONE;
+        if (id not_eq RFID_TAG_ID_NONE) {
+            size_t w = id >> 6;
+            if (w >= words.size()) {
+                words.resize(w + 1, 0);
+            }
+            words[w] |= uint64_t(1) << (id & 63);
+            ++count;
+        }
+    });
+    /// Маска укорачивается до сжатого индекса: разности снова считаются по числу живых меток.
+    _words.swap(words);
+    _count = count;
+}
+
+
+void TagSet::difference(const TagSet &a_, const TagSet &b_, TagSet &out_) {
+    size_t size = a_._words.size();
+    size_t common = std::min(size, b_._words.size());
+    out_._words.resize(size);
+    const uint64_t *a = a_._words.data();
+    const uint64_t *b = b_._words.data();
+    uint64_t *out = out_._words.data();
+    size_t count = 0;
+    /// Простой цикл по словам без ветвлений компилятор векторизует.
+    for (size_t w = 0; w < common; ++w) {
+        out[w] = a[w] & ~b[w];
+        count += __builtin_popcountll(out[w]);
+    }
+    for (size_t w = common; w < size; ++w) {
+        out[w] = a[w];
+        count += __builtin_popcountll(out[w]);
+    }
+    out_._count = count;
+}
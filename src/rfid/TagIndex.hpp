@@ -0,0 +1,157 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Плотные идентификаторы меток и наборы меток в виде битовых масок для сравнения циклов опроса.
+ * \author Величко Ростислав
+ * \date   07.17.2017
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+#include "Epc.hpp"
+#include "TagTable.hpp"
+
+
+static const uint32_t RFID_TAG_ID_NONE = 0xffffffff;  ///< Идентификатор освобождён при сжатии индекса.
+static const size_t RFID_TAG_INDEX_COMPACT_RATIO = 4; ///< Индекс сжимается, когда живых меток меньше 1/N идентификаторов.
+
+
+namespace robocooler {
+namespace rfid {
+
+class TagSet;
+
+/**
+ * \brief Новый идентификатор по прежнему после сжатия индекса.
+ */
+typedef std::vector<uint32_t> TagRemap;
+
+
+/**
+ * \brief Отображение EPC в плотные идентификаторы 0, 1, 2...
+ *        Идентификатор назначается при первом появлении метки. Метки, ушедшие из шкафа, освобождаются
+ *        сжатием индекса, иначе индекс и наборы росли бы с каждой когда либо прочитанной меткой.
+ */
+class TagIndex {
+    typedef std::vector<Epc> Epcs;
+    typedef std::vector<uint32_t> Slots;
+
+    Epcs _epcs;    ///< EPC по идентификатору.
+    Slots _slots;  ///< Хеш-таблица: идентификатор + 1, 0 - свободный слот.
+    size_t _mask;  ///< Маска индекса: ёмкость - 1.
+
+    /**
+     * \brief Метод возвращает слот с ключом epc_ или первый свободный слот на пути пробирования.
+     */
+    size_t lookup(const Epc &epc_) const;
+
+    void grow();
+
+public:
+    explicit TagIndex(size_t capacity_ = RFID_TAG_TABLE_CAPACITY);
+
+    /**
+     * \brief Метод возвращает идентификатор метки, назначая новый при первом появлении.
+     */
+    uint32_t intern(const Epc &epc_);
+
+    /**
+     * \brief Метод ищет идентификатор метки без назначения нового.
+     * \return false, если метка не встречалась.
+     */
+    bool find(const Epc &epc_, uint32_t &id_) const;
+
+    /**
+     * \brief Метод освобождает идентификаторы меток, которых нет в live_.
+     *        Оставшиеся метки получают идентификаторы 0, 1, 2... в прежнем порядке.
+     * \param remap_ Новый идентификатор по прежнему, RFID_TAG_ID_NONE - идентификатор освобождён.
+     *        Все наборы TagSet по этому индексу переводятся методом TagSet::remap.
+     */
+    void compact(const TagSet &live_, TagRemap &remap_);
+
+    const Epc& epc(uint32_t id_) const {
+        return _epcs[id_];
+    }
+
+    size_t size() const {
+        return _epcs.size();
+    }
+};
+
+
+/**
+ * \brief Набор меток - битовая маска по идентификаторам TagIndex.
+ *        Разность наборов вычисляется по словам, очистка и присваивание не выделяют память
+ *        после того, как маска выросла до количества известных меток.
+ */
+class TagSet {
+    typedef std::vector<uint64_t> Words;
+
+    Words _words;   ///< Биты присутствия меток.
+    size_t _count;  ///< Количество установленных битов.
+
+public:
+    TagSet()
+        : _count(0)
+    {}
+
+    /**
+     * \brief Метод добавляет метку в набор.
+     * \return true, если метки в наборе не было.
+     */
+    bool insert(uint32_t id_);
+
+    bool contains(uint32_t id_) const {
+        size_t w = id_ >> 6;
+        return w < _words.size() and (_words[w] >> (id_ & 63)) & 1;
+    }
+
+    void clear();
+
+    /**
+     * \brief Метод добавляет в набор все метки set_.
+     */
+    void merge(const TagSet &set_);
+
+    /**
+     * \brief Метод переводит набор на идентификаторы сжатого индекса, освобождённые метки исключаются.
+     */
+    void remap(const TagRemap &remap_);
+
+    void swap(TagSet &set_) {
+        _words.swap(set_._words);
+        std::swap(_count, set_._count);
+    }
+
+    size_t size() const {
+        return _count;
+    }
+
+    bool empty() const {
+        return 0 == _count;
+    }
+
+    /**
+     * \brief Метод вычисляет out_ = a_ \ b_ (метки из a_, которых нет в b_).
+     */
+    static void difference(const TagSet &a_, const TagSet &b_, TagSet &out_);
+
+    /**
+     * \brief Метод вызывает func_ для идентификатора каждой метки набора в порядке возрастания.
+     */
+    template<class Func>
+    void forEach(Func &&func_) const {
+        for (size_t w = 0; w < _words.size(); ++w) {
+            uint64_t word = _words[w];
+            while (word) {
+                func_(static_cast<uint32_t>((w << 6) + __builtin_ctzll(word)));
+                word &= word - 1;
+            }
+        }
+    }
+};
+} /// rfid
+} /// robocooler
@@ -0,0 +1,82 @@
+#include "TagTable.hpp"
+
+
+using namespace robocooler;
+using namespace rfid;
+
+
+size_t TagTable::lookup(const Epc &epc_) const {
+    size_t pos = epc_.hash() & _mask;
+    while (_slots[pos]._is_used and _slots[pos]._rec._epc not_eq epc_) {
+        pos = (pos + 1) & _mask;
+    }
+    return pos;
+}
+
+
+void TagTable::grow() {
+    Slots old(_slots.size() * 2);
+    old.swap(_slots);
+    _mask = _slots.size() - 1;
+    for (const Slot &slot : old) {
+        if (slot._is_used) {
+            _slots[lookup(slot._rec._epc)] = slot;
+        }
+    }
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+TagTable::TagTable(size_t capacity_)
+    : _size(0) {
+    size_t capacity = 2;
+    while (capacity < capacity_) {
+        capacity <<= 1;
+    }
+    _slots.resize(capacity);
+    _mask = capacity - 1;
+}
+
+
+TagRecord* TagTable::find(const Epc &epc_) {
+    Slot &slot = _slots[lookup(epc_)];
+    return slot._is_used ? &slot._rec : nullptr;
+}
+
+
+const TagRecord* TagTable::find(const Epc &epc_) const {
+    const Slot &slot = _slots[lookup(epc_)];
+    return slot._is_used ? &slot._rec : nullptr;
+}
+
+
+bool TagTable::contains(const Epc &epc_) const {
+    return _slots[lookup(epc_)]._is_used;
+}
+
+
+std::pair<TagRecord*, bool> TagTable::insert(const TagRecord &rec_) {
+    size_t pos = lookup(rec_._epc);
+    if (_slots[pos]._is_used) {
+        return std::make_pair(&_slots[pos]._rec, false);
+    }
+    /// Заполнение не более половины: короткие цепочки пробирования.
+    if ((_size + 1) * 2 > _slots.size()) {
+        grow();
+        pos = lookup(rec_._epc);
+    }
+    _slots[pos]._rec = rec_;
+    _slots[pos]._is_used = true;
+    ++_size;
+    return std::make_pair(&_slots[pos]._rec, true);
+}
+
+
+void TagTable::clear() {
+    if (_size) {
+        for (Slot &slot : _slots) {
+            slot._is_used = false;
+        }
+        _size = 0;
+    }
+}
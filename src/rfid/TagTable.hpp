@@ -0,0 +1,107 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Хранилище меток с ключом по двоичному EPC в плоской хеш-таблице с открытой адресацией.
+ * \author Величко Ростислав
+ * \date   07.17.2017
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+#include "Epc.hpp"
+
+
+static const size_t RFID_TAG_TABLE_CAPACITY = 256; ///< Начальная ёмкость таблицы меток, степень двойки.
+
+
+namespace robocooler {
+namespace rfid {
+
+
+/**
+ * \brief Запись о метке без размещения в куче.
+ */
+struct TagRecord {
+    Epc _epc;              ///< Двоичный EPC - ключ записи.
+    uint16_t _pc;          ///< Protocol Control слово метки.
+    uint8_t _ant_id;       ///< Антенна последнего считывания.
+    uint8_t _rssi;         ///< Уровень сигнала последнего считывания.
+    uint32_t _readed_num;  ///< Количество считываний метки.
+};
+
+
+/**
+ * \brief Таблица меток с линейным пробированием.
+ *        Ёмкость - степень двойки, заполнение не превышает половины, записи хранятся в одном массиве.
+ *        Очистка сохраняет выделенную память, копирование - одно копирование массива.
+ *        Порядок обхода определяется хешем EPC, а не порядком добавления.
+ */
+class TagTable {
+    struct Slot {
+        TagRecord _rec;  ///< Запись метки.
+        bool _is_used;   ///< Слот занят.
+    };
+    typedef std::vector<Slot> Slots;
+
+    Slots _slots;  ///< Слоты таблицы.
+    size_t _size;  ///< Количество занятых слотов.
+    size_t _mask;  ///< Маска индекса: ёмкость - 1.
+
+    /**
+     * \brief Метод возвращает слот с ключом epc_ или первый свободный слот на пути пробирования.
+     */
+    size_t lookup(const Epc &epc_) const;
+
+    /**
+     * \brief Метод удваивает ёмкость и переразмещает записи.
+     */
+    void grow();
+
+public:
+    explicit TagTable(size_t capacity_ = RFID_TAG_TABLE_CAPACITY);
+
+    /**
+     * \brief Метод возвращает запись метки или nullptr, если метки нет.
+     */
+    TagRecord* find(const Epc &epc_);
+    const TagRecord* find(const Epc &epc_) const;
+
+    bool contains(const Epc &epc_) const;
+
+    /**
+     * \brief Метод добавляет запись, если метки с таким EPC ещё нет.
+     * \return Запись в таблице и признак добавления.
+     */
+    std::pair<TagRecord*, bool> insert(const TagRecord &rec_);
+
+    void clear();
+
+    size_t size() const {
+        return _size;
+    }
+
+    bool empty() const {
+        return 0 == _size;
+    }
+
+    size_t capacity() const {
+        return _slots.size();
+    }
+
+    /**
+     * \brief Метод вызывает func_ для каждой записи таблицы.
+     */
+    template<class Func>
+    void forEach(Func &&func_) const {
+        for (const Slot &slot : _slots) {
+            if (slot._is_used) {
+                func_(slot._rec);
+            }
+        }
+    }
+};
+} /// rfid
+} /// robocooler
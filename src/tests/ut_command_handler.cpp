@@ -5,6 +5,9 @@
 #define BOOST_TEST_MODULE BoostRegex
 #define BOOST_AUTO_TEST_MAIN
 
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <functional>
 #include <string>
 
@@ -13,6 +16,7 @@
 
 #include "Log.hpp"
 #include "Bases.hpp"
+#include "JsonWriter.hpp"
 #include "CommandHandler.hpp"
 #include "CommandsHandler.hpp"
 
@@ -22,13 +26,18 @@ typedef robocooler::driver::WorkerBase WorkerBase;
 typedef robocooler::driver::GpioControllerBase GpioControllerBase;
 typedef robocooler::driver::RfidControllerBase RfidControllerBase;
 typedef robocooler::driver::CommandHandlerBase CommandHandlerBase;
+typedef robocooler::driver::ESendLane ESendLane;
+typedef robocooler::driver::JsonWriter JsonWriter;
 typedef robocooler::rfid::CommandsHandler RfidCommandsHandler;
 
 
 class TestGpioController
     : public GpioControllerBase {
 public:
-    TestGpioController() {
+    std::atomic<size_t> _left_opened;
+
+    TestGpioController()
+        : _left_opened(0) {
     }
     
     virtual ~TestGpioController() {
@@ -36,6 +45,7 @@ public:
         
     virtual void openLeftDoor(size_t mlscs_ = 0) {
         LOG(DEBUG);
+        ++_left_opened;
     }
 
     virtual void closeLeftDoor(size_t mlscs_ = 0) {
@@ -60,7 +70,23 @@ public:
 class TestRfidController
     : public RfidControllerBase {
 public:
-    TestRfidController(WorkerBase *worker_) {
+    std::vector<std::vector<uint8_t>> _executed; ///< Параметры выполненных команд.
+    size_t _inventory_count;
+    uint8_t _session;
+    size_t _sweep_period;
+    bool _is_delta_sync;
+    uint32_t _acked_version;
+    size_t _ant_settings_delay; ///< Имитация ожидания ответа модуля [милисекунды].
+    std::atomic<size_t> _started;
+
+    TestRfidController(WorkerBase *worker_)
+        : _inventory_count(0)
+        , _session(0)
+        , _sweep_period(0)
+        , _is_delta_sync(false)
+        , _acked_version(0)
+        , _ant_settings_delay(0)
+        , _started(0) {
     }
 
     virtual ~TestRfidController() {
@@ -68,23 +94,27 @@ public:
 
     virtual void startInventory(bool need_result_ = false) {
         LOG(DEBUG);
+        ++_started;
     }
 
     virtual void stopInventory() {
         LOG(DEBUG);
     }
 
-    virtual void inventory(size_t, bool) {
+    virtual void inventory(size_t count_, bool) {
         LOG(DEBUG);
+        _inventory_count = count_;
     }
 
     virtual bool execute(uint8_t cmd_id_, const std::vector<uint8_t> &data_buf_ = std::vector<uint8_t>()) {
         LOG(DEBUG) << RfidCommandsHandler::toString(cmd_id_) << ": " << RfidCommandsHandler::toString(data_buf_);
+        _executed.push_back(data_buf_);
         return true;
     }
 
     virtual std::string getAntSettings() {
         LOG(DEBUG);
+        std::this_thread::sleep_for(std::chrono::milliseconds(_ant_settings_delay));
         return "";
     }
 
@@ -109,9 +139,33 @@ public:
         LOG(DEBUG);
     }
 
+    virtual void setAntennasSequence(const std::vector<uint8_t> &ants_, size_t stay_) {
+        LOG(DEBUG) << RfidCommandsHandler::toString(ants_) << ": " << stay_;
+    }
+
+    virtual void setSessionSettings(uint8_t session_, size_t sweep_period_) {
+        LOG(DEBUG) << static_cast<uint16_t>(session_) << ": " << sweep_period_;
+        _session = session_;
+        _sweep_period = sweep_period_;
+    }
+
     virtual void findBrokenLabels(size_t iterations_num_) {
         LOG(DEBUG);
     }
+
+    virtual void setLabelsSyncMode(bool is_delta_) {
+        LOG(DEBUG);
+        _is_delta_sync = is_delta_;
+    }
+
+    virtual void ackLabelsSync(uint32_t version_) {
+        LOG(DEBUG);
+        _acked_version = version_;
+    }
+
+    virtual void resyncLabels() {
+        LOG(DEBUG);
+    }
 };
 
 
@@ -121,8 +175,13 @@ class TestWorker
     std::shared_ptr<TestRfidController> _rfid_controller;
     
 public:    
+    std::vector<std::string> _sent;
+    std::vector<std::string> _events;
+    uint64_t _acked_seq;
+
     TestWorker() 
-        : _gpio_controller(std::make_shared<TestGpioController>()) {
+        : _gpio_controller(std::make_shared<TestGpioController>())
+        , _acked_seq(0) {
         _rfid_controller = std::make_shared<TestRfidController>(this);
     }
     
@@ -133,7 +192,19 @@ public:
         return "0";
     }
 
-    virtual void send(const std::string &json_str_) {
+    virtual void send(const JsonWriter &writer_, ESendLane lane_, const char *coalesce_key_) {
+        _sent.push_back(writer_.str());
+    }
+
+    virtual void sendEvent(JsonWriter &writer_, const char *snapshot_key_) {
+        writer_.key("seq").value(static_cast<uint64_t>(_events.size() + 1))
+            .endObject()
+            .endObject();
+        _events.push_back(writer_.str());
+    }
+
+    virtual void ackEvents(uint64_t seq_) {
+        _acked_seq = seq_;
     }
 
     virtual GpioControllerBase* getGpioController() {
@@ -144,6 +215,14 @@ public:
         return _rfid_controller.get();
     }
 
+    TestRfidController* getTestRfidController() {
+        return _rfid_controller.get();
+    }
+
+    TestGpioController* getTestGpioController() {
+        return _gpio_controller.get();
+    }
+
     virtual CommandHandlerBase* getCommandHandler() {
         return nullptr;
     }
@@ -166,3 +245,65 @@ BOOST_AUTO_TEST_CASE(TestCommandHandler) {
     ch.handle(R"({"M":"closeRightDoor","H":"PlantHub","A":""})");
     ch.handle(R"({"H":"PlantHub", "M":"configureRFIDDevice", "A":{"frequencyRegion":{"startFrequency":0,"endFrequency":59,"region":1},"powers":[0,1,2,33]}})");
 }
+
+
+BOOST_AUTO_TEST_CASE(TestCommandDispatch) {
+    TestWorker worker;
+    test::TestRfidController *rfidc = worker.getTestRfidController();
+    CommandHandler ch(&worker);
+    /// Числа передаются в команды значениями, а не текстом.
+    ch.handle(R"({"H":"PlantHub","M":"configureRFIDDevice","A":{"frequencyRegion":{"startFrequency":0,"endFrequency":59,"region":1},"powers":[0,1,2,33]}})");
+    ch.wait();
+    BOOST_REQUIRE_EQUAL(rfidc->_executed.size(), 2);
+    BOOST_CHECK(rfidc->_executed[0] == std::vector<uint8_t>({1, 0, 59}));
+    BOOST_CHECK(rfidc->_executed[1] == std::vector<uint8_t>({0, 1, 2, 33}));
+    ch.handle(R"({"M":"getContent","H":"PlantHub","A":{"bufReadNumAttempt":"4"}})");
+    ch.wait();
+    BOOST_CHECK_EQUAL(rfidc->_inventory_count, 4);
+    ch.handle(R"({"M":"updateAntennasRequestsSettings","H":"PlantHub","A":{"session":1,"sweepPeriod":7}})");
+    ch.wait();
+    BOOST_CHECK_EQUAL(rfidc->_session, 1);
+    BOOST_CHECK_EQUAL(rfidc->_sweep_period, 7);
+    ch.handle(R"({"M":"setLabelsSyncMode","H":"PlantHub","A":{"delta":true}})");
+    ch.wait();
+    BOOST_CHECK(rfidc->_is_delta_sync);
+    ch.handle(R"({"M":"ackLabelsSynchronization","H":"PlantHub","A":{"version":12}})");
+    ch.wait();
+    BOOST_CHECK_EQUAL(rfidc->_acked_version, 12);
+    /// Событие с продуктами нумеруется и подтверждается сервером.
+    ch.handle(R"({"H":"PlantHub","M":"sendPutOrTakenGoodsByUser","A":{"O":["01 02"],"I":[],"PlantId":0}})");
+    BOOST_REQUIRE_EQUAL(worker._events.size(), 1);
+    BOOST_CHECK(worker._events[0].find(R"("param":{"id":0},"seq":1}})") not_eq std::string::npos);
+    ch.handle(R"({"M":"ackEvents","H":"PlantHub","A":{"seq":1}})");
+    BOOST_CHECK_EQUAL(worker._acked_seq, 1);
+    /// Неизвестные команды и испорченный json не меняют состояние.
+    ch.handle(R"({"M":"unknownMethod","H":"PlantHub","A":null})");
+    ch.handle(R"({"M":"getContent","H":"PlantHub","A":{)");
+    ch.wait();
+    BOOST_CHECK_EQUAL(rfidc->_executed.size(), 2);
+}
+
+
+BOOST_AUTO_TEST_CASE(TestSlowRfidQuery) {
+    TestWorker worker;
+    worker.getTestRfidController()->_ant_settings_delay = 500;
+    CommandHandler ch(&worker);
+    /// Дверь открывается, пока запрос настроек ждёт модуль.
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ch.handle(R"({"M":"getAntennasConfiguration","H":"PlantHub","A":{}})");
+    ch.handle(R"({"M":"openLeftDoor","H":"PlantHub","A":""})");
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    BOOST_CHECK_LT(elapsed.count(), 100);
+    BOOST_CHECK_EQUAL(worker.getTestGpioController()->_left_opened, 1);
+    /// Инвенторизация по открытию двери не ждёт завершения запроса настроек.
+    while (not worker.getTestRfidController()->_started and
+           std::chrono::steady_clock::now() - start < std::chrono::milliseconds(400)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    BOOST_CHECK_EQUAL(worker.getTestRfidController()->_started, 1);
+    BOOST_CHECK(worker._sent.empty());
+    /// Ответ отправляется по завершении запроса.
+    ch.wait();
+    BOOST_REQUIRE_EQUAL(worker._sent.size(), 1);
+    BOOST_CHECK(worker._sent[0].find("setCurrentConfiguration") not_eq std::string::npos);
+}
@@ -0,0 +1,135 @@
+#ifndef BOOST_STATIC_LINK
+#   define BOOST_TEST_DYN_LINK
+#endif // BOOST_STATIC_LINK
+
+#define BOOST_TEST_MODULE CommandPipeline
+#define BOOST_AUTO_TEST_MAIN
+
+#include <vector>
+#include <chrono>
+
+#include <boost/test/unit_test.hpp>
+
+#include "Log.hpp"
+#include "Message.hpp"
+#include "CommandsHandler.hpp"
+#include "CommandPipeline.hpp"
+
+
+typedef std::vector<uint8_t> Buffer;
+typedef robocooler::rfid::Message Message;
+typedef robocooler::rfid::Command Command;
+typedef robocooler::rfid::CommandsHandler CommandsHandler;
+typedef robocooler::rfid::CommandPipeline CommandPipeline;
+typedef robocooler::rfid::Command::ECommandId Cid;
+typedef CommandPipeline::Future Future;
+
+
+namespace test {
+
+/**
+ * \brief Функтор отправки, фиксирующий порядок отправленных команд.
+ */
+struct Sender {
+    std::vector<Cid> *_sent;
+    Cid _cid;
+
+    void operator() (Command*) {
+        _sent->push_back(_cid);
+    }
+};
+} // test
+
+
+BOOST_AUTO_TEST_CASE(TestPipelineBackToBack) {
+    std::vector<Cid> sent;
+    CommandPipeline pipeline(nullptr);
+    Future count = pipeline.post(Cid::cmd_get_inventory_buffer_tag_count,
+                                 test::Sender({&sent, Cid::cmd_get_inventory_buffer_tag_count}), 1000);
+    Future tags = pipeline.post(Cid::cmd_get_and_reset_inventory_buffer,
+                                test::Sender({&sent, Cid::cmd_get_and_reset_inventory_buffer}), 1000);
+    /// Вторая команда отправлена, не дожидаясь ответа на первую.
+    BOOST_REQUIRE_EQUAL(sent.size(), 2);
+    BOOST_CHECK(sent[0] == Cid::cmd_get_inventory_buffer_tag_count);
+    BOOST_CHECK_EQUAL(pipeline.inFlight(), 2);
+    BOOST_CHECK(pipeline.complete(Cid::cmd_get_inventory_buffer_tag_count));
+    BOOST_CHECK(pipeline.wait(count));
+    BOOST_CHECK(not pipeline.complete(Cid::cmd_get_firmware_version));
+    BOOST_CHECK(pipeline.complete(Cid::cmd_get_and_reset_inventory_buffer));
+    BOOST_CHECK(pipeline.wait(tags));
+    BOOST_CHECK_EQUAL(pipeline.inFlight(), 0);
+    BOOST_CHECK_EQUAL(pipeline.nextTimeout(), NO_DATA_TIMEOUT);
+}
+
+
+BOOST_AUTO_TEST_CASE(TestPipelineSameCommand) {
+    std::vector<Cid> sent;
+    CommandPipeline pipeline(nullptr);
+    test::Sender set_ant({&sent, Cid::cmd_set_work_antenna});
+    test::Sender inv({&sent, Cid::cmd_customized_session_target_inventory});
+    Future r1 = pipeline.post(Cid::cmd_set_work_antenna, set_ant, 1000);
+    Future r2 = pipeline.post(Cid::cmd_customized_session_target_inventory, inv, 1000);
+    Future r3 = pipeline.post(Cid::cmd_set_work_antenna, set_ant, 1000);
+    Future r4 = pipeline.post(Cid::cmd_customized_session_target_inventory, inv, 1000);
+    /// Ответы на одинаковые команды неразличимы: повтор ждёт ответа, порядок сохраняется.
+    BOOST_CHECK_EQUAL(sent.size(), 2);
+    BOOST_CHECK_EQUAL(pipeline.queued(), 2);
+    pipeline.complete(Cid::cmd_set_work_antenna);
+    BOOST_REQUIRE_EQUAL(sent.size(), 3);
+    BOOST_CHECK(sent[2] == Cid::cmd_set_work_antenna);
+    pipeline.complete(Cid::cmd_customized_session_target_inventory);
+    BOOST_CHECK_EQUAL(sent.size(), 4);
+    pipeline.complete(Cid::cmd_set_work_antenna);
+    pipeline.complete(Cid::cmd_customized_session_target_inventory);
+    BOOST_CHECK(pipeline.wait(r1) and pipeline.wait(r2) and pipeline.wait(r3) and pipeline.wait(r4));
+}
+
+
+BOOST_AUTO_TEST_CASE(TestPipelineDeadline) {
+    LOG_TOGGLE(WARNING, false);
+    std::vector<Cid> sent;
+    std::vector<Cid> failed;
+    CommandPipeline pipeline(nullptr);
+    Future lost = pipeline.post(Cid::cmd_get_output_power, test::Sender({&sent, Cid::cmd_get_output_power}), 20,
+                                [&failed](Cid cid_, bool is_done_) {
+        if (not is_done_) {
+            failed.push_back(cid_);
+        }
+    });
+    Future ok = pipeline.post(Cid::cmd_get_frequency_region, test::Sender({&sent, Cid::cmd_get_frequency_region}), 5000);
+    BOOST_CHECK(pipeline.nextTimeout() <= 21);
+    auto start = CommandPipeline::Clock::now();
+    /// Ожидание завершается по сроку без потока таймера.
+    BOOST_CHECK(not pipeline.wait(lost));
+    BOOST_CHECK(CommandPipeline::Clock::now() - start < std::chrono::seconds(1));
+    BOOST_REQUIRE_EQUAL(failed.size(), 1);
+    BOOST_CHECK(failed[0] == Cid::cmd_get_output_power);
+    BOOST_CHECK_EQUAL(pipeline.inFlight(), 1);
+    pipeline.cancel();
+    BOOST_CHECK(not pipeline.wait(ok));
+}
+
+
+BOOST_AUTO_TEST_CASE(TestBufferReadCompletion) {
+    LOG_TOGGLE(DEBUG, false);
+    CommandsHandler hdl(nullptr);
+    size_t tags = 0;
+    hdl.initOnReadDataFunc([&tags](const Command::ReadCmdData&) {
+        ++tags;
+    });
+    Buffer stream;
+    for (uint8_t t = 0; t < 3; ++t) {
+        /// TagCount, DataLen, PC, EPC (4 байта), CRC, RSSI, FreqAnt, InvCount.
+        Buffer data = {0x00, 0x03, 0x08, 0x30, 0x00, 0xe2, 0x00, 0x10, t, 0x12, 0x34, 0x50, 0x01, 0x01};
+        Message msg(RFID_ADDR, static_cast<uint8_t>(Cid::cmd_get_and_reset_inventory_buffer), data);
+        stream.insert(stream.end(), msg.getFrame(), msg.getFrame() + msg.getSize());
+    }
+    std::vector<Cid> results;
+    hdl.receiveChunk(stream.data(), stream.size(), [&results](Cid cid_) {
+        results.push_back(cid_);
+    });
+    /// Выгрузка буфера завершается последней меткой.
+    BOOST_CHECK_EQUAL(tags, 3);
+    BOOST_REQUIRE_EQUAL(results.size(), 1);
+    BOOST_CHECK(results[0] == Cid::cmd_get_and_reset_inventory_buffer);
+}
@@ -0,0 +1,180 @@
+#ifndef BOOST_STATIC_LINK
+#   define BOOST_TEST_DYN_LINK
+#endif // BOOST_STATIC_LINK
+
+#define BOOST_TEST_MODULE EventJournal
+#define BOOST_AUTO_TEST_MAIN
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include "Log.hpp"
+#include "EventJournal.hpp"
+
+
+typedef robocooler::driver::EventJournal EventJournal;
+typedef robocooler::driver::EventJournalStats EventJournalStats;
+typedef robocooler::driver::EPayloadFormat EPayloadFormat;
+typedef std::vector<uint64_t> Seqs;
+
+
+namespace {
+
+std::string journalPath(const char *name_) {
+    std::string path = "/tmp/" + std::string(name_) + "_" + std::to_string(getpid()) + ".journal";
+    remove(path.c_str());
+    return path;
+}
+
+
+Seqs replay(EventJournal &journal_, std::vector<std::string> *messages_ = nullptr,
+            std::vector<EPayloadFormat> *formats_ = nullptr) {
+    Seqs seqs;
+    journal_.replay([&seqs, messages_, formats_](uint64_t seq_, const std::string &message_, EPayloadFormat format_,
+                                                 const char*) {
+        seqs.push_back(seq_);
+        if (messages_) {
+            messages_->push_back(message_);
+        }
+        if (formats_) {
+            formats_->push_back(format_);
+        }
+    });
+    return seqs;
+}
+
+
+std::string message(uint64_t seq_) {
+    /// 40 байт: с заголовком записи - 64 байта в журнале.
+    std::string msg = "{\"M\":\"setPutOrTakenGoods\",\"seq\":" + std::to_string(seq_) + "}";
+    msg.resize(40, ' ');
+    return msg;
+}
+} /// namespace
+
+
+BOOST_AUTO_TEST_CASE(TestEventJournalReplay) {
+    std::string path = journalPath("ut_journal_replay");
+    {
+        EventJournal journal(path);
+        BOOST_REQUIRE(journal.isOpened());
+        BOOST_CHECK_EQUAL(journal.getLastSeq(), 0);
+        BOOST_CHECK(journal.append(1, message(1), EPayloadFormat::JSON));
+        BOOST_CHECK(journal.append(2, message(2), EPayloadFormat::JSON));
+        BOOST_CHECK(journal.append(3, message(3), EPayloadFormat::CBOR));
+        BOOST_CHECK(journal.append(4, message(4), EPayloadFormat::JSON, "verifyLabelsSynchronization"));
+        BOOST_CHECK(journal.append(5, message(5), EPayloadFormat::JSON, "verifyLabelsSynchronization"));
+        /// Номер должен возрастать.
+        BOOST_CHECK(not journal.append(5, message(5), EPayloadFormat::JSON));
+        /// Из снимков с одним ключом досылается последний.
+        BOOST_CHECK(replay(journal) == Seqs({1, 2, 3, 5}));
+        journal.ack(2);
+        BOOST_CHECK(replay(journal) == Seqs({3, 5}));
+    }
+    /// После штатного закрытия журнал продолжается с тех же номеров.
+    EventJournal journal(path);
+    BOOST_REQUIRE(journal.isOpened());
+    BOOST_CHECK_EQUAL(journal.getLastSeq(), 5);
+    std::vector<std::string> messages;
+    std::vector<EPayloadFormat> formats;
+    BOOST_CHECK(replay(journal, &messages, &formats) == Seqs({3, 5}));
+    BOOST_REQUIRE_EQUAL(messages.size(), 2);
+    BOOST_CHECK_EQUAL(messages[0], message(3));
+    /// Кодирование хранится в записи, а не определяется по содержимому посылки.
+    BOOST_REQUIRE_EQUAL(formats.size(), 2);
+    BOOST_CHECK(formats[0] == EPayloadFormat::CBOR);
+    BOOST_CHECK(formats[1] == EPayloadFormat::JSON);
+    journal.ack(5);
+    BOOST_CHECK(replay(journal).empty());
+    BOOST_CHECK_EQUAL(journal.getStats()._used, 0);
+    remove(path.c_str());
+}
+
+
+BOOST_AUTO_TEST_CASE(TestEventJournalRing) {
+    std::string path = journalPath("ut_journal_ring");
+    {
+        /// Кольцо на 4 записи: подтверждения освобождают место, запись переходит в начало.
+        EventJournal journal(path, 256);
+        BOOST_REQUIRE(journal.isOpened());
+        for (uint64_t seq = 1; seq <= 10; ++seq) {
+            BOOST_CHECK(journal.append(seq, message(seq), EPayloadFormat::JSON));
+            if (seq % 3 == 0) {
+                journal.ack(seq - 1);
+            }
+        }
+        BOOST_CHECK(replay(journal) == Seqs({9, 10}));
+        /// Без подтверждений вытесняются самые старые записи.
+        for (uint64_t seq = 11; seq <= 14; ++seq) {
+            BOOST_CHECK(journal.append(seq, message(seq), EPayloadFormat::JSON));
+        }
+        EventJournalStats stats = journal.getStats();
+        BOOST_CHECK_EQUAL(stats._dropped, 2);
+        BOOST_CHECK_EQUAL(stats._records, 4);
+        BOOST_CHECK(replay(journal) == Seqs({11, 12, 13, 14}));
+    }
+    EventJournal journal(path, 256);
+    BOOST_CHECK(replay(journal) == Seqs({11, 12, 13, 14}));
+    remove(path.c_str());
+}
+
+
+BOOST_AUTO_TEST_CASE(TestEventJournalCompact) {
+    std::string path = journalPath("ut_journal_compact");
+    {
+        /// Событие и снимки по 72 байта: седьмой снимок не помещается в кольцо.
+        EventJournal journal(path, 512);
+        BOOST_REQUIRE(journal.isOpened());
+        BOOST_CHECK(journal.append(1, message(1), EPayloadFormat::JSON));
+        for (uint64_t seq = 2; seq <= 8; ++seq) {
+            BOOST_CHECK(journal.append(seq, message(seq), EPayloadFormat::JSON, "s"));
+        }
+        /// Вместо события удалены заменённые снимки.
+        EventJournalStats stats = journal.getStats();
+        BOOST_CHECK_EQUAL(stats._dropped, 0);
+        BOOST_CHECK_EQUAL(stats._compacted, 5);
+        /// Снимок 7 заменён только что добавленным и будет удалён следующим сжатием.
+        BOOST_CHECK_EQUAL(stats._records, 3);
+        BOOST_CHECK(replay(journal) == Seqs({1, 8}));
+        for (uint64_t seq = 9; seq <= 11; ++seq) {
+            BOOST_CHECK(journal.append(seq, message(seq), EPayloadFormat::JSON));
+        }
+        BOOST_CHECK(replay(journal) == Seqs({1, 8, 9, 10, 11}));
+    }
+    /// Устаревшие записи за концом сжатого кольца не восстанавливаются.
+    EventJournal journal(path, 512);
+    std::vector<std::string> messages;
+    BOOST_CHECK(replay(journal, &messages) == Seqs({1, 8, 9, 10, 11}));
+    BOOST_REQUIRE_EQUAL(messages.size(), 5);
+    BOOST_CHECK_EQUAL(messages[0], message(1));
+    BOOST_CHECK_EQUAL(messages[1], message(8));
+    BOOST_CHECK_EQUAL(journal.getStats()._records, 6);
+    remove(path.c_str());
+}
+
+
+BOOST_AUTO_TEST_CASE(TestEventJournalBroken) {
+    std::string path = journalPath("ut_journal_broken");
+    {
+        EventJournal journal(path, 256);
+        for (uint64_t seq = 1; seq <= 3; ++seq) {
+            journal.append(seq, message(seq), EPayloadFormat::JSON);
+        }
+    }
+    /// Испорченная последняя запись отбрасывается при открытии.
+    FILE *file = fopen(path.c_str(), "r+b");
+    BOOST_REQUIRE(file);
+    fseek(file, 64 + 2 * 64 + 30, SEEK_SET);
+    fputc('#', file);
+    fclose(file);
+    EventJournal journal(path, 256);
+    BOOST_CHECK(replay(journal) == Seqs({1, 2}));
+    BOOST_CHECK(journal.append(4, message(4), EPayloadFormat::JSON));
+    BOOST_CHECK(replay(journal) == Seqs({1, 2, 4}));
+    remove(path.c_str());
+}
@@ -0,0 +1,272 @@
+#ifndef BOOST_STATIC_LINK
+#   define BOOST_TEST_DYN_LINK
+#endif // BOOST_STATIC_LINK
+
+#define BOOST_TEST_MODULE FrameParser
+#define BOOST_AUTO_TEST_MAIN
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "Log.hpp"
+#include "Message.hpp"
+#include "FrameParser.hpp"
+#include "CommandsHandler.hpp"
+
+
+typedef std::vector<uint8_t> Buffer;
+typedef robocooler::rfid::FrameParser FrameParser;
+typedef robocooler::rfid::FrameView FrameView;
+typedef robocooler::rfid::Message Message;
+typedef robocooler::rfid::CommandsHandler CommandsHandler;
+typedef robocooler::rfid::Command Command;
+typedef robocooler::rfid::Command::ECommandId Cid;
+
+
+namespace test {
+
+Buffer makeFrame(uint8_t cmd_, size_t data_len_, uint8_t seed_) {
+    Buffer frame;
+    frame.push_back(RFID_HEAD);
+    frame.push_back(static_cast<uint8_t>(data_len_ + 3));
+    frame.push_back(RFID_ADDR);
+    frame.push_back(cmd_);
+    for (size_t i = 0; i < data_len_; ++i) {
+        frame.push_back(static_cast<uint8_t>(seed_ + i));
+    }
+    uint8_t sum = 0;
+    for (uint8_t b : frame) {
+        sum += b;
+    }
+    frame.push_back(static_cast<uint8_t>((~sum) + 1));
+    return frame;
+}
+
+
+Buffer makeFrame(uint8_t cmd_, const Buffer &data_) {
+    Message msg(RFID_ADDR, cmd_, data_);
+    return msg.getAryTranData();
+}
+
+
+struct Collector {
+    std::vector<Buffer> _frames;
+
+    void operator() (const FrameView &frame_) {
+        _frames.push_back(Buffer(frame_.getFrame(), frame_.getFrame() + frame_.getSize()));
+    }
+};
+} // test
+
+
+BOOST_AUTO_TEST_CASE(TestFrameParserChunks) {
+    Buffer stream;
+    std::vector<Buffer> expected;
+    for (size_t i = 0; i < 50; ++i) {
+        Buffer f = test::makeFrame(0x91, 5 + (i * 7) % 40, static_cast<uint8_t>(i));
+        expected.push_back(f);
+        stream.insert(stream.end(), f.begin(), f.end());
+    }
+    /// Разные размеры блоков, в том числе с переходом через границу кольца.
+    for (size_t chunk : {size_t(1), size_t(3), size_t(64), size_t(1000), size_t(4096)}) {
+        FrameParser parser;
+        test::Collector collector;
+        for (size_t pos = 0; pos < stream.size(); pos += chunk) {
+            size_t len = std::min(chunk, stream.size() - pos);
+            parser.feed(&stream[pos], len, std::ref(collector));
+        }
+        BOOST_CHECK_EQUAL(collector._frames.size(), expected.size());
+        BOOST_CHECK(collector._frames == expected);
+        BOOST_CHECK_EQUAL(parser.getSkipped(), 0);
+        BOOST_CHECK_EQUAL(parser.size(), 0);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(TestFrameParserResync) {
+    Buffer f1 = test::makeFrame(0x72, 2, 1);
+    Buffer f2 = test::makeFrame(0x89, 18, 2);
+    Buffer bad = test::makeFrame(0x91, 10, 3);
+    bad.back() ^= 0xff;
+    Buffer stream = {0x00, 0x11, 0x22};
+    stream.insert(stream.end(), f1.begin(), f1.end());
+    stream.insert(stream.end(), bad.begin(), bad.end());
+    stream.push_back(RFID_HEAD);
+    stream.push_back(0x01); ///< Недопустимая длина.
+    stream.insert(stream.end(), f2.begin(), f2.end());
+
+    FrameParser parser;
+    test::Collector collector;
+    parser.feed(stream.data(), stream.size(), std::ref(collector));
+    BOOST_REQUIRE_EQUAL(collector._frames.size(), 2);
+    BOOST_CHECK(collector._frames[0] == f1);
+    BOOST_CHECK(collector._frames[1] == f2);
+    BOOST_CHECK_EQUAL(parser.getBadFrames(), 2);
+    BOOST_CHECK_EQUAL(parser.size(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(TestFrameParserView) {
+    Buffer f = test::makeFrame(0x92, 2, 0x10);
+    FrameParser parser;
+    FrameView view;
+    BOOST_CHECK_EQUAL(parser.write(f.data(), f.size() - 1), f.size() - 1);
+    BOOST_CHECK(not parser.next(view));
+    parser.write(&f.back(), 1);
+    BOOST_REQUIRE(parser.next(view));
+    BOOST_CHECK_EQUAL(view.getCmd(), 0x92);
+    BOOST_CHECK_EQUAL(view.getDataLen(), 5);
+    BOOST_CHECK_EQUAL(view.getDataSize(), 2);
+    BOOST_CHECK_EQUAL(view.getData()[0], 0x10);
+    BOOST_CHECK_EQUAL(view.getData()[1], 0x11);
+}
+
+
+BOOST_AUTO_TEST_CASE(TestMessageEncode) {
+    /// Пакет get_firmware_version из документации протокола: A0 03 FF 72 EC.
+    Message version(RFID_ADDR, 0x72);
+    Buffer expected = {0xa0, 0x03, 0xff, 0x72, 0xec};
+    BOOST_CHECK(version.getAryTranData() == expected);
+
+    uint8_t data[] = {0x01, 0x02, 0x03};
+    Message msg(RFID_ADDR, 0x81, data, sizeof(data));
+    BOOST_CHECK_EQUAL(msg.getSize(), sizeof(data) + RFID_PACK_MINLEN);
+    BOOST_CHECK(msg.getAryTranData() == test::makeFrame(0x81, sizeof(data), 0x01));
+
+    uint8_t out[RFID_MAX_PACK_LEN];
+    BOOST_CHECK_EQUAL(Message::encode(out, RFID_ADDR, 0x81, data, sizeof(data)), msg.getSize());
+    BOOST_CHECK_EQUAL(Message::encode(out, RFID_ADDR, 0x81, data, RFID_MAX_DATA_LEN + 1), 0);
+
+    FrameParser parser;
+    test::Collector collector;
+    parser.feed(msg.getFrame(), msg.getSize(), std::ref(collector));
+    BOOST_REQUIRE_EQUAL(collector._frames.size(), 1);
+    BOOST_CHECK(collector._frames[0] == msg.getAryTranData());
+}
+
+
+BOOST_AUTO_TEST_CASE(TestRealTimeInventory) {
+    LOG_TOGGLE(DEBUG, false);
+    CommandsHandler hdl(nullptr);
+    std::vector<Command::ReadCmdData> tags;
+    hdl.initOnReadDataFunc([&tags](const Command::ReadCmdData &rcd_) {
+        tags.push_back(rcd_);
+    });
+    Buffer stream;
+    for (uint8_t t = 0; t < 3; ++t) {
+        /// FreqAnt, PC, EPC (12 байт), RSSI.
+        Buffer data = {static_cast<uint8_t>(0x10 | t), 0x30, 0x00};
+        for (uint8_t e = 0; e < 12; ++e) {
+            data.push_back(static_cast<uint8_t>(t * 16 + e));
+        }
+        data.push_back(0xc5);
+        Buffer f = test::makeFrame(0x89, data);
+        stream.insert(stream.end(), f.begin(), f.end());
+    }
+    Buffer done = test::makeFrame(0x89, Buffer({0x00, 0x00, 0x64, 0x00, 0x00, 0x00, 0x03}));
+    stream.insert(stream.end(), done.begin(), done.end());
+
+    std::vector<Cid> results;
+    hdl.receiveChunk(stream.data(), stream.size(), [&results](Cid cid_) {
+        results.push_back(cid_);
+    });
+    BOOST_REQUIRE_EQUAL(tags.size(), 3);
+    BOOST_CHECK_EQUAL(tags[2]._AntId, 2);
+    BOOST_CHECK_EQUAL(tags[2]._RSSI, 0x45);
+    BOOST_CHECK_EQUAL(tags[2]._PC, 0x3000);
+    BOOST_CHECK_EQUAL(tags[2]._EPC._len, 12);
+    BOOST_CHECK_EQUAL(tags[2]._EPC._bytes[0], 32);
+    /// Только пакет завершения сообщает о выполнении команды.
+    BOOST_REQUIRE_EQUAL(results.size(), 1);
+    BOOST_CHECK(results[0] == Cid::cmd_real_time_inventory);
+}
+
+
+BOOST_AUTO_TEST_CASE(TestFastSwitchInventory) {
+    LOG_TOGGLE(DEBUG, false);
+    CommandsHandler hdl(nullptr);
+    std::vector<uint8_t> ants;
+    hdl.initOnReadDataFunc([&ants](const Command::ReadCmdData &rcd_) {
+        ants.push_back(rcd_._AntId);
+    });
+    Buffer stream;
+    for (uint8_t a : {0, 1, 3}) {
+        Buffer data = {static_cast<uint8_t>(0x20 | a), 0x30, 0x00, 0xe2, 0x00, 0x10, a, 0x50};
+        Buffer f = test::makeFrame(0x8a, data);
+        stream.insert(stream.end(), f.begin(), f.end());
+    }
+    /// Антенна 3 не подключена: опрос продолжается.
+    Buffer missing = test::makeFrame(0x8a, Buffer({0x02, 0x22}));
+    Buffer done = test::makeFrame(0x8a, Buffer({0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x40}));
+    stream.insert(stream.end(), missing.begin(), missing.end());
+    stream.insert(stream.end(), done.begin(), done.end());
+
+    std::vector<Cid> results;
+    hdl.receiveChunk(stream.data(), stream.size(), [&results](Cid cid_) {
+        results.push_back(cid_);
+    });
+    BOOST_CHECK(ants == std::vector<uint8_t>({0, 1, 3}));
+    BOOST_REQUIRE_EQUAL(results.size(), 1);
+    BOOST_CHECK(results[0] == Cid::cmd_fast_switch_ant_inventory);
+}
+
+
+BOOST_AUTO_TEST_CASE(TestSessionTargetInventory) {
+    LOG_TOGGLE(DEBUG, false);
+    /// Запрос: Session, Target, Repeat.
+    uint8_t request[] = {0x02, 0x01, 0x05};
+    Message msg(RFID_ADDR, 0x8b, request, sizeof(request));
+    BOOST_CHECK(msg.getAryTranData() == test::makeFrame(0x8b, Buffer({0x02, 0x01, 0x05})));
+
+    CommandsHandler hdl(nullptr);
+    size_t tags = 0;
+    hdl.initOnReadDataFunc([&tags](const Command::ReadCmdData&) {
+        ++tags;
+    });
+    /// Ответ совпадает по формату с cmd_real_time_inventory.
+    Buffer stream = test::makeFrame(0x8b, Buffer({0x01, 0x30, 0x00, 0xe2, 0x00, 0x10, 0x01, 0x50}));
+    Buffer done = test::makeFrame(0x8b, Buffer({0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x01}));
+    stream.insert(stream.end(), done.begin(), done.end());
+
+    std::vector<Cid> results;
+    hdl.receiveChunk(stream.data(), stream.size(), [&results](Cid cid_) {
+        results.push_back(cid_);
+    });
+    BOOST_CHECK_EQUAL(tags, 1);
+    BOOST_REQUIRE_EQUAL(results.size(), 1);
+    BOOST_CHECK(results[0] == Cid::cmd_customized_session_target_inventory);
+}
+
+
+BOOST_AUTO_TEST_CASE(TestTruncatedBufferTag) {
+    LOG_TOGGLE(DEBUG, false);
+    LOG_TOGGLE(WARNING, false);
+    CommandsHandler hdl(nullptr);
+    std::vector<Command::ReadCmdData> tags;
+    hdl.initOnReadDataFunc([&tags](const Command::ReadCmdData &rcd_) {
+        tags.push_back(rcd_);
+    });
+    /// TagCount = 2, DataLen = 8: PC, EPC (4 байта), CRC, RSSI, FreqAnt, InvCount.
+    Buffer valid = test::makeFrame(0x90, Buffer({0x00, 0x02, 0x08, 0x30, 0x00, 0xe2, 0x00, 0x10, 0x01, 0x12, 0x34, 0x45, 0x01, 0x03}));
+    /// DataLen = 0x40 не помещается в пакет.
+    Buffer broken = test::makeFrame(0x90, Buffer({0x00, 0x02, 0x40, 0x30, 0x00, 0xe2, 0x00, 0x10}));
+    Buffer stream = valid;
+    stream.insert(stream.end(), broken.begin(), broken.end());
+
+    std::vector<Cid> results;
+    hdl.receiveChunk(stream.data(), stream.size(), [&results](Cid cid_) {
+        results.push_back(cid_);
+    });
+    BOOST_REQUIRE_EQUAL(tags.size(), 1);
+    BOOST_CHECK_EQUAL(tags[0]._EPC._len, 4);
+    BOOST_CHECK_EQUAL(tags[0]._AntId, 1);
+    BOOST_CHECK_EQUAL(tags[0]._InvCount, 3);
+    /// Отброшенный пакет всё равно завершает выгрузку буфера.
+    BOOST_REQUIRE_EQUAL(results.size(), 1);
+    BOOST_CHECK(results[0] == Cid::cmd_get_inventory_buffer);
+
+    Command::ReadCmdData rcd;
+    BOOST_CHECK(not Command::parseInventoryBufferData(broken.data() + 4, broken.size() - 5, rcd));
+    BOOST_CHECK_EQUAL(rcd._TagCount, 2);
+}
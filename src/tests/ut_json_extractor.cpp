@@ -7,6 +7,7 @@
 
 #include <functional>
 #include <string>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 #include <boost/test/output_test_stream.hpp>
@@ -19,13 +20,19 @@ namespace ph = std::placeholders;
 
 namespace test {
 
+typedef robocooler::driver::JsonView JsonView;
+
+
 class HandleJson {
 public:    
+    std::vector<std::string> _jsons;
+
     HandleJson() {
     }
     
-    void onJson(const std::string &json_) {
-        LOG(DEBUG) << json_;
+    void onJson(const JsonView &json_) {
+        LOG(DEBUG) << json_.toString();
+        _jsons.push_back(json_.toString());
     }
 };
 } // test
@@ -42,4 +49,23 @@ BOOST_AUTO_TEST_CASE(TestJsonExtractor) {
     je.onMessage(R"(:"PlantHub","M":"sendPutOrTakenGoodsByUser","A":[{"O":[], "I":[5,2,6,8], "PlantId":1}]}]}�{)");
     je.onMessage(R"({}�{}�{}�{}�{}�{}�{}�{}�{}�)");
     je.onMessage(R"({"C":"d-5AC30A07-q,0|r,0|s,1","S":1,"M":[]}�{}�{}�{}�z{"C":"d-5AC30A07-q,1|r,0|s,1",")");
+    /// Незакрытая "{" в конце второго блока делает последующие посылки вложенными.
+    BOOST_REQUIRE_EQUAL(handle._jsons.size(), 2);
+    BOOST_CHECK_EQUAL(handle._jsons[1], R"({"C":"d-5AC30A07-N,1|O,0|P,1","M":[{"H":"PlantHub",)"
+                                        R"("M":"sendPutOrTakenGoodsByUser","A":[{"O":[], "I":[5,2,6,8], "PlantId":1}]}]})");
+}
+
+
+BOOST_AUTO_TEST_CASE(TestJsonExtractorStrings) {
+    HandleJson handle;
+    JsonExtractor je(std::bind(&HandleJson::onJson, &handle, ph::_1));
+    /// Скобки и экранированные кавычки внутри строк не влияют на границы посылок.
+    std::string msg = R"({"reason":"bad } label {","epc":"\"}{\""}{"M":"x"})";
+    /// Побайтовая подача: разбор продолжается с места остановки.
+    for (char c : msg) {
+        je.onMessage(&c, 1);
+    }
+    BOOST_REQUIRE_EQUAL(handle._jsons.size(), 2);
+    BOOST_CHECK_EQUAL(handle._jsons[0], R"({"reason":"bad } label {","epc":"\"}{\""})");
+    BOOST_CHECK_EQUAL(handle._jsons[1], R"({"M":"x"})");
 }
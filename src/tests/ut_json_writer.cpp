@@ -0,0 +1,70 @@
+#ifndef BOOST_STATIC_LINK
+#   define BOOST_TEST_DYN_LINK
+#endif // BOOST_STATIC_LINK
+
+#define BOOST_TEST_MODULE JsonWriter
+#define BOOST_AUTO_TEST_MAIN
+
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "JsonWriter.hpp"
+#include "CborReader.hpp"
+
+
+typedef robocooler::driver::JsonWriter JsonWriter;
+typedef robocooler::rfid::Epc Epc;
+typedef robocooler::driver::CborReader CborReader;
+typedef robocooler::driver::EPayloadFormat EPayloadFormat;
+typedef nlohmann::json Json;
+
+
+BOOST_AUTO_TEST_CASE(TestJsonWriter) {
+    const uint8_t bytes[] = {0xe2, 0x00, 0x10, 0x63, 0x0a, 0x01};
+    Epc epc;
+    epc.assign(bytes, sizeof(bytes));
+    JsonWriter writer;
+    writer.beginObject()
+        .key("H").value("labeledGoods")
+        .key("A").beginObject()
+            .key("empty").values(std::vector<std::string>())
+            .key("labels").beginArray().value(epc).value(epc, 42).endArray()
+            .key("reason").value(std::string("a \"b\"\\\n"))
+            .key("plantId").number("7")
+        .endObject()
+        .endObject();
+    BOOST_CHECK_EQUAL(writer.str(), R"({"H":"labeledGoods","A":{"empty":[],"labels":["e2 00 10 63 0a 01",)"
+                                    R"("e2 00 10 63 0a 01:42"],"reason":"a \"b\"\\\n","plantId":7}})");
+    /// Повторное использование буфера.
+    writer.clear();
+    writer.beginArray().value(static_cast<uint64_t>(0)).value(static_cast<uint64_t>(1234567890)).endArray();
+    BOOST_CHECK_EQUAL(writer.str(), "[0,1234567890]");
+}
+
+
+BOOST_AUTO_TEST_CASE(TestJsonWriterCbor) {
+    const uint8_t bytes[] = {0xe2, 0x00, 0x10, 0x63, 0x0a, 0x01};
+    Epc epc;
+    epc.assign(bytes, sizeof(bytes));
+    JsonWriter writer(EPayloadFormat::CBOR);
+    writer.beginObject()
+        .key("M").value("syncLabels")
+        .key("A").beginObject()
+            .key("labels").beginArray().value(epc).value(epc, 300).endArray()
+            .key("plantId").number("7")
+            .key("sets").value(Json::parse(R"({"powers":[0,33],"rate":-1.5,"on":true})"))
+        .endObject()
+        .endObject();
+    /// EPC - байтовая строка: 6 байт вместо 19 символов в кавычках.
+    BOOST_CHECK(writer.str().find(std::string("\x46\xe2\x00\x10\x63\x0a\x01", 7)) not_eq std::string::npos);
+    Json js;
+    CborReader reader(reinterpret_cast<const uint8_t*>(writer.str().data()), writer.str().size());
+    BOOST_REQUIRE_MESSAGE(reader.read(js), reader.what());
+    BOOST_CHECK_EQUAL(js.dump(), R"({"A":{"labels":["e2 00 10 63 0a 01",["e2 00 10 63 0a 01",300]],"plantId":7,)"
+                                 R"("sets":{"on":true,"powers":[0,33],"rate":-1.5}},"M":"syncLabels"})");
+    /// Обрезанная посылка отвергается.
+    CborReader cut(reinterpret_cast<const uint8_t*>(writer.str().data()), writer.str().size() - 1);
+    BOOST_CHECK(not cut.read(js));
+}
@@ -0,0 +1,103 @@
+#ifndef BOOST_STATIC_LINK
+#   define BOOST_TEST_DYN_LINK
+#endif // BOOST_STATIC_LINK
+
+#define BOOST_TEST_MODULE LabelSync
+#define BOOST_AUTO_TEST_MAIN
+
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include "Log.hpp"
+#include "LabelSync.hpp"
+
+
+typedef robocooler::driver::LabelSync LabelSync;
+typedef robocooler::driver::JsonWriter JsonWriter;
+typedef robocooler::rfid::TagIndex TagIndex;
+typedef robocooler::rfid::TagSet TagSet;
+typedef robocooler::rfid::Epc Epc;
+
+
+namespace test {
+
+uint32_t intern(TagIndex &ids_, uint8_t byte_) {
+    Epc epc;
+    epc.assign(&byte_, 1);
+    return ids_.intern(epc);
+}
+
+
+std::string write(LabelSync &sync_, const TagSet &cur_, const TagIndex &ids_) {
+    JsonWriter writer;
+    writer.beginObject();
+    sync_.write(cur_, ids_, writer);
+    writer.endObject();
+    return writer.str();
+}
+} // test
+
+
+BOOST_AUTO_TEST_CASE(TestLabelSyncDelta) {
+    TagIndex ids;
+    uint32_t a = test::intern(ids, 0xaa);
+    uint32_t b = test::intern(ids, 0xbb);
+    uint32_t c = test::intern(ids, 0xcc);
+    LabelSync sync;
+    TagSet cur;
+    cur.insert(a);
+    cur.insert(b);
+    std::string hash_ab = std::to_string(LabelSync::hash(cur, ids));
+    /// Первый снимок передаётся полностью.
+    BOOST_CHECK_EQUAL(test::write(sync, cur, ids),
+                      R"({"version":1,"base":0,"added":["aa","bb"],"removed":[],"count":2,"hash":)" + hash_ab + "}");
+    BOOST_CHECK(sync.ack(1));
+    cur.clear();
+    cur.insert(c);
+    cur.insert(b);
+    std::string hash_bc = std::to_string(LabelSync::hash(cur, ids));
+    BOOST_CHECK_EQUAL(test::write(sync, cur, ids),
+                      R"({"version":2,"base":1,"added":["cc"],"removed":["aa"],"count":2,"hash":)" + hash_bc + "}");
+    /// Без подтверждения изменения отсчитываются от той же базы.
+    BOOST_CHECK_EQUAL(test::write(sync, cur, ids),
+                      R"({"version":3,"base":1,"added":["cc"],"removed":["aa"],"count":2,"hash":)" + hash_bc + "}");
+    BOOST_CHECK(sync.ack(3));
+    BOOST_CHECK(not sync.ack(2));
+    BOOST_CHECK_EQUAL(test::write(sync, cur, ids),
+                      R"({"version":4,"base":3,"added":[],"removed":[],"count":2,"hash":)" + hash_bc + "}");
+    /// Расхождение с сервером: снимок снова передаётся полностью.
+    sync.reset();
+    BOOST_CHECK_EQUAL(test::write(sync, cur, ids),
+                      R"({"version":5,"base":0,"added":["bb","cc"],"removed":[],"count":2,"hash":)" + hash_bc + "}");
+}
+
+
+BOOST_AUTO_TEST_CASE(TestLabelSyncRemap) {
+    TagIndex ids;
+    uint32_t a = test::intern(ids, 0xaa);
+    uint32_t b = test::intern(ids, 0xbb);
+    uint32_t c = test::intern(ids, 0xcc);
+    LabelSync sync;
+    TagSet cur;
+    cur.insert(b);
+    cur.insert(c);
+    test::write(sync, cur, ids);
+    BOOST_CHECK(sync.ack(1));
+    /// Метка aa больше нигде не встречается, её идентификатор освобождается.
+    TagSet live;
+    live.merge(cur);
+    sync.collect(live);
+    BOOST_CHECK(not live.contains(a));
+    robocooler::rfid::TagRemap remap;
+    ids.compact(live, remap);
+    cur.remap(remap);
+    sync.remap(remap);
+    BOOST_CHECK_EQUAL(ids.size(), 2);
+    /// База переведена на новые идентификаторы: изменений нет, хеш прежний.
+    std::string hash_bc = std::to_string(LabelSync::hash(cur, ids));
+    BOOST_CHECK_EQUAL(test::write(sync, cur, ids),
+                      R"({"version":2,"base":1,"added":[],"removed":[],"count":2,"hash":)" + hash_bc + "}");
+    cur.insert(test::intern(ids, 0xdd));
+    BOOST_CHECK(test::write(sync, cur, ids).find(R"("added":["dd"],"removed":[])") not_eq std::string::npos);
+}
@@ -0,0 +1,52 @@
+#ifndef BOOST_STATIC_LINK
+#   define BOOST_TEST_DYN_LINK
+#endif // BOOST_STATIC_LINK
+
+#define BOOST_TEST_MODULE ReaderEmulator
+#define BOOST_AUTO_TEST_MAIN
+
+#include <memory>
+#include <thread>
+#include <chrono>
+
+#include <boost/test/unit_test.hpp>
+
+#include "Log.hpp"
+#include "ReaderEmulator.hpp"
+#include "RfidController.hpp"
+
+
+typedef robocooler::rfid::ReaderEmulator ReaderEmulator;
+typedef robocooler::driver::RfidController RfidController;
+typedef std::chrono::steady_clock Clock;
+
+
+BOOST_AUTO_TEST_CASE(TestEmulatorInventory) {
+    LOG_TOGGLE(DEBUG, false);
+    LOG_TOGGLE(TRACE, false);
+    LOG_TOGGLE(INFO, false);
+    ReaderEmulator::Settings sets = ReaderEmulator::defaultSettings();
+    sets._tags_num = 50;
+    for (double &prob : sets._read_prob) {
+        prob = 1.0;
+    }
+    sets._bytes_per_sec = 0;
+    sets._round_ms = 1;
+    ReaderEmulator emu(sets);
+    BOOST_REQUIRE_MESSAGE(emu.isInit(), emu.what());
+    {
+        /// Драйвер работает с эмулятором как с последовательным портом считывателя.
+        RfidController rfidc(nullptr, emu.getSlaveName(), 10, 1, 1);
+        BOOST_REQUIRE(rfidc.isInited());
+        rfidc.startInventory();
+        Clock::time_point deadline = Clock::now() + std::chrono::seconds(10);
+        while (rfidc.getProbBuffer().size() < sets._tags_num and Clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        rfidc.stopInventory();
+        BOOST_CHECK_EQUAL(rfidc.getProbBuffer().size(), sets._tags_num);
+        BOOST_CHECK(rfidc.getProbBuffer().contains(emu.getEpc(sets._tags_num - 1)));
+    }
+    BOOST_CHECK(emu.getFramesIn() > 0);
+    BOOST_CHECK(emu.getTagsOut() >= sets._tags_num);
+}
@@ -0,0 +1,96 @@
+#ifndef BOOST_STATIC_LINK
+#   define BOOST_TEST_DYN_LINK
+#endif // BOOST_STATIC_LINK
+
+#define BOOST_TEST_MODULE SendQueue
+#define BOOST_AUTO_TEST_MAIN
+
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include "Log.hpp"
+#include "SendQueue.hpp"
+
+
+typedef robocooler::driver::SendQueue SendQueue;
+typedef robocooler::driver::SendQueueStats SendQueueStats;
+typedef robocooler::driver::ESendLane ESendLane;
+typedef robocooler::driver::EPayloadFormat EPayloadFormat;
+
+
+BOOST_AUTO_TEST_CASE(TestSendQueueOrder) {
+    SendQueue queue;
+    queue.push("log", EPayloadFormat::JSON, ESendLane::DIAGNOSTIC);
+    queue.push("sync1", EPayloadFormat::JSON, ESendLane::STATE, "sync");
+    queue.push("out", EPayloadFormat::JSON, ESendLane::PRODUCT);
+    queue.push("sync2", EPayloadFormat::JSON, ESendLane::STATE, "sync");
+    queue.push("in", EPayloadFormat::JSON, ESendLane::PRODUCT);
+    /// Продукты обгоняют диагностику, устаревший снимок заменён новым на своём месте.
+    std::string msg;
+    EPayloadFormat format;
+    const char *expected[] = {"out", "in", "sync2", "log"};
+    for (const char *exp : expected) {
+        BOOST_REQUIRE(queue.pop(msg, format));
+        BOOST_CHECK_EQUAL(msg, exp);
+    }
+    BOOST_CHECK(not queue.pop(msg, format));
+    SendQueueStats stats = queue.getStats();
+    BOOST_CHECK_EQUAL(stats._pushed, 5);
+    BOOST_CHECK_EQUAL(stats._sent, 4);
+    BOOST_CHECK_EQUAL(stats._coalesced, 1);
+    BOOST_CHECK_EQUAL(stats._max_depth, 4);
+}
+
+
+BOOST_AUTO_TEST_CASE(TestSendQueueOverflow) {
+    SendQueue queue(2);
+    BOOST_CHECK(queue.push("log1", EPayloadFormat::JSON, ESendLane::DIAGNOSTIC));
+    BOOST_CHECK(queue.push("log2", EPayloadFormat::JSON, ESendLane::DIAGNOSTIC));
+    /// Продукты вытесняют самую старую диагностику.
+    BOOST_CHECK(queue.push("out", EPayloadFormat::JSON, ESendLane::PRODUCT));
+    BOOST_CHECK(queue.push("in", EPayloadFormat::JSON, ESendLane::PRODUCT));
+    /// Диагностика не вытесняет более приоритетные посылки.
+    BOOST_CHECK(not queue.push("log3", EPayloadFormat::JSON, ESendLane::DIAGNOSTIC));
+    BOOST_CHECK_EQUAL(queue.size(), 2);
+    BOOST_CHECK_EQUAL(queue.getStats()._dropped, 3);
+    std::string msg;
+    EPayloadFormat format;
+    BOOST_REQUIRE(queue.pop(msg, format));
+    BOOST_CHECK_EQUAL(msg, "out");
+}
+
+
+BOOST_AUTO_TEST_CASE(TestSendQueueFormat) {
+    SendQueue queue;
+    queue.push("{}", EPayloadFormat::JSON, ESendLane::STATE, "sync");
+    /// Снимок, сформированный после смены кодирования, заменяет прежний вместе с кодированием.
+    queue.push("\xbf\xff", EPayloadFormat::CBOR, ESendLane::STATE, "sync");
+    queue.push("{}", EPayloadFormat::JSON, ESendLane::PRODUCT);
+    std::string msg;
+    EPayloadFormat format;
+    BOOST_REQUIRE(queue.pop(msg, format));
+    BOOST_CHECK(format == EPayloadFormat::JSON);
+    BOOST_REQUIRE(queue.pop(msg, format));
+    BOOST_CHECK(format == EPayloadFormat::CBOR);
+    BOOST_CHECK_EQUAL(msg, "\xbf\xff");
+}
+
+
+BOOST_AUTO_TEST_CASE(TestSendQueueEventSeq) {
+    SendQueue queue;
+    queue.push("{\"seq\":1}", EPayloadFormat::JSON, ESendLane::PRODUCT, nullptr, 1);
+    queue.push("{\"seq\":2}", EPayloadFormat::JSON, ESendLane::PRODUCT, nullptr, 2);
+    std::string msg;
+    EPayloadFormat format;
+    BOOST_REQUIRE(queue.pop(msg, format));
+    /// Досылка журнала: событие 1 уже отправлено, событие 2 ещё в очереди и повторно не ставится.
+    queue.push("{\"seq\":1}", EPayloadFormat::JSON, ESendLane::PRODUCT, nullptr, 1);
+    queue.push("\xbf\xff", EPayloadFormat::CBOR, ESendLane::PRODUCT, nullptr, 2);
+    BOOST_CHECK_EQUAL(queue.size(), 2);
+    BOOST_REQUIRE(queue.pop(msg, format));
+    BOOST_CHECK(format == EPayloadFormat::CBOR);
+    BOOST_REQUIRE(queue.pop(msg, format));
+    BOOST_CHECK_EQUAL(msg, "{\"seq\":1}");
+    BOOST_CHECK(not queue.pop(msg, format));
+}
@@ -0,0 +1,163 @@
+#ifndef BOOST_STATIC_LINK
+#   define BOOST_TEST_DYN_LINK
+#endif // BOOST_STATIC_LINK
+
+#define BOOST_TEST_MODULE TagTable
+#define BOOST_AUTO_TEST_MAIN
+
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "TagTable.hpp"
+#include "TagIndex.hpp"
+
+
+typedef robocooler::rfid::Epc Epc;
+typedef robocooler::rfid::TagRecord TagRecord;
+typedef robocooler::rfid::TagTable TagTable;
+typedef robocooler::rfid::TagIndex TagIndex;
+typedef robocooler::rfid::TagSet TagSet;
+
+
+namespace test {
+
+TagRecord makeRecord(uint32_t id_, size_t len_ = 12) {
+    TagRecord rec = TagRecord();
+    uint8_t bytes[RFID_EPC_MAXLEN] = {0xe2, 0x00};
+    for (size_t i = 0; i < 4; ++i) {
+        bytes[len_ - 1 - i] = static_cast<uint8_t>(id_ >> (i * 8));
+    }
+    rec._epc.assign(bytes, len_);
+    rec._readed_num = 1;
+    return rec;
+}
+} // test
+
+
+BOOST_AUTO_TEST_CASE(TestTagTableInsert) {
+    TagTable table(4);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        BOOST_REQUIRE(table.insert(test::makeRecord(i)).second);
+    }
+    /// Ёмкость растёт, заполнение не более половины.
+    BOOST_CHECK_EQUAL(table.size(), 1000);
+    BOOST_CHECK(table.capacity() >= 2000);
+    auto res = table.insert(test::makeRecord(7));
+    BOOST_CHECK(not res.second);
+    ++res.first->_readed_num;
+    BOOST_CHECK_EQUAL(table.find(test::makeRecord(7)._epc)->_readed_num, 2);
+    BOOST_CHECK(not table.contains(test::makeRecord(1000)._epc));
+    /// EPC другой длины - другая метка.
+    BOOST_CHECK(table.insert(test::makeRecord(7, 16)).second);
+
+    size_t count = 0;
+    table.forEach([&count](const TagRecord&) {
+        ++count;
+    });
+    BOOST_CHECK_EQUAL(count, table.size());
+
+    TagTable copy = table;
+    size_t capacity = table.capacity();
+    table.clear();
+    BOOST_CHECK(table.empty());
+    BOOST_CHECK_EQUAL(table.capacity(), capacity);
+    BOOST_CHECK(not table.contains(test::makeRecord(7)._epc));
+    BOOST_CHECK(copy.contains(test::makeRecord(7)._epc));
+}
+
+
+BOOST_AUTO_TEST_CASE(TestEpcToString) {
+    uint8_t bytes[] = {0xe2, 0x00, 0x10, 0x0a};
+    Epc epc;
+    epc.assign(bytes, sizeof(bytes));
+    /// Формат сервера: байты в нижнем регистре через пробел.
+    BOOST_CHECK_EQUAL(epc.toString(), "e2 00 10 0a");
+    epc.assign(bytes, 0);
+    BOOST_CHECK_EQUAL(epc.toString(), "");
+}
+
+
+BOOST_AUTO_TEST_CASE(TestTagSetDiff) {
+    TagIndex index(4);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        BOOST_REQUIRE_EQUAL(index.intern(test::makeRecord(i)._epc), i);
+    }
+    BOOST_CHECK_EQUAL(index.intern(test::makeRecord(500)._epc), 500);
+    uint32_t id = 0;
+    BOOST_CHECK(index.find(test::makeRecord(999)._epc, id) and id == 999);
+    BOOST_CHECK(not index.find(test::makeRecord(1000)._epc, id));
+    BOOST_CHECK(index.epc(7) == test::makeRecord(7)._epc);
+
+    TagSet old_set;
+    TagSet cur_set;
+    for (uint32_t i = 0; i < 900; ++i) {
+        old_set.insert(i);
+    }
+    for (uint32_t i = 100; i < 1000; ++i) {
+        cur_set.insert(i);
+    }
+    BOOST_CHECK(not cur_set.insert(100));
+    BOOST_CHECK_EQUAL(cur_set.size(), 900);
+    /// Наборы разной длины: у старого нет слов для последних меток.
+    TagSet added;
+    TagSet removed;
+    TagSet::difference(cur_set, old_set, added);
+    TagSet::difference(old_set, cur_set, removed);
+    BOOST_CHECK_EQUAL(added.size(), 100);
+    BOOST_CHECK_EQUAL(removed.size(), 100);
+    std::vector<uint32_t> ids;
+    removed.forEach([&ids](uint32_t id_) {
+        ids.push_back(id_);
+    });
+    BOOST_REQUIRE_EQUAL(ids.size(), 100);
+    BOOST_CHECK_EQUAL(ids.front(), 0);
+    BOOST_CHECK_EQUAL(ids.back(), 99);
+    BOOST_CHECK(added.contains(999) and not added.contains(899));
+
+    old_set.swap(cur_set);
+    BOOST_CHECK(old_set.contains(999));
+    cur_set.clear();
+    BOOST_CHECK(cur_set.empty() and not cur_set.contains(0));
+}
+
+
+BOOST_AUTO_TEST_CASE(TestTagIndexCompact) {
+    TagIndex index(4);
+    TagSet live;
+    TagSet other;
+    /// Через шкаф прошли 1000 меток, остались каждая десятая.
+    for (uint32_t i = 0; i < 1000; ++i) {
+        uint32_t id = index.intern(test::makeRecord(i)._epc);
+        if (i % 10 == 0) {
+            live.insert(id);
+        }
+        if (i % 20 == 0) {
+            other.insert(id);
+        }
+    }
+    robocooler::rfid::TagRemap remap;
+    index.compact(live, remap);
+    BOOST_CHECK_EQUAL(index.size(), 100);
+    BOOST_REQUIRE_EQUAL(remap.size(), 1000);
+    BOOST_CHECK_EQUAL(remap[990], 99);
+    BOOST_CHECK_EQUAL(remap[991], RFID_TAG_ID_NONE);
+    live.remap(remap);
+    other.remap(remap);
+    BOOST_CHECK_EQUAL(live.size(), 100);
+    BOOST_CHECK_EQUAL(other.size(), 50);
+    BOOST_CHECK(other.contains(98) and not other.contains(99));
+    /// Метки сохраняют EPC, освобождённые не находятся, новые получают следующие идентификаторы.
+    uint32_t id = 0;
+    BOOST_CHECK(index.find(test::makeRecord(990)._epc, id) and id == 99);
+    BOOST_CHECK(index.epc(99) == test::makeRecord(990)._epc);
+    BOOST_CHECK(not index.find(test::makeRecord(991)._epc, id));
+    BOOST_CHECK_EQUAL(index.intern(test::makeRecord(991)._epc), 100);
+    BOOST_CHECK_EQUAL(index.intern(test::makeRecord(0)._epc), 0);
+
+    TagSet merged;
+    merged.insert(100);
+    merged.merge(other);
+    BOOST_CHECK_EQUAL(merged.size(), 51);
+}
@@ -0,0 +1,89 @@
+#ifndef BOOST_STATIC_LINK
+#   define BOOST_TEST_DYN_LINK
+#endif // BOOST_STATIC_LINK
+
+#define BOOST_TEST_MODULE Timer
+#define BOOST_AUTO_TEST_MAIN
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include <boost/test/unit_test.hpp>
+
+#include "Timer.hpp"
+
+
+typedef utils::Timer Timer;
+typedef std::shared_ptr<Timer> PTimer;
+typedef std::chrono::steady_clock Clock;
+
+
+BOOST_AUTO_TEST_CASE(TestTimerFire) {
+    std::atomic<size_t> fired(0);
+    Clock::time_point start = Clock::now();
+    Clock::time_point at;
+    Timer timer(20, [&] {
+        at = Clock::now();
+        ++fired;
+    });
+    timer.wait();
+    BOOST_CHECK_EQUAL(fired, 1);
+    BOOST_CHECK(std::chrono::milliseconds(20) <= at - start);
+    BOOST_CHECK(at - start < std::chrono::milliseconds(200));
+}
+
+
+BOOST_AUTO_TEST_CASE(TestTimerRestart) {
+    std::atomic<size_t> fired(0);
+    PTimer timer;
+    /// Перезапуск из функции таймера, как у keepalive.
+    timer = std::make_shared<Timer>(5, [&] {
+        if (++fired < 3) {
+            timer->restart();
+        }
+    });
+    while (fired < 3) {
+        timer->wait();
+    }
+    BOOST_CHECK_EQUAL(fired, 3);
+    timer.reset();
+}
+
+
+BOOST_AUTO_TEST_CASE(TestTimerCancel) {
+    std::atomic<size_t> fired(0);
+    {
+        Timer timer(10, [&] {
+            ++fired;
+        });
+    }
+    /// Таймер, уничтоженный до срока, не срабатывает; уничтожение соседнего таймера из функции таймера не блокирует.
+    PTimer other = std::make_shared<Timer>(1000, [&] {
+        ++fired;
+    });
+    Timer killer(5, [&] {
+        other.reset();
+    });
+    killer.wait();
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    BOOST_CHECK_EQUAL(fired, 0);
+    BOOST_CHECK(not other);
+}
+
+
+BOOST_AUTO_TEST_CASE(TestTimerExecuteNow) {
+    std::atomic<size_t> fired(0);
+    Clock::time_point start = Clock::now();
+    Timer timer(1000, [&] {
+        ++fired;
+    });
+    timer.executeNow();
+    timer.wait();
+    BOOST_CHECK_EQUAL(fired, 1);
+    BOOST_CHECK(Clock::now() - start < std::chrono::milliseconds(500));
+    /// Сработавший таймер не запускается повторно.
+    timer.executeNow();
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    BOOST_CHECK_EQUAL(fired, 1);
+}
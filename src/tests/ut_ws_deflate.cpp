@@ -0,0 +1,69 @@
+#ifndef BOOST_STATIC_LINK
+#   define BOOST_TEST_DYN_LINK
+#endif // BOOST_STATIC_LINK
+
+#define BOOST_TEST_MODULE WsDeflate
+#define BOOST_AUTO_TEST_MAIN
+
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include "WsConfig.hpp"
+
+
+namespace pmd = websocketpp::extensions::permessage_deflate;
+
+typedef robocooler::driver::WsClientConfig WsClientConfig;
+typedef robocooler::driver::DeflateStats DeflateStats;
+typedef WsClientConfig::permessage_deflate_type ClientDeflate;
+typedef pmd::enabled<WsClientConfig::permessage_deflate_config> ServerDeflate;
+
+
+static const char LABELS[] =
+    "{\"H\":\"PlantHub\",\"M\":\"labeledGoods\",\"A\":{\"labels\":["
+    "\"e2 00 51 86 06 0a 01 44 15 70 1c 4d\",\"e2 00 51 86 06 0a 01 44 15 70 1c 4e\","
+    "\"e2 00 51 86 06 0a 01 44 15 70 1c 4f\",\"e2 00 51 86 06 0a 01 44 15 70 1c 50\"]}}";
+
+
+BOOST_AUTO_TEST_CASE(TestWsDeflateOffer) {
+    ClientDeflate client;
+    BOOST_CHECK(client.generate_offer().find("client_no_context_takeover") == std::string::npos);
+    /// Сервер не ограничил своё окно - распаковка принимает окно 2^15.
+    websocketpp::http::attribute_list response;
+    response["client_max_window_bits"] = "15";
+    BOOST_CHECK(not client.negotiate(response).first);
+    BOOST_CHECK(client.is_enabled());
+}
+
+
+BOOST_AUTO_TEST_CASE(TestWsDeflateContextTakeover) {
+    ClientDeflate client;
+    websocketpp::http::attribute_list response;
+    BOOST_REQUIRE(not client.negotiate(response).first);
+    BOOST_REQUIRE(not client.init(false));
+    ServerDeflate server;
+    BOOST_REQUIRE(not server.negotiate(response).first);
+    BOOST_REQUIRE(not server.init(true));
+
+    DeflateStats before = robocooler::driver::getDeflateStats();
+    std::string msg(LABELS);
+    std::string first;
+    std::string second;
+    BOOST_REQUIRE(not client.compress(msg, first));
+    BOOST_REQUIRE(not client.compress(msg, second));
+    /// Повтор посылки кодируется ссылкой на предыдущую.
+    BOOST_CHECK_LT(second.size(), first.size() / 2);
+
+    std::string unpacked;
+    BOOST_REQUIRE(not server.decompress(reinterpret_cast<const uint8_t*>(first.data()), first.size(), unpacked));
+    BOOST_CHECK_EQUAL(unpacked, msg);
+    unpacked.clear();
+    BOOST_REQUIRE(not server.decompress(reinterpret_cast<const uint8_t*>(second.data()), second.size(), unpacked));
+    BOOST_CHECK_EQUAL(unpacked, msg);
+
+    DeflateStats after = robocooler::driver::getDeflateStats();
+    BOOST_CHECK_EQUAL(after._messages - before._messages, 2);
+    BOOST_CHECK_EQUAL(after._raw_bytes - before._raw_bytes, 2 * msg.size());
+    BOOST_CHECK_EQUAL(after._packed_bytes - before._packed_bytes, first.size() + second.size() - 8);
+}
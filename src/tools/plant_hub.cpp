@@ -0,0 +1,593 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Локальная замена сервера PlantHub: сценарии дверных сессий и замер задержек ответов драйвера.
+ * \author Величко Ростислав
+ * \date   07.27.2017
+ */
+
+#include <csignal>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include <boost/program_options.hpp>
+
+#include "websocketpp/config/asio.hpp"
+#include "websocketpp/server.hpp"
+#include "websocketpp/extensions/permessage_deflate/enabled.hpp"
+
+#include "json.hpp"
+#include "Log.hpp"
+#include "CborReader.hpp"
+#include "WsClient.hpp"
+#include "SignalDispatcher.hpp"
+
+
+#define DEFAULT_PORT 8443
+#define DEFAULT_REPLY_TIMEOUT 30000 ///< Ожидание ответа на команду [милисекунды].
+
+/// Сценарий по умолчанию - дверная сессия: "<пауза от предыдущей команды, мс> <команда> [<аргументы json>]".
+static const char DEFAULT_SCRIPT[] =
+    "0     getAntennasConfiguration\n"
+    "1000  getContent\n"
+    "15000 openLeftDoor\n"
+    "5000  closeLeftDoor\n"
+    "15000 openRightDoor\n"
+    "5000  closeRightDoor\n";
+
+
+namespace bpo = boost::program_options;
+
+typedef utils::SignalDispatcher SignalDispatcher;
+typedef nlohmann::json Json;
+
+
+/// plant-hub -n 10 -r /tmp/hub.tsv
+/// driver --dev_off -u localhost -p 8443 -i 1
+
+
+namespace {
+
+/**
+ * \brief Конфигурация сервера: TLS, как у PlantHub, и сжатие, которое предлагает драйвер.
+ *        Драйвер подключается только по wss, поэтому asio_no_tls не подходит.
+ */
+struct HubConfig : public websocketpp::config::asio_tls {
+    typedef HubConfig type;
+    typedef websocketpp::config::asio_tls base;
+
+    typedef websocketpp::extensions::permessage_deflate::enabled<base::permessage_deflate_config> permessage_deflate_type;
+};
+
+
+/**
+ * \brief Функция выдаёт контексту самоподписанный сертификат на ключе P-256, созданный при запуске.
+ *        Драйвер сертификат сервера не проверяет.
+ */
+bool useEphemeralCert(SSL_CTX *ctx_) {
+    EVP_PKEY *key = nullptr;
+    EVP_PKEY_CTX *key_ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    if (key_ctx and
+        EVP_PKEY_keygen_init(key_ctx) > 0 and
+        EVP_PKEY_CTX_set_ec_paramgen_curve_nid(key_ctx, NID_X9_62_prime256v1) > 0) {
+        EVP_PKEY_keygen(key_ctx, &key);
+    }
+    EVP_PKEY_CTX_free(key_ctx);
+    if (not key) {
+        return false;
+    }
+    X509 *cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 365L * 24 * 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    bool is_ok = X509_sign(cert, key, EVP_sha256()) > 0 and
+                 SSL_CTX_use_certificate(ctx_, cert) == 1 and
+                 SSL_CTX_use_PrivateKey(ctx_, key) == 1;
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return is_ok;
+}
+
+
+/**
+ * \brief Сервер одного холодильника. Выполняет сценарий после addToGroup, записывает время каждой посылки
+ *        драйвера и сопоставляет ответы командам: ответ относится к самой старой команде, которая его ожидает.
+ *        Подтверждает события журнала (ackEvents) и версии разностной синхронизации меток, как сервер.
+ *        Все обработчики выполняются в потоке сервера.
+ */
+class PlantHub {
+    typedef websocketpp::server<HubConfig> Server;
+    typedef Server::message_ptr PMessage;
+    typedef Server::connection_ptr PConnection;
+    typedef websocketpp::connection_hdl ConnectionHdl;
+    typedef boost::asio::ssl::context TlsContext;
+    typedef websocketpp::lib::shared_ptr<TlsContext> PTlsContext;
+    typedef std::chrono::steady_clock Clock;
+
+    struct Step {
+        size_t _delay;       ///< Пауза после предыдущей команды [милисекунды].
+        std::string _method;
+        Json _args;
+    };
+
+    struct Pending {
+        std::string _method;
+        Clock::time_point _sent;
+    };
+
+    Server _server;
+    PTlsContext _tls_context;
+    std::vector<Step> _steps;
+    size_t _sessions;         ///< Повторов сценария.
+    size_t _reply_timeout;
+    bool _is_cbor;            ///< Выбирать двоичный подпротокол, если драйвер его предлагает.
+    std::ofstream _record;    ///< Запись посылок драйвера: время, метод, размер, задержка.
+
+    ConnectionHdl _hdl;
+    bool _is_connected;
+    bool _is_con_cbor;
+    bool _is_waiting;         ///< Очередная команда ждёт подключения драйвера.
+    bool _is_started;
+    bool _is_stopped;
+    size_t _session;
+    size_t _step;
+    std::deque<Pending> _pending;
+    Clock::time_point _start;
+    Clock::time_point _finish;
+
+    std::map<std::string, std::vector<double>> _latencies; ///< Задержки ответов по командам [милисекунды].
+    std::map<std::string, size_t> _received;               ///< Посылки драйвера по методам.
+    size_t _received_bytes;
+    size_t _connects;
+    size_t _timeouts;
+
+    static double ms(const Clock::time_point &from_, const Clock::time_point &to_) {
+        return std::chrono::duration<double, std::milli>(to_ - from_).count();
+    }
+
+    /**
+     * \brief Функция возвращает методы посылок драйвера, которыми он отвечает на команду.
+     */
+    static const std::vector<std::string>& replies(const std::string &method_) {
+        static const std::vector<std::string> labels = {"verifyLabelsSynchronization", "syncLabels"};
+        static const std::map<std::string, std::vector<std::string>> table = {
+            {"getContent", labels},
+            {"closeLeftDoor", labels},
+            {"closeRightDoor", labels},
+            {"requestLabelsSynchronization", labels},
+            {"getAntennasConfiguration", {"setCurrentConfiguration"}},
+            {"sendPutOrTakenGoodsByUser", {"setPutOrTakenGoods"}}
+        };
+        static const std::vector<std::string> none;
+        auto it = table.find(method_);
+        return it not_eq table.end() ? it->second : none;
+    }
+
+    void send(const std::string &method_, const Json &args_) {
+        Json msg = {{"H", "PlantHub"}, {"M", method_}, {"A", args_}};
+        websocketpp::lib::error_code ec;
+        if (_is_con_cbor) {
+            std::vector<uint8_t> data = Json::to_cbor(msg);
+            _server.send(_hdl, data.data(), data.size(), websocketpp::frame::opcode::binary, ec);
+        } else {
+            _server.send(_hdl, msg.dump(), websocketpp::frame::opcode::text, ec);
+        }
+        if (ec) {
+            LOG(WARNING) << "Can`t send " << method_ << ": " << ec.message();
+        }
+    }
+
+    void schedule(size_t delay_) {
+        _server.set_timer(static_cast<long>(delay_), [this](const websocketpp::lib::error_code &ec_) {
+            if (not ec_ and not _is_stopped) {
+                runStep();
+            }
+        });
+    }
+
+    /**
+     * \brief Метод снимает с ожидания команды без ответа дольше reply_timeout.
+     */
+    void expire(const Clock::time_point &now_) {
+        while (not _pending.empty() and ms(_pending.front()._sent, now_) > _reply_timeout) {
+            LOG(WARNING) << "No reply to " << _pending.front()._method;
+            _pending.pop_front();
+            ++_timeouts;
+        }
+    }
+
+    void runStep() {
+        if (not _is_connected) {
+            _is_waiting = true;
+            return;
+        }
+        const Step &step = _steps[_step];
+        Clock::time_point now = Clock::now();
+        expire(now);
+        if (not replies(step._method).empty()) {
+            _pending.push_back({step._method, now});
+        }
+        LOG(INFO) << "Session " << _session + 1 << "/" << _sessions << ": " << step._method;
+        send(step._method, step._args);
+        if (++_step == _steps.size()) {
+            _step = 0;
+            ++_session;
+        }
+        if (_session < _sessions) {
+            schedule(_steps[_step]._delay);
+        } else {
+            /// Дождаться ответов на последние команды.
+            _server.set_timer(static_cast<long>(_reply_timeout), [this](const websocketpp::lib::error_code&) {
+                finish();
+            });
+        }
+    }
+
+    void finish() {
+        if (_is_stopped) {
+            return;
+        }
+        expire(Clock::now() + std::chrono::milliseconds(_reply_timeout + 1));
+        _finish = Clock::now();
+        LOG(INFO) << "Script is done.";
+        /// Разбудить диспетчер сигналов в main.
+        std::raise(SIGTERM);
+    }
+
+    bool onValidate(ConnectionHdl hdl_) {
+        PConnection con = _server.get_con_from_hdl(hdl_);
+        const std::vector<std::string> &protocols = con->get_requested_subprotocols();
+        if (_is_cbor and std::find(protocols.begin(), protocols.end(), WS_SUBPROTOCOL_CBOR) not_eq protocols.end()) {
+            con->select_subprotocol(WS_SUBPROTOCOL_CBOR);
+        }
+        return true;
+    }
+
+    void onOpen(ConnectionHdl hdl_) {
+        PConnection con = _server.get_con_from_hdl(hdl_);
+        if (_is_connected) {
+            LOG(WARNING) << "Replace previous driver connection.";
+            websocketpp::lib::error_code ec;
+            _server.close(_hdl, websocketpp::close::status::policy_violation, "replaced", ec);
+        }
+        _hdl = hdl_;
+        _is_connected = true;
+        _is_con_cbor = (con->get_subprotocol() == WS_SUBPROTOCOL_CBOR);
+        ++_connects;
+        LOG(INFO) << "Driver connected: " << con->get_remote_endpoint()
+                  << (_is_con_cbor ? " CBOR" : " JSON")
+                  << " extensions \"" << con->get_request_header("Sec-WebSocket-Extensions") << "\"";
+    }
+
+    void onClose(ConnectionHdl hdl_) {
+        if (not _hdl.owner_before(hdl_) and not hdl_.owner_before(_hdl)) {
+            LOG(INFO) << "Driver disconnected.";
+            _is_connected = false;
+        }
+    }
+
+    void onMessage(ConnectionHdl, PMessage msg_) {
+        Clock::time_point now = Clock::now();
+        const std::string &payload = msg_->get_payload();
+        Json js;
+        if (msg_->get_opcode() == websocketpp::frame::opcode::binary) {
+            robocooler::driver::CborReader reader(reinterpret_cast<const uint8_t*>(payload.data()), payload.size());
+            if (not reader.read(js)) {
+                LOG(WARNING) << "Bad CBOR: " << reader.what();
+                js = Json();
+            }
+        } else {
+            js = Json::parse(payload, nullptr, false);
+        }
+        std::string method = "?";
+        const Json *args = nullptr;
+        if (js.is_object()) {
+            auto m = js.find("M");
+            if (m not_eq js.end() and m->is_string()) {
+                method = m->get<std::string>();
+            }
+            auto a = js.find("A");
+            if (a not_eq js.end() and a->is_object()) {
+                args = &(*a);
+            }
+        }
+        if (method == "addToGroup" and not _is_started) {
+            _start = now;
+        }
+        ++_received[method];
+        _received_bytes += payload.size();
+
+        /// Ответ относится к самой старой ожидающей его команде.
+        double latency = -1;
+        for (auto it = _pending.begin(); it not_eq _pending.end(); ++it) {
+            const std::vector<std::string> &expected = replies(it->_method);
+            if (std::find(expected.begin(), expected.end(), method) not_eq expected.end()) {
+                latency = ms(it->_sent, now);
+                _latencies[it->_method].push_back(latency);
+                _pending.erase(it);
+                break;
+            }
+        }
+        if (_record.is_open()) {
+            _record << ms(_start, now) << "\t" << method << "\t" << payload.size() << "\t";
+            if (latency < 0) {
+                _record << "-\n";
+            } else {
+                _record << latency << "\n";
+            }
+        }
+
+        if (args) {
+            auto seq = args->find("seq");
+            if (seq not_eq args->end() and seq->is_number_unsigned()) {
+                send("ackEvents", {{"seq", seq->get<uint64_t>()}});
+            }
+            auto version = args->find("version");
+            if (method == "syncLabels" and version not_eq args->end() and version->is_number_unsigned()) {
+                send("ackLabelsSynchronization", {{"version", version->get<uint64_t>()}});
+            }
+        }
+        if (method == "addToGroup") {
+            if (not _is_started) {
+                _is_started = true;
+                schedule(_steps[0]._delay);
+            } else if (_is_waiting) {
+                _is_waiting = false;
+                schedule(0);
+            }
+        }
+    }
+
+public:
+    typedef Step ScriptStep;
+
+    PlantHub(const std::vector<Step> &steps_, size_t sessions_, size_t reply_timeout_, bool is_cbor_,
+             const std::string &record_path_)
+        : _steps(steps_)
+        , _sessions(sessions_)
+        , _reply_timeout(reply_timeout_)
+        , _is_cbor(is_cbor_)
+        , _is_connected(false)
+        , _is_con_cbor(false)
+        , _is_waiting(false)
+        , _is_started(false)
+        , _is_stopped(false)
+        , _session(0)
+        , _step(0)
+        , _start(Clock::now())
+        , _finish(_start)
+        , _received_bytes(0)
+        , _connects(0)
+        , _timeouts(0) {
+        if (not record_path_.empty()) {
+            _record.open(record_path_);
+            _record << "ms\tmethod\tbytes\tlatency_ms\n";
+        }
+        namespace ph = websocketpp::lib::placeholders;
+        _server.clear_access_channels(websocketpp::log::alevel::all);
+        _server.clear_error_channels(websocketpp::log::elevel::all);
+        _server.set_validate_handler(websocketpp::lib::bind(&PlantHub::onValidate, this, ph::_1));
+        _server.set_open_handler(websocketpp::lib::bind(&PlantHub::onOpen, this, ph::_1));
+        _server.set_close_handler(websocketpp::lib::bind(&PlantHub::onClose, this, ph::_1));
+        _server.set_fail_handler(websocketpp::lib::bind(&PlantHub::onClose, this, ph::_1));
+        _server.set_message_handler(websocketpp::lib::bind(&PlantHub::onMessage, this, ph::_1, ph::_2));
+        _server.set_tls_init_handler([this](ConnectionHdl) {
+            return _tls_context;
+        });
+        _server.init_asio();
+        _server.set_reuse_addr(true);
+    }
+
+    /**
+     * \brief Метод готовит общий для подключений контекст TLS; без файлов создаётся временный сертификат.
+     */
+    bool initTls(const std::string &cert_path_, const std::string &key_path_) {
+        _tls_context = websocketpp::lib::make_shared<TlsContext>(TlsContext::sslv23_server);
+        boost::system::error_code ec;
+        _tls_context->set_options(TlsContext::default_workarounds |
+                                  TlsContext::no_sslv2 |
+                                  TlsContext::no_sslv3 |
+                                  TlsContext::no_tlsv1 |
+                                  TlsContext::no_tlsv1_1 |
+                                  TlsContext::no_compression, ec);
+        if (cert_path_.empty()) {
+            return useEphemeralCert(_tls_context->native_handle());
+        }
+        _tls_context->use_certificate_chain_file(cert_path_, ec);
+        if (not ec) {
+            _tls_context->use_private_key_file(key_path_, TlsContext::pem, ec);
+        }
+        if (ec) {
+            LOG(ERROR) << "Can`t load certificate: " << ec.message();
+        }
+        return not ec;
+    }
+
+    bool listen(uint16_t port_) {
+        websocketpp::lib::error_code ec;
+        _server.listen(port_, ec);
+        if (not ec) {
+            _server.start_accept(ec);
+        }
+        if (ec) {
+            LOG(ERROR) << "Can`t listen " << port_ << ": " << ec.message();
+        }
+        return not ec;
+    }
+
+    void run() {
+        _server.run();
+    }
+
+    /**
+     * \brief Метод завершает работу сервера. Может вызываться из любого потока, повторно.
+     */
+    void stop() {
+        _server.get_io_service().post([this] {
+            if (_is_stopped) {
+                return;
+            }
+            _is_stopped = true;
+            if (_finish == _start) {
+                _finish = Clock::now();
+            }
+            websocketpp::lib::error_code ec;
+            _server.stop_listening(ec);
+            if (_is_connected) {
+                _server.close(_hdl, websocketpp::close::status::going_away, "", ec);
+            }
+            _server.stop();
+        });
+    }
+
+    /**
+     * \brief Метод выводит распределения задержек ответов; вызывается после остановки сервера.
+     */
+    void report(std::ostream &out_) {
+        double elapsed = ms(_start, _finish);
+        out_ << "connects: " << _connects << ", sessions: " << _session << "/" << _sessions
+             << ", elapsed: " << elapsed << " ms, timeouts: " << _timeouts << "\n";
+        size_t total = 0;
+        for (const auto &rec : _received) {
+            total += rec.second;
+        }
+        out_ << "received: " << total << " messages, " << _received_bytes << " bytes";
+        if (elapsed > 0) {
+            out_ << ", " << total * 1000.0 / elapsed << " msg/s";
+        }
+        out_ << "\n";
+        for (const auto &rec : _received) {
+            out_ << "  " << rec.first << ": " << rec.second << "\n";
+        }
+        out_ << "latency [ms]: command n min p50 p90 p99 max mean\n";
+        for (auto &rec : _latencies) {
+            std::vector<double> &vals = rec.second;
+            std::sort(vals.begin(), vals.end());
+            double sum = 0;
+            for (double v : vals) {
+                sum += v;
+            }
+            auto pct = [&vals](size_t p_) {
+                return vals[std::min(vals.size() - 1, vals.size() * p_ / 100)];
+            };
+            out_ << "  " << rec.first << " " << vals.size() << " " << vals.front() << " " << pct(50) << " "
+                 << pct(90) << " " << pct(99) << " " << vals.back() << " " << sum / vals.size() << "\n";
+        }
+    }
+
+    /**
+     * \brief Функция разбирает сценарий; пустые строки и строки с # пропускаются.
+     */
+    static bool parseScript(std::istream &in_, std::vector<Step> &steps_) {
+        std::string line;
+        size_t num = 0;
+        while (std::getline(in_, line)) {
+            ++num;
+            size_t pos = line.find_first_not_of(" \t");
+            if (pos == std::string::npos or line[pos] == '#') {
+                continue;
+            }
+            std::istringstream ss(line);
+            Step step;
+            if (not (ss >> step._delay >> step._method)) {
+                LOG(ERROR) << "Bad script line " << num << ": " << line;
+                return false;
+            }
+            std::string args;
+            std::getline(ss, args);
+            step._args = args.find_first_not_of(" \t") == std::string::npos ? Json::object() :
+                         Json::parse(args, nullptr, false);
+            if (step._args.is_discarded()) {
+                LOG(ERROR) << "Bad JSON at script line " << num << ": " << args;
+                return false;
+            }
+            steps_.push_back(std::move(step));
+        }
+        return not steps_.empty();
+    }
+};
+} /// namespace
+
+
+int main(int argc, char **argv) {
+    LOG_TO_STDOUT;
+    LOG_TOGGLE(DEBUG, false);
+    LOG_TOGGLE(TRACE, false);
+    try {
+        size_t port;
+        size_t sessions;
+        size_t reply_timeout;
+        std::string script_path;
+        std::string record_path;
+        std::string cert_path;
+        std::string key_path;
+        bool is_cbor;
+        bpo::options_description desc("Локальный сервер PlantHub для нагрузочной проверки драйвера.\n" \
+                                      "Пример запуска: \"./plant-hub -n 10 -r /tmp/hub.tsv\", " \
+                                      "драйвер: \"./driver -u localhost -p 8443\"");
+        desc.add_options()
+          ("help,h", "Показать список параметров")
+          ("port,p", bpo::value<size_t>(&port)->default_value(DEFAULT_PORT), "Порт сервера")
+          ("sessions,n", bpo::value<size_t>(&sessions)->default_value(1), "Количество повторов сценария")
+          ("script,s", bpo::value<std::string>(&script_path),
+                       "Файл сценария: строки \"<пауза мс> <команда> [<аргументы json>]\"; по умолчанию дверная сессия")
+          ("record,r", bpo::value<std::string>(&record_path), "Файл записи посылок драйвера с временем и задержкой")
+          ("reply_timeout,t", bpo::value<size_t>(&reply_timeout)->default_value(DEFAULT_REPLY_TIMEOUT),
+                              "Ожидание ответа на команду [мс]")
+          ("cbor", bpo::bool_switch(&is_cbor)->default_value(false), "Выбирать двоичный подпротокол CBOR")
+          ("cert", bpo::value<std::string>(&cert_path), "Сертификат сервера PEM; по умолчанию временный")
+          ("key", bpo::value<std::string>(&key_path), "Закрытый ключ сервера PEM")
+          ; //NOLINT
+        bpo::variables_map vm;
+        bpo::store(bpo::parse_command_line(argc, argv, desc), vm);
+        bpo::notify(vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << "\n";
+            return 0;
+        }
+        std::vector<PlantHub::ScriptStep> steps;
+        bool is_parsed = false;
+        if (script_path.empty()) {
+            std::istringstream in(DEFAULT_SCRIPT);
+            is_parsed = PlantHub::parseScript(in, steps);
+        } else {
+            std::ifstream in(script_path);
+            is_parsed = in and PlantHub::parseScript(in, steps);
+        }
+        if (not is_parsed or sessions == 0) {
+            LOG(ERROR) << "Script is empty.";
+            return 1;
+        }
+        PlantHub hub(steps, sessions, reply_timeout, is_cbor, record_path);
+        if (not hub.initTls(cert_path, key_path) or not hub.listen(static_cast<uint16_t>(port))) {
+            return 1;
+        }
+        std::cout << "port: " << port << ", steps: " << steps.size() << ", sessions: " << sessions << "\n";
+        std::thread thread(&PlantHub::run, &hub);
+        /// Запустить диспетчер сигналов: SIGINT, SIGTERM или завершение сценария.
+        SignalDispatcher([&hub] {
+            hub.stop();
+        });
+        thread.join();
+        hub.report(std::cout);
+    } catch (std::exception &e) {
+        LOG(FATAL) << "EXCEPTION: " << e.what();
+    }
+    return 0;
+}
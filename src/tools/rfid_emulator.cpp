@@ -0,0 +1,111 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Эмулятор RFID считывателя на псевдотерминале для замеров и проверки драйвера без оборудования.
+ * \author Величко Ростислав
+ * \date   07.17.2017
+ */
+
+#include <unistd.h>
+
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <boost/program_options.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "Log.hpp"
+#include "ReaderEmulator.hpp"
+#include "SignalDispatcher.hpp"
+
+
+namespace bpo = boost::program_options;
+
+typedef utils::SignalDispatcher SignalDispatcher;
+typedef robocooler::rfid::ReaderEmulator ReaderEmulator;
+typedef std::shared_ptr<ReaderEmulator> PReaderEmulator;
+
+
+/// rfid-emulator -n 300 -l /tmp/ttyRFID
+/// rfid-reader -d /tmp/ttyRFID -i
+
+
+int main(int argc, char **argv) {
+    LOG_TO_STDOUT;
+    LOG_TOGGLE(DEBUG, false);
+    LOG_TOGGLE(TRACE, false);
+    try {
+        ReaderEmulator::Settings sets = ReaderEmulator::defaultSettings();
+        std::string probs;
+        std::string link;
+        size_t baud;
+        size_t rssi_min;
+        size_t rssi_max;
+        bpo::options_description desc("Эмулятор RFID считывателя на псевдотерминале.\n" \
+                                      "Пример запуска: \"./rfid-emulator -n 300 -p 0.9,0.8,0.8,0 -l /tmp/ttyRFID\"");
+        desc.add_options()
+          ("help,h", "Показать список параметров")
+          ("tags,n", bpo::value<size_t>(&sets._tags_num)->default_value(sets._tags_num), "Количество меток в шкафу")
+          ("epc_len,e", bpo::value<size_t>(&sets._epc_len)->default_value(sets._epc_len), "Длина EPC [байт]")
+          ("probs,p", bpo::value<std::string>(&probs)->default_value("0.9,0.9,0.9,0.9"),
+                      "Вероятность считывания метки за цикл для антенн 1..4, 0 - антенна не подключена")
+          ("rssi_min", bpo::value<size_t>(&rssi_min)->default_value(sets._rssi_min), "Нижняя граница RSSI")
+          ("rssi_max", bpo::value<size_t>(&rssi_max)->default_value(sets._rssi_max), "Верхняя граница RSSI")
+          ("baud,b", bpo::value<size_t>(&baud)->default_value(115200), "Скорость UART [бод], 0 - без ограничения")
+          ("round,r", bpo::value<size_t>(&sets._round_ms)->default_value(sets._round_ms),
+                      "Длительность цикла инвенторизации на антенне [мс]")
+          ("persist", bpo::value<size_t>(&sets._session_persist_ms)->default_value(sets._session_persist_ms),
+                      "Время сохранения флага сессий S1..S3 [мс]")
+          ("seed,s", bpo::value<uint32_t>(&sets._seed)->default_value(sets._seed), "Начальное значение генератора")
+          ("link,l", bpo::value<std::string>(&link), "Символическая ссылка на псевдотерминал для драйвера")
+          ; //NOLINT
+        bpo::variables_map vm;
+        bpo::store(bpo::parse_command_line(argc, argv, desc), vm);
+        bpo::notify(vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << "\n";
+            return 0;
+        }
+        std::vector<std::string> prob_strs;
+        boost::split(prob_strs, probs, boost::is_any_of(","));
+        for (size_t a = 0; a < RFID_EMU_ANTS_NUM; ++a) {
+            sets._read_prob[a] = a < prob_strs.size() ? std::stod(prob_strs[a]) : 0.0;
+        }
+        sets._rssi_min = static_cast<uint8_t>(std::min<size_t>(rssi_min, 0x7f));
+        sets._rssi_max = static_cast<uint8_t>(std::min<size_t>(rssi_max, 0x7f));
+        sets._bytes_per_sec = baud / 10; ///< 8N1: 10 бит на байт.
+
+        PReaderEmulator emu = std::make_shared<ReaderEmulator>(sets);
+        if (not emu->isInit()) {
+            LOG(ERROR) << emu->what();
+            return 1;
+        }
+        std::string device = emu->getSlaveName();
+        if (not link.empty()) {
+            unlink(link.c_str());
+            if (symlink(device.c_str(), link.c_str()) == 0) {
+                device = link;
+            } else {
+                LOG(ERROR) << "Can`t create link " << link;
+            }
+        }
+        std::cout << "device: " << device << "\n"
+                  << "tags: " << sets._tags_num << ", baud: " << baud << ", round: " << sets._round_ms << " ms\n";
+        /// Запустить диспетчер сигналов прерывания работы SIGINT и SIGTERM.
+        SignalDispatcher([] {
+            LOG(INFO) << "Stop emulator.";
+        });
+        std::cout << "requests: " << emu->getFramesIn()
+                  << ", responses: " << emu->getFramesOut()
+                  << ", tags: " << emu->getTagsOut() << "\n";
+        if (device == link) {
+            unlink(link.c_str());
+        }
+        emu.reset();
+    } catch (std::exception &e) {
+        LOG(FATAL) << "EXCEPTION: " << e.what();
+    }
+    return 0;
+}
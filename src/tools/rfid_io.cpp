@@ -83,6 +83,9 @@ std::string cmd_codes = "Reader control commands:\n" \
                         "18000-6C Commands:\n" \
                         "cmd_inventory = 0x80\n" \
                         "cmd_read      = 0x81\n" \
+                        "cmd_real_time_inventory = 0x89\n" \
+                        "cmd_fast_switch_ant_inventory = 0x8a\n" \
+                        "cmd_customized_session_target_inventory = 0x8b\n" \
                         "Buffer control commands:\n" \
                         "cmd_get_inventory_buffer           = 0x90\n" \
                         "cmd_get_and_reset_inventory_buffer = 0x91\n" \
@@ -34,8 +34,6 @@ typedef utils::SignalDispatcher SignalDispatcher;
 typedef robocooler::rfid::Message::Buffer RfidBuffer;
 typedef robocooler::rfid::Command::ECommandId RfidCid;
 typedef robocooler::driver::RfidController RfidController;
-typedef robocooler::driver::MapReadDatas MapReadDatas;
-typedef robocooler::driver::ReadDataIter ReadDataIter;
 typedef std::shared_ptr<RfidController> PRfidController;
 typedef utils::Timer Timer;
 
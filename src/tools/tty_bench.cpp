@@ -0,0 +1,239 @@
+/** Copyright &copy; 2017, rostislav.vel@gmail.com.
+ * \brief  Тестовое приложение для измерения скорости приёма из последовательного порта.
+ *         Сравнивает побайтное чтение с паузой 1 мс и чтение блоками по событию poll
+ *         на выгрузке буфера меток (cmd_get_and_reset_inventory_buffer) через псевдотерминал.
+ * \author Величко Ростислав
+ * \date   17.08.2017
+ */
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+
+#include <boost/program_options.hpp>
+
+#include "Log.hpp"
+#include "TtyIo.hpp"
+#include "Message.hpp"
+#include "CommandsHandler.hpp"
+
+
+#define DEFAULT_TAGS_NUM 200
+#define DEFAULT_RUNS_NUM 3
+#define DEFAULT_EPC_LEN 12
+#define UART_BYTES_PER_SEC 11520 ///< 115200 бод, 10 бит на байт.
+#define PACE_CHUNK 64            ///< Размер блока записи при эмуляции скорости UART.
+#define READOUT_DEADLINE 60      ///< Предельное время одного замера [секунды].
+
+namespace bpo = boost::program_options;
+namespace chr = std::chrono;
+
+typedef robocooler::rfid::Message RfidMessage;
+typedef robocooler::rfid::Message::Buffer RfidBuffer;
+typedef robocooler::rfid::Command RfidCmd;
+typedef robocooler::rfid::Command::ECommandId RfidCid;
+typedef robocooler::rfid::CommandsHandler RfidCommandsHandler;
+typedef chr::steady_clock Clock;
+
+
+struct BenchResult {
+    size_t _bytes;       ///< Количество переданных байт.
+    size_t _tags;        ///< Количество разобранных меток.
+    double _readout_ms;  ///< Время от первого записанного байта до последней разобранной метки.
+    double _tail_ms;     ///< Время от последнего записанного байта до последней разобранной метки.
+};
+
+
+/**
+ * \brief Функция формирует ответы на cmd_get_and_reset_inventory_buffer для заданного количества меток.
+ */
+static RfidBuffer makeReadout(size_t tags_num_) {
+    RfidBuffer out;
+    for (size_t t = 0; t < tags_num_; ++t) {
+        RfidBuffer data;
+        data.push_back(static_cast<uint8_t>((tags_num_ >> 8) & 0xff));
+        data.push_back(static_cast<uint8_t>(tags_num_ & 0xff));
+        data.push_back(DEFAULT_EPC_LEN + 4); ///< PC + EPC + CRC.
+        data.push_back(0x30);
+        data.push_back(0x00);
+        for (size_t e = 0; e < DEFAULT_EPC_LEN; ++e) {
+            data.push_back(static_cast<uint8_t>((t >> (8 * (e % 4))) & 0xff));
+        }
+        data.push_back(0x12);
+        data.push_back(0x34);
+        data.push_back(0x50);                           ///< RSSI.
+        data.push_back(static_cast<uint8_t>(t & 0x03)); ///< Частота | антенна.
+        data.push_back(0x01);                           ///< Количество опросов.
+        RfidMessage msg(RFID_ADDR, static_cast<uint8_t>(RfidCid::cmd_get_and_reset_inventory_buffer), data);
+        out.insert(out.end(), msg.getFrame(), msg.getFrame() + msg.getSize());
+    }
+    return out;
+}
+
+
+static double toMs(const Clock::duration &d_) {
+    return chr::duration_cast<chr::microseconds>(d_).count() / 1000.0;
+}
+
+
+/**
+ * \brief Функция выполняет один замер выгрузки буфера меток.
+ * \param event_mode_  true - чтение блоками по событию, false - побайтное чтение с паузой 1 мс.
+ * \param pace_        true - эмулировать скорость UART 115200.
+ */
+static BenchResult runOnce(bool event_mode_, bool pace_, size_t tags_num_) {
+    BenchResult res = {0, 0, 0.0, 0.0};
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 or grantpt(master) not_eq 0 or unlockpt(master) not_eq 0) {
+        LOG(ERROR) << "Can`t open pseudo terminal.";
+        return res;
+    }
+    std::string slave_name = ptsname(master);
+    utils::TtyIo tty_io(slave_name, B115200);
+    if (not tty_io.isInit()) {
+        LOG(ERROR) << tty_io.what();
+        close(master);
+        return res;
+    }
+    RfidCommandsHandler hdl(&tty_io);
+    std::atomic<size_t> tags(0);
+    hdl.initOnReadDataFunc([&tags](const RfidCmd::ReadCmdData&) {
+        ++tags;
+    });
+
+    RfidBuffer readout = makeReadout(tags_num_);
+    res._bytes = readout.size();
+    Clock::time_point start;
+    Clock::time_point written;
+    std::atomic_bool is_written(false);
+    start = Clock::now();
+    std::thread writer([&] {
+        size_t pos = 0;
+        while (pos < readout.size()) {
+            size_t len = pace_ ? std::min<size_t>(PACE_CHUNK, readout.size() - pos) : readout.size() - pos;
+            ssize_t wlen = ::write(master, &readout[pos], len);
+            if (wlen <= 0) {
+                break;
+            }
+            pos += static_cast<size_t>(wlen);
+            if (pace_) {
+                std::this_thread::sleep_until(start + chr::microseconds(pos * 1000000 / UART_BYTES_PER_SEC));
+            }
+        }
+        written = Clock::now();
+        is_written = true;
+    });
+
+    Clock::time_point deadline = start + chr::seconds(READOUT_DEADLINE);
+    Clock::time_point last = start;
+    if (event_mode_) {
+        uint8_t buf[1024];
+        while (tags < tags_num_ and Clock::now() < deadline) {
+            int rlen = tty_io.readAvailable(buf, sizeof(buf), 100);
+            if (rlen > 0) {
+                hdl.receiveChunk(buf, static_cast<size_t>(rlen), RfidCommandsHandler::OnCmdResultFunc());
+                last = Clock::now();
+            }
+        }
+    } else {
+        while (tags < tags_num_ and Clock::now() < deadline) {
+            uint8_t byte = 0;
+            int rlen = tty_io.read(&byte, 1);
+            if (rlen > 0) {
+                hdl.receivePacket(byte);
+                last = Clock::now();
+            }
+            std::this_thread::sleep_for(chr::milliseconds(1));
+        }
+    }
+    writer.join();
+    close(master);
+    res._tags = tags;
+    res._readout_ms = toMs(last - start);
+    res._tail_ms = is_written ? std::max(0.0, toMs(last - written)) : 0.0;
+    return res;
+}
+
+
+static void report(const std::string &name_, const std::vector<BenchResult> &results_) {
+    double readout_ms = 0.0;
+    double tail_ms = 0.0;
+    size_t bytes = 0;
+    size_t tags = 0;
+    for (const BenchResult &r : results_) {
+        readout_ms += r._readout_ms;
+        tail_ms += r._tail_ms;
+        bytes += r._bytes;
+        tags += r._tags;
+    }
+    double n = static_cast<double>(results_.size());
+    double bps = readout_ms > 0.0 ? bytes * 1000.0 / readout_ms : 0.0;
+    std::cout << std::left << std::setw(8) << name_ << std::fixed << std::setprecision(1)
+              << " bytes/s: " << std::setw(10) << bps
+              << " readout: " << std::setw(9) << readout_ms / n << " ms"
+              << " tail: " << std::setw(8) << tail_ms / n << " ms"
+              << " tags: " << tags / results_.size() << "\n";
+}
+
+
+/// tty-bench -n 200 -r 3
+/// tty-bench -n 500 --no-pace
+
+
+int main(int argc, char **argv) {
+    LOG_TO_STDOUT;
+    LOG_TOGGLE(DEBUG, false);
+    LOG_TOGGLE(TRACE, false);
+    try {
+        size_t tags_num;
+        size_t runs_num;
+        std::string mode;
+        bpo::options_description desc("Замер скорости приёма выгрузки буфера меток RFID через псевдотерминал.\n" \
+                                      "Пример запуска: \"./tty-bench -n 200 -r 3\"");
+        desc.add_options()
+          ("help,h", "Показать список параметров")
+          ("tags,n", bpo::value<size_t>(&tags_num)->default_value(DEFAULT_TAGS_NUM), "Количество меток в буфере")
+          ("runs,r", bpo::value<size_t>(&runs_num)->default_value(DEFAULT_RUNS_NUM), "Количество замеров")
+          ("mode,m", bpo::value<std::string>(&mode)->default_value("both"), "Режим чтения: legacy | event | both")
+          ("no-pace", "Не ограничивать скорость записи скоростью UART 115200")
+          ; //NOLINT
+        bpo::variables_map vm;
+        bpo::store(bpo::parse_command_line(argc, argv, desc), vm);
+        bpo::notify(vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << "\n";
+            return 0;
+        }
+        bool pace = not vm.count("no-pace");
+        runs_num = std::max<size_t>(runs_num, 1);
+        std::cout << "tags: " << tags_num << ", runs: " << runs_num
+                  << ", pace: " << (pace ? "115200" : "none") << "\n";
+        if (mode == "legacy" or mode == "both") {
+            std::vector<BenchResult> results;
+            for (size_t r = 0; r < runs_num; ++r) {
+                results.push_back(runOnce(false, pace, tags_num));
+            }
+            report("legacy", results);
+        }
+        if (mode == "event" or mode == "both") {
+            std::vector<BenchResult> results;
+            for (size_t r = 0; r < runs_num; ++r) {
+                results.push_back(runOnce(true, pace, tags_num));
+            }
+            report("event", results);
+        }
+    } catch (std::exception &e) {
+        LOG(FATAL) << "EXCEPTION: " << e.what();
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*!
+ * \brief  Последовательный исполнитель задач в отдельном потоке.
+ * \author R.N.Velichko rostislav.vel@gmail.com
+ * \date   07.28.2017
+ */
+
+#pragma once
+
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+#include "Log.hpp"
+
+namespace utils {
+
+/**
+ * Исполнитель выполняет задачи по одной в собственном потоке в порядке постановки.
+ * Постановка задачи не ждёт её выполнения, поэтому вызывающий поток не блокируется длительными операциями.
+ */
+class Executor {
+public:
+    typedef std::function<void()> Task;
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _task_cond;  ///< Появление задачи или остановка.
+    std::condition_variable _idle_cond;  ///< Очередь выполнена.
+    std::deque<Task> _tasks;             ///< Очередь задач.
+    bool _is_busy;                       ///< Задача выполняется.
+    bool _is_run;                        ///< Флаг работы потока.
+    std::thread _thread;                 ///< Поток выполнения.
+
+    void run() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (_is_run) {
+            if (_tasks.empty()) {
+                _idle_cond.notify_all();
+                _task_cond.wait(lock);
+                continue;
+            }
+            Task task = std::move(_tasks.front());
+            _tasks.pop_front();
+            _is_busy = true;
+            lock.unlock();
+            try {
+                task();
+            } catch (const std::exception &e) {
+                LOG(ERROR) << "Task is failed: " << e.what();
+            }
+            lock.lock();
+            _is_busy = false;
+        }
+        _idle_cond.notify_all();
+    }
+
+    bool isExecutorThread() const {
+        return std::this_thread::get_id() == _thread.get_id();
+    }
+
+public:
+    Executor()
+        : _is_busy(false)
+        , _is_run(true) {
+        _thread = std::thread(&Executor::run, this);
+    }
+
+    /**
+     * Невыполненные задачи отбрасываются, выполняемая задача дожидается завершения.
+     */
+    ~Executor() {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _is_run = false;
+            _tasks.clear();
+            _task_cond.notify_all();
+        }
+        if (isExecutorThread()) {
+            _thread.detach();
+        } else {
+            _thread.join();
+        }
+    }
+
+    /**
+     * Метод ставит задачу в очередь. Может вызываться из любого потока, в том числе из задачи.
+     */
+    void post(const Task &task_) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_is_run) {
+            _tasks.push_back(task_);
+            _task_cond.notify_one();
+        }
+    }
+
+    /**
+     * Метод дожидается выполнения всех поставленных задач. Из задачи вызывается без ожидания.
+     */
+    void wait() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (isExecutorThread()) {
+            return;
+        }
+        _idle_cond.wait(lock, [this] {
+            return not _is_run or (_tasks.empty() and not _is_busy);
+        });
+    }
+
+    /**
+     * Метод возвращает количество задач в очереди.
+     */
+    size_t size() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        return _tasks.size();
+    }
+};
+} /// utils
@@ -49,7 +49,7 @@ public:
 private:
     typedef std::tuple<Level, std::string, std::string, Timeval> QueueTask;
     typedef std::queue<QueueTask> Queue;
-    typedef std::array<bool, static_cast<size_t>(Level::_quantity)> ToggleArray;
+    typedef std::array<std::atomic_bool, static_cast<size_t>(Level::_quantity)> ToggleArray;
 
     
     ToggleArray _toggle_levels;
@@ -96,6 +96,13 @@ public:
 
     void toggle(const Level& level_, bool is_on_);
 
+    /**
+     * Метод проверяет, выводится ли уровень, без блокировки очереди сообщений.
+     */
+    bool isEnabled(const Level& level_) const {
+        return _toggle_levels[static_cast<size_t>(level_)];
+    }
+
     bool isLogOutFile() const;
 };
 
@@ -154,6 +161,16 @@ struct LogSequence {
     }
 };
 
+
+
+/**
+ * Приводит цепочку вывода в LOG к void для тернарного оператора, пропускающего выключенные уровни.
+ */
+struct LogVoidify {
+    template<class Type>
+    void operator & (const Type&) {
+    }
+};
 } /// utils
 
 
@@ -174,10 +191,16 @@ struct LogSequence {
 
 #define IS_LOG_TO_FILE utils::Singleton<utils::Log>::getShared()->isLogOutFile()
 
-#define LOGM(level, method) utils::LogSequence XAFTERX(log_, __LINE__)((level), (method)); XAFTERX(log_, __LINE__) << ""
+/**
+ * Для выключенного уровня сообщение не формируется: аргументы не вычисляются, память не выделяется.
+ * В отличие от прежнего LOGM, побочные эффекты выражений в цепочке << при выключенном уровне не выполняются,
+ * поэтому в LOG допустимы только выражения без побочных эффектов.
+ */
+#define LOGM(level, method) not LOG_IS_ON(level) ? (void)0 : utils::LogVoidify() & utils::LogSequence((level), (method)) << ""
 #define LOG(level) LOGM((level), METHOD)
 
 #define LOG_TOGGLE(level, is_on) utils::Singleton<utils::Log>::getShared()->toggle((level), (is_on));
+#define LOG_IS_ON(level) utils::Singleton<utils::Log>::getShared()->isEnabled(level)
 
 #define TEST   utils::Log::Level::_test
 #define DEBUG   utils::Log::Level::_debug
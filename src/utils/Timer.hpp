@@ -8,118 +8,216 @@
 
 #include <chrono>
 #include <thread>
-#include <atomic>
 #include <mutex>
-#include <algorithm>
+#include <memory>
+#include <map>
+#include <functional>
 #include <condition_variable>
 
+#include "Singleton.hpp"
+
 namespace utils {
 
 namespace chr = std::chrono;
 
-/// Шаг асинхронного ожидания истечения заданного времени в милисекундах
-static const size_t ASYNC_THRED_STEP = 10; // mlsec
+
+/**
+ * Общий поток обслуживания всех таймеров.
+ * Сроки хранятся в упорядоченной очереди, поток спит до ближайшего срока и не просыпается без задач.
+ * Задачи выполняются по очереди в этом потоке, поэтому длительные операции задерживают остальные таймеры.
+ */
+class TimerScheduler {
+public:
+    typedef chr::steady_clock Clock;
+    typedef std::function<void()> Task;
+
+    struct Entry;
+    typedef std::shared_ptr<Entry> PEntry;
+    typedef std::multimap<Clock::time_point, PEntry> Queue;
+
+    struct Entry {
+        Task _task;             ///< Выполняемая функция.
+        Queue::iterator _pos;   ///< Положение в очереди сроков, действительно при _is_armed.
+        bool _is_armed;         ///< Срок назначен.
+        bool _is_running;       ///< Функция выполняется.
+        size_t _fired;          ///< Количество выполнений.
+
+        Entry()
+            : _is_armed(false)
+            , _is_running(false)
+            , _fired(0)
+        {}
+    };
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _wake_cond;  ///< Пробуждение потока при появлении более раннего срока.
+    std::condition_variable _done_cond;  ///< Уведомление о завершении очередной задачи.
+    Queue _queue;                        ///< Очередь сроков.
+    bool _is_run;                        ///< Флаг работы потока.
+    std::thread _thread;                 ///< Поток обслуживания.
+
+    void run() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (_is_run) {
+            if (_queue.empty()) {
+                _wake_cond.wait(lock);
+                continue;
+            }
+            Queue::iterator iter = _queue.begin();
+            if (Clock::now() < iter->first) {
+                _wake_cond.wait_until(lock, iter->first);
+                continue;
+            }
+            /// Держать задачу, даже если таймер будет уничтожен из неё самой.
+            PEntry entry = iter->second;
+            _queue.erase(iter);
+            entry->_is_armed = false;
+            entry->_is_running = true;
+            lock.unlock();
+            entry->_task();
+            lock.lock();
+            entry->_is_running = false;
+            ++entry->_fired;
+            _done_cond.notify_all();
+        }
+    }
+
+    bool isSchedulerThread() const {
+        return std::this_thread::get_id() == _thread.get_id();
+    }
+
+public:
+    TimerScheduler()
+        : _is_run(true) {
+        _thread = std::thread(&TimerScheduler::run, this);
+    }
+
+    ~TimerScheduler() {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _is_run = false;
+            _wake_cond.notify_all();
+        }
+        if (isSchedulerThread()) {
+            _thread.detach();
+        } else {
+            _thread.join();
+        }
+    }
+
+    /**
+     * Метод назначает (или переназначает) срок выполнения задачи.
+     */
+    void schedule(const PEntry &entry_, const Clock::time_point &deadline_) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (entry_->_is_armed) {
+            _queue.erase(entry_->_pos);
+        }
+        entry_->_pos = _queue.insert(std::make_pair(deadline_, entry_));
+        entry_->_is_armed = true;
+        if (entry_->_pos == _queue.begin()) {
+            _wake_cond.notify_one();
+        }
+    }
+
+    /**
+     * Метод переносит срок выполнения задачи, только если он ещё назначен.
+     * \return false, если задача уже выполнена или снята с очереди.
+     */
+    bool advance(const PEntry &entry_, const Clock::time_point &deadline_) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (not entry_->_is_armed) {
+            return false;
+        }
+        _queue.erase(entry_->_pos);
+        entry_->_pos = _queue.insert(std::make_pair(deadline_, entry_));
+        if (entry_->_pos == _queue.begin()) {
+            _wake_cond.notify_one();
+        }
+        return true;
+    }
+
+    /**
+     * Метод снимает задачу с очереди и дожидается её завершения, если она выполняется.
+     * Из задачи таймера вызывается без ожидания.
+     */
+    void cancel(const PEntry &entry_) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (entry_->_is_armed) {
+            _queue.erase(entry_->_pos);
+            entry_->_is_armed = false;
+        }
+        if (not isSchedulerThread()) {
+            _done_cond.wait(lock, [&entry_] {
+                return not entry_->_is_running;
+            });
+        }
+    }
+
+    /**
+     * Метод дожидается очередного выполнения задачи, если её срок назначен или она выполняется.
+     */
+    void wait(const PEntry &entry_) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (isSchedulerThread()) {
+            return;
+        }
+        size_t fired = entry_->_fired;
+        _done_cond.wait(lock, [&entry_, fired] {
+            return entry_->_fired not_eq fired or not (entry_->_is_armed or entry_->_is_running);
+        });
+    }
+};
 
 
 /**
- * Таймер с корректной обработкой и остановкой потока.
+ * Таймер однократного выполнения функции с возможностью перезапуска.
+ * Все таймеры обслуживаются одним потоком TimerScheduler.
  */
 class Timer {
-    typedef std::thread Thread;
-    typedef std::shared_ptr<Thread> PThread;
-    typedef std::condition_variable Condition;
-    typedef std::shared_ptr<Condition> PCondition;
-
-    std::atomic_bool _is_restart;         ///< Атомарный флаг перезапуска.
-    std::atomic_bool _is_run;             ///< Атомарный флаг.
-    PThread _thread;                      ///< Поток таймера.
-    std::mutex _mutex;                    ///< Объект синхронизации доступа к стартовому времени таймера.
-    chr::steady_clock::time_point _start; ///< Начальное время таймера.
-    PCondition _wait_condition;           ///< Условная переменная синхронизации для реализации ожидания срабатывания таймера.
-    size_t _mlsleep;                       ///< Промежуток времени, обслужываемый таймером.
+    typedef TimerScheduler::Clock Clock;
+    typedef std::shared_ptr<TimerScheduler> PTimerScheduler;
+
+    PTimerScheduler _scheduler;       ///< Общий поток таймеров, живёт не меньше таймера.
+    TimerScheduler::PEntry _entry;    ///< Задача таймера в очереди сроков.
+    size_t _mlsleep;                  ///< Промежуток времени, обслужываемый таймером.
 
 public:
     /**
-     * Шаблонный конструктор объекта асинхронного таймера с периодическим освобождением потока.
+     * Шаблонный конструктор объекта асинхронного таймера.
      * \param  mlsleep_  Интервал задержки до выполненения переданной функции в милисекундах.
      * \param  callback_ Выполняемая функция.
      * \param  аrgs_     Изменяемый набор параметров выполняемой функции.
      */
     template<class Callable, class... Arguments>
     Timer(size_t mlsleep_, Callable &&callback_, Arguments&&... args_)
-        : _mlsleep(mlsleep_) {
+        : _scheduler(Singleton<TimerScheduler>::getShared())
+        , _entry(std::make_shared<TimerScheduler::Entry>())
+        , _mlsleep(mlsleep_) {
         /// Функтор с переменным числом параметров.
-        auto task(std::bind(std::forward<Callable>(callback_), std::forward<Arguments>(args_)...));
-        /// Запуск асинхронного потока.
-        _thread = std::shared_ptr<Thread>(new Thread([=] {
-            /// Инициализация запуска.
-            _is_run = true;
-            _is_restart = true;
-            /// Получить время отсчёта таймера.
-            _start = chr::steady_clock::now();
-            /// Запустить цикл таймера до вызова деструктора.
-            while (_is_run) {
-                /// Заснуть на время не больше пошагового интервала.
-                std::this_thread::sleep_for(chr::milliseconds(std::min(ASYNC_THRED_STEP, mlsleep_)));
-                /// Проверить готовность таймера.
-                chr::nanoseconds diff;
-                {
-                    std::unique_lock<std::mutex> lock(_mutex);
-                    diff = chr::duration_cast<chr::nanoseconds>(chr::steady_clock::now() - _start);
-                }
-                if (_is_restart) {
-                    size_t diff_timeout = static_cast<size_t>(std::chrono::duration_cast<chr::milliseconds>(diff).count());
-                    if (mlsleep_ <= diff_timeout) {
-                        /// Сбросить атомарный флага перезапуска.
-                        _is_restart = false;
-                        /// Выполнить задачу.
-                        task();
-                        /// Просигнализировать ожидающую переменную.
-                        if (_wait_condition) {
-                            _wait_condition->notify_one();
-                        }
-                    }
-                }
-            }
-        }), [this](Thread *p_) {
-            p_->join();
-        });
+        _entry->_task = std::bind(std::forward<Callable>(callback_), std::forward<Arguments>(args_)...);
+        _scheduler->schedule(_entry, Clock::now() + chr::milliseconds(mlsleep_));
     }
 
     ~Timer() {
-        /// Корректное уничтожение запущенного потока.
-        _is_restart = false;
-        _is_run = false;
+        /// После выхода из деструктора функция таймера не выполняется.
+        _scheduler->cancel(_entry);
     }
 
     void executeNow() {
-        if (_thread) {
-            std::unique_lock<std::mutex> lock(_mutex);
-            _start += chr::milliseconds(_mlsleep);
-        }
+        /// Сработавший таймер повторно не выполняется.
+        _scheduler->advance(_entry, Clock::now());
     }
 
     void wait() {
-        /// Ожидание завершения выполнения потока.
-        if (_thread) {
-            /// Проинициализировать условную переменную по требования.
-            _wait_condition = std::make_shared<std::condition_variable>();
-            /// Активировать ожидание нотификации.
-            std::unique_lock<std::mutex> lock(_mutex);
-            _wait_condition->wait(lock);
-        }
+        /// Ожидание выполнения функции таймера.
+        _scheduler->wait(_entry);
     }
 
     void restart() {
-        if (_thread) {
-            /// Активировать атомарный флага перезапуска.
-            _is_restart = true;
-            /// обновить время запуска таймера.
-            {
-                std::unique_lock<std::mutex> lock(_mutex);
-                _start = chr::steady_clock::now();
-            }
-        }
+        /// Обновить время срабатывания таймера.
+        _scheduler->schedule(_entry, Clock::now() + chr::milliseconds(_mlsleep));
     }
 };
 } /// utils
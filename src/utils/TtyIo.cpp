@@ -1,3 +1,6 @@
+#include <poll.h>
+#include <sys/eventfd.h>
+
 #include <sstream>
 
 #include "TtyIo.hpp"
@@ -61,7 +64,8 @@ bool TtyIo::setMincount(bool mcount_, int mtime_) {
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
-TtyIo::TtyIo(const std::string &tty_name_, int tty_speed_) {
+TtyIo::TtyIo(const std::string &tty_name_, int tty_speed_)
+    : _wake_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
     _fd = open(tty_name_.c_str(), O_RDWR | O_NOCTTY | O_SYNC);
     if (_fd < 0) {
         std::stringstream ss;
@@ -78,6 +82,9 @@ TtyIo::~TtyIo() {
     if (_fd >= 0) {
         close(_fd);
     }
+    if (_wake_fd >= 0) {
+        close(_wake_fd);
+    }
 }
 
 
@@ -102,6 +109,20 @@ int TtyIo::write(const std::vector<uint8_t> &ibuf_) {
 }
 
 
+int TtyIo::write(const uint8_t *ibuf_, size_t len_) {
+    int wlen = ERROR_LEN;
+    if (_fd >= 0) {
+        wlen = ::write(_fd, ibuf_, len_);
+        if (wlen not_eq static_cast<int>(len_)) {
+            std::stringstream ss;
+            ss << "Error from write: " << std::to_string(wlen) << ", " << strerror(errno);
+            _what = ss.str();
+        }
+    }
+    return wlen;
+}
+
+
 int TtyIo::read(uint8_t *obuf_, size_t len_) {
     int rlen = ERROR_LEN;
     if (_fd >= 0) {
@@ -116,6 +137,61 @@ int TtyIo::read(uint8_t *obuf_, size_t len_) {
 }
 
 
+int TtyIo::readAvailable(uint8_t *obuf_, size_t len_, int timeout_ms_) {
+    if (_fd < 0) {
+        return ERROR_LEN;
+    }
+    struct pollfd fds[2];
+    fds[0].fd = _fd;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    fds[1].fd = _wake_fd;
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+    nfds_t nfds = (_wake_fd >= 0) ? 2 : 1;
+    int pres = poll(fds, nfds, timeout_ms_);
+    if (pres < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        std::stringstream ss;
+        ss << std::string("Error from poll: ") << strerror(errno);
+        _what = ss.str();
+        return ERROR_LEN;
+    }
+    if (nfds == 2 and (fds[1].revents & POLLIN)) {
+        /// Сбросить счётчик пробуждений.
+        eventfd_t val;
+        eventfd_read(_wake_fd, &val);
+    }
+    if (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        _what = "Error from poll: device is disconnected";
+        return ERROR_LEN;
+    }
+    int rlen = 0;
+    if (fds[0].revents & POLLIN) {
+        /// Данные уже в драйвере: read вернёт всё доступное, не дожидаясь VTIME.
+        rlen = ::read(_fd, obuf_, len_);
+        if (rlen == ERROR_LEN) {
+            if (errno == EAGAIN or errno == EINTR) {
+                return 0;
+            }
+            std::stringstream ss;
+            ss << std::string("Error from read: ") << std::to_string(rlen) << ": " << strerror(errno);
+            _what = ss.str();
+        }
+    }
+    return rlen;
+}
+
+
+void TtyIo::interrupt() {
+    if (_wake_fd >= 0) {
+        eventfd_write(_wake_fd, 1);
+    }
+}
+
+
 bool TtyIo::isInit() {
     return (_fd >= 0);
 }
@@ -21,11 +21,13 @@
 
 #define NO_ERROR 0
 #define ERROR_LEN -1
+#define NO_DATA_TIMEOUT -1 ///< Ожидать данные без ограничения по времени.
 
 namespace utils {
 
 class TtyIo {
     int _fd;           /// Дескриптор файла порта.
+    int _wake_fd;      /// Дескриптор eventfd для прерывания ожидания данных.
     std::string _what; /// Строка с сообщением об ошибке.
 
     /**
@@ -62,6 +64,14 @@ public:
      */
     int write(const std::vector<uint8_t> &ibuf_);
 
+    /**
+     * Метод выполняет запись байт из непрерывного массива в порт объмена.
+     * \param  ibuf_  Указатель на данные на отправку.
+     * \param  len_   Количество байт.
+     * \return  Возвращает количество отправленных байт либо -1 в случае ошибки.
+     */
+    int write(const uint8_t *ibuf_, size_t len_);
+
     /**
      * Метод выполняет чтение байт из порта объмена.
      * \param  obuf_  Указатель на массив для записи полученных данных.
@@ -70,6 +80,20 @@ public:
      */
     int read(uint8_t *obuf_, size_t len_);
 
+    /**
+     * Метод ожидает появления данных в порту (poll) и за один системный вызов читает всё доступное.
+     * \param  obuf_        Указатель на массив для записи полученных данных.
+     * \param  len_         Доступный размер переданного массива.
+     * \param  timeout_ms_  Таймаут ожидания [миллисекунды], NO_DATA_TIMEOUT - без ограничения.
+     * \return  Количество прочитанных байт; 0 - по таймауту или после interrupt(); -1 в случае ошибки.
+     */
+    int readAvailable(uint8_t *obuf_, size_t len_, int timeout_ms_ = NO_DATA_TIMEOUT);
+
+    /**
+     * Метод прерывает ожидание в readAvailable из другого потока.
+     */
+    void interrupt();
+
     /**
      * Метод возвращает true если порт подключён и готов к объмену, false - в противном случае.
      */